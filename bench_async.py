@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+"""
+Slow-handler load test - dashboard latency while tare and reset are hammered.
+
+Phase 1 measures the dashboard endpoint (/api/status) alone. Phase 2
+repeats the measurement while other clients keep POSTing /api/zero and
+/api/motor/reset, which run on the device's HTTP worker pool. With the
+worker pool, dashboard p99 should stay close to phase 1; the hammer
+clients see 503 once the worker queue is full.
+
+    python3 bench_async.py 192.168.1.50
+    python3 bench_async.py 192.168.1.50 --clients 4 --hammer 4 --duration 20
+
+WARNING: /api/motor/reset stops the motor - run with the cabin empty.
+"""
+
+import argparse
+import http.client
+import sys
+import threading
+import time
+from collections import Counter
+
+from bench_http import run
+
+SLOW_PATHS = ["/api/zero", "/api/motor/reset"]
+
+
+def hammer(host, port, path, deadline, codes, lock):
+    conn = None
+    local = Counter()
+    while time.time() < deadline:
+        try:
+            if conn is None:
+                conn = http.client.HTTPConnection(host, port, timeout=10)
+            conn.request("POST", path, body=b"", headers={"Content-Length": "0"})
+            resp = conn.getresponse()
+            resp.read()
+            local[resp.status] += 1
+            if resp.status == 503:
+                time.sleep(float(resp.getheader("Retry-After", "1")) / 10)
+        except (OSError, http.client.HTTPException):
+            local["error"] += 1
+            if conn is not None:
+                conn.close()
+            conn = None
+            time.sleep(0.05)
+    if conn is not None:
+        conn.close()
+    with lock:
+        codes[path].update(local)
+
+
+def report(label, r):
+    print(f"{label:<18}{r['rps']:>9.1f}{r['mean_ms']:>10.1f}{r['p50_ms']:>9.1f}"
+          f"{r['p99_ms']:>9.1f}{r['errors']:>8}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Dashboard latency under slow-handler load")
+    parser.add_argument("host", help="ESP32 IP address")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--path", default="/api/status", help="Dashboard endpoint to measure")
+    parser.add_argument("--clients", type=int, default=2, help="Dashboard keep-alive clients")
+    parser.add_argument("--hammer", type=int, default=2,
+                        help="Clients per slow endpoint (/api/zero, /api/motor/reset)")
+    parser.add_argument("--duration", type=float, default=10.0, help="Seconds per phase")
+    args = parser.parse_args()
+
+    print(f"📊 {args.path} on http://{args.host}:{args.port} "
+          f"({args.clients} clients, {args.duration:.0f} s per phase)")
+    print(f"{'phase':<18}{'req/s':>9}{'mean ms':>10}{'p50 ms':>9}{'p99 ms':>9}{'errors':>8}")
+
+    idle = run(args.host, args.port, args.path, args.clients, args.duration)
+    report("idle", idle)
+
+    codes = {p: Counter() for p in SLOW_PATHS}
+    lock = threading.Lock()
+    deadline = time.time() + args.duration + 1
+    threads = [threading.Thread(target=hammer, args=(args.host, args.port, p, deadline, codes, lock))
+               for p in SLOW_PATHS for _ in range(args.hammer)]
+    for t in threads:
+        t.start()
+    time.sleep(0.5)  # Let the worker queue fill up
+    loaded = run(args.host, args.port, args.path, args.clients, args.duration)
+    for t in threads:
+        t.join()
+    report("tare+reset load", loaded)
+
+    print("\nSlow endpoint responses:")
+    for path in SLOW_PATHS:
+        c = codes[path]
+        print(f"  {path:<20} 200: {c.get(200, 0):<6} 503: {c.get(503, 0):<6} "
+              f"errors: {c.get('error', 0)}")
+
+    ratio = loaded["p99_ms"] / idle["p99_ms"] if idle["p99_ms"] else 0.0
+    print(f"\n{args.path} p99: {idle['p99_ms']:.1f} ms idle -> {loaded['p99_ms']:.1f} ms "
+          f"under load ({ratio:.1f}x)")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""
+Compare two host benchmark runs (JSON lines from the "bench" target).
+
+Flags every benchmark whose ns/op grew by more than the threshold and exits
+with status 1 if there is one, so it can gate a build before flashing:
+
+    cmake --build build-host --target bench
+    cp build-host/bench_results.json baseline.json       # on the reference commit
+    ...
+    cmake --build build-host --target bench
+    python3 bench_compare.py baseline.json build-host/bench_results.json --threshold 15
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    results = {}
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith("{"):
+                continue
+            r = json.loads(line)
+            if "bench" in r and "ns_per_op" in r:
+                results[r["bench"]] = r
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare host benchmark results")
+    parser.add_argument("baseline", help="JSON lines of the reference run")
+    parser.add_argument("current", help="JSON lines of the run to check")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="Allowed ns/op increase, percent (default 10)")
+    parser.add_argument("--json", action="store_true", help="Print the comparison as JSON")
+    args = parser.parse_args()
+
+    base = load(args.baseline)
+    cur = load(args.current)
+    rows = []
+    for name, r in cur.items():
+        b = base.get(name)
+        if b is None or b["ns_per_op"] <= 0:
+            rows.append({"bench": name, "baseline_ns": None, "current_ns": r["ns_per_op"],
+                         "change_pct": None, "regression": False})
+            continue
+        change = (r["ns_per_op"] - b["ns_per_op"]) / b["ns_per_op"] * 100.0
+        rows.append({"bench": name, "baseline_ns": b["ns_per_op"], "current_ns": r["ns_per_op"],
+                     "change_pct": round(change, 1), "regression": change > args.threshold})
+    missing = sorted(set(base) - set(cur))
+    regressions = [r for r in rows if r["regression"]]
+
+    if args.json:
+        print(json.dumps({"threshold_pct": args.threshold, "results": rows,
+                          "missing": missing, "regressions": len(regressions)}))
+    else:
+        print(f"{'benchmark':<28}{'base ns/op':>12}{'now ns/op':>12}{'change':>9}")
+        for r in rows:
+            base_ns = f"{r['baseline_ns']:.1f}" if r["baseline_ns"] is not None else "-"
+            change = f"{r['change_pct']:+.1f}%" if r["change_pct"] is not None else "new"
+            mark = "  ❌" if r["regression"] else ""
+            print(f"{r['bench']:<28}{base_ns:>12}{r['current_ns']:>12.1f}{change:>9}{mark}")
+        for name in missing:
+            print(f"{name:<28}{'missing from current run':>33}")
+        if regressions:
+            print(f"\n❌ {len(regressions)} benchmark(s) slower by more than {args.threshold:.0f}%")
+        else:
+            print(f"\n✅ No regressions above {args.threshold:.0f}%")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
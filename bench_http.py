@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+"""
+HTTP API benchmark - requests/second and latency of ESP32 endpoints.
+
+Compares endpoints under the same load, e.g. the cached /api/status
+document against the per-request formatted /api/weight:
+
+    python3 bench_http.py 192.168.1.50
+    python3 bench_http.py 192.168.1.50 --clients 4 --duration 20 /api/weight /api/status
+
+With --profiles every WiFi power profile is activated in turn (POST
+/api/wifi/profile) and the endpoints are measured under each one; the
+device's own WebSocket PING/PONG RTT per profile is printed at the end:
+
+    python3 bench_http.py 192.168.1.50 --profiles
+
+Errors are split by kind (connect, reset, timeout, 503 busy, other 4xx/5xx),
+which tells socket exhaustion (resets, refused connects) apart from a slow
+server (timeouts). The same load against the host build of the web server:
+
+    ./build-host/sim_http --serve 8080
+    python3 bench_http.py 127.0.0.1 --port 8080 --clients 16 --json
+"""
+
+import argparse
+import http.client
+import json
+import socket
+import statistics
+import sys
+import threading
+import time
+
+
+ERROR_KINDS = ["connect", "reset", "timeout", "busy_503", "http_4xx", "http_5xx"]
+
+
+def worker(host, port, path, deadline, results, lock):
+    latencies = []
+    errors = dict.fromkeys(ERROR_KINDS, 0)
+    conn = None
+    while time.time() < deadline:
+        try:
+            if conn is None:
+                conn = http.client.HTTPConnection(host, port, timeout=5)
+                try:
+                    conn.connect()
+                except OSError:
+                    errors["connect"] += 1
+                    conn = None
+                    time.sleep(0.05)
+                    continue
+            start = time.perf_counter()
+            conn.request("GET", path)
+            resp = conn.getresponse()
+            resp.read()
+            elapsed = time.perf_counter() - start
+            if resp.status == 200:
+                latencies.append(elapsed)
+            elif resp.status == 503:
+                errors["busy_503"] += 1
+            elif resp.status < 500:
+                errors["http_4xx"] += 1
+            else:
+                errors["http_5xx"] += 1
+        except (OSError, http.client.HTTPException) as e:
+            errors["timeout" if isinstance(e, socket.timeout) else "reset"] += 1
+            if conn is not None:
+                conn.close()
+            conn = None
+            time.sleep(0.05)
+    if conn is not None:
+        conn.close()
+    with lock:
+        results["latencies"].extend(latencies)
+        for kind, n in errors.items():
+            results["error_kinds"][kind] += n
+
+
+def percentile(values, pct):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    k = min(len(values) - 1, int(round(pct / 100.0 * (len(values) - 1))))
+    return values[k]
+
+
+def run(host, port, path, clients, duration):
+    results = {"latencies": [], "error_kinds": dict.fromkeys(ERROR_KINDS, 0)}
+    lock = threading.Lock()
+    deadline = time.time() + duration
+    threads = [threading.Thread(target=worker, args=(host, port, path, deadline, results, lock))
+               for _ in range(clients)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+    lat = results["latencies"]
+    errors = sum(results["error_kinds"].values())
+    return {
+        "path": path,
+        "requests": len(lat),
+        "errors": errors,
+        "error_kinds": results["error_kinds"],
+        "error_rate": errors / (len(lat) + errors) if lat or errors else 0.0,
+        "rps": len(lat) / duration,
+        "p50_ms": percentile(lat, 50) * 1000,
+        "p99_ms": percentile(lat, 99) * 1000,
+        "p999_ms": percentile(lat, 99.9) * 1000,
+        "max_ms": max(lat) * 1000 if lat else 0.0,
+        "mean_ms": statistics.mean(lat) * 1000 if lat else 0.0,
+    }
+
+
+PROFILES = ["low_latency", "balanced", "low_power"]
+
+
+def api(host, port, method, path, body=None):
+    conn = http.client.HTTPConnection(host, port, timeout=5)
+    try:
+        headers = {"Content-Type": "application/json"} if body else {}
+        conn.request(method, path, body=json.dumps(body) if body else None, headers=headers)
+        resp = conn.getresponse()
+        data = resp.read()
+        if resp.status != 200:
+            raise RuntimeError(f"{method} {path}: HTTP {resp.status}")
+        return json.loads(data)
+    finally:
+        conn.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark ESP32 HTTP endpoints")
+    parser.add_argument("host", help="ESP32 IP address")
+    parser.add_argument("paths", nargs="*", default=["/api/weight", "/api/status"],
+                        help="Endpoints to compare (default: /api/weight /api/status)")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--clients", type=int, default=4, help="Concurrent keep-alive clients")
+    parser.add_argument("--duration", type=float, default=10.0, help="Seconds per endpoint")
+    parser.add_argument("--profiles", action="store_true",
+                        help="Repeat the run under each WiFi power profile")
+    parser.add_argument("--json", action="store_true", help="One JSON line per endpoint")
+    args = parser.parse_intermixed_args()
+
+    if args.json:
+        for path in args.paths:
+            print(json.dumps(run(args.host, args.port, path, args.clients, args.duration)))
+        return 0
+
+    print(f"📊 Benchmarking http://{args.host}:{args.port} "
+          f"({args.clients} clients, {args.duration:.0f} s per endpoint)")
+
+    original = None
+    if args.profiles:
+        original = api(args.host, args.port, "GET", "/api/wifi/profile")["profile"]
+
+    try:
+        for profile in (PROFILES if args.profiles else [None]):
+            if profile:
+                api(args.host, args.port, "POST", "/api/wifi/profile", {"profile": profile})
+                time.sleep(2)  # Let power save settle
+                print(f"\n📶 profile: {profile}")
+            print(f"{'endpoint':<22}{'req/s':>9}{'mean ms':>10}{'p50 ms':>9}{'p99 ms':>9}"
+                  f"{'p99.9 ms':>10}{'errors':>8}")
+            for path in args.paths:
+                r = run(args.host, args.port, path, args.clients, args.duration)
+                print(f"{r['path']:<22}{r['rps']:>9.1f}{r['mean_ms']:>10.1f}"
+                      f"{r['p50_ms']:>9.1f}{r['p99_ms']:>9.1f}{r['p999_ms']:>10.1f}{r['errors']:>8}")
+                kinds = ", ".join(f"{k} {n}" for k, n in r["error_kinds"].items() if n)
+                if kinds:
+                    print(f"{'':<22}⚠️  {kinds} ({r['error_rate'] * 100:.1f}%)")
+    finally:
+        if original:
+            api(args.host, args.port, "POST", "/api/wifi/profile", {"profile": original})
+
+    if args.profiles:
+        rtt = api(args.host, args.port, "GET", "/api/wifi/profile")["rtt_us"]
+        print("\nDevice-measured WebSocket RTT (needs an open dashboard or /ws client):")
+        for name in PROFILES:
+            s = rtt.get(name, {})
+            print(f"  {name:<12} n={s.get('count', 0):<5} mean {s.get('mean', 0) / 1000:6.1f} ms"
+                  f"  min {s.get('min', 0) / 1000:6.1f} ms  max {s.get('max', 0) / 1000:6.1f} ms")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
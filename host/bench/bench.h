@@ -0,0 +1,34 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// Minimal timing helpers for host benchmarks. Each result is printed as one
+// JSON object per line so runs can be diffed or collected by scripts.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+static inline uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// extra is an optional JSON fragment such as ",\"points\":100" (or "")
+static inline void bench_report(const char *name, uint64_t ops, uint64_t elapsed_ns,
+                                const char *extra)
+{
+    double ns_per_op = ops ? (double)elapsed_ns / (double)ops : 0.0;
+    printf("{\"bench\":\"%s\",\"ops\":%llu,\"ns_per_op\":%.1f,\"ops_per_sec\":%.0f%s}\n",
+           name, (unsigned long long)ops, ns_per_op,
+           ns_per_op > 0 ? 1e9 / ns_per_op : 0.0, extra ? extra : "");
+}
+
+// Keeps the compiler from optimizing a result away
+static inline void bench_sink(const void *p)
+{
+    __asm__ volatile("" : : "r"(p) : "memory");
+}
+
+#endif // BENCH_H
@@ -0,0 +1,211 @@
+// Hot-path logging cost: the sampling line ("[%d] Weight: %.2f kg | Raw: %ld")
+// formatted the way ESP_LOGI does it against DLOGI storing it into the
+// deferred ring, plus the formatting the drain task does later. The
+// immediate number is formatting only; on the device ESP_LOGI also blocks
+// on the UART once its FIFO is full (uart_us_per_line at 115200 baud).
+//
+// Also checks deferred_log_format() against snprintf, and runs N producer
+// threads against a draining consumer: every record must be either drained
+// or counted as dropped.
+//
+//   ./bench_deferred_log [threads] [seconds]
+
+#include "bench.h"
+#include "deferred_log.h"
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UART_BAUD 115200
+
+static const char *TAG = "BENCH";
+
+static char expect[DEFERRED_LOG_LINE_MAX];
+
+static int check(const char *fmt, int nargs, const deferred_arg_t *args)
+{
+    deferred_log_record_t rec = { .fmt = fmt, .nargs = (uint8_t)nargs };
+    memcpy(rec.args, args, (size_t)nargs * sizeof(deferred_arg_t));
+    char got[DEFERRED_LOG_LINE_MAX];
+    deferred_log_format(&rec, got, sizeof(got));
+    if (strcmp(expect, got) != 0) {
+        printf("❌ \"%s\": expected \"%s\", got \"%s\"\n", fmt, expect, got);
+        return 1;
+    }
+    return 0;
+}
+
+#define CASE0(fmt) \
+    (snprintf(expect, sizeof(expect), fmt), check(fmt, 0, NULL))
+#define CASE1(fmt, a) \
+    (snprintf(expect, sizeof(expect), fmt, a), \
+     check(fmt, 1, (deferred_arg_t[]){ DEFERRED_ARG(a) }))
+#define CASE2(fmt, a, b) \
+    (snprintf(expect, sizeof(expect), fmt, a, b), \
+     check(fmt, 2, (deferred_arg_t[]){ DEFERRED_ARG(a), DEFERRED_ARG(b) }))
+#define CASE3(fmt, a, b, c) \
+    (snprintf(expect, sizeof(expect), fmt, a, b, c), \
+     check(fmt, 3, (deferred_arg_t[]){ DEFERRED_ARG(a), DEFERRED_ARG(b), DEFERRED_ARG(c) }))
+#define CASE4(fmt, a, b, c, d) \
+    (snprintf(expect, sizeof(expect), fmt, a, b, c, d), \
+     check(fmt, 4, (deferred_arg_t[]){ DEFERRED_ARG(a), DEFERRED_ARG(b), DEFERRED_ARG(c), \
+                                       DEFERRED_ARG(d) }))
+
+static int check_format(void)
+{
+    int failures = 0;
+    failures += CASE3("[%d] Weight: %.2f kg | Raw: %ld", 42, 12.345f, -123456L);
+    failures += CASE2("🛑 Motor stopped - weight %.2f kg < threshold %.2f kg", 0.5f, 1.0f);
+    failures += CASE3("%5.1f|%-6d|%06u", 3.14159, -7, 42u);
+    failures += CASE4("%s=%x/%X/%#o", "duty", 255u, 0xABCDu, 8u);
+    failures += CASE1("%lld ms", -9000000000LL);
+    failures += CASE1("%llu", 18000000000000000000ULL);
+    failures += CASE2("%hhd %hu", 300, 70000);
+    failures += CASE1("%zu bytes", (size_t)1234);
+    failures += CASE2("%c%c", 'o', 'k');
+    failures += CASE1("%.3e", 12345.678);
+    failures += CASE1("%+g", 0.0001);
+    failures += CASE1("100%% %s", "done");
+    failures += CASE1("%" PRId32, (int32_t)-5);
+    failures += CASE1("%" PRIu32, (uint32_t)4000000000u);
+    failures += CASE1("%lu", 4000000000UL);
+    failures += CASE0("⚠️  Unusual reading - check sensor or calibration!");
+
+    // Lines longer than DEFERRED_LOG_LINE_MAX are cut like snprintf does
+    char *long_text = malloc(DEFERRED_LOG_LINE_MAX);
+    memset(long_text, 'x', DEFERRED_LOG_LINE_MAX - 1);
+    long_text[DEFERRED_LOG_LINE_MAX - 1] = '\0';
+    failures += CASE2("%s%s", long_text, long_text);
+    free(long_text);
+    return failures;
+}
+
+static atomic_bool stop_flag;
+static atomic_ullong attempts;
+
+static void *producer(void *arg)
+{
+    unsigned long long n = 0;
+    while (!atomic_load_explicit(&stop_flag, memory_order_relaxed)) {
+        DLOGI(TAG, "[%d] Weight: %.2f kg | Raw: %ld", (int)n, 12.5f, (long)n);
+        n++;
+    }
+    atomic_fetch_add(&attempts, n);
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    while (!atomic_load_explicit(&stop_flag, memory_order_relaxed)) {
+        if (deferred_log_flush() == 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    int threads = argc > 1 ? atoi(argv[1]) : 2;
+    double seconds = argc > 2 ? atof(argv[2]) : 1.0;
+    if (threads < 1 || threads > 16) {
+        threads = 2;
+    }
+    // Records are drained without printing (the filter runs before formatting)
+    sim_log_level = ESP_LOG_NONE;
+
+    int failures = check_format();
+    if (failures) {
+        printf("❌ %d format mismatches\n", failures);
+        return 1;
+    }
+
+    // ESP_LOGI-style: prefix + message formatted on the calling task
+    const int ops = 200000;
+    char line[DEFERRED_LOG_LINE_MAX];
+    size_t bytes = 0;
+    uint64_t t0 = bench_now_ns();
+    for (int i = 0; i < ops; i++) {
+        int n = snprintf(line, sizeof(line), "I (%lu) %s: [%d] Weight: %.2f kg | Raw: %ld\n",
+                         (unsigned long)i * 1000, TAG, i, 12.5f + i * 0.01f, 8388000L + i);
+        bench_sink(line);
+        bytes += (size_t)n;
+    }
+    char extra[160];
+    double line_bytes = (double)bytes / ops;
+    snprintf(extra, sizeof(extra), ",\"bytes_per_line\":%.1f,\"uart_us_per_line\":%.0f",
+             line_bytes, line_bytes * 10 * 1e6 / UART_BAUD);
+    bench_report("log_immediate_format", ops, bench_now_ns() - t0, extra);
+
+    // DLOGI: batches that fit the ring, drained between batches (untimed)
+    uint64_t elapsed = 0;
+    int done = 0;
+    while (done < ops) {
+        t0 = bench_now_ns();
+        for (int i = 0; i < DEFERRED_LOG_RING_LEN; i++, done++) {
+            DLOGI(TAG, "[%d] Weight: %.2f kg | Raw: %ld", done, 12.5f + done * 0.01f,
+                  8388000L + done);
+        }
+        elapsed += bench_now_ns() - t0;
+        deferred_log_flush();
+    }
+    deferred_log_stats_t st;
+    deferred_log_get_stats(&st);
+    snprintf(extra, sizeof(extra), ",\"record_bytes\":%zu,\"dropped\":%u",
+             sizeof(deferred_log_record_t), (unsigned)st.dropped);
+    bench_report("dlogi_record", (uint64_t)done, elapsed, extra);
+
+    // What the drain task pays later, per record
+    deferred_log_record_t rec = {
+        .fmt = "[%d] Weight: %.2f kg | Raw: %ld", .nargs = 3,
+        .args = { DEFERRED_ARG(42), DEFERRED_ARG(12.5f), DEFERRED_ARG(8388608L) }
+    };
+    t0 = bench_now_ns();
+    for (int i = 0; i < ops; i++) {
+        rec.args[0].i = i;
+        deferred_log_format(&rec, line, sizeof(line));
+        bench_sink(line);
+    }
+    bench_report("deferred_log_format", ops, bench_now_ns() - t0, "");
+
+    // Producers on every thread against one draining consumer
+    deferred_log_stats_t before;
+    deferred_log_get_stats(&before);
+    pthread_t tid[17];
+    pthread_create(&tid[threads], NULL, consumer, NULL);
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&tid[i], NULL, producer, NULL);
+    }
+    t0 = bench_now_ns();
+    while (bench_now_ns() - t0 < (uint64_t)(seconds * 1e9)) {
+        usleep(10000);
+    }
+    atomic_store(&stop_flag, true);
+    for (int i = 0; i <= threads; i++) {
+        pthread_join(tid[i], NULL);
+    }
+    elapsed = bench_now_ns() - t0;
+    deferred_log_flush();
+    deferred_log_get_stats(&st);
+
+    uint64_t total = atomic_load(&attempts);
+    uint32_t written = st.written - before.written;
+    uint32_t dropped = st.dropped - before.dropped;
+    uint32_t drained = st.drained - before.drained;
+    snprintf(extra, sizeof(extra),
+             ",\"threads\":%d,\"written\":%u,\"dropped\":%u,\"drained\":%u,\"high_water\":%u",
+             threads, (unsigned)written, (unsigned)dropped, (unsigned)drained,
+             (unsigned)st.high_water);
+    bench_report("dlogi_contended", total, elapsed, extra);
+    if (written + (uint64_t)dropped != total || drained != written) {
+        printf("❌ Records lost: %llu attempts, %u written, %u dropped, %u drained\n",
+               (unsigned long long)total, (unsigned)written, (unsigned)dropped, (unsigned)drained);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+// Benchmark for the on-device history store (main/history.c):
+// sample insert cost and /api/history query cost per tier.
+
+#include "bench.h"
+#include "history.h"
+#include <math.h>
+
+#define SAMPLE_PERIOD_MS 100                     // 10 SPS, HX711 default rate
+#define FILL_MS (7LL * 24 * 3600 * 1000)         // One week of samples
+
+static history_point_t out[HISTORY_MAX_POINTS];
+
+static float synthetic_weight(int64_t t_ms)
+{
+    // Slow load changes plus sensor noise
+    return 2.0f + 1.5f * sinf((float)t_ms / 600000.0f) + 0.01f * (float)((t_ms * 7919) % 100);
+}
+
+static void bench_query(const char *name, int64_t now_ms, int64_t span_ms, size_t points)
+{
+    const int iters = 2000;
+    history_tier_t tier = HISTORY_TIER_RAW;
+    size_t n = 0;
+
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < iters; i++) {
+        n = history_query(now_ms - span_ms, now_ms, points, out, &tier);
+        bench_sink(out);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    char extra[96];
+    snprintf(extra, sizeof(extra), ",\"tier\":\"%s\",\"points\":%zu", history_tier_name(tier), n);
+    bench_report(name, iters, elapsed, extra);
+}
+
+int main(void)
+{
+    history_reset();
+
+    int64_t t = 0;
+    uint64_t samples = 0;
+    uint64_t start = bench_now_ns();
+    for (t = 0; t < FILL_MS; t += SAMPLE_PERIOD_MS) {
+        history_add(t, synthetic_weight(t));
+        samples++;
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    char extra[64];
+    snprintf(extra, sizeof(extra), ",\"memory_bytes\":%zu", history_memory_bytes());
+    bench_report("history_add", samples, elapsed, extra);
+
+    int64_t now = t - SAMPLE_PERIOD_MS;
+    bench_query("history_query_raw_20s", now, 20 * 1000, 100);
+    bench_query("history_query_1s_5min", now, 5 * 60 * 1000, 100);
+    bench_query("history_query_1m_6h", now, 6 * 3600 * 1000, 200);
+    bench_query("history_query_1h_7d", now, 7 * 24 * 3600 * 1000LL, 100);
+    return 0;
+}
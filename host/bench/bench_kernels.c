@@ -0,0 +1,172 @@
+// Benchmark for the per-sample hot path of the firmware: HX711 24-bit
+// decode and sign extension, raw-to-kg conversion, the Modbus RTU CRC of
+// the DRI0050 frames and the whole sample stage (average of
+// READINGS_PER_SAMPLE conversions as in hx711_read_average, conversion to
+// kg and the auto-control decision). JSON formatting and the history
+// downsampler are covered by bench_telemetry and bench_history.
+
+#include "bench.h"
+#include "control_policy.h"
+#include "hx711.h"
+#include "hx711_config.h"
+#include "modbus_crc.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAMES 1000000            // Conversions per run
+#define CRC_FRAMES 1000000
+#define CRC_BLOCK 256
+
+static uint8_t frames[FRAMES][3];
+
+// Load-cell-like signal around zero (both signs) plus LSB noise, encoded
+// the way the HX711 shifts it out (data[2] = MSB)
+static void make_frames(void)
+{
+    uint32_t seed = 12345;
+    for (int i = 0; i < FRAMES; i++) {
+        seed = seed * 1103515245u + 12345u;
+        int32_t raw = (int32_t)(300000.0f * sinf(i / 5000.0f)) + (int32_t)((seed >> 16) & 0xFF) - 128;
+        uint32_t u = (uint32_t)raw & 0xFFFFFF;
+        frames[i][0] = (uint8_t)u;
+        frames[i][1] = (uint8_t)(u >> 8);
+        frames[i][2] = (uint8_t)(u >> 16);
+    }
+}
+
+static int check_decode(void)
+{
+    static const struct { uint8_t data[3]; int32_t value; } cases[] = {
+        { { 0x00, 0x00, 0x00 }, 0 },
+        { { 0xFF, 0xFF, 0x7F }, 0x7FFFFF },
+        { { 0x00, 0x00, 0x80 }, -0x800000 },
+        { { 0xFF, 0xFF, 0xFF }, -1 },
+        { { 0x30, 0x96, 0xFE }, -92624 },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        int32_t v = hx711_decode_raw(cases[i].data);
+        if (v != cases[i].value) {
+            fprintf(stderr, "hx711_decode_raw case %zu: got %ld, want %ld\n",
+                    i, (long)v, (long)cases[i].value);
+            return 1;
+        }
+    }
+    // Modbus check value of "123456789"
+    if (modbus_crc16((const uint8_t *)"123456789", 9) != 0x4B37) {
+        fprintf(stderr, "modbus_crc16 check value mismatch\n");
+        return 1;
+    }
+    return 0;
+}
+
+static void bench_decode(void)
+{
+    int64_t sum = 0;
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < FRAMES; i++) {
+        sum += hx711_decode_raw(frames[i]);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    bench_sink(&sum);
+    bench_report("hx711_decode", FRAMES, elapsed, "");
+}
+
+static void bench_units(const hx711_t *scale)
+{
+    static long raws[FRAMES];
+    for (int i = 0; i < FRAMES; i++) {
+        raws[i] = hx711_decode_raw(frames[i]);
+    }
+    float sum = 0.0f;
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < FRAMES; i++) {
+        sum += hx711_raw_to_units(scale, raws[i]);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    bench_sink(&sum);
+    bench_report("hx711_raw_to_units", FRAMES, elapsed, "");
+}
+
+static void bench_crc(void)
+{
+    // DRI0050 write-register frame: CRC over the first 6 bytes
+    uint8_t frame[8] = { 0x32, 0x06, 0x00, 0x06, 0x01, 0xF4 };
+    uint32_t acc = 0;
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < CRC_FRAMES; i++) {
+        frame[5] = (uint8_t)i;
+        uint16_t crc = modbus_crc16(frame, 6);
+        frame[6] = crc & 0xFF;
+        frame[7] = crc >> 8;
+        acc += crc;
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    bench_sink(&acc);
+    char extra[64];
+    snprintf(extra, sizeof(extra), ",\"bytes\":6,\"mb_per_sec\":%.1f",
+             6.0 * CRC_FRAMES / ((double)elapsed / 1e9) / 1e6);
+    bench_report("modbus_crc16_frame", CRC_FRAMES, elapsed, extra);
+
+    // Bulk throughput
+    static uint8_t block[CRC_BLOCK];
+    for (int i = 0; i < CRC_BLOCK; i++) {
+        block[i] = (uint8_t)(i * 31 + 7);
+    }
+    int blocks = CRC_FRAMES / 32;
+    start = bench_now_ns();
+    for (int i = 0; i < blocks; i++) {
+        block[0] = (uint8_t)i;
+        acc += modbus_crc16(block, CRC_BLOCK);
+    }
+    elapsed = bench_now_ns() - start;
+    bench_sink(&acc);
+    snprintf(extra, sizeof(extra), ",\"bytes\":%d,\"mb_per_sec\":%.1f",
+             CRC_BLOCK, (double)CRC_BLOCK * blocks / ((double)elapsed / 1e9) / 1e6);
+    bench_report("modbus_crc16_256b", blocks, elapsed, extra);
+}
+
+// One published sample: READINGS_PER_SAMPLE conversions averaged the way
+// hx711_read_average does, converted to kg and run through the policy
+static void bench_sample_stage(const hx711_t *scale)
+{
+    elevator_state_t st = {
+        .auto_mode = true, .threshold = CONTROL_DEFAULT_THRESHOLD, .stable = true
+    };
+    int samples = FRAMES / READINGS_PER_SAMPLE;
+    int actions = 0;
+    uint64_t start = bench_now_ns();
+    for (int s = 0; s < samples; s++) {
+        long sum = 0;
+        for (int i = 0; i < READINGS_PER_SAMPLE; i++) {
+            sum += hx711_decode_raw(frames[s * READINGS_PER_SAMPLE + i]);
+        }
+        st.raw = sum / READINGS_PER_SAMPLE;
+        st.weight = hx711_raw_to_units(scale, st.raw);
+        control_action_t action = control_policy_decide(&st);
+        if (action != CONTROL_ACTION_NONE) {
+            st.motor_triggered = action == CONTROL_ACTION_START;
+            actions++;
+        }
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    bench_sink(&st);
+    char extra[64];
+    snprintf(extra, sizeof(extra), ",\"readings\":%d,\"actions\":%d", READINGS_PER_SAMPLE, actions);
+    bench_report("sample_stage", samples, elapsed, extra);
+}
+
+int main(void)
+{
+    if (check_decode() != 0) {
+        return 1;
+    }
+    make_frames();
+
+    hx711_t scale = { .offset = HX711_OFFSET, .scale = HX711_CALIBRATION_FACTOR };
+    bench_decode();
+    bench_units(&scale);
+    bench_crc();
+    bench_sample_stage(&scale);
+    return 0;
+}
@@ -0,0 +1,198 @@
+// Load estimator: cost of load_estimator_update() and the accuracy of the
+// modelled cabin response at the corners of the accepted model range
+// (cabin_model_valid()). The response is checked against an RK4
+// integration in double precision with a step well under both the
+// resonance period and the drive time constant. Fails if a window is off
+// by more than 0.1 % of the peak response. The cost per model is only
+// reported (bench_compare.py catches regressions): wall-clock time is
+// too noisy on a shared host to pass or fail a test.
+//
+//   ./bench_load_estimator
+
+#include "bench.h"
+#include "load_estimator.h"
+#include <math.h>
+#include <string.h>
+
+#define UPDATES 20000
+#define TIMING_RUNS 3
+#define CHANGE_US 1000000000LL
+
+typedef struct {
+    const char *name;
+    float cell_hz;
+    float cell_damping;
+    float accel_ms;
+} model_case_t;
+
+static const model_case_t cases[] = {
+    { "default", CABIN_MODEL_CELL_HZ, CABIN_MODEL_CELL_DAMPING, CABIN_MODEL_ACCEL_MS },
+    { "soft_platform", 1.5f, 0.05f, 15.0f },
+    { "slow_ringing_slow_drive", 0.1f, 0.01f, 10000.0f },
+    { "slow_ringing_fast_drive", 0.1f, 0.01f, 1.0f },
+    { "fast_ringing_fast_drive", 100.0f, 0.01f, 1.0f },
+    { "fast_ringing_slow_drive", 100.0f, 0.01f, 10000.0f },
+    { "overdamped_fast_drive", 0.1f, 2.0f, 1.0f },
+    { "overdamped_slow_drive", 100.0f, 2.0f, 10000.0f },
+};
+#define CASE_COUNT (sizeof(cases) / sizeof(cases[0]))
+
+static cabin_model_t make_model(const model_case_t *c)
+{
+    cabin_model_t m;
+    cabin_model_default(&m);
+    m.cell_hz = c->cell_hz;
+    m.cell_damping = c->cell_damping;
+    m.accel_ms = c->accel_ms;
+    return m;
+}
+
+// Same as settle_time() in load_estimator.c
+static double settle_s(const cabin_model_t *m)
+{
+    double w0 = 2.0 * M_PI * m->cell_hz;
+    return LOAD_ESTIMATOR_SETTLED * (m->accel_ms / 1000.0 + 1.0 / (m->cell_damping * w0));
+}
+
+// y'' + 2 zeta w0 y' + w0^2 y = w0^2 u, u = a / g decaying with tau;
+// returns the mean of y over [t0, t1] (y = 0 before the change)
+static double reference_response(const cabin_model_t *m, double t0, double t1)
+{
+    double w0 = 2.0 * M_PI * m->cell_hz;
+    double zeta = m->cell_damping;
+    double tau = m->accel_ms / 1000.0;
+    double h = fmin(0.02 / w0, tau / 20.0);
+    double start = t0 > 0.0 ? t0 : 0.0;
+    double end = fmin(t1, settle_s(m));
+    double z[4] = { 0.0, 0.0, m->speed_mps / (tau * 9.81), 0.0 };   // y, y', u, integral
+    double area0 = 0.0;
+    bool at_start = start == 0.0;
+    double t = 0.0;
+
+    while (t < end) {
+        double step = fmin(h, end - t);
+        if (!at_start && t + step >= start) {
+            step = start - t;
+        }
+        double k[4][4];
+        double s[4];
+        for (int stage = 0; stage < 4; stage++) {
+            double c = stage == 0 ? 0.0 : (stage == 3 ? 1.0 : 0.5);
+            for (int i = 0; i < 4; i++) {
+                s[i] = z[i] + (stage == 0 ? 0.0 : c * step * k[stage - 1][i]);
+            }
+            k[stage][0] = s[1];
+            k[stage][1] = w0 * w0 * (s[2] - s[0]) - 2.0 * zeta * w0 * s[1];
+            k[stage][2] = -s[2] / tau;
+            k[stage][3] = s[0];
+        }
+        for (int i = 0; i < 4; i++) {
+            z[i] += step / 6.0 * (k[0][i] + 2.0 * k[1][i] + 2.0 * k[2][i] + k[3][i]);
+        }
+        t += step;
+        if (!at_start && t >= start) {
+            area0 = z[3];
+            at_start = true;
+        }
+    }
+    return (z[3] - area0) / (t1 - t0);
+}
+
+static float update_at(double t0, double t1)
+{
+    motor_motion_t motion = {
+        .state = MOTOR_STATE_FORWARD,
+        .previous = MOTOR_STATE_STOPPED,
+        .duty = 255,
+        .change_us = CHANGE_US
+    };
+    load_estimator_update(1.0f, CHANGE_US + (int64_t)(t0 * 1e6), CHANGE_US + (int64_t)(t1 * 1e6),
+                          &motion);
+    load_estimate_t e;
+    load_estimator_get(&e);
+    return e.response;
+}
+
+// Sample windows relative to the change: across it, during the drive
+// ramp, in the ring-down and halfway to settled
+static int windows(const cabin_model_t *m, double out[][2])
+{
+    double settle = settle_s(m);
+    double tau = m->accel_ms / 1000.0;
+    out[0][0] = -0.1;           out[0][1] = 0.2;
+    out[1][0] = 0.5 * tau;      out[1][1] = 2.0 * tau + 0.3;
+    out[2][0] = 0.1 * settle;   out[2][1] = 0.1 * settle + 0.6;
+    out[3][0] = 0.5 * settle;   out[3][1] = 0.5 * settle + 0.6;
+    return 4;
+}
+
+static int check_accuracy(const model_case_t *c)
+{
+    cabin_model_t m = make_model(c);
+    if (!cabin_model_valid(&m)) {
+        printf("❌ %s: model rejected\n", c->name);
+        return 1;
+    }
+    load_estimator_set_model(&m);
+
+    double w[4][2];
+    int n = windows(&m, w);
+    double ref[4];
+    float got[4];
+    double peak = 0.0;
+    for (int i = 0; i < n; i++) {
+        ref[i] = reference_response(&m, w[i][0], w[i][1]);
+        got[i] = update_at(w[i][0], w[i][1]);
+        peak = fmax(peak, fabs(ref[i]));
+    }
+    int failed = 0;
+    for (int i = 0; i < n; i++) {
+        double err = fabs(got[i] - ref[i]);
+        if (err > 1e-3 * peak + 1e-7) {
+            printf("❌ %s: window [%.3f, %.3f] s response %.6g, reference %.6g\n",
+                   c->name, w[i][0], w[i][1], got[i], ref[i]);
+            failed = 1;
+        }
+    }
+    return failed;
+}
+
+// Cost per update, cycling through the case's windows (best of
+// TIMING_RUNS, so a busy host skews the report less)
+static void time_updates(const model_case_t *c)
+{
+    cabin_model_t m = make_model(c);
+    load_estimator_set_model(&m);
+    double w[4][2];
+    int n = windows(&m, w);
+    float sink = 0.0f;
+    uint64_t elapsed = UINT64_MAX;
+
+    for (int run = 0; run < TIMING_RUNS; run++) {
+        uint64_t t0 = bench_now_ns();
+        for (int i = 0; i < UPDATES; i++) {
+            sink += update_at(w[i % n][0], w[i % n][1]);
+        }
+        uint64_t t = bench_now_ns() - t0;
+        if (t < elapsed) {
+            elapsed = t;
+        }
+    }
+    bench_sink(&sink);
+
+    char name[64];
+    snprintf(name, sizeof(name), "load_update_%s", c->name);
+    bench_report(name, UPDATES, elapsed, "");
+}
+
+int main(void)
+{
+    int failed = 0;
+    for (size_t i = 0; i < CASE_COUNT; i++) {
+        failed |= check_accuracy(&cases[i]);
+    }
+    for (size_t i = 0; i < CASE_COUNT; i++) {
+        time_updates(&cases[i]);
+    }
+    return failed;
+}
@@ -0,0 +1,138 @@
+// Metrics hot-path cost: histogram observe and counter increment, single
+// threaded and with N threads hammering the same histogram. Checks that
+// no update is lost (rendered _count and _sum match the observations; the
+// sum passes 2^32 us, so the carry into the high word is exercised too)
+// and reports the render time and size of the /metrics text.
+//
+//   ./bench_metrics [threads]
+
+#include "bench.h"
+#include "metrics.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OPS_PER_THREAD 2000000
+
+static uint32_t next_value(uint32_t *seed)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return *seed >> 12;     // 0..1 s
+}
+
+static void *observer(void *arg)
+{
+    uint32_t seed = (uint32_t)(uintptr_t)arg * 2654435761u;
+    for (int i = 0; i < OPS_PER_THREAD; i++) {
+        metrics_observe(METRIC_SAMPLE_TO_DECISION, next_value(&seed));
+    }
+    return NULL;
+}
+
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+} text_t;
+
+static void text_write(void *ctx, const char *data, size_t len)
+{
+    text_t *t = ctx;
+    if (t->len + len + 1 > t->cap) {
+        t->cap = (t->len + len + 1) * 2;
+        t->buf = realloc(t->buf, t->cap);
+    }
+    memcpy(t->buf + t->len, data, len);
+    t->len += len;
+    t->buf[t->len] = '\0';
+}
+
+static unsigned long long rendered_count(const char *text, const char *name)
+{
+    char key[96];
+    snprintf(key, sizeof(key), "\n%s_count ", name);
+    const char *p = strstr(text, key);
+    return p ? strtoull(p + strlen(key), NULL, 10) : 0;
+}
+
+// _sum in microseconds
+static unsigned long long rendered_sum_us(const char *text, const char *name)
+{
+    char key[96];
+    snprintf(key, sizeof(key), "\n%s_sum ", name);
+    const char *p = strstr(text, key);
+    return p ? (unsigned long long)(strtod(p + strlen(key), NULL) * 1e6 + 0.5) : 0;
+}
+
+int main(int argc, char **argv)
+{
+    int threads = argc > 1 ? atoi(argv[1]) : 4;
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    // Single thread, uncontended
+    uint64_t t0 = bench_now_ns();
+    for (uint32_t i = 0; i < OPS_PER_THREAD; i++) {
+        metrics_observe(METRIC_HX711_CONVERSION, (i * 37u) % 200000u);
+    }
+    bench_report("histogram_observe", OPS_PER_THREAD, bench_now_ns() - t0, "");
+
+    t0 = bench_now_ns();
+    for (uint32_t i = 0; i < OPS_PER_THREAD; i++) {
+        metrics_count(METRIC_HX711_TIMEOUTS);
+    }
+    bench_report("counter_inc", OPS_PER_THREAD, bench_now_ns() - t0, "");
+
+    int slot = metrics_http_register("/api/status", "GET");
+    t0 = bench_now_ns();
+    for (uint32_t i = 0; i < OPS_PER_THREAD; i++) {
+        metrics_http_observe(slot, i & 0xFFFF);
+    }
+    bench_report("http_observe", OPS_PER_THREAD, bench_now_ns() - t0, "");
+
+    // Contended: all threads on one histogram
+    pthread_t tid[64];
+    if (threads > 64) {
+        threads = 64;
+    }
+    t0 = bench_now_ns();
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&tid[i], NULL, observer, (void *)(uintptr_t)(i + 1));
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tid[i], NULL);
+    }
+    char extra[64];
+    snprintf(extra, sizeof(extra), ",\"threads\":%d", threads);
+    bench_report("histogram_observe_contended", (uint64_t)threads * OPS_PER_THREAD,
+                 bench_now_ns() - t0, extra);
+
+    // Render
+    text_t text = { NULL, 0, 0 };
+    t0 = bench_now_ns();
+    metrics_render(text_write, &text);
+    snprintf(extra, sizeof(extra), ",\"bytes\":%zu", text.len);
+    bench_report("render", 1, bench_now_ns() - t0, extra);
+
+    unsigned long long want = (unsigned long long)threads * OPS_PER_THREAD;
+    unsigned long long got = rendered_count(text.buf, "elevator_sample_to_decision_seconds");
+    unsigned long long want_sum = 0;
+    for (int i = 0; i < threads; i++) {
+        uint32_t seed = (uint32_t)(uintptr_t)(i + 1) * 2654435761u;
+        for (int j = 0; j < OPS_PER_THREAD; j++) {
+            want_sum += next_value(&seed);
+        }
+    }
+    unsigned long long got_sum = rendered_sum_us(text.buf, "elevator_sample_to_decision_seconds");
+    free(text.buf);
+    if (got != want) {
+        printf("❌ lost updates: rendered count %llu, expected %llu\n", got, want);
+        return 1;
+    }
+    if (got_sum != want_sum) {
+        printf("❌ lost updates: rendered sum %llu us, expected %llu us\n", got_sum, want_sum);
+        return 1;
+    }
+    return 0;
+}
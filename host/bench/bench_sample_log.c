@@ -0,0 +1,249 @@
+// Benchmark for the flash sample log (sample_log.c) on a file-backed
+// partition image with NOR semantics (sim_partition.c), sized like the
+// "samplelog" entry of partitions.csv. A 10 Hz synthetic signal (HX711
+// noise, load steps, motor trips, tares, timing jitter) runs the log
+// through several laps of the partition, then:
+//
+//   sample_log_add      cost per sample (CPU without image I/O), bytes per
+//                       sample and the flash traffic / erase rate it causes
+//   sample_log_recover  sample_log_init() on the full image (boot cost),
+//                       also after a torn block write
+//   sample_log_read     download of the whole log, decoded and checked
+//                       sample by sample against the generator
+//
+// Usage: bench_sample_log [image]   (default sample_log.img, recreated)
+
+#include "bench.h"
+#include "esp_partition.h"
+#include "sample_log.h"
+#include "sim_partition.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define PARTITION_ADDRESS 0x190000  // partitions.csv
+#define PARTITION_SIZE 0x270000
+#define SAMPLE_MS 100
+#define LAPS 3
+#define LOAD_STEP_SAMPLES 3000      // New load every 5 minutes
+#define TARE_SAMPLES 500000         // Calibration offset changes
+#define SCALE 21.5f
+#define FLASH_ENDURANCE 100000      // Erase cycles per sector
+#define DEVICE_SAMPLE_MS 2000       // UPDATE_INTERVAL_MS
+
+static uint32_t hash(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+typedef struct {
+    int64_t t_ms;
+    int32_t raw;
+    uint8_t state;
+    int32_t offset;
+} gen_sample_t;
+
+static void generate(uint32_t i, gen_sample_t *s)
+{
+    uint32_t h = hash(i);
+    uint32_t step = i / LOAD_STEP_SAMPLES;
+    s->offset = 84000 + (int32_t)(i / TARE_SAMPLES) * 150;
+    int32_t load = (int32_t)(hash(step) % 200000);
+    s->t_ms = (int64_t)i * SAMPLE_MS + (h % 50 == 0 ? 1 : 0);
+    s->raw = s->offset + load + (int32_t)(h & 0x7F) - 64;
+
+    // A trip in the first tenth of every other load step
+    bool trip = (step & 1) && (i % LOAD_STEP_SAMPLES) < LOAD_STEP_SAMPLES / 10;
+    s->state = SAMPLE_LOG_STATE_AUTO_MODE;
+    if (trip) {
+        s->state |= 1 | SAMPLE_LOG_STATE_TRIGGERED;     // MOTOR_FORWARD
+    }
+    if (h % 100000 != 0) {
+        s->state |= SAMPLE_LOG_STATE_SENSOR_OK;
+    }
+}
+
+static void log_sample(uint32_t i)
+{
+    gen_sample_t s;
+    generate(i, &s);
+    sample_log_set_calibration(SCALE, s.offset);
+    sample_log_add(s.t_ms, s.raw, s.state);
+}
+
+typedef struct {
+    uint32_t total;         // Samples logged
+    uint32_t next;          // Generator index of the next expected sample
+    uint32_t checked;
+    uint32_t errors;
+    uint32_t blocks;
+    uint64_t bytes;
+    uint32_t last_seq;
+} verify_t;
+
+static void verify_entry(void *ctx, const sample_log_entry_t *e)
+{
+    verify_t *v = ctx;
+    if (v->checked == 0) {
+        // First retained sample: find it by time (t = i * SAMPLE_MS + jitter)
+        v->next = (uint32_t)(e->t_ms / SAMPLE_MS);
+    }
+    gen_sample_t s;
+    generate(v->next, &s);
+    if (e->t_ms != s.t_ms || e->raw != s.raw || e->state != s.state ||
+        e->offset != s.offset || e->scale != SCALE) {
+        if (v->errors++ < 5) {
+            fprintf(stderr, "sample %u: got t=%lld raw=%ld state=0x%02x offset=%ld, "
+                    "want t=%lld raw=%ld state=0x%02x offset=%ld\n", v->next,
+                    (long long)e->t_ms, (long)e->raw, e->state, (long)e->offset,
+                    (long long)s.t_ms, (long)s.raw, s.state, (long)s.offset);
+        }
+    }
+    v->next++;
+    v->checked++;
+}
+
+static bool verify_block(void *ctx, const uint8_t *block, size_t len)
+{
+    verify_t *v = ctx;
+    uint32_t seq = (uint32_t)block[4] | (uint32_t)block[5] << 8 |
+                   (uint32_t)block[6] << 16 | (uint32_t)block[7] << 24;
+    if (v->blocks > 0 && seq <= v->last_seq) {
+        fprintf(stderr, "block %u after %u: out of order\n", seq, v->last_seq);
+        v->errors++;
+    }
+    v->last_seq = seq;
+    if (sample_log_decode(block, len, verify_entry, v) != len) {
+        fprintf(stderr, "block %u does not decode\n", seq);
+        v->errors++;
+    }
+    v->blocks++;
+    v->bytes += len;
+    return true;
+}
+
+static int read_back(uint32_t total, uint64_t *elapsed, verify_t *v)
+{
+    memset(v, 0, sizeof(*v));
+    v->total = total;
+    uint64_t start = bench_now_ns();
+    sample_log_read(0, verify_block, v);
+    *elapsed = bench_now_ns() - start;
+    if (v->errors > 0) {
+        fprintf(stderr, "read back: %u errors\n", v->errors);
+        return 1;
+    }
+    if (v->next != total) {
+        fprintf(stderr, "read back ends at sample %u, logged %u\n", v->next, total);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = argc > 1 ? argv[1] : "sample_log.img";
+    remove(path);
+    if (!sim_partition_attach(SAMPLE_LOG_PARTITION_LABEL, 0x01, SAMPLE_LOG_PARTITION_SUBTYPE,
+                              PARTITION_ADDRESS, PARTITION_SIZE, path) ||
+        !sample_log_init()) {
+        fprintf(stderr, "cannot set up %s\n", path);
+        return 1;
+    }
+    sample_log_stats_t st;
+    sample_log_get_stats(&st);
+
+    // Enough samples for LAPS laps at 2 bytes per sample
+    uint32_t total = st.capacity_blocks *
+                     ((SAMPLE_LOG_BLOCK_SIZE - SAMPLE_LOG_HEADER_SIZE) / 2) * LAPS;
+
+    sim_partition_reset_stats();
+    uint64_t start = bench_now_ns();
+    for (uint32_t i = 0; i < total; i++) {
+        log_sample(i);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    sim_partition_stats_t ps;
+    sim_partition_get_stats(&ps);
+    sample_log_get_stats(&st);
+
+    double samples_per_block = (double)st.samples / st.blocks_written;
+    double lap_days = st.capacity_blocks * samples_per_block * DEVICE_SAMPLE_MS / 86400e3;
+    char extra[512];
+    snprintf(extra, sizeof(extra),
+             ",\"bytes_per_sample\":%.3f,\"flash_bytes_per_sample\":%.3f"
+             ",\"cpu_ns_per_sample\":%.1f,\"write_mb_per_s\":%.1f"
+             ",\"blocks\":%u,\"partial_blocks\":%u,\"sectors_erased\":%u"
+             ",\"samples_per_erase\":%.0f,\"lap_days_at_2s\":%.1f,\"wear_years_at_2s\":%.0f",
+             (double)st.payload_bytes / st.samples,
+             (double)ps.write_bytes / st.samples,
+             (double)(elapsed - ps.io_ns) / st.samples,
+             ps.write_bytes / (elapsed / 1e9) / 1e6,
+             st.blocks_written, st.partial_blocks, st.sectors_erased,
+             (double)st.samples / st.sectors_erased, lap_days,
+             lap_days * FLASH_ENDURANCE / 365.0);
+    bench_report("sample_log_add", st.samples, elapsed, extra);
+    if (ps.program_violations > 0 || ps.alignment_errors > 0 || st.write_errors > 0) {
+        fprintf(stderr, "flash misuse: %u program violations, %u alignment errors, %u write errors\n",
+                ps.program_violations, ps.alignment_errors, st.write_errors);
+        return 1;
+    }
+
+    // Reboot: the log must come back where it was (RAM block lost)
+    sample_log_flush();
+    sample_log_get_stats(&st);
+    uint32_t seq = st.seq;
+    uint16_t boot = st.boot;
+    sim_partition_reset_stats();
+    start = bench_now_ns();
+    sample_log_init();
+    elapsed = bench_now_ns() - start;
+    sim_partition_get_stats(&ps);
+    sample_log_get_stats(&st);
+    snprintf(extra, sizeof(extra), ",\"flash_reads\":%llu,\"read_bytes\":%llu,\"used_blocks\":%u",
+             (unsigned long long)ps.reads, (unsigned long long)ps.read_bytes, st.used_blocks);
+    bench_report("sample_log_recover", 1, elapsed, extra);
+    if (st.seq != seq || st.boot != boot + 1) {
+        fprintf(stderr, "recovery: seq %u boot %u, want %u %u\n", st.seq, st.boot, seq, boot + 1);
+        return 1;
+    }
+
+    uint64_t read_ns;
+    verify_t v;
+    if (read_back(total, &read_ns, &v) != 0) {
+        return 1;
+    }
+    snprintf(extra, sizeof(extra), ",\"samples\":%u,\"mb_per_s\":%.1f",
+             v.checked, v.bytes / (read_ns / 1e9) / 1e6);
+    bench_report("sample_log_read", v.blocks, read_ns, extra);
+
+    // Torn write: garbage in the next slot (power cut mid-program); the
+    // log must skip it, keep going and never program over it
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+        (esp_partition_subtype_t)SAMPLE_LOG_PARTITION_SUBTYPE, SAMPLE_LOG_PARTITION_LABEL);
+    uint32_t slot = st.seq % st.capacity_blocks;    // Head, as no write failed
+    uint8_t torn[SAMPLE_LOG_BLOCK_SIZE / 2];
+    memset(torn, 0xA5, sizeof(torn));
+    memcpy(torn, "SL\x01", 3);
+    esp_partition_write(part, slot * SAMPLE_LOG_BLOCK_SIZE, torn, sizeof(torn));
+    sample_log_init();
+    sim_partition_reset_stats();
+    uint32_t more = 50000;
+    for (uint32_t i = total; i < total + more; i++) {
+        log_sample(i);
+    }
+    sample_log_flush();
+    sim_partition_get_stats(&ps);
+    if (ps.program_violations > 0 || read_back(total + more, &read_ns, &v) != 0) {
+        fprintf(stderr, "torn block not skipped (%u program violations)\n",
+                ps.program_violations);
+        return 1;
+    }
+    sim_partition_detach_all();
+    remove(path);
+    return 0;
+}
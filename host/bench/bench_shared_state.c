@@ -0,0 +1,137 @@
+// Seqlock shared-state stress test: one writer publishing at full speed,
+// N readers taking snapshots and checking that no snapshot mixes two
+// updates. Compares reader throughput against a plain mutex-protected copy.
+//
+//   ./bench_shared_state [readers] [seconds]
+
+#include "bench.h"
+#include "shared_state.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+static atomic_bool stop_flag;
+static atomic_ullong writes;
+
+// Every field is derived from n, so a torn snapshot is detectable
+static void fill(elevator_state_t *st, int64_t n)
+{
+    st->sample_ms = n;
+    st->raw = (long)(n * 7);
+    st->weight = (float)(n & 0xFFFF);
+    st->threshold = (float)((n + 1) & 0xFFFF);
+    st->stable = (n & 1) != 0;
+    st->auto_mode = (n & 2) != 0;
+    st->motor_triggered = (n & 4) != 0;
+}
+
+static int consistent(const elevator_state_t *st)
+{
+    elevator_state_t want;
+    fill(&want, st->sample_ms);
+    return st->raw == want.raw && st->weight == want.weight &&
+           st->threshold == want.threshold && st->stable == want.stable &&
+           st->auto_mode == want.auto_mode && st->motor_triggered == want.motor_triggered;
+}
+
+// Mutex baseline
+static pthread_mutex_t baseline_lock = PTHREAD_MUTEX_INITIALIZER;
+static elevator_state_t baseline_state;
+static int use_mutex;
+
+static void *writer(void *arg)
+{
+    int64_t n = 1;
+    while (!atomic_load_explicit(&stop_flag, memory_order_relaxed)) {
+        if (use_mutex) {
+            pthread_mutex_lock(&baseline_lock);
+            fill(&baseline_state, n);
+            pthread_mutex_unlock(&baseline_lock);
+        } else {
+            fill(shared_state_begin_update(), n);
+            shared_state_end_update();
+        }
+        n++;
+    }
+    atomic_store(&writes, (unsigned long long)(n - 1));
+    return NULL;
+}
+
+typedef struct {
+    uint64_t reads;
+    uint64_t torn;
+} reader_result_t;
+
+static void *reader(void *arg)
+{
+    reader_result_t *r = arg;
+    elevator_state_t st;
+    while (!atomic_load_explicit(&stop_flag, memory_order_relaxed)) {
+        if (use_mutex) {
+            pthread_mutex_lock(&baseline_lock);
+            st = baseline_state;
+            pthread_mutex_unlock(&baseline_lock);
+        } else {
+            shared_state_read(&st);
+        }
+        if (!consistent(&st)) {
+            r->torn++;
+        }
+        r->reads++;
+    }
+    return NULL;
+}
+
+static uint64_t run(const char *name, int readers, double seconds)
+{
+    pthread_t wt, rt[64];
+    reader_result_t res[64] = {0};
+    elevator_state_t initial;
+
+    fill(&initial, 0);
+    shared_state_init(&initial);
+    baseline_state = initial;
+    atomic_store(&stop_flag, false);
+
+    uint64_t start = bench_now_ns();
+    pthread_create(&wt, NULL, writer, NULL);
+    for (int i = 0; i < readers; i++) {
+        pthread_create(&rt[i], NULL, reader, &res[i]);
+    }
+    struct timespec ts = { (time_t)seconds, (long)((seconds - (time_t)seconds) * 1e9) };
+    nanosleep(&ts, NULL);
+    atomic_store(&stop_flag, true);
+    pthread_join(wt, NULL);
+    uint64_t total = 0, torn = 0;
+    for (int i = 0; i < readers; i++) {
+        pthread_join(rt[i], NULL);
+        total += res[i].reads;
+        torn += res[i].torn;
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    char extra[128];
+    snprintf(extra, sizeof(extra), ",\"readers\":%d,\"writes\":%llu,\"torn\":%llu",
+             readers, (unsigned long long)atomic_load(&writes), (unsigned long long)torn);
+    bench_report(name, total, elapsed, extra);
+    return torn;
+}
+
+int main(int argc, char **argv)
+{
+    int readers = argc > 1 ? atoi(argv[1]) : 3;
+    double seconds = argc > 2 ? atof(argv[2]) : 1.0;
+    if (readers < 1) readers = 1;
+    if (readers > 64) readers = 64;
+
+    use_mutex = 0;
+    uint64_t torn = run("shared_state_seqlock_read", readers, seconds);
+    use_mutex = 1;
+    run("shared_state_mutex_read", readers, seconds);
+
+    if (torn) {
+        fprintf(stderr, "FAIL: %llu torn snapshots\n", (unsigned long long)torn);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+// Benchmark for telemetry encodings: binary frames (main/telemetry_codec.c)
+// versus the JSON status document (main/status_json.c). Reports encode cost
+// and bytes per sample for single-sample and batched frames.
+
+#include "bench.h"
+#include "status_json.h"
+#include "telemetry_codec.h"
+#include <math.h>
+#include <string.h>
+
+#define SAMPLES 200000
+#define SAMPLE_PERIOD_MS 12   // ~80 SPS, HX711 fast mode
+
+static telemetry_sample_t samples[SAMPLES];
+static system_status_t statuses[SAMPLES];
+
+static void make_samples(void)
+{
+    for (int i = 0; i < SAMPLES; i++) {
+        float weight = 2.0f + 0.5f * sinf(i / 400.0f) + 0.002f * (float)((i * 7919) % 10);
+        long raw = -104016 + (long)(weight * 98347.22f);
+        statuses[i] = (system_status_t) {
+            .seq = i, .sample_ms = 5000 + (int64_t)i * SAMPLE_PERIOD_MS,
+            .weight = weight, .load = weight, .raw = raw, .stable = true, .sensor_ready = true,
+            .motor_state = weight > 2.2f ? 1 : 0, .auto_mode = true, .threshold = 2.2f,
+            .wifi_connected = true, .rssi = -61, .uptime_ms = 5000 + (int64_t)i * SAMPLE_PERIOD_MS
+        };
+        samples[i] = (telemetry_sample_t) {
+            .t_ms = (uint32_t)statuses[i].sample_ms,
+            .weight_g = (int32_t)lroundf(weight * 1000.0f),
+            .raw = (int32_t)raw,
+            .flags = (uint8_t)(statuses[i].motor_state | TELEMETRY_FLAG_AUTO_MODE |
+                               TELEMETRY_FLAG_STABLE | TELEMETRY_FLAG_SENSOR_READY)
+        };
+    }
+}
+
+static void report(const char *name, uint64_t elapsed, uint64_t bytes)
+{
+    char extra[64];
+    snprintf(extra, sizeof(extra), ",\"bytes_per_sample\":%.2f", (double)bytes / SAMPLES);
+    bench_report(name, SAMPLES, elapsed, extra);
+}
+
+int main(void)
+{
+    make_samples();
+
+    // JSON status document per sample
+    char json[STATUS_JSON_MAX];
+    uint64_t bytes = 0;
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < SAMPLES; i++) {
+        bytes += status_json_format(&statuses[i], json, sizeof(json));
+        bench_sink(json);
+    }
+    report("json_status_encode", bench_now_ns() - start, bytes);
+
+    // Binary frame per sample
+    uint8_t frame[384];
+    telemetry_encoder_t enc;
+    bytes = 0;
+    start = bench_now_ns();
+    for (int i = 0; i < SAMPLES; i++) {
+        telemetry_encoder_begin(&enc, frame, sizeof(frame), (uint16_t)i, samples[i].t_ms);
+        telemetry_encoder_add(&enc, &samples[i]);
+        bytes += telemetry_encoder_finish(&enc);
+        bench_sink(frame);
+    }
+    report("binary_encode_single", bench_now_ns() - start, bytes);
+
+    // Binary frames batched until full (as for rate-capped WebSocket clients)
+    bytes = 0;
+    uint16_t seq = 0;
+    start = bench_now_ns();
+    telemetry_encoder_begin(&enc, frame, sizeof(frame), seq++, samples[0].t_ms);
+    for (int i = 0; i < SAMPLES; i++) {
+        if (!telemetry_encoder_add(&enc, &samples[i])) {
+            bytes += telemetry_encoder_finish(&enc);
+            bench_sink(frame);
+            telemetry_encoder_begin(&enc, frame, sizeof(frame), seq++, samples[i].t_ms);
+            telemetry_encoder_add(&enc, &samples[i]);
+        }
+    }
+    bytes += telemetry_encoder_finish(&enc);
+    report("binary_encode_batched", bench_now_ns() - start, bytes);
+
+    // Decode round trip check on the last batch
+    telemetry_sample_t decoded[TELEMETRY_MAX_SAMPLES];
+    int n = telemetry_decode(frame, enc.len, decoded, TELEMETRY_MAX_SAMPLES, NULL);
+    // Field by field: the struct has padding bytes
+    const telemetry_sample_t *got = &decoded[n > 0 ? n - 1 : 0], *want = &samples[SAMPLES - 1];
+    if (n <= 0 || got->t_ms != want->t_ms || got->weight_g != want->weight_g ||
+        got->raw != want->raw || got->flags != want->flags) {
+        fprintf(stderr, "telemetry round trip mismatch\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+// Tracer cost and ring consistency: N threads record events as fast as
+// they can while the main thread keeps taking snapshots. Every event's
+// name is derived from its arg, so a torn slot in a snapshot is detected.
+// Also times the Chrome JSON export of a full ring.
+//
+//   ./bench_trace [threads] [seconds]
+
+#include "bench.h"
+#include "trace.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+static const char *names[4] = { "hx711_wait", "hx711_shift", "control_step", "decision" };
+static atomic_bool stop_flag;
+static atomic_ullong recorded;
+
+static void *recorder(void *arg)
+{
+    int32_t i = 0;
+    while (!atomic_load_explicit(&stop_flag, memory_order_relaxed)) {
+        trace_record('i', names[i & 3], i);
+        i++;
+    }
+    atomic_fetch_add(&recorded, (unsigned long long)i);
+    return NULL;
+}
+
+static size_t json_bytes;
+
+static void count_write(void *ctx, const char *data, size_t len)
+{
+    bench_sink(data);
+    json_bytes += len;
+}
+
+int main(int argc, char **argv)
+{
+    int threads = argc > 1 ? atoi(argv[1]) : 2;
+    double seconds = argc > 2 ? atof(argv[2]) : 1.0;
+    if (threads < 1 || threads > 16) {
+        threads = 2;
+    }
+
+    // Uncontended record cost
+    const int single_ops = 1000000;
+    uint64_t t0 = bench_now_ns();
+    for (int i = 0; i < single_ops; i++) {
+        trace_record('B', names[i & 3], i);
+    }
+    bench_report("trace_record", single_ops, bench_now_ns() - t0, "");
+
+    trace_event_t *events = malloc(TRACE_MAX_CORES * TRACE_RING_LEN * sizeof(trace_event_t));
+    t0 = bench_now_ns();
+    size_t n = trace_snapshot(events, TRACE_MAX_CORES * TRACE_RING_LEN);
+    bench_report("trace_snapshot", 1, bench_now_ns() - t0, "");
+
+    t0 = bench_now_ns();
+    trace_render_json(events, n, count_write, NULL);
+    char extra[96];
+    snprintf(extra, sizeof(extra), ",\"events\":%zu,\"bytes\":%zu", n, json_bytes);
+    bench_report("trace_render_json", 1, bench_now_ns() - t0, extra);
+
+    // Concurrent writers vs. snapshots
+    pthread_t tid[16];
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&tid[i], NULL, recorder, NULL);
+    }
+    uint64_t snapshots = 0, torn = 0, seen = 0;
+    uint64_t deadline = bench_now_ns() + (uint64_t)(seconds * 1e9);
+    t0 = bench_now_ns();
+    while (bench_now_ns() < deadline) {
+        n = trace_snapshot(events, TRACE_MAX_CORES * TRACE_RING_LEN);
+        for (size_t i = 0; i < n; i++) {
+            if (events[i].name != names[events[i].arg & 3]) {
+                torn++;
+            }
+        }
+        seen += n;
+        snapshots++;
+    }
+    uint64_t elapsed = bench_now_ns() - t0;
+    atomic_store(&stop_flag, true);
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tid[i], NULL);
+    }
+    free(events);
+
+    snprintf(extra, sizeof(extra), ",\"threads\":%d,\"snapshots\":%llu,\"torn\":%llu,\"skipped\":%u",
+             threads, (unsigned long long)snapshots, (unsigned long long)torn,
+             (unsigned)trace_overwritten());
+    bench_report("trace_record_contended", atomic_load(&recorded), elapsed, extra);
+    if (torn != 0) {
+        printf("❌ %llu torn events in snapshots\n", (unsigned long long)torn);
+        return 1;
+    }
+    return seen > 0 ? 0 : 1;
+}
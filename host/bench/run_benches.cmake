@@ -0,0 +1,13 @@
+# Runs every benchmark in BENCHES and collects their JSON lines into OUTPUT.
+# Invoked by the "bench" target (host/CMakeLists.txt).
+file(WRITE "${OUTPUT}" "")
+foreach(bench ${BENCHES})
+    get_filename_component(name "${bench}" NAME_WE)
+    message(STATUS "Running ${name}")
+    execute_process(COMMAND "${bench}" OUTPUT_VARIABLE out RESULT_VARIABLE rc)
+    if(NOT rc EQUAL 0)
+        message(FATAL_ERROR "${name} failed (${rc})")
+    endif()
+    file(APPEND "${OUTPUT}" "${out}")
+endforeach()
+message(STATUS "Results: ${OUTPUT}")
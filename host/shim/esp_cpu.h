@@ -0,0 +1,17 @@
+#ifndef SHIM_ESP_CPU_H
+#define SHIM_ESP_CPU_H
+
+// Host shim: esp_cpu.h - the cycle counter follows the virtual clock at
+// SIM_CPU_MHZ, so cycle-based timings come out in simulated time
+
+#include <stdint.h>
+#include "sim_sched.h"
+
+#define SIM_CPU_MHZ 240
+
+static inline uint32_t esp_cpu_get_cycle_count(void)
+{
+    return (uint32_t)(sim_now_us() * SIM_CPU_MHZ);
+}
+
+#endif // SHIM_ESP_CPU_H
@@ -0,0 +1,14 @@
+#ifndef SHIM_ESP_ROM_SYS_H
+#define SHIM_ESP_ROM_SYS_H
+
+// Host shim: esp_rom_sys.h - CPU clock of the simulated chip
+
+#include <stdint.h>
+#include "esp_cpu.h"
+
+static inline uint32_t esp_rom_get_cpu_ticks_per_us(void)
+{
+    return SIM_CPU_MHZ;
+}
+
+#endif // SHIM_ESP_ROM_SYS_H
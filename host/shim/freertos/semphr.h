@@ -0,0 +1,19 @@
+#ifndef SHIM_FREERTOS_SEMPHR_H
+#define SHIM_FREERTOS_SEMPHR_H
+
+// Host shim: freertos/semphr.h - semaphores are zero-size queues, as in
+// FreeRTOS. No priority inheritance (tasks never preempt each other here).
+
+#include "freertos/queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+#define xSemaphoreCreateMutex()          xQueueCreateCountingSemaphore(1, 1)
+#define xSemaphoreCreateBinary()         xQueueCreateCountingSemaphore(1, 0)
+#define xSemaphoreCreateCounting(max, n) xQueueCreateCountingSemaphore(max, n)
+#define xSemaphoreTake(sem, ticks)       xQueueReceive(sem, NULL, ticks)
+#define xSemaphoreGive(sem)              xQueueSend(sem, NULL, 0)
+#define xSemaphoreGiveFromISR(sem, woken) (*(woken) = pdFALSE, xQueueSend(sem, NULL, 0))
+#define vSemaphoreDelete(sem)            vQueueDelete(sem)
+
+#endif // SHIM_FREERTOS_SEMPHR_H
@@ -0,0 +1,11 @@
+#ifndef SHIM_NVS_FLASH_H
+#define SHIM_NVS_FLASH_H
+
+// Host shim: nvs_flash.h (see nvs.h)
+
+#include "esp_err.h"
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
+
+#endif // SHIM_NVS_FLASH_H
@@ -0,0 +1,11 @@
+#ifndef SHIM_ETS_SYS_H
+#define SHIM_ETS_SYS_H
+
+// Host shim: rom/ets_sys.h - busy wait advances the virtual clock
+// without giving up the CPU
+
+#include <stdint.h>
+
+void ets_delay_us(uint32_t us);
+
+#endif // SHIM_ETS_SYS_H
@@ -0,0 +1,1174 @@
+#define _GNU_SOURCE     // memmem
+
+#include "esp_http_server.h"
+#include "sim_httpd.h"
+#include "sim_sched.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char *TAG = "SIM_HTTPD";
+
+#define SIM_LWIP_MAX_SOCKETS 16     // CONFIG_LWIP_MAX_SOCKETS (sdkconfig.defaults)
+#define HTTPD_INTERNAL_SOCKETS 3    // Listen + control sockets, as esp_http_server counts them
+#define SIM_HTTPD_MAX_SESSIONS 32
+#define SESSION_RX_BUF (HTTPD_MAX_URI_LEN + HTTPD_MAX_REQ_HDR_LEN + 64)
+#define WS_FRAME_MAX 1024
+#define WORK_QUEUE_LEN 16           // Pending httpd_queue_work() items
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+typedef struct {
+    int fd;                     // -1 when free
+    int64_t last_us;            // Last activity, for the LRU purge
+    bool websocket;
+    const httpd_uri_t *ws_uri;
+    bool detached;              // Request handed to a worker (async handler)
+    uint8_t rx[SESSION_RX_BUF]; // Bytes read but not consumed yet
+    size_t rx_len;
+} session_t;
+
+struct sim_httpd {
+    httpd_config_t config;
+    int listen_fd;
+    int ctrl[2];                // Work queue pipe (esp_http_server: UDP control socket)
+    int work_pending;
+    httpd_uri_t *handlers;
+    int handler_count;
+    session_t sessions[SIM_HTTPD_MAX_SESSIONS];
+    uint16_t port;
+    uint32_t request_cost_us;
+};
+
+typedef struct {
+    httpd_work_fn_t fn;
+    void *arg;
+} work_item_t;
+
+// Server-private request state (req->aux)
+typedef struct {
+    session_t *sess;
+    char hdr[HTTPD_MAX_REQ_HDR_LEN + 1];   // Header lines, NUL terminated
+    const char *query;                      // Inside req->uri, NULL if none
+    size_t body_left;
+    bool keep_alive;
+    bool detached;
+    // Response
+    char status[48];
+    char type[64];
+    const char *resp_field[16];
+    const char *resp_value[16];
+    int resp_hdrs;
+    bool headers_sent;
+    bool failed;
+    // WebSocket frame being handled
+    httpd_ws_type_t ws_type;
+    bool ws_final;
+    size_t ws_len;
+    uint8_t ws_payload[WS_FRAME_MAX];
+} req_aux_t;
+
+static struct sim_httpd *running_server = NULL;
+static sim_httpd_overrides_t overrides = { .port = -1, .lru_purge = -1 };
+static sim_httpd_stats_t stats;
+
+void sim_httpd_override(const sim_httpd_overrides_t *o)
+{
+    overrides = *o;
+}
+
+uint16_t sim_httpd_port(void)
+{
+    return running_server ? running_server->port : 0;
+}
+
+void sim_httpd_get_stats(sim_httpd_stats_t *out)
+{
+    *out = stats;
+    out->open_sockets = 0;
+    for (int i = 0; running_server && i < SIM_HTTPD_MAX_SESSIONS; i++) {
+        out->open_sockets += running_server->sessions[i].fd >= 0;
+    }
+}
+
+const char *http_method_str(httpd_method_t method)
+{
+    static const char *names[] = { "DELETE", "GET", "HEAD", "POST", "PUT" };
+    return (unsigned)method < sizeof(names) / sizeof(names[0]) ? names[method] : "<unknown>";
+}
+
+// Socket I/O. The server task blocks in sim_poll() like esp_http_server
+// blocks in recv()/send() with SO_RCVTIMEO/SO_SNDTIMEO: nothing else is
+// served meanwhile.
+
+static int wait_fd(struct sim_httpd *hd, int fd, short events, uint16_t timeout_s)
+{
+    struct pollfd p = { .fd = fd, .events = events };
+    int ready = sim_poll(&p, 1, timeout_s * 1000);
+    if (ready == 0) {
+        stats.timeouts++;
+        return HTTPD_SOCK_ERR_TIMEOUT;
+    }
+    return ready < 0 ? HTTPD_SOCK_ERR_FAIL : 0;
+}
+
+// Read more bytes into the session buffer; >0 bytes read, 0 peer closed, <0 error
+static int session_fill(struct sim_httpd *hd, session_t *s)
+{
+    while (1) {
+        if (s->rx_len == sizeof(s->rx)) {
+            return HTTPD_SOCK_ERR_FAIL;
+        }
+        ssize_t n = recv(s->fd, s->rx + s->rx_len, sizeof(s->rx) - s->rx_len, 0);
+        if (n >= 0) {
+            s->rx_len += (size_t)n;
+            return (int)n;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            return HTTPD_SOCK_ERR_FAIL;
+        }
+        int err = wait_fd(hd, s->fd, POLLIN, hd->config.recv_wait_timeout);
+        if (err < 0) {
+            return err;
+        }
+    }
+}
+
+static void session_consume(session_t *s, size_t n)
+{
+    memmove(s->rx, s->rx + n, s->rx_len - n);
+    s->rx_len -= n;
+}
+
+// Read exactly len bytes (WebSocket frames); 0 on success
+static int session_read_exact(struct sim_httpd *hd, session_t *s, void *buf, size_t len)
+{
+    while (s->rx_len < len) {
+        if (len > sizeof(s->rx) || session_fill(hd, s) <= 0) {
+            return HTTPD_SOCK_ERR_FAIL;
+        }
+    }
+    memcpy(buf, s->rx, len);
+    session_consume(s, len);
+    return 0;
+}
+
+static esp_err_t sock_send(struct sim_httpd *hd, int fd, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n > 0) {
+            p += n;
+            len -= (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            return ESP_ERR_HTTPD_RESP_SEND;
+        }
+        if (wait_fd(hd, fd, POLLOUT, hd->config.send_wait_timeout) < 0) {
+            return ESP_ERR_HTTPD_RESP_SEND;
+        }
+    }
+    return ESP_OK;
+}
+
+// Sessions
+
+static session_t *session_find(struct sim_httpd *hd, int fd)
+{
+    for (int i = 0; i < SIM_HTTPD_MAX_SESSIONS; i++) {
+        if (hd->sessions[i].fd == fd && fd >= 0) {
+            return &hd->sessions[i];
+        }
+    }
+    return NULL;
+}
+
+static session_t *session_free_slot(struct sim_httpd *hd)
+{
+    for (int i = 0; i < hd->config.max_open_sockets; i++) {
+        if (hd->sessions[i].fd < 0) {
+            return &hd->sessions[i];
+        }
+    }
+    return NULL;
+}
+
+static void session_close(struct sim_httpd *hd, session_t *s)
+{
+    int fd = s->fd;
+    s->fd = -1;
+    s->rx_len = 0;
+    s->websocket = false;
+    s->ws_uri = NULL;
+    s->detached = false;
+    if (hd->config.close_fn != NULL) {
+        hd->config.close_fn(hd, fd);    // Owns closing the socket
+    } else {
+        close(fd);
+    }
+}
+
+// Least recently used session that is not serving a detached request
+static bool session_close_lru(struct sim_httpd *hd)
+{
+    session_t *lru = NULL;
+    for (int i = 0; i < hd->config.max_open_sockets; i++) {
+        session_t *s = &hd->sessions[i];
+        if (s->fd >= 0 && !s->detached && (lru == NULL || s->last_us < lru->last_us)) {
+            lru = s;
+        }
+    }
+    if (lru == NULL) {
+        return false;
+    }
+    ESP_LOGD(TAG, "LRU purge of fd %d", lru->fd);
+    session_close(hd, lru);
+    stats.lru_purged++;
+    return true;
+}
+
+static void accept_conn(struct sim_httpd *hd)
+{
+    if (session_free_slot(hd) == NULL && hd->config.lru_purge_enable) {
+        session_close_lru(hd);
+    }
+    int fd = accept(hd->listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+    session_t *s = session_free_slot(hd);
+    if (s == NULL) {
+        ESP_LOGW(TAG, "No free session for new connection (max_open_sockets=%d)",
+                 hd->config.max_open_sockets);
+        close(fd);
+        stats.refused++;
+        return;
+    }
+    int one = 1;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    // Loopback + Nagle + delayed ACK would add 40 ms stalls lwIP does not have
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    s->fd = fd;
+    s->last_us = esp_timer_get_time();
+    s->rx_len = 0;
+    stats.accepted++;
+    uint16_t open = 0;
+    for (int i = 0; i < SIM_HTTPD_MAX_SESSIONS; i++) {
+        open += hd->sessions[i].fd >= 0;
+    }
+    if (open > stats.open_sockets_max) {
+        stats.open_sockets_max = open;
+    }
+}
+
+// Responses
+
+static const char *err_status(httpd_err_code_t error, const char **msg)
+{
+    static const struct { const char *status; const char *msg; } table[] = {
+        [HTTPD_400_BAD_REQUEST] = { "400 Bad Request", "Bad request syntax" },
+        [HTTPD_404_NOT_FOUND] = { "404 Not Found", "Nothing matches the given URI" },
+        [HTTPD_405_METHOD_NOT_ALLOWED] = { "405 Method Not Allowed", "Request method for this URI is not handled by server" },
+        [HTTPD_408_REQ_TIMEOUT] = { "408 Request Timeout", "Server closed this connection" },
+        [HTTPD_411_LENGTH_REQUIRED] = { "411 Length Required", "Chunked encoding not supported" },
+        [HTTPD_414_URI_TOO_LONG] = { "414 URI Too Long", "URI is too long" },
+        [HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE] = { "431 Request Header Fields Too Large", "Header fields are too long" },
+        [HTTPD_500_INTERNAL_SERVER_ERROR] = { "500 Internal Server Error", "Server has encountered an unexpected error" },
+        [HTTPD_501_METHOD_NOT_IMPLEMENTED] = { "501 Method Not Implemented", "Server does not support this method" },
+        [HTTPD_505_VERSION_NOT_SUPPORTED] = { "505 Version Not Supported", "HTTP version not supported by server" },
+    };
+    if ((unsigned)error >= HTTPD_ERR_CODE_MAX) {
+        error = HTTPD_500_INTERNAL_SERVER_ERROR;
+    }
+    if (msg != NULL && *msg == NULL) {
+        *msg = table[error].msg;
+    }
+    return table[error].status;
+}
+
+static void count_status(const char *status)
+{
+    switch (status[0]) {
+        case '2': stats.responses_2xx++; break;
+        case '4': stats.responses_4xx++; break;
+        case '5': stats.responses_5xx++; break;
+        default: break;
+    }
+}
+
+// Status line and headers; content_len < 0 means chunked
+static esp_err_t send_headers(httpd_req_t *r, ssize_t content_len)
+{
+    req_aux_t *ra = r->aux;
+    char buf[1024];
+    int len = snprintf(buf, sizeof(buf), "HTTP/1.1 %s\r\nContent-Type: %s\r\n",
+                       ra->status, ra->type);
+    if (content_len < 0) {
+        len += snprintf(buf + len, sizeof(buf) - len, "Transfer-Encoding: chunked\r\n");
+    } else {
+        len += snprintf(buf + len, sizeof(buf) - len, "Content-Length: %d\r\n", (int)content_len);
+    }
+    for (int i = 0; i < ra->resp_hdrs && len < (int)sizeof(buf); i++) {
+        len += snprintf(buf + len, sizeof(buf) - len, "%s: %s\r\n",
+                        ra->resp_field[i], ra->resp_value[i]);
+    }
+    len += snprintf(buf + len, sizeof(buf) - len, "\r\n");
+    if (len >= (int)sizeof(buf)) {
+        return ESP_ERR_HTTPD_RESP_HDR;
+    }
+    ra->headers_sent = true;
+    count_status(ra->status);
+    esp_err_t err = sock_send(r->handle, ra->sess->fd, buf, len);
+    ra->failed |= err != ESP_OK;
+    return err;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status)
+{
+    req_aux_t *ra = r->aux;
+    snprintf(ra->status, sizeof(ra->status), "%s", status);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+    req_aux_t *ra = r->aux;
+    snprintf(ra->type, sizeof(ra->type), "%s", type);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value)
+{
+    req_aux_t *ra = r->aux;
+    int max = r->handle->config.max_resp_headers;
+    if (ra->resp_hdrs >= max || ra->resp_hdrs >= (int)(sizeof(ra->resp_field) / sizeof(ra->resp_field[0]))) {
+        return ESP_ERR_HTTPD_RESP_HDR;
+    }
+    ra->resp_field[ra->resp_hdrs] = field;
+    ra->resp_value[ra->resp_hdrs++] = value;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    req_aux_t *ra = r->aux;
+    if (buf_len == HTTPD_RESP_USE_STRLEN) {
+        buf_len = buf ? (ssize_t)strlen(buf) : 0;
+    }
+    esp_err_t err = send_headers(r, buf_len);
+    if (err == ESP_OK && buf_len > 0) {
+        err = sock_send(r->handle, ra->sess->fd, buf, (size_t)buf_len);
+        ra->failed |= err != ESP_OK;
+    }
+    return err;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    req_aux_t *ra = r->aux;
+    if (buf_len == HTTPD_RESP_USE_STRLEN) {
+        buf_len = buf ? (ssize_t)strlen(buf) : 0;
+    }
+    if (!ra->headers_sent) {
+        esp_err_t err = send_headers(r, -1);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    char *frame = malloc((size_t)buf_len + 16);
+    if (frame == NULL) {
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    int len = snprintf(frame, 16, "%x\r\n", (unsigned)buf_len);
+    if (buf_len > 0) {
+        memcpy(frame + len, buf, (size_t)buf_len);
+        len += (int)buf_len;
+    }
+    memcpy(frame + len, "\r\n", 2);
+    esp_err_t err = sock_send(r->handle, ra->sess->fd, frame, (size_t)len + 2);
+    ra->failed |= err != ESP_OK;
+    free(frame);
+    return err;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg)
+{
+    const char *status = err_status(error, &msg);
+    httpd_resp_set_status(req, status);
+    httpd_resp_set_type(req, "text/html");
+    return httpd_resp_send(req, msg, HTTPD_RESP_USE_STRLEN);
+}
+
+// Requests
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    req_aux_t *ra = r->aux;
+    session_t *s = ra->sess;
+    if (ra->body_left == 0) {
+        return 0;
+    }
+    if (buf_len > ra->body_left) {
+        buf_len = ra->body_left;
+    }
+    if (s->rx_len == 0) {
+        int n = session_fill(r->handle, s);
+        if (n <= 0) {
+            return n == 0 ? HTTPD_SOCK_ERR_FAIL : n;
+        }
+    }
+    size_t n = s->rx_len < buf_len ? s->rx_len : buf_len;
+    memcpy(buf, s->rx, n);
+    session_consume(s, n);
+    ra->body_left -= n;
+    return (int)n;
+}
+
+// Finds "Field: value" in the header block; returns the value and its length
+static const char *find_hdr(const req_aux_t *ra, const char *field, size_t *len)
+{
+    size_t flen = strlen(field);
+    for (const char *line = ra->hdr; *line; ) {
+        const char *end = strstr(line, "\r\n");
+        if (end == NULL) {
+            end = line + strlen(line);
+        }
+        if ((size_t)(end - line) > flen && line[flen] == ':' && strncasecmp(line, field, flen) == 0) {
+            const char *v = line + flen + 1;
+            while (*v == ' ' || *v == '\t') {
+                v++;
+            }
+            *len = (size_t)(end - v);
+            return v;
+        }
+        line = *end ? end + 2 : end;
+    }
+    return NULL;
+}
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field)
+{
+    size_t len = 0;
+    return find_hdr(r->aux, field, &len) ? len : 0;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size)
+{
+    size_t len;
+    const char *v = find_hdr(r->aux, field, &len);
+    if (v == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (val_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t n = len < val_size - 1 ? len : val_size - 1;
+    memcpy(val, v, n);
+    val[n] = '\0';
+    return n < len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+size_t httpd_req_get_url_query_len(httpd_req_t *r)
+{
+    req_aux_t *ra = r->aux;
+    return ra->query ? strlen(ra->query) : 0;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    req_aux_t *ra = r->aux;
+    if (ra->query == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (buf_len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    snprintf(buf, buf_len, "%s", ra->query);
+    return strlen(ra->query) >= buf_len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size)
+{
+    size_t klen = strlen(key);
+    for (const char *p = qry; p && *p; ) {
+        const char *end = strchr(p, '&');
+        if (end == NULL) {
+            end = p + strlen(p);
+        }
+        if (strncmp(p, key, klen) == 0 && p[klen] == '=') {
+            const char *v = p + klen + 1;
+            size_t len = (size_t)(end - v);
+            if (val_size == 0) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            size_t n = len < val_size - 1 ? len : val_size - 1;
+            memcpy(val, v, n);
+            val[n] = '\0';
+            return n < len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+        }
+        p = *end ? end + 1 : end;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+int httpd_req_to_sockfd(httpd_req_t *r)
+{
+    req_aux_t *ra = r->aux;
+    return ra->sess->fd;
+}
+
+static httpd_req_t *req_new(struct sim_httpd *hd, session_t *s)
+{
+    httpd_req_t *r = calloc(1, sizeof(httpd_req_t));
+    req_aux_t *ra = calloc(1, sizeof(req_aux_t));
+    if (r == NULL || ra == NULL) {
+        free(r);
+        free(ra);
+        return NULL;
+    }
+    r->handle = hd;
+    r->aux = ra;
+    ra->sess = s;
+    ra->keep_alive = true;
+    strcpy(ra->status, "200 OK");
+    strcpy(ra->type, "text/html");
+    return r;
+}
+
+static void req_free(httpd_req_t *r)
+{
+    free(r->aux);
+    free(r);
+}
+
+// Drop the unread body, then close the session if the request failed or
+// the client asked for it
+static void req_finish(struct sim_httpd *hd, httpd_req_t *r, esp_err_t ret)
+{
+    req_aux_t *ra = r->aux;
+    session_t *s = ra->sess;
+    char discard[256];
+    while (ret == ESP_OK && !ra->failed && ra->body_left > 0) {
+        if (httpd_req_recv(r, discard, sizeof(discard)) <= 0) {
+            ra->failed = true;
+        }
+    }
+    s->last_us = esp_timer_get_time();
+    if (ret != ESP_OK || ra->failed) {
+        stats.closed_on_error++;
+        session_close(hd, s);
+    } else if (!ra->keep_alive) {
+        session_close(hd, s);
+    }
+    req_free(r);
+}
+
+esp_err_t httpd_req_async_handler_begin(httpd_req_t *r, httpd_req_t **out)
+{
+    httpd_req_t *copy = malloc(sizeof(httpd_req_t));
+    req_aux_t *ra = malloc(sizeof(req_aux_t));
+    if (copy == NULL || ra == NULL) {
+        free(copy);
+        free(ra);
+        return ESP_ERR_NO_MEM;
+    }
+    req_aux_t *orig = r->aux;
+    memcpy(copy, r, sizeof(*copy));
+    memcpy(ra, orig, sizeof(*ra));
+    if (orig->query != NULL) {
+        ra->query = copy->uri + (orig->query - r->uri);
+    }
+    copy->aux = ra;
+    orig->detached = true;
+    orig->sess->detached = true;
+    *out = copy;
+    return ESP_OK;
+}
+
+esp_err_t httpd_req_async_handler_complete(httpd_req_t *r)
+{
+    req_aux_t *ra = r->aux;
+    struct sim_httpd *hd = r->handle;
+    session_t *s = ra->sess;
+    s->detached = false;
+    req_finish(hd, r, ESP_OK);
+    // Let the server task poll the socket again
+    work_item_t wake = { NULL, NULL };
+    if (write(hd->ctrl[1], &wake, sizeof(wake)) != sizeof(wake)) {
+        ESP_LOGW(TAG, "Control pipe full");
+    }
+    return ESP_OK;
+}
+
+// WebSocket
+
+static void sha1(const uint8_t *data, size_t len, uint8_t out[20])
+{
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    uint64_t bits = (uint64_t)len * 8;
+    size_t total = ((len + 8) / 64 + 1) * 64;
+    for (size_t off = 0; off < total; off += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 64; i++) {
+            size_t k = off + i;
+            uint8_t b = k < len ? data[k] : k == len ? 0x80 : 0;
+            if (k >= total - 8) {
+                b = (uint8_t)(bits >> (8 * (total - 1 - k)));
+            }
+            if (i % 4 == 0) {
+                w[i / 4] = 0;
+            }
+            w[i / 4] |= (uint32_t)b << (24 - 8 * (i % 4));
+        }
+        for (int i = 16; i < 80; i++) {
+            uint32_t x = w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16];
+            w[i] = (x << 1) | (x >> 31);
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+            uint32_t t = ((a << 5) | (a >> 27)) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = (b << 30) | (b >> 2);
+            b = a;
+            a = t;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+    for (int i = 0; i < 20; i++) {
+        out[i] = (uint8_t)(h[i / 4] >> (24 - 8 * (i % 4)));
+    }
+}
+
+static void base64(const uint8_t *in, size_t len, char *out)
+{
+    static const char tbl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = (uint32_t)in[i] << 16 | (i + 1 < len ? in[i + 1] << 8 : 0) |
+                     (i + 2 < len ? in[i + 2] : 0);
+        *out++ = tbl[(v >> 18) & 63];
+        *out++ = tbl[(v >> 12) & 63];
+        *out++ = i + 1 < len ? tbl[(v >> 6) & 63] : '=';
+        *out++ = i + 2 < len ? tbl[v & 63] : '=';
+    }
+    *out = '\0';
+}
+
+static esp_err_t ws_handshake(struct sim_httpd *hd, httpd_req_t *r, const httpd_uri_t *uri)
+{
+    char key[64], proto[64];
+    if (httpd_req_get_hdr_value_str(r, "Sec-WebSocket-Key", key, sizeof(key)) != ESP_OK) {
+        httpd_resp_send_err(r, HTTPD_400_BAD_REQUEST, "Missing Sec-WebSocket-Key");
+        return ESP_FAIL;
+    }
+    char concat[128];
+    uint8_t digest[20];
+    char accept[32];
+    snprintf(concat, sizeof(concat), "%s%s", key, WS_GUID);
+    sha1((const uint8_t *)concat, strlen(concat), digest);
+    base64(digest, sizeof(digest), accept);
+
+    char buf[256];
+    int len = snprintf(buf, sizeof(buf),
+                       "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+                       "Connection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n", accept);
+    if (uri->supported_subprotocol != NULL &&
+        httpd_req_get_hdr_value_str(r, "Sec-WebSocket-Protocol", proto, sizeof(proto)) == ESP_OK &&
+        strstr(proto, uri->supported_subprotocol) != NULL) {
+        len += snprintf(buf + len, sizeof(buf) - len, "Sec-WebSocket-Protocol: %s\r\n",
+                        uri->supported_subprotocol);
+    }
+    len += snprintf(buf + len, sizeof(buf) - len, "\r\n");
+    req_aux_t *ra = r->aux;
+    ra->headers_sent = true;
+    return sock_send(hd, ra->sess->fd, buf, len);
+}
+
+static esp_err_t ws_send(struct sim_httpd *hd, int fd, const httpd_ws_frame_t *f)
+{
+    uint8_t head[10];
+    size_t n = 0;
+    head[n++] = (f->final || !f->fragmented ? 0x80 : 0) | (f->type & 0x0F);
+    if (f->len < 126) {
+        head[n++] = (uint8_t)f->len;
+    } else if (f->len <= 0xFFFF) {
+        head[n++] = 126;
+        head[n++] = (uint8_t)(f->len >> 8);
+        head[n++] = (uint8_t)f->len;
+    } else {
+        head[n++] = 127;
+        for (int i = 7; i >= 0; i--) {
+            head[n++] = (uint8_t)((uint64_t)f->len >> (8 * i));
+        }
+    }
+    uint8_t *frame = malloc(n + f->len);
+    if (frame == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(frame, head, n);
+    if (f->len > 0) {
+        memcpy(frame + n, f->payload, f->len);
+    }
+    esp_err_t err = sock_send(hd, fd, frame, n + f->len);
+    free(frame);
+    if (err == ESP_OK) {
+        stats.ws_frames_sent++;
+    }
+    return err;
+}
+
+esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *pkt, size_t max_len)
+{
+    req_aux_t *ra = req->aux;
+    pkt->type = ra->ws_type;
+    pkt->final = ra->ws_final;
+    pkt->fragmented = !ra->ws_final;
+    if (max_len == 0) {
+        pkt->len = ra->ws_len;
+        return ESP_OK;
+    }
+    if (pkt->payload == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pkt->len = ra->ws_len < max_len ? ra->ws_len : max_len;
+    memcpy(pkt->payload, ra->ws_payload, pkt->len);
+    return ESP_OK;
+}
+
+esp_err_t httpd_ws_send_frame(httpd_req_t *req, httpd_ws_frame_t *pkt)
+{
+    req_aux_t *ra = req->aux;
+    return ws_send(req->handle, ra->sess->fd, pkt);
+}
+
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame)
+{
+    session_t *s = session_find(hd, fd);
+    if (s == NULL || !s->websocket) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ws_send(hd, fd, frame);
+}
+
+httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t hd, int fd)
+{
+    session_t *s = session_find(hd, fd);
+    if (s == NULL) {
+        return HTTPD_WS_CLIENT_INVALID;
+    }
+    return s->websocket ? HTTPD_WS_CLIENT_WEBSOCKET : HTTPD_WS_CLIENT_HTTP;
+}
+
+// One frame from an upgraded session
+static void process_ws_frame(struct sim_httpd *hd, session_t *s)
+{
+    uint8_t head[2], ext[8], mask[4] = {0};
+    if (session_read_exact(hd, s, head, 2) != 0) {
+        stats.closed_by_peer++;
+        session_close(hd, s);
+        return;
+    }
+    uint64_t len = head[1] & 0x7F;
+    size_t ext_len = len == 126 ? 2 : len == 127 ? 8 : 0;
+    if (ext_len && session_read_exact(hd, s, ext, ext_len) != 0) {
+        session_close(hd, s);
+        return;
+    }
+    if (ext_len) {
+        len = 0;
+        for (size_t i = 0; i < ext_len; i++) {
+            len = len << 8 | ext[i];
+        }
+    }
+    if (len > WS_FRAME_MAX || ((head[1] & 0x80) && session_read_exact(hd, s, mask, 4) != 0)) {
+        stats.closed_on_error++;
+        session_close(hd, s);
+        return;
+    }
+
+    httpd_req_t *r = req_new(hd, s);
+    if (r == NULL) {
+        session_close(hd, s);
+        return;
+    }
+    req_aux_t *ra = r->aux;
+    ra->ws_type = (httpd_ws_type_t)(head[0] & 0x0F);
+    ra->ws_final = (head[0] & 0x80) != 0;
+    ra->ws_len = (size_t)len;
+    if (len && session_read_exact(hd, s, ra->ws_payload, (size_t)len) != 0) {
+        req_free(r);
+        session_close(hd, s);
+        return;
+    }
+    for (size_t i = 0; i < len; i++) {
+        ra->ws_payload[i] ^= mask[i % 4];
+    }
+    s->last_us = esp_timer_get_time();
+
+    const httpd_uri_t *uri = s->ws_uri;
+    bool control = ra->ws_type == HTTPD_WS_TYPE_PING || ra->ws_type == HTTPD_WS_TYPE_PONG ||
+                   ra->ws_type == HTTPD_WS_TYPE_CLOSE;
+    if (control && !uri->handle_ws_control_frames) {
+        httpd_ws_frame_t reply = {
+            .final = true,
+            .type = ra->ws_type == HTTPD_WS_TYPE_PING ? HTTPD_WS_TYPE_PONG : HTTPD_WS_TYPE_CLOSE,
+            .payload = ra->ws_payload,
+            .len = ra->ws_type == HTTPD_WS_TYPE_PING ? ra->ws_len : 0
+        };
+        bool close_it = ra->ws_type == HTTPD_WS_TYPE_CLOSE;
+        if (ra->ws_type != HTTPD_WS_TYPE_PONG) {
+            ws_send(hd, s->fd, &reply);
+        }
+        req_free(r);
+        if (close_it) {
+            session_close(hd, s);
+        }
+        return;
+    }
+
+    r->method = 0;  // Not HTTP_GET: that marks the handshake call
+    memcpy((char *)r->uri, uri->uri, strlen(uri->uri) + 1);
+    r->user_ctx = uri->user_ctx;
+    esp_err_t ret = uri->handler(r);
+    bool close_it = ret != ESP_OK || ra->ws_type == HTTPD_WS_TYPE_CLOSE;
+    req_free(r);
+    if (close_it) {
+        session_close(hd, s);
+    }
+}
+
+// Request line + headers; false when the session was closed
+static bool parse_request(struct sim_httpd *hd, session_t *s, httpd_req_t *r, bool *upgrade)
+{
+    req_aux_t *ra = r->aux;
+    char *end;
+    while ((end = memmem(s->rx, s->rx_len, "\r\n\r\n", 4)) == NULL) {
+        int n = s->rx_len == sizeof(s->rx) ? HTTPD_SOCK_ERR_FAIL : session_fill(hd, s);
+        if (n <= 0) {
+            if (n == 0 && s->rx_len == 0) {
+                stats.closed_by_peer++;
+            } else if (n == HTTPD_SOCK_ERR_TIMEOUT) {
+                httpd_resp_send_err(r, HTTPD_408_REQ_TIMEOUT, NULL);
+                stats.closed_on_error++;
+            } else if (s->rx_len == sizeof(s->rx)) {
+                httpd_resp_send_err(r, HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE, NULL);
+                stats.closed_on_error++;
+            }
+            session_close(hd, s);
+            return false;
+        }
+    }
+    size_t head_len = (size_t)(end - (char *)s->rx) + 4;
+    char *line_end = memmem(s->rx, head_len, "\r\n", 2);
+    size_t line_len = (size_t)(line_end - (char *)s->rx);
+    size_t hdr_len = head_len - line_len - 2;
+
+    char method[8], version[16];
+    char *uri = (char *)r->uri;
+    char line[HTTPD_MAX_URI_LEN + 32];
+    httpd_err_code_t err = HTTPD_ERR_CODE_MAX;
+    if (line_len >= sizeof(line)) {
+        err = HTTPD_414_URI_TOO_LONG;
+    } else if (hdr_len > HTTPD_MAX_REQ_HDR_LEN) {
+        err = HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE;
+    } else {
+        memcpy(line, s->rx, line_len);
+        line[line_len] = '\0';
+        if (sscanf(line, "%7s %512s %15s", method, uri, version) != 3 ||
+            strncmp(version, "HTTP/1.", 7) != 0) {
+            err = HTTPD_400_BAD_REQUEST;
+        }
+    }
+    if (err == HTTPD_ERR_CODE_MAX) {
+        static const char *methods[] = { "DELETE", "GET", "HEAD", "POST", "PUT" };
+        r->method = -1;
+        for (int i = 0; i < 5; i++) {
+            if (strcmp(method, methods[i]) == 0) {
+                r->method = i;
+            }
+        }
+        if (r->method < 0) {
+            err = HTTPD_501_METHOD_NOT_IMPLEMENTED;
+        }
+    }
+    if (err != HTTPD_ERR_CODE_MAX) {
+        httpd_resp_send_err(r, err, NULL);
+        stats.closed_on_error++;
+        session_close(hd, s);
+        return false;
+    }
+
+    memcpy(ra->hdr, s->rx + line_len + 2, hdr_len - 2);
+    ra->hdr[hdr_len - 2] = '\0';
+    session_consume(s, head_len);
+
+    char *q = strchr(uri, '?');
+    if (q != NULL) {
+        *q = '\0';      // Handlers match on the path; the query stays readable
+        ra->query = q + 1;
+    }
+    char val[32];
+    if (httpd_req_get_hdr_value_str(r, "Content-Length", val, sizeof(val)) == ESP_OK) {
+        r->content_len = strtoul(val, NULL, 10);
+        ra->body_left = r->content_len;
+    }
+    ra->keep_alive = !(httpd_req_get_hdr_value_str(r, "Connection", val, sizeof(val)) == ESP_OK &&
+                       strcasecmp(val, "close") == 0);
+    *upgrade = httpd_req_get_hdr_value_str(r, "Upgrade", val, sizeof(val)) == ESP_OK &&
+               strcasecmp(val, "websocket") == 0;
+    return true;
+}
+
+static void charge_request_cost(uint32_t us)
+{
+    if (us > 0) {
+        // Occupies the (single) simulated CPU: other tasks do not run meanwhile
+        struct timespec ts = { us / 1000000, (long)(us % 1000000) * 1000 };
+        nanosleep(&ts, NULL);
+    }
+}
+
+static void process_request(struct sim_httpd *hd, session_t *s)
+{
+    httpd_req_t *r = req_new(hd, s);
+    if (r == NULL) {
+        session_close(hd, s);
+        return;
+    }
+    bool upgrade = false;
+    if (!parse_request(hd, s, r, &upgrade)) {
+        req_free(r);
+        return;
+    }
+    stats.requests++;
+    charge_request_cost(hd->request_cost_us);
+
+    const httpd_uri_t *match = NULL;
+    bool uri_known = false;
+    for (int i = 0; i < hd->handler_count; i++) {
+        if (strcmp(hd->handlers[i].uri, r->uri) == 0) {
+            uri_known = true;
+            if ((int)hd->handlers[i].method == r->method) {
+                match = &hd->handlers[i];
+                break;
+            }
+        }
+    }
+    if (match == NULL) {
+        // esp_http_server answers and closes the session
+        httpd_resp_send_err(r, uri_known ? HTTPD_405_METHOD_NOT_ALLOWED : HTTPD_404_NOT_FOUND, NULL);
+        req_finish(hd, r, ESP_FAIL);
+        return;
+    }
+
+    r->user_ctx = match->user_ctx;
+    if (match->is_websocket) {
+        if (!upgrade) {
+            httpd_resp_send_err(r, HTTPD_400_BAD_REQUEST, "WebSocket upgrade expected");
+            req_finish(hd, r, ESP_FAIL);
+            return;
+        }
+        if (ws_handshake(hd, r, match) != ESP_OK) {
+            req_finish(hd, r, ESP_FAIL);
+            return;
+        }
+        s->websocket = true;
+        s->ws_uri = match;
+    }
+
+    esp_err_t ret = match->handler(r);
+    req_aux_t *ra = r->aux;
+    if (ra->detached) {
+        req_free(r);    // A worker owns the copy and completes it
+        return;
+    }
+    req_finish(hd, r, ret);
+}
+
+static void server_task(void *arg)
+{
+    struct sim_httpd *hd = arg;
+    struct pollfd fds[SIM_HTTPD_MAX_SESSIONS + 2];
+    session_t *owners[SIM_HTTPD_MAX_SESSIONS + 2];
+
+    while (1) {
+        int n = 0;
+        fds[n] = (struct pollfd) { .fd = hd->ctrl[0], .events = POLLIN };
+        owners[n++] = NULL;
+        fds[n] = (struct pollfd) { .fd = hd->listen_fd, .events = POLLIN };
+        owners[n++] = NULL;
+        for (int i = 0; i < SIM_HTTPD_MAX_SESSIONS; i++) {
+            session_t *s = &hd->sessions[i];
+            if (s->fd >= 0 && !s->detached) {
+                fds[n] = (struct pollfd) { .fd = s->fd, .events = POLLIN };
+                owners[n++] = s;
+            }
+        }
+        if (sim_poll(fds, n, -1) <= 0) {
+            continue;
+        }
+        int64_t busy_start = esp_timer_get_time();
+
+        if (fds[0].revents & POLLIN) {
+            work_item_t w;
+            while (read(hd->ctrl[0], &w, sizeof(w)) == sizeof(w)) {
+                if (w.fn != NULL) {
+                    hd->work_pending--;
+                    w.fn(w.arg);
+                }
+            }
+        }
+        if (fds[1].revents & POLLIN) {
+            accept_conn(hd);
+        }
+        for (int i = 2; i < n; i++) {
+            session_t *s = owners[i];
+            // Skip sessions closed or detached while handling earlier ones
+            if (fds[i].revents == 0 || s->fd != fds[i].fd || s->detached) {
+                continue;
+            }
+            if (s->websocket) {
+                process_ws_frame(hd, s);
+            } else {
+                process_request(hd, s);
+            }
+        }
+        stats.busy_us += (uint64_t)(esp_timer_get_time() - busy_start);
+    }
+}
+
+esp_err_t httpd_queue_work(httpd_handle_t hd, httpd_work_fn_t work, void *arg)
+{
+    if (hd == NULL || work == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    work_item_t w = { work, arg };
+    if (hd->work_pending >= WORK_QUEUE_LEN ||
+        write(hd->ctrl[1], &w, sizeof(w)) != sizeof(w)) {
+        stats.work_dropped++;
+        return ESP_FAIL;
+    }
+    hd->work_pending++;
+    stats.work_queued++;
+    return ESP_OK;
+}
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    if (running_server != NULL) {
+        return ESP_ERR_HTTPD_TASK;
+    }
+    struct sim_httpd *hd = calloc(1, sizeof(*hd));
+    if (hd == NULL) {
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    hd->config = *config;
+    if (overrides.port >= 0) hd->config.server_port = (uint16_t)overrides.port;
+    if (overrides.max_open_sockets > 0) hd->config.max_open_sockets = (uint16_t)overrides.max_open_sockets;
+    if (overrides.lru_purge >= 0) hd->config.lru_purge_enable = overrides.lru_purge != 0;
+    if (overrides.backlog > 0) hd->config.backlog_conn = (uint16_t)overrides.backlog;
+    hd->request_cost_us = overrides.request_cost_us;
+
+    int lwip_max = overrides.lwip_max_sockets > 0 ? overrides.lwip_max_sockets : SIM_LWIP_MAX_SOCKETS;
+    if (hd->config.max_open_sockets > lwip_max - HTTPD_INTERNAL_SOCKETS ||
+        hd->config.max_open_sockets > SIM_HTTPD_MAX_SESSIONS) {
+        ESP_LOGE(TAG, "Config option max_open_sockets is too large (max allowed %d)",
+                 lwip_max - HTTPD_INTERNAL_SOCKETS);
+        free(hd);
+        return ESP_ERR_INVALID_ARG;
+    }
+    hd->handlers = calloc(hd->config.max_uri_handlers, sizeof(httpd_uri_t));
+    for (int i = 0; i < SIM_HTTPD_MAX_SESSIONS; i++) {
+        hd->sessions[i].fd = -1;
+    }
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(hd->config.server_port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    int one = 1;
+    socklen_t addr_len = sizeof(addr);
+    hd->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (hd->handlers == NULL || hd->listen_fd < 0 ||
+        setsockopt(hd->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+        bind(hd->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(hd->listen_fd, hd->config.backlog_conn) != 0 ||
+        getsockname(hd->listen_fd, (struct sockaddr *)&addr, &addr_len) != 0 ||
+        pipe(hd->ctrl) != 0) {
+        ESP_LOGE(TAG, "Cannot listen on port %u: %s", hd->config.server_port, strerror(errno));
+        if (hd->listen_fd >= 0) {
+            close(hd->listen_fd);
+        }
+        free(hd->handlers);
+        free(hd);
+        return ESP_FAIL;
+    }
+    fcntl(hd->listen_fd, F_SETFL, fcntl(hd->listen_fd, F_GETFL) | O_NONBLOCK);
+    fcntl(hd->ctrl[0], F_SETFL, fcntl(hd->ctrl[0], F_GETFL) | O_NONBLOCK);
+    fcntl(hd->ctrl[1], F_SETFL, fcntl(hd->ctrl[1], F_GETFL) | O_NONBLOCK);
+    hd->port = ntohs(addr.sin_port);
+
+    if (xTaskCreatePinnedToCore(server_task, "httpd", hd->config.stack_size, hd,
+                                hd->config.task_priority, NULL, hd->config.core_id) != pdPASS) {
+        close(hd->listen_fd);
+        free(hd->handlers);
+        free(hd);
+        return ESP_ERR_HTTPD_TASK;
+    }
+    running_server = hd;
+    *handle = hd;
+    ESP_LOGI(TAG, "Listening on 127.0.0.1:%u (max_open_sockets=%u, lru_purge=%d, backlog=%u)",
+             hd->port, hd->config.max_open_sockets, hd->config.lru_purge_enable,
+             hd->config.backlog_conn);
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    // The server task lives as long as the simulation; stop accepting only
+    if (handle != NULL && handle->listen_fd >= 0) {
+        close(handle->listen_fd);
+        handle->listen_fd = -1;
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+    if (handle == NULL || uri_handler == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < handle->handler_count; i++) {
+        if (strcmp(handle->handlers[i].uri, uri_handler->uri) == 0 &&
+            handle->handlers[i].method == uri_handler->method) {
+            return ESP_ERR_HTTPD_HANDLER_EXISTS;
+        }
+    }
+    if (handle->handler_count >= handle->config.max_uri_handlers) {
+        ESP_LOGW(TAG, "No slots left for registering handler (max_uri_handlers=%u)",
+                 handle->config.max_uri_handlers);
+        return ESP_ERR_HTTPD_HANDLERS_FULL;
+    }
+    handle->handlers[handle->handler_count++] = *uri_handler;
+    return ESP_OK;
+}
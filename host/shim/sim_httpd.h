@@ -0,0 +1,47 @@
+#ifndef SIM_HTTPD_H
+#define SIM_HTTPD_H
+
+// Harness side of the esp_http_server shim: configuration overrides to
+// explore other httpd settings without editing web_server.c, and the
+// server-side counters a load test reports next to client latencies.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    int port;                   // -1: keep the firmware's port, 0: any free port
+    int max_open_sockets;       // 0: keep
+    int lru_purge;              // -1: keep, 0/1: off/on
+    int backlog;                // 0: keep
+    int lwip_max_sockets;       // 0: CONFIG_LWIP_MAX_SOCKETS from sdkconfig.defaults
+    uint32_t request_cost_us;   // Server task time charged per request (ESP32 parse + lwIP)
+} sim_httpd_overrides_t;
+
+// Applied by the next httpd_start()
+void sim_httpd_override(const sim_httpd_overrides_t *overrides);
+
+// Port the running server listens on (127.0.0.1), 0 if not started
+uint16_t sim_httpd_port(void);
+
+typedef struct {
+    uint32_t accepted;          // Connections that got a session
+    uint32_t refused;           // Accepted and closed at once: all sessions taken
+    uint32_t lru_purged;        // Sessions closed to make room (lru_purge_enable)
+    uint32_t closed_on_error;   // Closed after a failed handler, 404/405 or bad request
+    uint32_t closed_by_peer;
+    uint32_t timeouts;          // recv/send timeouts (each one stalls the server task)
+    uint32_t requests;
+    uint32_t responses_2xx;
+    uint32_t responses_4xx;
+    uint32_t responses_5xx;
+    uint32_t ws_frames_sent;
+    uint32_t work_queued;       // httpd_queue_work() calls accepted
+    uint32_t work_dropped;      // ... refused (control queue full)
+    uint16_t open_sockets;      // Sessions open now
+    uint16_t open_sockets_max;
+    uint64_t busy_us;           // Time the server task spent handling events
+} sim_httpd_stats_t;
+
+void sim_httpd_get_stats(sim_httpd_stats_t *out);
+
+#endif // SIM_HTTPD_H
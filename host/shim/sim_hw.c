@@ -0,0 +1,489 @@
+#include "sim_hw.h"
+#include "sim_sched.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "driver/gptimer.h"
+#include "rom/ets_sys.h"
+#include "freertos/task.h"
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+// GPIO
+
+typedef struct {
+    int level;                  // Last level driven by the firmware
+    sim_gpio_input_fn input;
+    sim_gpio_output_fn output;
+    void *input_ctx;
+    void *output_ctx;
+} sim_pin_t;
+
+static sim_pin_t pins[GPIO_NUM_MAX];
+static void (*sync_hook)(void) = NULL;
+
+static bool pin_valid(gpio_num_t pin)
+{
+    return pin >= 0 && pin < GPIO_NUM_MAX;
+}
+
+void sim_gpio_attach_input(gpio_num_t pin, sim_gpio_input_fn fn, void *ctx)
+{
+    if (pin_valid(pin)) {
+        pins[pin].input = fn;
+        pins[pin].input_ctx = ctx;
+    }
+}
+
+void sim_gpio_attach_output(gpio_num_t pin, sim_gpio_output_fn fn, void *ctx)
+{
+    if (pin_valid(pin)) {
+        pins[pin].output = fn;
+        pins[pin].output_ctx = ctx;
+    }
+}
+
+int sim_gpio_output_level(gpio_num_t pin)
+{
+    return pin_valid(pin) ? pins[pin].level : 0;
+}
+
+void sim_hw_set_sync_hook(void (*fn)(void))
+{
+    sync_hook = fn;
+}
+
+esp_err_t gpio_config(const gpio_config_t *conf)
+{
+    return conf->pin_bit_mask >> GPIO_NUM_MAX ? ESP_ERR_INVALID_ARG : ESP_OK;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t pin)
+{
+    return pin_valid(pin) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t pin, gpio_mode_t mode)
+{
+    return pin_valid(pin) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level)
+{
+    if (!pin_valid(pin)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (sync_hook) {
+        sync_hook();
+    }
+    pins[pin].level = level ? 1 : 0;
+    if (pins[pin].output) {
+        pins[pin].output(pins[pin].output_ctx, pins[pin].level);
+    }
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t pin)
+{
+    if (!pin_valid(pin)) {
+        return 0;
+    }
+    return pins[pin].input ? pins[pin].input(pins[pin].input_ctx) : pins[pin].level;
+}
+
+// LEDC
+
+static uint32_t duty_pending[LEDC_CHANNEL_MAX];
+static uint32_t duty_latched[LEDC_CHANNEL_MAX];
+static uint8_t timer_bits[LEDC_TIMER_MAX] = { 8, 8, 8, 8 };
+static uint8_t channel_timer[LEDC_CHANNEL_MAX];
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *conf)
+{
+    if (conf->timer_num >= LEDC_TIMER_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    timer_bits[conf->timer_num] = (uint8_t)conf->duty_resolution;
+    return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *conf)
+{
+    if (conf->channel >= LEDC_CHANNEL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (sync_hook) {
+        sync_hook();
+    }
+    channel_timer[conf->channel] = (uint8_t)conf->timer_sel;
+    duty_pending[conf->channel] = conf->duty;
+    duty_latched[conf->channel] = conf->duty;
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t mode, ledc_channel_t channel, uint32_t duty)
+{
+    if (channel >= LEDC_CHANNEL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    duty_pending[channel] = duty;
+    return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t mode, ledc_channel_t channel)
+{
+    if (channel >= LEDC_CHANNEL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (sync_hook) {
+        sync_hook();
+    }
+    duty_latched[channel] = duty_pending[channel];
+    return ESP_OK;
+}
+
+uint32_t ledc_get_duty(ledc_mode_t mode, ledc_channel_t channel)
+{
+    return channel < LEDC_CHANNEL_MAX ? duty_latched[channel] : 0;
+}
+
+uint32_t sim_ledc_duty(ledc_channel_t channel)
+{
+    return ledc_get_duty(LEDC_LOW_SPEED_MODE, channel);
+}
+
+uint32_t sim_ledc_max_duty(ledc_channel_t channel)
+{
+    return channel < LEDC_CHANNEL_MAX ? (1u << timer_bits[channel_timer[channel]]) - 1 : 0;
+}
+
+// UART
+
+#define SIM_UART_RX_LEN 1024
+
+typedef struct {
+    sim_uart_tx_fn tx;
+    void *ctx;
+    uint8_t rx[SIM_UART_RX_LEN];
+    size_t rx_len;
+} sim_uart_t;
+
+static sim_uart_t uarts[UART_NUM_MAX];
+
+void sim_uart_attach(uart_port_t port, sim_uart_tx_fn fn, void *ctx)
+{
+    if (port >= 0 && port < UART_NUM_MAX) {
+        uarts[port].tx = fn;
+        uarts[port].ctx = ctx;
+    }
+}
+
+void sim_uart_inject(uart_port_t port, const uint8_t *data, size_t len)
+{
+    if (port < 0 || port >= UART_NUM_MAX) {
+        return;
+    }
+    sim_uart_t *u = &uarts[port];
+    if (len > SIM_UART_RX_LEN - u->rx_len) {
+        len = SIM_UART_RX_LEN - u->rx_len;   // RX FIFO overflow drops the rest
+    }
+    memcpy(u->rx + u->rx_len, data, len);
+    u->rx_len += len;
+}
+
+esp_err_t uart_param_config(uart_port_t port, const uart_config_t *conf)
+{
+    return port >= 0 && port < UART_NUM_MAX ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_set_pin(uart_port_t port, int tx, int rx, int rts, int cts)
+{
+    return port >= 0 && port < UART_NUM_MAX ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_driver_install(uart_port_t port, int rx_buf, int tx_buf, int queue_size,
+                              void *queue, int intr_flags)
+{
+    return port >= 0 && port < UART_NUM_MAX ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_driver_delete(uart_port_t port)
+{
+    return ESP_OK;
+}
+
+int uart_write_bytes(uart_port_t port, const void *src, size_t size)
+{
+    if (port < 0 || port >= UART_NUM_MAX) {
+        return -1;
+    }
+    if (uarts[port].tx) {
+        uarts[port].tx(uarts[port].ctx, src, size);
+    }
+    return (int)size;
+}
+
+int uart_read_bytes(uart_port_t port, void *buf, uint32_t length, TickType_t ticks_to_wait)
+{
+    if (port < 0 || port >= UART_NUM_MAX) {
+        return -1;
+    }
+    sim_uart_t *u = &uarts[port];
+    if (u->rx_len < length && ticks_to_wait > 0) {
+        vTaskDelay(ticks_to_wait);
+    }
+    size_t n = length < u->rx_len ? length : u->rx_len;
+    memcpy(buf, u->rx, n);
+    memmove(u->rx, u->rx + n, u->rx_len - n);
+    u->rx_len -= n;
+    return (int)n;
+}
+
+esp_err_t uart_wait_tx_done(uart_port_t port, TickType_t ticks_to_wait)
+{
+    return ESP_OK;
+}
+
+// GPTIMER: the counter is derived from the virtual clock, the alarm is a
+// one-shot esp_timer re-armed on every start / reload
+
+#define SIM_GPTIMER_MAX 4
+
+struct sim_gptimer {
+    uint32_t resolution_hz;
+    gptimer_alarm_cb_t on_alarm;
+    void *user_ctx;
+    gptimer_alarm_config_t alarm;
+    bool alarm_set;
+    bool enabled;
+    bool running;
+    uint64_t count_base;        // Count at start_us
+    int64_t start_us;
+    esp_timer_handle_t esp;
+};
+
+static struct sim_gptimer gptimers[SIM_GPTIMER_MAX];
+static int gptimer_used = 0;
+
+static uint64_t gptimer_count_now(const struct sim_gptimer *t)
+{
+    if (!t->running) {
+        return t->count_base;
+    }
+    return t->count_base +
+           (uint64_t)(esp_timer_get_time() - t->start_us) * t->resolution_hz / 1000000u;
+}
+
+static void gptimer_arm(struct sim_gptimer *t)
+{
+    esp_timer_stop(t->esp);
+    if (!t->running || !t->alarm_set) {
+        return;
+    }
+    uint64_t count = gptimer_count_now(t);
+    uint64_t ticks = t->alarm.alarm_count > count ? t->alarm.alarm_count - count : 0;
+    esp_timer_start_once(t->esp, (ticks * 1000000u + t->resolution_hz - 1) / t->resolution_hz);
+}
+
+static void gptimer_fire(void *arg)
+{
+    struct sim_gptimer *t = arg;
+    if (!t->running) {
+        return;
+    }
+    gptimer_alarm_event_data_t edata = {
+        .count_value = gptimer_count_now(t),
+        .alarm_value = t->alarm.alarm_count
+    };
+    if (t->alarm.flags.auto_reload_on_alarm) {
+        t->count_base = t->alarm.reload_count;
+        t->start_us = esp_timer_get_time();
+    }
+    if (t->on_alarm != NULL) {
+        t->on_alarm(t, &edata, t->user_ctx);
+    }
+    if (t->alarm.flags.auto_reload_on_alarm) {
+        gptimer_arm(t);
+    }
+}
+
+esp_err_t gptimer_new_timer(const gptimer_config_t *config, gptimer_handle_t *ret_timer)
+{
+    if (config->resolution_hz == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (gptimer_used >= SIM_GPTIMER_MAX) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    struct sim_gptimer *t = &gptimers[gptimer_used++];
+    memset(t, 0, sizeof(*t));
+    t->resolution_hz = config->resolution_hz;
+    const esp_timer_create_args_t args = { .callback = gptimer_fire, .arg = t, .name = "gptimer" };
+    esp_err_t err = esp_timer_create(&args, &t->esp);
+    if (err != ESP_OK) {
+        gptimer_used--;
+        return err;
+    }
+    *ret_timer = t;
+    return ESP_OK;
+}
+
+esp_err_t gptimer_del_timer(gptimer_handle_t timer)
+{
+    if (timer->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_timer_delete(timer->esp);
+    return ESP_OK;
+}
+
+esp_err_t gptimer_register_event_callbacks(gptimer_handle_t timer, const gptimer_event_callbacks_t *cbs,
+                                           void *user_data)
+{
+    if (timer->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->on_alarm = cbs->on_alarm;
+    timer->user_ctx = user_data;
+    return ESP_OK;
+}
+
+esp_err_t gptimer_set_alarm_action(gptimer_handle_t timer, const gptimer_alarm_config_t *config)
+{
+    timer->alarm_set = config != NULL;
+    if (config != NULL) {
+        timer->alarm = *config;
+    }
+    gptimer_arm(timer);
+    return ESP_OK;
+}
+
+esp_err_t gptimer_enable(gptimer_handle_t timer)
+{
+    if (timer->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t gptimer_disable(gptimer_handle_t timer)
+{
+    if (!timer->enabled || timer->running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t gptimer_start(gptimer_handle_t timer)
+{
+    if (!timer->enabled || timer->running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->start_us = esp_timer_get_time();
+    timer->running = true;
+    gptimer_arm(timer);
+    return ESP_OK;
+}
+
+esp_err_t gptimer_stop(gptimer_handle_t timer)
+{
+    if (!timer->running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->count_base = gptimer_count_now(timer);
+    timer->running = false;
+    esp_timer_stop(timer->esp);
+    return ESP_OK;
+}
+
+esp_err_t gptimer_get_raw_count(gptimer_handle_t timer, uint64_t *value)
+{
+    *value = gptimer_count_now(timer);
+    return ESP_OK;
+}
+
+// Logging
+
+esp_log_level_t sim_log_level = ESP_LOG_WARN;
+
+void sim_log(esp_log_level_t level, const char *tag, const char *fmt, ...)
+{
+    static const char letters[] = "NEWIDV";
+    if (level > sim_log_level) {
+        return;
+    }
+    fprintf(stderr, "%c (%lld) %s: ", letters[level], (long long)(sim_now_us() / 1000), tag);
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+}
+
+// System
+
+static esp_reset_reason_t reset_reason = ESP_RST_POWERON;
+
+esp_reset_reason_t esp_reset_reason(void)
+{
+    return reset_reason;
+}
+
+void sim_set_reset_reason(esp_reset_reason_t reason)
+{
+    reset_reason = reason;
+}
+
+void esp_restart(void)
+{
+    fprintf(stderr, "esp_restart() called at %lld ms\n", (long long)(sim_now_us() / 1000));
+    exit(3);
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return 256 * 1024;
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+    return 256 * 1024;
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+        case ESP_OK:                return "ESP_OK";
+        case ESP_FAIL:              return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:        return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:   return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:  return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:     return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:       return "ESP_ERR_TIMEOUT";
+        default:                    return "UNKNOWN ERROR";
+    }
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+void ets_delay_us(uint32_t us)
+{
+    sim_advance_us(us);
+}
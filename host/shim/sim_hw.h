@@ -0,0 +1,34 @@
+#ifndef SIM_HW_H
+#define SIM_HW_H
+
+// Device-model side of the gpio / ledc / uart shims
+
+#include <stddef.h>
+#include <stdint.h>
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "driver/uart.h"
+
+// Level returned by gpio_get_level() for an input driven by a device
+typedef int (*sim_gpio_input_fn)(void *ctx);
+// Called after the firmware drives an output pin
+typedef void (*sim_gpio_output_fn)(void *ctx, int level);
+
+void sim_gpio_attach_input(gpio_num_t pin, sim_gpio_input_fn fn, void *ctx);
+void sim_gpio_attach_output(gpio_num_t pin, sim_gpio_output_fn fn, void *ctx);
+
+// Current output level / latched PWM duty, as seen by the hardware
+int sim_gpio_output_level(gpio_num_t pin);
+uint32_t sim_ledc_duty(ledc_channel_t channel);
+uint32_t sim_ledc_max_duty(ledc_channel_t channel);
+
+// Called before a motor-relevant output changes (gpio level or PWM duty),
+// so a physics model can integrate up to now with the old drive values
+void sim_hw_set_sync_hook(void (*fn)(void));
+
+// UART: TX bytes go to the hook, sim_uart_inject() feeds RX
+typedef void (*sim_uart_tx_fn)(void *ctx, const uint8_t *data, size_t len);
+void sim_uart_attach(uart_port_t port, sim_uart_tx_fn fn, void *ctx);
+void sim_uart_inject(uart_port_t port, const uint8_t *data, size_t len);
+
+#endif // SIM_HW_H
@@ -0,0 +1,125 @@
+#include "nvs.h"
+#include "nvs_flash.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_NVS_MAX_ENTRIES 16
+#define SIM_NVS_MAX_NAMESPACES 8
+#define SIM_NVS_KEY_LEN 16      // NVS limit: 15 characters
+
+typedef struct {
+    char ns[SIM_NVS_KEY_LEN];
+    char key[SIM_NVS_KEY_LEN];
+    void *data;
+    size_t len;
+} nvs_entry_t;
+
+static nvs_entry_t entries[SIM_NVS_MAX_ENTRIES];
+static char namespaces[SIM_NVS_MAX_NAMESPACES][SIM_NVS_KEY_LEN];
+static bool initialized = false;
+
+esp_err_t nvs_flash_init(void)
+{
+    initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    for (int i = 0; i < SIM_NVS_MAX_ENTRIES; i++) {
+        free(entries[i].data);
+    }
+    memset(entries, 0, sizeof(entries));
+    return ESP_OK;
+}
+
+// Handles are namespace index + 1
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *out)
+{
+    if (!initialized) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    if (strlen(name) >= SIM_NVS_KEY_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < SIM_NVS_MAX_NAMESPACES; i++) {
+        if (namespaces[i][0] == '\0') {
+            if (mode == NVS_READONLY) {
+                return ESP_ERR_NVS_NOT_FOUND;
+            }
+            strcpy(namespaces[i], name);
+        }
+        if (strcmp(namespaces[i], name) == 0) {
+            *out = (nvs_handle_t)i + 1;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return ESP_OK;
+}
+
+static nvs_entry_t *find(nvs_handle_t handle, const char *key, bool create)
+{
+    const char *ns = namespaces[handle - 1];
+    nvs_entry_t *free_entry = NULL;
+    for (int i = 0; i < SIM_NVS_MAX_ENTRIES; i++) {
+        nvs_entry_t *e = &entries[i];
+        if (e->data != NULL && strcmp(e->ns, ns) == 0 && strcmp(e->key, key) == 0) {
+            return e;
+        }
+        if (e->data == NULL && free_entry == NULL) {
+            free_entry = e;
+        }
+    }
+    if (!create || free_entry == NULL) {
+        return NULL;
+    }
+    strcpy(free_entry->ns, ns);
+    strcpy(free_entry->key, key);
+    return free_entry;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    if (strlen(key) >= SIM_NVS_KEY_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    nvs_entry_t *e = find(handle, key, true);
+    void *data = malloc(length ? length : 1);
+    if (e == NULL || data == NULL) {
+        free(data);
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+    memcpy(data, value, length);
+    free(e->data);
+    e->data = data;
+    e->len = length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out, size_t *length)
+{
+    nvs_entry_t *e = find(handle, key, false);
+    if (e == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out == NULL) {
+        *length = e->len;
+        return ESP_OK;
+    }
+    if (*length < e->len) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out, e->data, e->len);
+    *length = e->len;
+    return ESP_OK;
+}
@@ -0,0 +1,199 @@
+#include "esp_partition.h"
+#include "sim_partition.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SIM_PARTITION_MAX 4
+#define SIM_FLASH_SECTOR 4096
+
+typedef struct {
+    esp_partition_t part;
+    int fd;
+} sim_partition_t;
+
+static sim_partition_t partitions[SIM_PARTITION_MAX];
+static int partition_count = 0;
+static sim_partition_stats_t stats;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static bool fill_erased(int fd, off_t offset, size_t size)
+{
+    static uint8_t erased[SIM_FLASH_SECTOR];
+    memset(erased, 0xFF, sizeof(erased));
+    while (size > 0) {
+        size_t n = size < sizeof(erased) ? size : sizeof(erased);
+        if (pwrite(fd, erased, n, offset) != (ssize_t)n) {
+            return false;
+        }
+        offset += (off_t)n;
+        size -= n;
+    }
+    return true;
+}
+
+bool sim_partition_attach(const char *label, uint8_t type, uint8_t subtype,
+                          uint32_t address, uint32_t size, const char *path)
+{
+    if (partition_count >= SIM_PARTITION_MAX || size % SIM_FLASH_SECTOR != 0) {
+        return false;
+    }
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size != (off_t)size) {
+        // New image: all of it erased
+        if (ftruncate(fd, 0) != 0 || !fill_erased(fd, 0, size)) {
+            perror(path);
+            close(fd);
+            return false;
+        }
+    }
+
+    sim_partition_t *p = &partitions[partition_count++];
+    memset(p, 0, sizeof(*p));
+    p->part.type = (esp_partition_type_t)type;
+    p->part.subtype = (esp_partition_subtype_t)subtype;
+    p->part.address = address;
+    p->part.size = size;
+    p->part.erase_size = SIM_FLASH_SECTOR;
+    snprintf(p->part.label, sizeof(p->part.label), "%s", label);
+    p->fd = fd;
+    return true;
+}
+
+void sim_partition_detach_all(void)
+{
+    for (int i = 0; i < partition_count; i++) {
+        close(partitions[i].fd);
+    }
+    partition_count = 0;
+}
+
+void sim_partition_get_stats(sim_partition_stats_t *out)
+{
+    *out = stats;
+}
+
+void sim_partition_reset_stats(void)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    for (int i = 0; i < partition_count && i < SIM_PARTITION_MAX; i++) {
+        const esp_partition_t *p = &partitions[i].part;
+        if ((type == ESP_PARTITION_TYPE_ANY || p->type == type) &&
+            (subtype == ESP_PARTITION_SUBTYPE_ANY || p->subtype == subtype) &&
+            (label == NULL || strcmp(p->label, label) == 0)) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static int fd_of(const esp_partition_t *partition)
+{
+    return ((const sim_partition_t *)partition)->fd;
+}
+
+static bool in_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    if (offset > partition->size || size > partition->size - offset) {
+        stats.alignment_errors++;
+        return false;
+    }
+    return true;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset,
+                             void *dst, size_t size)
+{
+    if (partition == NULL || dst == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!in_range(partition, src_offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint64_t start = now_ns();
+    ssize_t n = pread(fd_of(partition), dst, size, (off_t)src_offset);
+    stats.io_ns += now_ns() - start;
+    stats.reads++;
+    stats.read_bytes += size;
+    return n == (ssize_t)size ? ESP_OK : ESP_FAIL;
+}
+
+// NOR programming: bits only go from 1 to 0
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset,
+                              const void *src, size_t size)
+{
+    if (partition == NULL || src == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!in_range(partition, dst_offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint64_t start = now_ns();
+    uint8_t *cur = malloc(size);
+    if (cur == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = ESP_FAIL;
+    int fd = fd_of(partition);
+    if (pread(fd, cur, size, (off_t)dst_offset) == (ssize_t)size) {
+        const uint8_t *in = src;
+        bool violation = false;
+        for (size_t i = 0; i < size; i++) {
+            violation |= (in[i] & ~cur[i]) != 0;
+            cur[i] &= in[i];
+        }
+        if (violation) {
+            stats.program_violations++;
+        }
+        if (pwrite(fd, cur, size, (off_t)dst_offset) == (ssize_t)size) {
+            err = ESP_OK;
+        }
+    }
+    free(cur);
+    stats.io_ns += now_ns() - start;
+    stats.writes++;
+    stats.write_bytes += size;
+    return err;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset,
+                                    size_t size)
+{
+    if (partition == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (offset % SIM_FLASH_SECTOR != 0 || size % SIM_FLASH_SECTOR != 0) {
+        stats.alignment_errors++;
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!in_range(partition, offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint64_t start = now_ns();
+    bool ok = fill_erased(fd_of(partition), (off_t)offset, size);
+    stats.io_ns += now_ns() - start;
+    stats.erases++;
+    stats.erase_bytes += size;
+    return ok ? ESP_OK : ESP_FAIL;
+}
@@ -0,0 +1,31 @@
+#ifndef SIM_PARTITION_H
+#define SIM_PARTITION_H
+
+// Harness side of the esp_partition shim: back a partition with an image
+// file and count the flash traffic the firmware generates.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Attach an image file as a partition (created filled with 0xFF, i.e.
+// erased, if missing or of another size). address only shows up in logs.
+bool sim_partition_attach(const char *label, uint8_t type, uint8_t subtype,
+                          uint32_t address, uint32_t size, const char *path);
+void sim_partition_detach_all(void);
+
+typedef struct {
+    uint64_t reads;
+    uint64_t read_bytes;
+    uint64_t writes;
+    uint64_t write_bytes;
+    uint64_t erases;
+    uint64_t erase_bytes;
+    uint64_t io_ns;                 // Host time spent in the image file
+    uint32_t program_violations;    // Writes that tried to set a 0 bit back to 1
+    uint32_t alignment_errors;      // Erases not on sector boundaries, out-of-range access
+} sim_partition_stats_t;
+
+void sim_partition_get_stats(sim_partition_stats_t *out);
+void sim_partition_reset_stats(void);
+
+#endif // SIM_PARTITION_H
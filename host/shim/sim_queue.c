@@ -0,0 +1,115 @@
+#include "sim_sched.h"
+#include "esp_timer.h"
+#include "freertos/queue.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TICK_US (1000000 / configTICK_RATE_HZ)
+
+// Tasks run one at a time, so the queue state needs no lock: a task can
+// only be interrupted while it waits in sim_wait()
+struct sim_queue {
+    UBaseType_t item_size;      // 0 for semaphores
+    UBaseType_t length;
+    UBaseType_t count;
+    UBaseType_t head;
+    uint8_t items[];
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    if (length == 0) {
+        return NULL;
+    }
+    QueueHandle_t q = calloc(1, sizeof(*q) + (size_t)length * item_size);
+    if (q != NULL) {
+        q->item_size = item_size;
+        q->length = length;
+    }
+    return q;
+}
+
+QueueHandle_t xQueueCreateCountingSemaphore(UBaseType_t max_count, UBaseType_t initial_count)
+{
+    QueueHandle_t q = xQueueCreate(max_count, 0);
+    if (q != NULL) {
+        q->count = initial_count;
+    }
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    free(queue);
+}
+
+// Wait until ready(q) holds or the ticks run out; false on timeout
+static bool wait_until(QueueHandle_t q, bool (*ready)(QueueHandle_t), TickType_t ticks)
+{
+    int64_t deadline = ticks == portMAX_DELAY ? -1 : esp_timer_get_time() + (int64_t)ticks * TICK_US;
+    while (!ready(q)) {
+        int64_t now = esp_timer_get_time();
+        if (deadline >= 0 && now >= deadline) {
+            return false;
+        }
+        sim_wait(q, deadline < 0 ? -1 : deadline - now);
+    }
+    return true;
+}
+
+static bool has_space(QueueHandle_t q)
+{
+    return q->count < q->length;
+}
+
+static bool has_item(QueueHandle_t q)
+{
+    return q->count > 0;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait)
+{
+    if (!wait_until(queue, has_space, ticks_to_wait)) {
+        return pdFALSE;
+    }
+    if (queue->item_size > 0) {
+        UBaseType_t tail = (queue->head + queue->count) % queue->length;
+        memcpy(queue->items + (size_t)tail * queue->item_size, item, queue->item_size);
+    }
+    queue->count++;
+    sim_notify(queue);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *out, TickType_t ticks_to_wait)
+{
+    if (!wait_until(queue, has_item, ticks_to_wait)) {
+        return pdFALSE;
+    }
+    if (queue->item_size > 0) {
+        memcpy(out, queue->items + (size_t)queue->head * queue->item_size, queue->item_size);
+        queue->head = (queue->head + 1) % queue->length;
+    }
+    queue->count--;
+    sim_notify(queue);
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    return queue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+{
+    return queue->length - queue->count;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+    queue->count = 0;
+    queue->head = 0;
+    sim_notify(queue);
+    return pdPASS;
+}
@@ -0,0 +1,516 @@
+#include "sim_sched.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define TICK_US (1000000 / configTICK_RATE_HZ)
+#define SIM_MAX_POLL_FDS 64
+#define FOREVER INT64_MAX
+
+struct sim_task {
+    pthread_t thread;
+    const char *name;
+    TaskFunction_t fn;
+    void *arg;
+    UBaseType_t priority;
+    BaseType_t core;
+    int64_t wake_us;
+    bool done;
+    const void *wait_obj;       // sim_wait() object, NULL if none
+    struct pollfd *pfds;        // sim_poll() set, NULL if none
+    int npfds;
+};
+
+struct sim_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    const char *name;
+    int64_t expiry_us;
+    uint64_t period_us;     // 0 for one-shot
+    bool active;
+    bool used;
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static int64_t now_us = 0;
+static uint64_t switches = 0;
+
+static struct sim_task tasks[SIM_MAX_TASKS];
+static int task_count = 0;
+static struct sim_task *running = NULL;     // NULL: the scheduler owns the CPU
+static struct sim_timer timers[SIM_MAX_TIMERS];
+static bool realtime = false;
+static int64_t wall_origin_us;      // Wall clock at virtual time 0
+
+static int64_t wall_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000 - wall_origin_us;
+}
+
+// Real-time mode: catch the clock up with the wall clock; caller holds lock
+static void sync_clock(void)
+{
+    if (realtime) {
+        int64_t w = wall_us();
+        if (w > now_us) {
+            now_us = w;
+        }
+    }
+}
+
+int64_t sim_now_us(void)
+{
+    pthread_mutex_lock(&lock);
+    sync_clock();
+    int64_t t = now_us;
+    pthread_mutex_unlock(&lock);
+    return t;
+}
+
+void sim_advance_us(int64_t us)
+{
+    pthread_mutex_lock(&lock);
+    if (realtime) {
+        // Busy-wait for real: the caller keeps the CPU meanwhile
+        int64_t end = wall_us() + us;
+        while (wall_us() < end) {
+        }
+        sync_clock();
+    } else {
+        now_us += us;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+uint64_t sim_switches(void)
+{
+    return switches;
+}
+
+// Give the CPU back to the scheduler until wake_us; caller holds lock
+static void block_until(struct sim_task *self, int64_t wake_us)
+{
+    self->wake_us = wake_us;
+    running = NULL;
+    pthread_cond_broadcast(&cond);
+    while (running != self) {
+        pthread_cond_wait(&cond, &lock);
+    }
+}
+
+static struct sim_task *current_task(void)
+{
+    pthread_t me = pthread_self();
+    for (int i = 0; i < task_count; i++) {
+        if (!tasks[i].done && pthread_equal(tasks[i].thread, me)) {
+            return &tasks[i];
+        }
+    }
+    return NULL;
+}
+
+static void *task_entry(void *p)
+{
+    struct sim_task *self = p;
+    pthread_mutex_lock(&lock);
+    while (running != self) {
+        pthread_cond_wait(&cond, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+
+    self->fn(self->arg);
+
+    // Returning from a task function is an error on FreeRTOS; treat it as delete
+    vTaskDelete(NULL);
+    return NULL;
+}
+
+void sim_run_until(int64_t t_us)
+{
+    pthread_mutex_lock(&lock);
+    while (1) {
+        // Earliest runnable task (higher priority first on a tie) or timer
+        struct sim_task *next_task = NULL;
+        for (int i = 0; i < task_count; i++) {
+            struct sim_task *t = &tasks[i];
+            if (t->done || t->wake_us > t_us) {
+                continue;
+            }
+            if (next_task == NULL || t->wake_us < next_task->wake_us ||
+                (t->wake_us == next_task->wake_us && t->priority > next_task->priority)) {
+                next_task = t;
+            }
+        }
+        struct sim_timer *next_timer = NULL;
+        for (int i = 0; i < SIM_MAX_TIMERS; i++) {
+            struct sim_timer *tm = &timers[i];
+            if (tm->active && tm->expiry_us <= t_us &&
+                (next_timer == NULL || tm->expiry_us < next_timer->expiry_us)) {
+                next_timer = tm;
+            }
+        }
+
+        if (next_timer != NULL && (next_task == NULL || next_timer->expiry_us <= next_task->wake_us)) {
+            if (next_timer->expiry_us > now_us) {
+                now_us = next_timer->expiry_us;
+            }
+            if (next_timer->period_us) {
+                next_timer->expiry_us += next_timer->period_us;
+            } else {
+                next_timer->active = false;
+            }
+            switches++;
+            pthread_mutex_unlock(&lock);
+            next_timer->callback(next_timer->arg);
+            pthread_mutex_lock(&lock);
+            continue;
+        }
+        if (next_task == NULL) {
+            break;
+        }
+
+        if (next_task->wake_us > now_us) {
+            now_us = next_task->wake_us;
+        }
+        switches++;
+        running = next_task;
+        pthread_cond_broadcast(&cond);
+        while (running != NULL) {
+            pthread_cond_wait(&cond, &lock);
+        }
+    }
+    if (now_us < t_us) {
+        now_us = t_us;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void sim_set_realtime(bool enabled)
+{
+    pthread_mutex_lock(&lock);
+    realtime = false;
+    wall_origin_us = wall_us() + wall_origin_us - now_us;
+    realtime = enabled;
+    pthread_mutex_unlock(&lock);
+}
+
+void sim_run_realtime(int64_t t_us)
+{
+    struct pollfd fds[SIM_MAX_POLL_FDS];
+    struct sim_task *owners[SIM_MAX_POLL_FDS];
+
+    while (1) {
+        int64_t now = sim_now_us();
+        sim_run_until(now < t_us ? now : t_us);
+        if (now >= t_us) {
+            break;
+        }
+
+        // Sleep until the next wake-up or timer, or a socket a task waits on
+        int nfds = 0;
+        int64_t next = t_us;
+        pthread_mutex_lock(&lock);
+        for (int i = 0; i < task_count; i++) {
+            struct sim_task *t = &tasks[i];
+            if (t->done) {
+                continue;
+            }
+            if (t->wake_us < next) {
+                next = t->wake_us;
+            }
+            for (int k = 0; t->pfds != NULL && k < t->npfds && nfds < SIM_MAX_POLL_FDS; k++) {
+                fds[nfds] = t->pfds[k];
+                fds[nfds].revents = 0;
+                owners[nfds++] = t;
+            }
+        }
+        for (int i = 0; i < SIM_MAX_TIMERS; i++) {
+            if (timers[i].active && timers[i].expiry_us < next) {
+                next = timers[i].expiry_us;
+            }
+        }
+        sync_clock();
+        int64_t wait_us = next - now_us;
+        pthread_mutex_unlock(&lock);
+
+        if (wait_us > 1000000) {
+            wait_us = 1000000;
+        }
+        int timeout_ms = wait_us <= 0 ? 0 : (int)((wait_us + 999) / 1000);
+        if (poll(fds, nfds, timeout_ms) > 0) {
+            pthread_mutex_lock(&lock);
+            sync_clock();
+            for (int i = 0; i < nfds; i++) {
+                if (fds[i].revents != 0 && owners[i]->pfds != NULL) {
+                    owners[i]->wake_us = now_us;
+                }
+            }
+            pthread_mutex_unlock(&lock);
+        }
+    }
+}
+
+int sim_poll(struct pollfd *fds, int nfds, int timeout_ms)
+{
+    int ready = poll(fds, nfds, 0);
+    if (ready != 0 || timeout_ms == 0) {
+        return ready;
+    }
+    pthread_mutex_lock(&lock);
+    struct sim_task *self = current_task();
+    if (self == NULL) {
+        pthread_mutex_unlock(&lock);
+        return poll(fds, nfds, timeout_ms);
+    }
+    sync_clock();
+    self->pfds = fds;
+    self->npfds = nfds;
+    block_until(self, timeout_ms < 0 ? FOREVER : now_us + (int64_t)timeout_ms * 1000);
+    self->pfds = NULL;
+    pthread_mutex_unlock(&lock);
+    return poll(fds, nfds, 0);
+}
+
+void sim_wait(const void *obj, int64_t timeout_us)
+{
+    pthread_mutex_lock(&lock);
+    struct sim_task *self = current_task();
+    if (self != NULL) {
+        sync_clock();
+        self->wait_obj = obj;
+        block_until(self, timeout_us < 0 ? FOREVER : now_us + timeout_us);
+        self->wait_obj = NULL;
+    } else if (timeout_us > 0) {
+        now_us += timeout_us;     // Not a task: nothing can notify us meanwhile
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void sim_notify(const void *obj)
+{
+    pthread_mutex_lock(&lock);
+    sync_clock();
+    for (int i = 0; i < task_count; i++) {
+        if (!tasks[i].done && tasks[i].wait_obj == obj) {
+            tasks[i].wake_us = now_us;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+// FreeRTOS task API
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack,
+                                   void *arg, UBaseType_t priority, TaskHandle_t *out,
+                                   BaseType_t core)
+{
+    pthread_mutex_lock(&lock);
+    if (task_count == SIM_MAX_TASKS) {
+        pthread_mutex_unlock(&lock);
+        return pdFAIL;
+    }
+    struct sim_task *t = &tasks[task_count++];
+    *t = (struct sim_task) {
+        .name = name,
+        .fn = fn,
+        .arg = arg,
+        .priority = priority,
+        .core = core == tskNO_AFFINITY ? 0 : core,
+        .wake_us = now_us,
+    };
+    if (pthread_create(&t->thread, NULL, task_entry, t) != 0) {
+        task_count--;
+        pthread_mutex_unlock(&lock);
+        return pdFAIL;
+    }
+    pthread_mutex_unlock(&lock);
+    if (out) {
+        *out = t;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                       UBaseType_t priority, TaskHandle_t *out)
+{
+    return xTaskCreatePinnedToCore(fn, name, stack, arg, priority, out, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    pthread_mutex_lock(&lock);
+    struct sim_task *self = current_task();
+    if (task == NULL || task == self) {
+        if (self == NULL) {
+            pthread_mutex_unlock(&lock);
+            return;
+        }
+        self->done = true;
+        running = NULL;
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&lock);
+        pthread_exit(NULL);
+    }
+    // Deleting another task: it is blocked, so it simply never runs again
+    task->done = true;
+    pthread_mutex_unlock(&lock);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    pthread_mutex_lock(&lock);
+    sync_clock();
+    struct sim_task *self = current_task();
+    if (self == NULL) {
+        // Not a task (simulation main thread): just move the clock
+        now_us += (int64_t)ticks * TICK_US;
+    } else {
+        block_until(self, now_us + (int64_t)ticks * TICK_US);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void vTaskDelayUntil(TickType_t *previous_wake, TickType_t period)
+{
+    *previous_wake += period;
+    pthread_mutex_lock(&lock);
+    int64_t wake = (int64_t)*previous_wake * TICK_US;
+    sync_clock();
+    struct sim_task *self = current_task();
+    if (self != NULL) {
+        block_until(self, wake > now_us ? wake : now_us);
+    } else if (wake > now_us) {
+        now_us = wake;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(sim_now_us() / TICK_US);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    pthread_mutex_lock(&lock);
+    struct sim_task *self = current_task();
+    pthread_mutex_unlock(&lock);
+    return self;
+}
+
+const char *pcTaskGetName(TaskHandle_t task)
+{
+    if (task == NULL) {
+        task = xTaskGetCurrentTaskHandle();
+    }
+    return task ? task->name : "sim";
+}
+
+BaseType_t xPortGetCoreID(void)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    return self ? self->core : 0;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    return 0;
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void)
+{
+    pthread_mutex_lock(&lock);
+    UBaseType_t n = 0;
+    for (int i = 0; i < task_count; i++) {
+        n += !tasks[i].done;
+    }
+    pthread_mutex_unlock(&lock);
+    return n;
+}
+
+// esp_timer API
+
+int64_t esp_timer_get_time(void)
+{
+    return sim_now_us();
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+    pthread_mutex_lock(&lock);
+    for (int i = 0; i < SIM_MAX_TIMERS; i++) {
+        if (!timers[i].used) {
+            timers[i] = (struct sim_timer) {
+                .callback = args->callback,
+                .arg = args->arg,
+                .name = args->name,
+                .used = true,
+            };
+            *out = &timers[i];
+            pthread_mutex_unlock(&lock);
+            return ESP_OK;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return ESP_ERR_NO_MEM;
+}
+
+static esp_err_t timer_start(esp_timer_handle_t timer, uint64_t us, uint64_t period)
+{
+    pthread_mutex_lock(&lock);
+    if (timer->active) {
+        pthread_mutex_unlock(&lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    sync_clock();
+    timer->expiry_us = now_us + (int64_t)us;
+    timer->period_us = period;
+    timer->active = true;
+    pthread_mutex_unlock(&lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return timer_start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    return timer_start(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&lock);
+    esp_err_t err = timer->active ? ESP_OK : ESP_ERR_INVALID_STATE;
+    timer->active = false;
+    pthread_mutex_unlock(&lock);
+    return err;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&lock);
+    timer->active = false;
+    timer->used = false;
+    pthread_mutex_unlock(&lock);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&lock);
+    bool active = timer->active;
+    pthread_mutex_unlock(&lock);
+    return active;
+}
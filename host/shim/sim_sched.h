@@ -0,0 +1,49 @@
+#ifndef SIM_SCHED_H
+#define SIM_SCHED_H
+
+// Virtual clock and cooperative scheduler behind the FreeRTOS and
+// esp_timer shims. Time only moves when every task is blocked (or a task
+// busy-waits with ets_delay_us), so a simulated minute takes as long as
+// the code it runs, not sixty seconds.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct pollfd;
+
+#define SIM_MAX_TASKS 16
+#define SIM_MAX_TIMERS 16
+
+int64_t sim_now_us(void);
+
+// Busy wait in the calling context: moves the clock, no task switch
+void sim_advance_us(int64_t us);
+
+// Run tasks and timer callbacks in time order until the clock reaches
+// t_us. Call from the simulation's main thread (not from a task).
+void sim_run_until(int64_t t_us);
+
+// Number of task switches and timer callbacks so far (for reporting)
+uint64_t sim_switches(void);
+
+// Real-time mode (web server on real sockets): the clock follows the wall
+// clock from now on and sim_run_realtime() sleeps until the next task
+// wake-up, timer or socket event instead of jumping ahead. Tasks still run
+// one at a time, like on a single core.
+void sim_set_realtime(bool enabled);
+
+// Real-time counterpart of sim_run_until(), from the main thread
+void sim_run_realtime(int64_t t_us);
+
+// poll() for tasks: blocks the calling task (not the simulation) until
+// one of fds is ready or timeout_ms passes (-1: forever). Socket events
+// wake it only in real-time mode.
+int sim_poll(struct pollfd *fds, int nfds, int timeout_ms);
+
+// Block the calling task until sim_notify(obj) or timeout_us (-1: forever).
+// Wake-ups can be spurious, so re-check the condition. Base of the
+// queue and semaphore shims.
+void sim_wait(const void *obj, int64_t timeout_us);
+void sim_notify(const void *obj);
+
+#endif // SIM_SCHED_H
@@ -0,0 +1,214 @@
+#include "sim_app.h"
+#include "control_policy.h"
+#include "control_task.h"
+#include "capture.h"
+#include "deferred_log.h"
+#include "deadline_monitor.h"
+#include "hx711.h"
+#include "hx711_config.h"
+#include "motor_control_bts7960.h"
+#include "shared_state.h"
+#include "warm_state.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "rom/ets_sys.h"
+
+static const char *TAG = "SIM_APP";
+
+static sim_app_config_t config;
+static hx711_t scale;
+static uint32_t samples = 0;
+
+void sim_app_default_config(sim_app_config_t *cfg)
+{
+    *cfg = (sim_app_config_t) {
+        .readings_per_sample = READINGS_PER_SAMPLE,
+        .update_interval_ms = UPDATE_INTERVAL_MS,
+        .threshold = CONTROL_DEFAULT_THRESHOLD,
+        .auto_mode = CONTROL_DEFAULT_AUTO_MODE,
+        .calibration_factor = HX711_CALIBRATION_FACTOR,
+        .offset = HX711_OFFSET,
+    };
+    cabin_model_default(&cfg->cabin);
+}
+
+uint32_t sim_app_samples(void)
+{
+    return samples;
+}
+
+// Same order as app_main() on a fast boot (or a warm one with warm_boot)
+static void main_task(void *arg)
+{
+    deferred_log_start();
+    elevator_state_t initial = {
+        .stable = true,
+        .auto_mode = config.auto_mode,
+        .threshold = config.threshold,
+        .motor_triggered = config.motor_triggered
+    };
+    warm_state_t warm;
+    bool warm_boot = config.warm_boot && warm_state_restore(&warm);
+    if (warm_boot) {
+        initial.weight = warm.last_weight;
+        initial.load = warm.last_weight;
+        initial.auto_mode = warm.auto_mode;
+        initial.threshold = warm.threshold;
+        initial.motor_triggered = warm_state_resume_trip(&warm);
+    }
+    shared_state_init(&initial);
+    load_estimator_set_model(&config.cabin);
+    if (warm_boot) {
+        load_estimator_reset(warm.last_weight);
+    }
+
+    hx711_init(&scale, HX711_DT_PIN, HX711_SCK_PIN);
+    hx711_set_scale(&scale, config.calibration_factor);
+    hx711_set_offset(&scale, warm_boot ? warm.offset : config.offset);
+
+    motor_control_init();
+    if (initial.motor_triggered && initial.auto_mode) {
+        motor_start_forward();    // Trip in progress (warm-reset resume path)
+    }
+    control_task_start(config.on_control_change);
+    deadline_monitor_start(config.on_control_change);
+    ESP_LOGI(TAG, "Boot-to-ready: %lld ms", (long long)(esp_timer_get_time() / 1000));
+
+    int deadline_id = deadline_register("sample",
+                                        SAMPLE_PERIOD_US(config.readings_per_sample,
+                                                         config.update_interval_ms),
+                                        SAMPLE_DEADLINE_BUDGET_MS * 1000);
+    while (1) {
+        deadline_checkin(deadline_id);
+        if (hx711_is_ready(&scale)) {
+            // The first reading was converted during the period before the call
+            int64_t window_start_us = esp_timer_get_time() - HX711_CONVERSION_MS * 1000;
+            float weight = hx711_get_units(&scale, config.readings_per_sample);
+            int64_t window_end_us = esp_timer_get_time();
+            motor_motion_t motion;
+            motor_get_motion(&motion);
+            float load = load_estimator_update(weight, window_start_us, window_end_us, &motion);
+            long raw_value = hx711_read_average(&scale, config.readings_per_sample);
+
+            elevator_state_t *st = shared_state_begin_update();
+            st->weight = weight;
+            st->load = load;
+            st->raw = raw_value;
+            st->sample_ms = esp_timer_get_time() / 1000;
+            shared_state_end_update();
+            capture_sample(weight);
+            if (config.on_sample != NULL) {
+                config.on_sample(weight, raw_value);
+            }
+            samples++;
+        } else {
+            ESP_LOGW(TAG, "HX711 not ready!");
+        }
+        vTaskDelay(pdMS_TO_TICKS(config.update_interval_ms));
+    }
+}
+
+hx711_t *sim_app_scale(void)
+{
+    return &scale;
+}
+
+static void set_motor_flags(bool triggered, bool auto_mode)
+{
+    elevator_state_t *st = shared_state_begin_update();
+    st->motor_triggered = triggered;
+    st->auto_mode = auto_mode;
+    shared_state_end_update();
+}
+
+void sim_app_command(capture_cmd_t cmd, int32_t arg, float farg)
+{
+    if (capture_cmd_is_float(cmd)) {
+        capture_command_float(cmd, farg);
+    } else {
+        capture_command(cmd, arg);
+    }
+
+    elevator_state_t *st;
+    switch (cmd) {
+        case CAPTURE_CMD_FORWARD:
+            motor_start_forward();
+            set_motor_flags(true, false);
+            break;
+        case CAPTURE_CMD_BACKWARD:
+            motor_start_backward();
+            set_motor_flags(true, false);
+            break;
+        case CAPTURE_CMD_STOP:
+            motor_stop();
+            set_motor_flags(false, true);
+            break;
+        case CAPTURE_CMD_RESET:
+            motor_stop();
+            set_motor_flags(false, true);
+            motor_control_init();
+            vTaskDelay(pdMS_TO_TICKS(100));
+            break;
+        case CAPTURE_CMD_AUTO_MODE:
+            st = shared_state_begin_update();
+            st->auto_mode = arg != 0;
+            shared_state_end_update();
+            break;
+        case CAPTURE_CMD_THRESHOLD:
+            st = shared_state_begin_update();
+            st->threshold = farg;
+            shared_state_end_update();
+            break;
+        case CAPTURE_CMD_ZERO:
+            hx711_zero_scale(&scale);
+            break;
+        case CAPTURE_CMD_SCALE:
+            hx711_set_scale(&scale, farg);
+            break;
+        case CAPTURE_CMD_OFFSET:
+            hx711_set_offset(&scale, arg);
+            break;
+        case CAPTURE_CMD_READINGS:
+            config.readings_per_sample = (uint8_t)arg;
+            break;
+        case CAPTURE_CMD_INTERVAL:
+            config.update_interval_ms = (uint16_t)arg;
+            break;
+    }
+    ESP_LOGI(TAG, "Command %s (%g)", capture_cmd_name(cmd),
+             capture_cmd_is_float(cmd) ? farg : (float)arg);
+}
+
+static const sim_app_cmd_t *script;
+static size_t script_len;
+
+static void api_task(void *arg)
+{
+    for (size_t i = 0; i < script_len; i++) {
+        int64_t wait_us = script[i].t_us - esp_timer_get_time();
+        if (wait_us > 0) {
+            vTaskDelay((TickType_t)(wait_us / (portTICK_PERIOD_MS * 1000)));
+            wait_us = script[i].t_us - esp_timer_get_time();
+            if (wait_us > 0) {
+                ets_delay_us((uint32_t)wait_us);
+            }
+        }
+        sim_app_command(script[i].cmd, script[i].arg, script[i].farg);
+    }
+    vTaskDelete(NULL);
+}
+
+void sim_app_run_commands(const sim_app_cmd_t *cmds, size_t count)
+{
+    script = cmds;
+    script_len = count;
+    xTaskCreatePinnedToCore(api_task, "api", 4096, NULL, 5, NULL, 0);
+}
+
+void sim_app_start(const sim_app_config_t *cfg)
+{
+    config = *cfg;
+    xTaskCreatePinnedToCore(main_task, "main", 3584, NULL, 1, NULL, 0);
+}
@@ -0,0 +1,57 @@
+#ifndef SIM_APP_H
+#define SIM_APP_H
+
+// Firmware wiring for host simulation: the app_main() boot sequence and
+// sampling loop from main.c, minus NVS, WiFi, web server and self-test.
+// Runs the real hx711.c, motor_control_bts7960.c and control_task.c.
+
+#include "capture.h"
+#include "hx711.h"
+#include "load_estimator.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint8_t readings_per_sample;
+    uint16_t update_interval_ms;
+    float threshold;
+    bool auto_mode;
+    bool motor_triggered;       // Initial state (replay of a capture taken mid-trip)
+    bool warm_boot;             // Restore the RTC copy (warm_state) like app_main() after a reset
+    float calibration_factor;
+    int32_t offset;
+    cabin_model_t cabin;        // Load estimator model (config_store cabin_* fields)
+    void (*on_sample)(float weight, long raw);  // After each published sample, like web_server_process_weight
+    void (*on_control_change)(void);            // Passed to control_task_start()
+} sim_app_config_t;
+
+// Defaults match a first boot (config_store defaults)
+void sim_app_default_config(sim_app_config_t *cfg);
+
+// Create the "main" task; it boots and then samples forever
+void sim_app_start(const sim_app_config_t *cfg);
+
+// Samples published to the shared state so far
+uint32_t sim_app_samples(void);
+
+// The running scale (tare, calibration commands)
+hx711_t *sim_app_scale(void);
+
+// Apply an API command the way web_server.c does (motor_cmd_*, tare,
+// POST /api/config) and record it if a capture is running. Blocks like
+// the HTTP handler would, so call it from a task.
+void sim_app_command(capture_cmd_t cmd, int32_t arg, float farg);
+
+typedef struct {
+    int64_t t_us;               // Virtual time to apply the command at
+    capture_cmd_t cmd;
+    int32_t arg;
+    float farg;                 // Argument of float commands
+} sim_app_cmd_t;
+
+// Apply a time-ordered command script from an "api" task (priority of
+// httpd); cmds must stay valid while the simulation runs
+void sim_app_run_commands(const sim_app_cmd_t *cmds, size_t count);
+
+#endif // SIM_APP_H
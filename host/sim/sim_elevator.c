@@ -0,0 +1,598 @@
+// Whole-system elevator simulation on the host: the real sampling loop,
+// HX711 driver, control task and BTS7960 driver run against a physics
+// model of the cabin on a virtual clock, far faster than real time.
+//
+//   ./sim_elevator list
+//   ./sim_elevator start_stop [--csv trace.csv] [--capture run.cap] [-v]
+//   ./sim_elevator all                  # every scenario, one process each
+//
+// --capture records the run in the on-device capture format (capture.h)
+// for sim_replay.
+//
+// Each scenario prints one JSON result line and exits non-zero on failure.
+
+#include "sim_app.h"
+#include "sim_sched.h"
+#include "sim_world.h"
+#include "capture.h"
+#include "config_store.h"
+#include "control_task.h"
+#include "deadline_monitor.h"
+#include "http_workers.h"
+#include "hx711_config.h"
+#include "motor_control_bts7960.h"
+#include "shared_state.h"
+#include "warm_state.h"
+#include "esp_system.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "rom/ets_sys.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define OBSERVE_STEP_MS 10
+#define LOOP_STALL_MS 400     // Busy spin that starves the control task
+
+typedef struct {
+    const char *name;
+    const char *description;
+    int64_t (*run)(void);   // Returns the stimulus time for start_latency_ms
+} scenario_t;
+
+// Observation state shared by the scenario helpers
+static FILE *csv = NULL;
+static const char *capture_path = NULL;
+static int failures = 0;
+static motor_state_t last_motor = MOTOR_STATE_STOPPED;
+static int64_t last_start_ms = -1;   // Most recent STOPPED -> FORWARD
+static int64_t last_stop_ms = -1;
+static int starts = 0;
+static float max_position = 0.0f;
+static float max_current = 0.0f;
+static int64_t last_sample_ms = 0;
+static int64_t first_sample_ms = -1;
+static int64_t max_sample_gap_ms = 0;   // Longest time between two samples
+static float last_load_kg = 0.0f;
+static int64_t load_change_ms = 0;
+static int64_t sample_span_ms = 0;   // Sample time minus the start of its window
+static int moving_samples = 0;       // Samples published while the cabin moved
+static float moving_error_weight = 0.0f;   // Largest |sample - load| among them
+static float moving_error_load = 0.0f;     // Same for the compensated load
+static float moving_min_weight = 1e9f;     // Lowest of those samples
+
+static int64_t now_ms(void)
+{
+    return sim_now_us() / 1000;
+}
+
+static void observe(void)
+{
+    sim_world_state_t w;
+    sim_world_get(&w);
+    motor_state_t motor = motor_get_state();
+    if (motor != last_motor) {
+        if (motor == MOTOR_STATE_FORWARD) {
+            last_start_ms = now_ms();
+            starts++;
+        } else if (motor == MOTOR_STATE_STOPPED) {
+            last_stop_ms = now_ms();
+        }
+        last_motor = motor;
+    }
+    if (w.position_m > max_position) max_position = w.position_m;
+    if (w.motor_current_a > max_current) max_current = w.motor_current_a;
+
+    // Accuracy while moving: samples taken with the cabin in motion, with
+    // a window that started after the latest load change
+    elevator_state_t st;
+    shared_state_read(&st);
+    if (w.load_kg != last_load_kg) {
+        last_load_kg = w.load_kg;
+        load_change_ms = now_ms();
+    }
+    if (st.sample_ms != last_sample_ms) {
+        if (last_sample_ms != 0 && st.sample_ms - last_sample_ms > max_sample_gap_ms) {
+            max_sample_gap_ms = st.sample_ms - last_sample_ms;
+        }
+        last_sample_ms = st.sample_ms;
+        if (first_sample_ms < 0) {
+            first_sample_ms = st.sample_ms;
+        }
+        if (motor != MOTOR_STATE_STOPPED && fabsf(w.velocity_mps) > 0.001f &&
+            st.sample_ms - sample_span_ms >= load_change_ms) {
+            float err_weight = fabsf(st.weight - w.load_kg);
+            float err_load = fabsf(st.load - w.load_kg);
+            moving_samples++;
+            if (err_weight > moving_error_weight) moving_error_weight = err_weight;
+            if (err_load > moving_error_load) moving_error_load = err_load;
+            if (st.weight < moving_min_weight) moving_min_weight = st.weight;
+        }
+    }
+
+    if (csv != NULL) {
+        fprintf(csv, "%lld,%.3f,%.4f,%.4f,%.4f,%d,%d,%.4f,%.4f,%.3f,%.3f\n",
+                (long long)now_ms(), w.load_kg, w.cell_kg, st.weight, st.load, (int)motor,
+                st.motor_triggered, w.position_m, w.velocity_mps, w.accel_mps2,
+                w.motor_current_a);
+    }
+}
+
+// Advance the simulation to t_ms, observing every OBSERVE_STEP_MS
+static void run_to(int64_t t_ms)
+{
+    while (now_ms() < t_ms) {
+        int64_t next = now_ms() + OBSERVE_STEP_MS;
+        sim_run_until((next < t_ms ? next : t_ms) * 1000);
+        observe();
+    }
+}
+
+static void expect(bool ok, const char *what)
+{
+    if (!ok) {
+        failures++;
+        fprintf(stderr, "❌ [%lld ms] expected: %s\n", (long long)now_ms(), what);
+    }
+}
+
+static void boot_with(const sim_world_params_t *params, const sim_app_config_t *cfg)
+{
+    // Weight read (first conversion before the call), then the raw read
+    sample_span_ms = (2 * cfg->readings_per_sample + 1) * HX711_CONVERSION_MS;
+    config_store_init();
+    sim_world_init(params);
+    if (capture_path != NULL) {
+        capture_header_t header = {
+            .calibration_factor = cfg->calibration_factor,
+            .offset = cfg->offset,
+            .threshold = cfg->threshold,
+            .update_interval_ms = cfg->update_interval_ms,
+            .readings_per_sample = cfg->readings_per_sample,
+            .auto_mode = cfg->auto_mode,
+        };
+        capture_start(&header);
+    }
+    sim_app_start(cfg);
+}
+
+static void boot(void)
+{
+    sim_world_params_t params;
+    sim_world_default_params(&params);
+    sim_app_config_t cfg;
+    sim_app_default_config(&cfg);
+    boot_with(&params, &cfg);
+}
+
+static int save_capture(void)
+{
+    static uint8_t data[CAPTURE_BUF_SIZE];
+    capture_stop();
+    size_t len = capture_copy(0, data, sizeof(data));
+    FILE *f = fopen(capture_path, "wb");
+    if (f == NULL || fwrite(data, 1, len, f) != len) {
+        perror(capture_path);
+        if (f) fclose(f);
+        return 1;
+    }
+    fclose(f);
+    return 0;
+}
+
+// Scenarios
+
+static int64_t scenario_start_stop(void)
+{
+    boot();
+    run_to(5000);
+    expect(starts == 0, "motor idle with an empty cabin");
+
+    sim_world_set_load(0.5f);
+    int64_t load_ms = now_ms();
+    run_to(10000);
+    expect(motor_get_state() == MOTOR_STATE_FORWARD, "motor running with 0.5 kg on board");
+    expect(last_start_ms >= load_ms && last_start_ms - load_ms <= 3000,
+           "start within 3 s of loading");
+
+    run_to(15000);
+    sim_world_state_t w;
+    sim_world_get(&w);
+    expect(w.position_m > 0.1f, "cabin moved up");
+
+    sim_world_set_load(0.0f);
+    int64_t unload_ms = now_ms();
+    run_to(20000);
+    sim_world_get(&w);
+    expect(motor_get_state() == MOTOR_STATE_STOPPED, "motor stopped after unloading");
+    expect(last_stop_ms >= unload_ms && last_stop_ms - unload_ms <= 3000,
+           "stop within 3 s of unloading");
+    expect(w.velocity_mps == 0.0f, "cabin held by the worm gear");
+    expect(starts == 1, "exactly one start");
+    return load_ms;
+}
+
+static int64_t scenario_below_threshold(void)
+{
+    boot();
+    run_to(5000);
+    sim_world_set_load(0.15f);   // Below the 0.2 kg default threshold
+    run_to(30000);
+    expect(starts == 0, "no start below the threshold");
+    expect(sim_app_samples() > 5, "samples keep flowing");
+    return 5000;
+}
+
+static int64_t scenario_sensor_unplugged(void)
+{
+    boot();
+    run_to(3000);
+    sim_world_set_sensor_connected(false);
+    run_to(5000);
+    uint32_t samples = sim_app_samples();
+    sim_world_set_load(0.5f);
+    run_to(20000);
+    expect(starts == 0, "no start while the HX711 is disconnected");
+    expect(sim_app_samples() <= samples + 1, "no samples from a disconnected HX711");
+    return 5000;
+}
+
+static int64_t scenario_heavy_load(void)
+{
+    boot();
+    run_to(5000);
+    sim_world_set_load(2.0f);
+    int64_t load_ms = now_ms();
+    run_to(10000);
+    sim_world_state_t w;
+    sim_world_get(&w);
+    expect(motor_get_state() == MOTOR_STATE_FORWARD, "motor running with 2 kg on board");
+    expect(w.velocity_mps > 0.02f, "cabin climbing with 2 kg");
+    run_to(60000);
+    sim_world_get(&w);
+    expect(max_position > 1.0f, "cabin travelled more than 1 m");
+    return load_ms;
+}
+
+static int64_t scenario_manual_override(void)
+{
+    // Same timing as a user on the dashboard: raise the threshold above the
+    // load, drive the motor by hand, then stop it (auto mode comes back)
+    static const sim_app_cmd_t script[] = {
+        { 10000000, CAPTURE_CMD_THRESHOLD, 0, 1.0f },
+        { 15000000, CAPTURE_CMD_FORWARD, 0, 0.0f },
+        { 20000000, CAPTURE_CMD_STOP, 0, 0.0f },
+    };
+    boot();
+    sim_app_run_commands(script, sizeof(script) / sizeof(script[0]));
+    run_to(5000);
+    sim_world_set_load(0.5f);
+    run_to(10000);
+    expect(motor_get_state() == MOTOR_STATE_FORWARD, "auto start with 0.5 kg on board");
+
+    run_to(14000);
+    expect(motor_get_state() == MOTOR_STATE_STOPPED, "auto stop after raising the threshold to 1 kg");
+    run_to(16000);
+    elevator_state_t st;
+    shared_state_read(&st);
+    expect(motor_get_state() == MOTOR_STATE_FORWARD && !st.auto_mode,
+           "manual forward runs with auto mode off");
+
+    run_to(25000);
+    shared_state_read(&st);
+    expect(motor_get_state() == MOTOR_STATE_STOPPED && st.auto_mode,
+           "manual stop re-enables auto mode");
+    expect(starts == 2, "one auto and one manual start");
+    return 15000;    // Latency of the manual start
+}
+
+// Higher priority than the control task, spinning without yielding (like
+// a driver busy-waiting with interrupts still enabled)
+static void stall_task(void *arg)
+{
+    ets_delay_us(LOOP_STALL_MS * 1000);
+    vTaskDelete(NULL);
+}
+
+static bool find_deadline(const char *name, deadline_task_stats_t *out)
+{
+    for (int i = 0; i < deadline_task_count(); i++) {
+        if (deadline_get_stats(i, out) && strcmp(out->name, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int64_t scenario_loop_stall(void)
+{
+    boot();
+    run_to(5000);
+    sim_world_set_load(0.5f);
+    run_to(8000);
+    expect(motor_get_state() == MOTOR_STATE_FORWARD, "motor running with 0.5 kg on board");
+
+    uint32_t writes = config_store_write_count();
+    xTaskCreatePinnedToCore(stall_task, "stall", 2048, NULL, CONTROL_TASK_PRIORITY + 1, NULL,
+                            CONTROL_TASK_CORE);
+    int64_t stall_ms = now_ms();
+    run_to(stall_ms + LOOP_STALL_MS + 100);
+    expect(motor_get_state() == MOTOR_STATE_STOPPED && last_stop_ms >= stall_ms,
+           "deadline monitor stopped the motor during the stall");
+
+    deadline_task_stats_t control;
+    deadline_task_stats_t sample;
+    expect(find_deadline("control", &control) && control.misses == 1,
+           "one control deadline miss");
+    expect(control.worst_overrun_us > CONTROL_DEADLINE_BUDGET_MS * 1000 &&
+           control.worst_overrun_us <= LOOP_STALL_MS * 1000,
+           "control overrun between the budget and the stall length");
+    expect(find_deadline("sample", &sample) && sample.misses == 0 && sample.checkins > 2,
+           "sampling loop kept its deadline");
+
+    // The load is still over the threshold, but the miss latched auto mode off
+    run_to(15000);
+    elevator_state_t es;
+    shared_state_read(&es);
+    elevator_config_t stored;
+    config_store_get(&stored);
+    expect(motor_get_state() == MOTOR_STATE_STOPPED && starts == 1,
+           "no restart after the loop recovered");
+    expect(!es.auto_mode && !stored.auto_mode, "auto mode latched off");
+    expect(config_store_write_count() == writes + 1, "auto mode off written to flash");
+    return stall_ms;
+}
+
+static int64_t tare_done_ms = -1;
+
+// POST /api/zero as the HTTP worker runs it
+static void tare_task(void *arg)
+{
+    int sample_deadline = deadline_find("sample");
+    deadline_pause(sample_deadline);
+    hx711_zero_scale(sim_app_scale());
+    deadline_resume(sample_deadline);
+    tare_done_ms = now_ms();
+    vTaskDelete(NULL);
+}
+
+static int64_t scenario_tare_while_sampling(void)
+{
+    boot();
+    run_to(5000);
+    int64_t sample_ms = last_sample_ms;
+    while (last_sample_ms == sample_ms) {
+        run_to(now_ms() + OBSERVE_STEP_MS);
+    }
+
+    // Start the tare just before the next sample, between two of its 10 ms
+    // DOUT polls: the sampling loop sees a conversion ready, then waits for
+    // the HX711 until the tare is done
+    run_to(last_sample_ms + UPDATE_INTERVAL_MS - 95);
+    int64_t tare_ms = now_ms();
+    xTaskCreatePinnedToCore(tare_task, "tare", 4096, NULL, HTTP_WORKER_PRIORITY, NULL,
+                            HTTP_WORKER_CORE);
+    run_to(tare_ms + 5000);
+
+    deadline_task_stats_t sample;
+    expect(tare_done_ms > tare_ms, "tare finished");
+    expect(find_deadline("sample", &sample) && sample.pauses == 1, "sample deadline paused once");
+    expect(max_sample_gap_ms * 1000 > sample.period_us + sample.budget_us,
+           "sampling loop held past its deadline by the tare");
+    expect(sample.misses == 0 && last_stop_ms < 0, "no deadline miss, no emergency stop");
+
+    elevator_state_t es;
+    shared_state_read(&es);
+    expect(es.auto_mode, "auto mode still on");
+    sim_world_set_load(0.5f);
+    run_to(now_ms() + 6000);
+    expect(motor_get_state() == MOTOR_STATE_FORWARD && starts == 1, "auto start after the tare");
+    return tare_ms;
+}
+
+// Soft, lightly damped platform (1.5 Hz, damping 0.05) on a 24 V drive,
+// sampled every ~0.3 s: the start rings through several samples and a load
+// 20 g over the threshold reads below it mid-trip. The load is put down
+// slowly so only the start excites the platform.
+#define SOFT_SUPPLY_V 24.0f
+#define SOFT_SPEED_MPS 0.36f      // Cabin speed at full duty on SOFT_SUPPLY_V
+#define SOFT_CELL_HZ 1.5f
+#define SOFT_CELL_DAMPING 0.05f
+#define SOFT_LOAD_KG 0.22f
+#define SOFT_LOAD_RAMP_MS 3000
+
+static int64_t scenario_moving_soft_platform(void)
+{
+    sim_world_params_t params;
+    sim_world_default_params(&params);
+    params.supply_v = SOFT_SUPPLY_V;
+    params.cell_natural_hz = SOFT_CELL_HZ;
+    params.cell_damping = SOFT_CELL_DAMPING;
+    sim_app_config_t cfg;
+    sim_app_default_config(&cfg);
+    cfg.readings_per_sample = 1;
+    cfg.update_interval_ms = 100;
+    cfg.cabin.speed_mps = SOFT_SPEED_MPS;
+    cfg.cabin.cell_hz = SOFT_CELL_HZ;
+    cfg.cabin.cell_damping = SOFT_CELL_DAMPING;
+    boot_with(&params, &cfg);
+
+    run_to(3000);
+    int64_t load_ms = now_ms();
+    for (int i = 1; i <= SOFT_LOAD_RAMP_MS / 100; i++) {
+        sim_world_set_load(SOFT_LOAD_KG * i * 100 / SOFT_LOAD_RAMP_MS);
+        run_to(load_ms + i * 100);
+    }
+    run_to(12000);
+    expect(starts == 1 && motor_get_state() == MOTOR_STATE_FORWARD,
+           "one start, motor still running with the load on board");
+    expect(moving_min_weight < cfg.threshold, "raw samples dipped below the threshold mid-trip");
+    expect(moving_error_load < SOFT_LOAD_KG - cfg.threshold,
+           "compensated load stayed on the right side of the threshold");
+    expect(moving_error_load < 0.5f * moving_error_weight,
+           "compensation at least halves the error while moving");
+
+    sim_world_set_load(0.0f);
+    int64_t unload_ms = now_ms();
+    run_to(16000);
+    expect(motor_get_state() == MOTOR_STATE_STOPPED && last_stop_ms - unload_ms <= 3000,
+           "stop within 3 s of unloading");
+    return load_ms;
+}
+
+// Brownout mid-trip (the motor stalled and pulled the supply down): the
+// RTC copy says an auto trip was running. The warm boot must not drive
+// the motor before a fresh sample; the control task restarts the trip
+// from the first real reading.
+static int64_t scenario_brownout_mid_trip(void)
+{
+    sim_world_params_t params;
+    sim_world_default_params(&params);
+    sim_app_config_t cfg;
+    sim_app_default_config(&cfg);
+    cfg.warm_boot = true;
+
+    // What the control task kept in RTC memory before the reset
+    sim_set_reset_reason(ESP_RST_BROWNOUT);
+    warm_state_save_offset(cfg.offset);
+    warm_state_save_control(0.5f, cfg.threshold, true, true, MOTOR_STATE_FORWARD,
+                            WARM_TRIP_RUNNING);
+    boot_with(&params, &cfg);
+    sim_world_set_load(0.5f);
+
+    run_to(10000);
+    warm_state_t warm;
+    warm_state_get(&warm);
+    expect(warm_state_resumed() && (warm.faults & WARM_FAULT_BROWNOUT),
+           "warm boot with the brownout latched");
+    expect(first_sample_ms > 0 && last_start_ms >= first_sample_ms,
+           "motor not driven before the first sample");
+    expect(motor_get_state() == MOTOR_STATE_FORWARD && starts == 1,
+           "trip restarted by the control task");
+    return first_sample_ms;
+}
+
+static const scenario_t scenarios[] = {
+    { "start_stop", "0.5 kg loaded then removed: one start, one stop", scenario_start_stop },
+    { "below_threshold", "0.15 kg stays below the threshold: no start", scenario_below_threshold },
+    { "sensor_unplugged", "HX711 disconnected before loading: no start", scenario_sensor_unplugged },
+    { "heavy_load", "2 kg: motor starts and lifts the cabin", scenario_heavy_load },
+    { "manual_override", "API threshold change, manual forward and stop", scenario_manual_override },
+    { "loop_stall", "Control task starved 400 ms mid-trip: deadline stop, auto mode latched off", scenario_loop_stall },
+    { "tare_while_sampling", "Tare holds the HX711 over a sample: deadline paused, no stop",
+      scenario_tare_while_sampling },
+    { "moving_soft_platform", "Ringing platform mid-trip: no false stop on the compensated load",
+      scenario_moving_soft_platform },
+    { "brownout_mid_trip", "Brownout reset mid-trip: no restart before a fresh sample",
+      scenario_brownout_mid_trip },
+};
+#define SCENARIO_COUNT (sizeof(scenarios) / sizeof(scenarios[0]))
+
+static double wall_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int run_scenario(const scenario_t *sc)
+{
+    double t0 = wall_ms();
+    int64_t event_ms = sc->run();
+    double wall = wall_ms() - t0;
+
+    control_stats_t cs;
+    control_task_get_stats(&cs);
+    sim_world_state_t w;
+    sim_world_get(&w);
+    double sim_s = now_ms() / 1000.0;
+    printf("{\"scenario\":\"%s\",\"result\":\"%s\",\"sim_s\":%.1f,\"wall_ms\":%.1f,"
+           "\"speedup\":%.0f,\"start_latency_ms\":%lld,\"starts\":%d,\"samples\":%u,"
+           "\"max_position_m\":%.3f,\"max_current_a\":%.2f,\"conversions\":%u,"
+           "\"conversions_missed\":%u,\"control_iterations\":%u,\"moving_samples\":%d,"
+           "\"moving_error_weight_kg\":%.3f,\"moving_error_load_kg\":%.3f,\"switches\":%llu}\n",
+           sc->name, failures ? "fail" : "pass", sim_s, wall, wall > 0 ? sim_s * 1000.0 / wall : 0.0,
+           (long long)(last_start_ms >= 0 ? last_start_ms - event_ms : -1), starts,
+           (unsigned)sim_app_samples(), max_position, max_current, (unsigned)w.conversions,
+           (unsigned)w.conversions_missed, (unsigned)cs.iterations, moving_samples,
+           moving_error_weight, moving_error_load, (unsigned long long)sim_switches());
+    fflush(stdout);
+    if (csv) {
+        fclose(csv);
+    }
+    if (capture_path != NULL && save_capture() != 0) {
+        return 2;
+    }
+    return failures ? 1 : 0;
+}
+
+static const scenario_t *find(const char *name)
+{
+    for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+        if (strcmp(scenarios[i].name, name) == 0) {
+            return &scenarios[i];
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = NULL;
+    const char *csv_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            csv_path = argv[++i];
+        } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            capture_path = argv[++i];
+        } else if (strcmp(argv[i], "-v") == 0) {
+            sim_log_level = ESP_LOG_INFO;
+        } else {
+            name = argv[i];
+        }
+    }
+
+    if (name == NULL || strcmp(name, "list") == 0) {
+        for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+            printf("%-18s %s\n", scenarios[i].name, scenarios[i].description);
+        }
+        return name == NULL ? 2 : 0;
+    }
+
+    if (strcmp(name, "all") == 0) {
+        // Firmware state is static, so every scenario gets a fresh process
+        int failed = 0;
+        for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                exit(run_scenario(&scenarios[i]));
+            }
+            int status = 0;
+            waitpid(pid, &status, 0);
+            failed += !(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        }
+        return failed ? 1 : 0;
+    }
+
+    const scenario_t *sc = find(name);
+    if (sc == NULL) {
+        fprintf(stderr, "Unknown scenario '%s' (try: list)\n", name);
+        return 2;
+    }
+    if (csv_path != NULL) {
+        csv = fopen(csv_path, "w");
+        if (csv == NULL) {
+            perror(csv_path);
+            return 2;
+        }
+        fprintf(csv, "t_ms,load_kg,cell_kg,weight_kg,estimate_kg,motor,triggered,position_m,"
+                     "velocity_mps,accel_mps2,current_a\n");
+    }
+    return run_scenario(sc);
+}
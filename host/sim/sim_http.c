@@ -0,0 +1,949 @@
+// web_server.c on the host: the firmware's HTTP API and dashboard served
+// from 127.0.0.1 by the esp_http_server shim (sim_httpd.c), with the
+// sampling loop, control task and cabin model running behind it in real
+// time, plus a load generator of N concurrent keep-alive clients.
+//
+//   ./sim_http --serve 8080                 # browse it, or run bench_http.py against it
+//   ./sim_http --clients 16 --duration 10 --mix weight
+//   ./sim_http --clients 24 --ws-clients 4 --mix mixed --request-cost-us 800
+//   ./sim_http --clients 20 --no-lru        # socket exhaustion without LRU purge
+//   ./sim_http --ws-burst 5                 # WebSocket frames of a burst all delivered
+//
+// Prints one JSON line: throughput, latency percentiles of completed
+// requests, error counts by kind, and the server's socket counters
+// (busy_pct: share of the time since boot the httpd task was handling
+// events). Latencies near 1 s and 3 s are SYN-ACK retransmits of clients
+// that overflowed the listen backlog.
+//
+// The host CPU is much faster than the ESP32 and loopback has no radio, so
+// absolute numbers are optimistic; --request-cost-us charges the httpd task
+// a fixed time per request to bring them closer. What carries over is the
+// shape: where latency jumps, when sockets run out, what the LRU purge and
+// the worker queue do under load.
+
+#include "sim_app.h"
+#include "sim_httpd.h"
+#include "sim_sched.h"
+#include "sim_world.h"
+#include "config_store.h"
+#include "status_json.h"
+#include "web_server.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_SERVE_PORT 8080
+#define MAX_CLIENTS 256
+#define MAX_WS_CLIENTS 32
+#define CONNECT_RETRY_MS 10         // Pause after a failed connect
+#define WARMUP_MS 500               // Boot + first samples before the clock starts
+#define START_TIMEOUT_MS 5000       // Server must be listening by then
+#define WS_BURST_GAP_MS 200         // Between bursts: every rate cap has expired
+#define WS_BURST_TIMEOUT_MS 500     // Second frame of a burst must arrive by then
+
+typedef struct {
+    const char *method;
+    const char *path;
+    const char *body;
+    int weight;
+} load_req_t;
+
+typedef struct {
+    const char *name;
+    const char *description;
+    const load_req_t *reqs;
+    int count;
+} load_mix_t;
+
+static const load_req_t mix_weight[] = {
+    { "GET", "/api/weight", NULL, 1 },
+};
+static const load_req_t mix_status[] = {
+    { "GET", "/api/status", NULL, 1 },
+};
+static const load_req_t mix_motor[] = {
+    { "POST", "/api/motor/forward", "", 3 },
+    { "POST", "/api/motor/stop", "", 3 },
+    { "POST", "/api/motor/auto", "", 1 },
+    { "POST", "/api/motor/threshold", "{\"threshold\":0.30}", 2 },
+    { "POST", "/api/motor/reset", "", 1 },      // HTTP worker, 503 when the queue is full
+};
+static const load_req_t mix_dashboard[] = {
+    { "GET", "/api/status", NULL, 10 },
+    { "GET", "/api/history", NULL, 1 },
+    { "GET", "/", NULL, 1 },
+};
+static const load_req_t mix_mixed[] = {
+    { "GET", "/api/weight", NULL, 50 },
+    { "GET", "/api/status", NULL, 25 },
+    { "GET", "/api/history", NULL, 4 },
+    { "POST", "/api/motor/forward", "", 6 },
+    { "POST", "/api/motor/stop", "", 6 },
+    { "POST", "/api/motor/threshold", "{\"threshold\":0.30}", 5 },
+    { "POST", "/api/motor/reset", "", 2 },
+    { "POST", "/api/zero", "", 2 },             // Tare: ~1 s on an HTTP worker
+};
+
+#define MIX(name, reqs, description) { name, description, reqs, sizeof(reqs) / sizeof(reqs[0]) }
+static const load_mix_t mixes[] = {
+    MIX("weight", mix_weight, "GET /api/weight"),
+    MIX("status", mix_status, "GET /api/status"),
+    MIX("motor", mix_motor, "Motor endpoints, including reset on the worker pool"),
+    MIX("dashboard", mix_dashboard, "What an open dashboard without WebSocket polls"),
+    MIX("mixed", mix_mixed, "Weight and status polling with motor commands and tare"),
+};
+#define MIX_COUNT (sizeof(mixes) / sizeof(mixes[0]))
+
+typedef struct {
+    int clients;
+    int ws_clients;
+    double duration_s;
+    const load_mix_t *mix;
+    int timeout_ms;             // Client connect/recv/send timeout
+    int think_ms;               // Pause between requests of one client
+    bool close_each;            // Connection: close on every request
+    uint16_t port;
+} load_config_t;
+
+// Outcome counters of one client (summed at the end)
+typedef struct {
+    uint32_t requests;          // Responses received (any status)
+    uint32_t ok;                // 2xx
+    uint32_t busy;              // 503 (worker queue full)
+    uint32_t http_4xx;
+    uint32_t http_5xx;          // Other 5xx
+    uint32_t connect_errors;    // Refused or timed out
+    uint32_t resets;            // Closed by the server mid-request
+    uint32_t timeouts;          // No response within timeout_ms
+    uint32_t connections;
+    uint32_t ws_frames;
+    uint32_t ws_disconnects;
+    uint32_t *latency_us;       // Completed requests
+    size_t latency_count;
+    size_t latency_cap;
+} client_stats_t;
+
+typedef struct {
+    pthread_t thread;
+    const load_config_t *cfg;
+    int id;
+    client_stats_t st;
+} client_t;
+
+static atomic_bool load_stop = false;
+static atomic_bool load_done = false;
+static bool load_failed = false;
+static double load_elapsed_s = 0.0;
+
+static double wall_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void sleep_ms(int ms)
+{
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000 };
+    nanosleep(&ts, NULL);
+}
+
+static void record_latency(client_stats_t *st, uint32_t us)
+{
+    if (st->latency_count == st->latency_cap) {
+        size_t cap = st->latency_cap ? st->latency_cap * 2 : 4096;
+        uint32_t *p = realloc(st->latency_us, cap * sizeof(uint32_t));
+        if (p == NULL) {
+            return;
+        }
+        st->latency_us = p;
+        st->latency_cap = cap;
+    }
+    st->latency_us[st->latency_count++] = us;
+}
+
+// Client side
+
+typedef enum {
+    IO_OK = 0,
+    IO_RESET = -1,
+    IO_TIMEOUT = -2,
+} io_result_t;
+
+static io_result_t io_error(ssize_t n)
+{
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return IO_TIMEOUT;
+    }
+    return IO_RESET;
+}
+
+static int client_connect(const load_config_t *cfg)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(cfg->port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    // Non-blocking connect: with the backlog full the SYN is dropped and a
+    // blocking connect() would retry for seconds
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    int err = 0;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        if (errno != EINPROGRESS) {
+            close(fd);
+            return -1;
+        }
+        struct pollfd p = { .fd = fd, .events = POLLOUT };
+        socklen_t len = sizeof(err);
+        if (poll(&p, 1, cfg->timeout_ms) != 1 ||
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    int one = 1;
+    struct timeval tv = { cfg->timeout_ms / 1000, (cfg->timeout_ms % 1000) * 1000 };
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+static io_result_t send_all(int fd, const char *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return io_error(n);
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return IO_OK;
+}
+
+// Buffered response reader
+typedef struct {
+    int fd;
+    char buf[8192];
+    size_t pos;
+    size_t len;
+} reader_t;
+
+static io_result_t rd_fill(reader_t *r)
+{
+    if (r->pos < r->len) {
+        return IO_OK;
+    }
+    ssize_t n = recv(r->fd, r->buf, sizeof(r->buf), 0);
+    if (n <= 0) {
+        return io_error(n);
+    }
+    r->pos = 0;
+    r->len = (size_t)n;
+    return IO_OK;
+}
+
+// One line without the CRLF, truncated to max - 1 characters
+static io_result_t rd_line(reader_t *r, char *out, size_t max)
+{
+    size_t n = 0;
+    while (1) {
+        io_result_t res = rd_fill(r);
+        if (res != IO_OK) {
+            return res;
+        }
+        char c = r->buf[r->pos++];
+        if (c == '\n') {
+            break;
+        }
+        if (c != '\r' && n + 1 < max) {
+            out[n++] = c;
+        }
+    }
+    out[n] = '\0';
+    return IO_OK;
+}
+
+static io_result_t rd_skip(reader_t *r, size_t n)
+{
+    while (n > 0) {
+        io_result_t res = rd_fill(r);
+        if (res != IO_OK) {
+            return res;
+        }
+        size_t k = r->len - r->pos < n ? r->len - r->pos : n;
+        r->pos += k;
+        n -= k;
+    }
+    return IO_OK;
+}
+
+// Send one request and read the whole response; *keep_alive is cleared if
+// the server asked to close
+static io_result_t http_exchange(reader_t *r, const load_req_t *rq, bool close_each,
+                                 int *status, bool *keep_alive)
+{
+    char req[512];
+    size_t body_len = rq->body ? strlen(rq->body) : 0;
+    int len = snprintf(req, sizeof(req),
+                       "%s %s HTTP/1.1\r\nHost: 127.0.0.1\r\n%s"
+                       "Content-Length: %zu\r\n\r\n%s",
+                       rq->method, rq->path, close_each ? "Connection: close\r\n" : "",
+                       body_len, rq->body ? rq->body : "");
+    io_result_t res = send_all(r->fd, req, (size_t)len);
+    if (res != IO_OK) {
+        return res;
+    }
+
+    char line[512];
+    if ((res = rd_line(r, line, sizeof(line))) != IO_OK) {
+        return res;
+    }
+    if (sscanf(line, "HTTP/1.%*d %d", status) != 1) {
+        return IO_RESET;
+    }
+    long content_len = -1;
+    bool chunked = false;
+    *keep_alive = !close_each;
+    while (1) {
+        if ((res = rd_line(r, line, sizeof(line))) != IO_OK) {
+            return res;
+        }
+        if (line[0] == '\0') {
+            break;
+        }
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            content_len = strtol(line + 15, NULL, 10);
+        } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0 && strstr(line, "chunked")) {
+            chunked = true;
+        } else if (strncasecmp(line, "Connection:", 11) == 0 && strstr(line, "close")) {
+            *keep_alive = false;
+        }
+    }
+    if (!chunked) {
+        return content_len > 0 ? rd_skip(r, (size_t)content_len) : IO_OK;
+    }
+    while (1) {
+        if ((res = rd_line(r, line, sizeof(line))) != IO_OK) {
+            return res;
+        }
+        size_t n = strtoul(line, NULL, 16);
+        if ((res = rd_skip(r, n + 2)) != IO_OK) {   // Data + CRLF
+            return res;
+        }
+        if (n == 0) {
+            return IO_OK;
+        }
+    }
+}
+
+static const load_req_t *pick(const load_mix_t *mix, uint32_t *seed)
+{
+    int total = 0;
+    for (int i = 0; i < mix->count; i++) {
+        total += mix->reqs[i].weight;
+    }
+    *seed = *seed * 1103515245u + 12345u;
+    int r = (int)((*seed >> 8) % (uint32_t)total);
+    for (int i = 0; i < mix->count; i++) {
+        r -= mix->reqs[i].weight;
+        if (r < 0) {
+            return &mix->reqs[i];
+        }
+    }
+    return &mix->reqs[0];
+}
+
+static void *http_client(void *arg)
+{
+    client_t *c = arg;
+    const load_config_t *cfg = c->cfg;
+    uint32_t seed = 0x9E3779B9u * (uint32_t)(c->id + 1);
+    reader_t *r = calloc(1, sizeof(reader_t));
+    r->fd = -1;
+
+    while (!atomic_load(&load_stop)) {
+        if (r->fd < 0) {
+            r->fd = client_connect(cfg);
+            if (r->fd < 0) {
+                c->st.connect_errors++;
+                sleep_ms(CONNECT_RETRY_MS);
+                continue;
+            }
+            r->pos = r->len = 0;
+            c->st.connections++;
+        }
+
+        const load_req_t *rq = pick(cfg->mix, &seed);
+        int status = 0;
+        bool keep_alive = true;
+        double t0 = wall_s();
+        io_result_t res = http_exchange(r, rq, cfg->close_each, &status, &keep_alive);
+        double t1 = wall_s();
+        if (res != IO_OK) {
+            if (atomic_load(&load_stop)) {
+                break;      // Cut off by the end of the run, not an error
+            }
+            if (res == IO_TIMEOUT) {
+                c->st.timeouts++;
+            } else {
+                c->st.resets++;
+            }
+            close(r->fd);
+            r->fd = -1;
+            continue;
+        }
+
+        c->st.requests++;
+        record_latency(&c->st, (uint32_t)((t1 - t0) * 1e6));
+        if (status >= 200 && status < 300) {
+            c->st.ok++;
+        } else if (status == 503) {
+            c->st.busy++;
+        } else if (status >= 400 && status < 500) {
+            c->st.http_4xx++;
+        } else {
+            c->st.http_5xx++;
+        }
+        if (!keep_alive) {
+            close(r->fd);
+            r->fd = -1;
+        }
+        if (cfg->think_ms > 0) {
+            sleep_ms(cfg->think_ms);
+        }
+    }
+    if (r->fd >= 0) {
+        close(r->fd);
+    }
+    free(r);
+    return NULL;
+}
+
+// Dashboard WebSocket client: handshake on /ws, then count pushed frames
+// and answer PINGs (the server measures RTT with them)
+static bool ws_open(reader_t *r, const load_config_t *cfg)
+{
+    r->fd = client_connect(cfg);
+    if (r->fd < 0) {
+        return false;
+    }
+    r->pos = r->len = 0;
+    static const char upgrade[] =
+        "GET /ws HTTP/1.1\r\nHost: 127.0.0.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    char line[256];
+    int status = 0;
+    if (send_all(r->fd, upgrade, sizeof(upgrade) - 1) != IO_OK ||
+        rd_line(r, line, sizeof(line)) != IO_OK ||
+        sscanf(line, "HTTP/1.%*d %d", &status) != 1 || status != 101) {
+        close(r->fd);
+        r->fd = -1;
+        return false;
+    }
+    while (rd_line(r, line, sizeof(line)) == IO_OK && line[0] != '\0') {
+    }
+    return true;
+}
+
+static io_result_t ws_read_frame(reader_t *r, uint8_t *opcode, uint8_t *payload, size_t max, size_t *len)
+{
+    uint8_t head[2];
+    io_result_t res;
+    for (int i = 0; i < 2; i++) {
+        if ((res = rd_fill(r)) != IO_OK) {
+            return res;
+        }
+        head[i] = (uint8_t)r->buf[r->pos++];
+    }
+    uint64_t n = head[1] & 0x7F;
+    int ext = n == 126 ? 2 : n == 127 ? 8 : 0;
+    if (ext) {
+        n = 0;
+        for (int i = 0; i < ext; i++) {
+            if ((res = rd_fill(r)) != IO_OK) {
+                return res;
+            }
+            n = n << 8 | (uint8_t)r->buf[r->pos++];
+        }
+    }
+    *opcode = head[0] & 0x0F;
+    *len = 0;
+    for (uint64_t i = 0; i < n; i++) {
+        if ((res = rd_fill(r)) != IO_OK) {
+            return res;
+        }
+        uint8_t b = (uint8_t)r->buf[r->pos++];
+        if (*len < max) {
+            payload[(*len)++] = b;
+        }
+    }
+    return IO_OK;
+}
+
+static void *ws_client(void *arg)
+{
+    client_t *c = arg;
+    reader_t *r = calloc(1, sizeof(reader_t));
+    r->fd = -1;
+    uint8_t payload[125];
+
+    while (!atomic_load(&load_stop)) {
+        if (r->fd < 0) {
+            if (!ws_open(r, c->cfg)) {
+                c->st.connect_errors++;
+                sleep_ms(CONNECT_RETRY_MS);
+                continue;
+            }
+            c->st.connections++;
+        }
+        uint8_t opcode;
+        size_t len;
+        io_result_t res = ws_read_frame(r, &opcode, payload, sizeof(payload), &len);
+        if (res == IO_TIMEOUT) {
+            continue;       // Quiet stretch (no samples): keep listening
+        }
+        if (res != IO_OK || opcode == 0x8) {
+            if (!atomic_load(&load_stop)) {
+                c->st.ws_disconnects++;
+            }
+            close(r->fd);
+            r->fd = -1;
+            continue;
+        }
+        if (opcode == 0x9) {
+            // PONG with the PING payload, masked as clients must
+            uint8_t frame[6 + sizeof(payload)] = { 0x8A, (uint8_t)(0x80 | len), 1, 2, 3, 4 };
+            for (size_t i = 0; i < len; i++) {
+                frame[6 + i] = payload[i] ^ frame[2 + i % 4];
+            }
+            send_all(r->fd, (const char *)frame, 6 + len);
+        } else {
+            c->st.ws_frames++;
+        }
+    }
+    if (r->fd >= 0) {
+        close(r->fd);
+    }
+    free(r);
+    return NULL;
+}
+
+// Load run
+
+static client_t clients[MAX_CLIENTS + MAX_WS_CLIENTS];
+
+static void *load_controller(void *arg)
+{
+    load_config_t *cfg = arg;
+    for (int waited = 0; sim_httpd_port() == 0; waited += 10) {
+        if (waited >= START_TIMEOUT_MS) {
+            load_failed = true;
+            atomic_store(&load_done, true);
+            return NULL;
+        }
+        sleep_ms(10);
+    }
+    cfg->port = sim_httpd_port();
+    sleep_ms(WARMUP_MS);
+
+    int total = cfg->clients + cfg->ws_clients;
+    double t0 = wall_s();
+    for (int i = 0; i < total; i++) {
+        clients[i].cfg = cfg;
+        clients[i].id = i;
+        pthread_create(&clients[i].thread, NULL, i < cfg->clients ? http_client : ws_client,
+                       &clients[i]);
+    }
+    while (wall_s() - t0 < cfg->duration_s) {
+        sleep_ms(10);
+    }
+    atomic_store(&load_stop, true);
+    load_elapsed_s = wall_s() - t0;
+    for (int i = 0; i < total; i++) {
+        // Clients blocked in recv() return within timeout_ms
+        pthread_join(clients[i].thread, NULL);
+    }
+    atomic_store(&load_done, true);
+    return NULL;
+}
+
+// WebSocket burst: two status broadcasts inside the per-client rate cap
+// (two threshold changes back to back) with nothing else publishing. The
+// second frame must still arrive, sent by the server's follow-up flush.
+
+typedef struct {
+    int bursts;
+    int delivered;
+    double max_ms;              // Slowest second frame
+} ws_burst_result_t;
+
+static ws_burst_result_t burst_result;
+
+// Read frames until a text frame contains needle; ms waited, -1 on timeout
+static double ws_wait_for(reader_t *r, const char *needle, int timeout_ms)
+{
+    uint8_t payload[STATUS_JSON_MAX + 1];
+    double t0 = wall_s();
+    while (1) {
+        int left_ms = timeout_ms - (int)((wall_s() - t0) * 1000.0);
+        if (left_ms <= 0) {
+            return -1.0;
+        }
+        if (r->pos == r->len) {
+            struct pollfd p = { .fd = r->fd, .events = POLLIN };
+            if (poll(&p, 1, left_ms) != 1) {
+                return -1.0;
+            }
+        }
+        uint8_t opcode;
+        size_t len;
+        if (ws_read_frame(r, &opcode, payload, sizeof(payload) - 1, &len) != IO_OK) {
+            return -1.0;
+        }
+        payload[len] = '\0';
+        if (opcode == 0x1 && strstr((const char *)payload, needle) != NULL) {
+            return (wall_s() - t0) * 1000.0;
+        }
+    }
+}
+
+static void *ws_burst_controller(void *arg)
+{
+    load_config_t *cfg = arg;
+    for (int waited = 0; sim_httpd_port() == 0; waited += 10) {
+        if (waited >= START_TIMEOUT_MS) {
+            load_failed = true;
+            atomic_store(&load_done, true);
+            return NULL;
+        }
+        sleep_ms(10);
+    }
+    cfg->port = sim_httpd_port();
+    sleep_ms(WARMUP_MS);
+
+    reader_t *ws = calloc(1, sizeof(reader_t));
+    reader_t *http = calloc(1, sizeof(reader_t));
+    http->fd = client_connect(cfg);
+    if (!ws_open(ws, cfg) || http->fd < 0) {
+        load_failed = true;
+    }
+    for (int i = 0; i < burst_result.bursts && !load_failed; i++) {
+        sleep_ms(WS_BURST_GAP_MS);
+        char first[48];
+        char second[48];
+        snprintf(first, sizeof(first), "{\"threshold\":%.2f}", 0.40 + 0.02 * i);
+        snprintf(second, sizeof(second), "{\"threshold\":%.2f}", 0.41 + 0.02 * i);
+        const load_req_t req_first = { "POST", "/api/motor/threshold", first, 1 };
+        const load_req_t req_second = { "POST", "/api/motor/threshold", second, 1 };
+        int status = 0;
+        bool keep_alive = true;
+        double t0 = wall_s();
+        if (http_exchange(http, &req_first, false, &status, &keep_alive) != IO_OK ||
+            http_exchange(http, &req_second, false, &status, &keep_alive) != IO_OK) {
+            load_failed = true;
+            break;
+        }
+        if ((wall_s() - t0) * 1000.0 >= 50.0) {
+            continue;       // Not a burst inside the rate cap: does not count
+        }
+        char needle[32];
+        snprintf(needle, sizeof(needle), "\"threshold\":%.2f", 0.41 + 0.02 * i);
+        double ms = ws_wait_for(ws, needle, WS_BURST_TIMEOUT_MS);
+        if (ms >= 0.0) {
+            burst_result.delivered++;
+            if (ms > burst_result.max_ms) {
+                burst_result.max_ms = ms;
+            }
+        } else {
+            fprintf(stderr, "❌ burst %d: second frame not delivered within %d ms\n",
+                    i, WS_BURST_TIMEOUT_MS);
+        }
+    }
+    if (ws->fd >= 0) {
+        close(ws->fd);
+    }
+    if (http->fd >= 0) {
+        close(http->fd);
+    }
+    free(ws);
+    free(http);
+    atomic_store(&load_done, true);
+    return NULL;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile_ms(const uint32_t *sorted, size_t n, double p)
+{
+    if (n == 0) {
+        return 0.0;
+    }
+    size_t i = (size_t)(p * (double)(n - 1) + 0.5);
+    return sorted[i] / 1000.0;
+}
+
+typedef struct {
+    double max_error_rate;      // < 0: not checked
+    bool expect_exhaustion;     // Sockets must have run out (refused or purged)
+    uint32_t min_requests;
+} load_checks_t;
+
+static int report(const load_config_t *cfg, const load_checks_t *checks)
+{
+    client_stats_t sum = {0};
+    int total = cfg->clients + cfg->ws_clients;
+    for (int i = 0; i < total; i++) {
+        client_stats_t *s = &clients[i].st;
+        sum.requests += s->requests;
+        sum.ok += s->ok;
+        sum.busy += s->busy;
+        sum.http_4xx += s->http_4xx;
+        sum.http_5xx += s->http_5xx;
+        sum.connect_errors += s->connect_errors;
+        sum.resets += s->resets;
+        sum.timeouts += s->timeouts;
+        sum.connections += s->connections;
+        sum.ws_frames += s->ws_frames;
+        sum.ws_disconnects += s->ws_disconnects;
+        sum.latency_count += s->latency_count;
+    }
+    uint32_t *lat = malloc((sum.latency_count + 1) * sizeof(uint32_t));
+    size_t n = 0;
+    for (int i = 0; i < total; i++) {
+        memcpy(lat + n, clients[i].st.latency_us, clients[i].st.latency_count * sizeof(uint32_t));
+        n += clients[i].st.latency_count;
+        free(clients[i].st.latency_us);
+    }
+    qsort(lat, n, sizeof(uint32_t), cmp_u32);
+
+    uint32_t errors = sum.busy + sum.http_4xx + sum.http_5xx + sum.connect_errors +
+                      sum.resets + sum.timeouts;
+    uint32_t attempts = sum.requests + sum.connect_errors + sum.resets + sum.timeouts;
+    double error_rate = attempts ? (double)errors / attempts : 0.0;
+    sim_httpd_stats_t hs;
+    sim_httpd_get_stats(&hs);
+
+    printf("{\"load\":\"%s\",\"clients\":%d,\"ws_clients\":%d,\"duration_s\":%.1f,"
+           "\"requests\":%u,\"rps\":%.1f,\"p50_ms\":%.2f,\"p99_ms\":%.2f,\"p999_ms\":%.2f,"
+           "\"max_ms\":%.2f,\"ok\":%u,\"busy_503\":%u,\"http_4xx\":%u,\"http_5xx\":%u,"
+           "\"connect_errors\":%u,\"resets\":%u,\"timeouts\":%u,\"error_rate\":%.4f,"
+           "\"connections\":%u,\"ws_frames\":%u,\"ws_disconnects\":%u,"
+           "\"server\":{\"accepted\":%u,\"refused\":%u,\"lru_purged\":%u,\"closed_on_error\":%u,"
+           "\"timeouts\":%u,\"requests\":%u,\"2xx\":%u,\"4xx\":%u,\"5xx\":%u,\"ws_frames\":%u,"
+           "\"work_dropped\":%u,\"open_sockets_max\":%u,\"busy_pct\":%.1f}}\n",
+           cfg->mix->name, cfg->clients, cfg->ws_clients, load_elapsed_s, sum.requests,
+           load_elapsed_s > 0 ? sum.requests / load_elapsed_s : 0.0,
+           percentile_ms(lat, n, 0.50), percentile_ms(lat, n, 0.99), percentile_ms(lat, n, 0.999),
+           n ? lat[n - 1] / 1000.0 : 0.0, sum.ok, sum.busy, sum.http_4xx, sum.http_5xx,
+           sum.connect_errors, sum.resets, sum.timeouts, error_rate, sum.connections,
+           sum.ws_frames, sum.ws_disconnects, hs.accepted, hs.refused, hs.lru_purged,
+           hs.closed_on_error, hs.timeouts, hs.requests, hs.responses_2xx, hs.responses_4xx,
+           hs.responses_5xx, hs.ws_frames_sent, hs.work_dropped, hs.open_sockets_max,
+           100.0 * (double)hs.busy_us / (double)sim_now_us());
+    fflush(stdout);
+    free(lat);
+
+    int failed = 0;
+    if (sum.requests < checks->min_requests) {
+        fprintf(stderr, "❌ %u requests completed, expected at least %u\n",
+                sum.requests, checks->min_requests);
+        failed = 1;
+    }
+    if (checks->max_error_rate >= 0 && error_rate > checks->max_error_rate) {
+        fprintf(stderr, "❌ error rate %.4f above %.4f\n", error_rate, checks->max_error_rate);
+        failed = 1;
+    }
+    if (checks->expect_exhaustion && hs.refused + hs.lru_purged == 0) {
+        fprintf(stderr, "❌ expected the server to run out of sockets\n");
+        failed = 1;
+    }
+    return failed;
+}
+
+// Firmware side: sampler and control task (sim_app) plus the network task
+// of main.c, minus WiFi
+
+static void network_task(void *arg)
+{
+    web_server_set_hx711(sim_app_scale());
+    web_server_init();
+    vTaskDelete(NULL);
+}
+
+// publish false: the status is only pushed by the HTTP handlers
+static void start_firmware(bool publish)
+{
+    config_store_init();
+    elevator_config_t stored;
+    config_store_get(&stored);
+
+    sim_world_params_t params;
+    sim_world_default_params(&params);
+    sim_world_init(&params);
+
+    sim_app_config_t cfg;
+    sim_app_default_config(&cfg);
+    cfg.threshold = stored.threshold;
+    cfg.auto_mode = stored.auto_mode;
+    cfg.on_sample = publish ? web_server_process_weight : NULL;
+    cfg.on_control_change = publish ? web_server_request_status : NULL;
+    sim_app_start(&cfg);
+    xTaskCreatePinnedToCore(network_task, "network", 4096, NULL, 5, NULL, 0);
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: sim_http [--serve [port]] [--clients N] [--ws-clients N] [--duration S]\n"
+            "                [--mix NAME] [--timeout-ms N] [--think-ms N] [--close]\n"
+            "                [--max-sockets N] [--no-lru] [--backlog N] [--lwip-sockets N]\n"
+            "                [--request-cost-us N] [--max-error-rate R] [--expect-exhaustion]\n"
+            "                [--min-requests N] [--ws-burst N] [-v]\n"
+            "mixes:\n");
+    for (size_t i = 0; i < MIX_COUNT; i++) {
+        fprintf(stderr, "  %-10s %s\n", mixes[i].name, mixes[i].description);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    load_config_t cfg = {
+        .clients = 8,
+        .duration_s = 5.0,
+        .mix = &mixes[MIX_COUNT - 1],
+        .timeout_ms = 5000,
+    };
+    load_checks_t checks = { .max_error_rate = -1.0 };
+    sim_httpd_overrides_t ov = { .port = 0, .lru_purge = -1 };
+    bool serve = false;
+    sim_log_level = ESP_LOG_ERROR;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(a, "--serve") == 0) {
+            serve = true;
+            ov.port = DEFAULT_SERVE_PORT;
+            if (has_value && argv[i + 1][0] != '-') {
+                ov.port = atoi(argv[++i]);
+            }
+        } else if (strcmp(a, "--clients") == 0 && has_value) {
+            cfg.clients = atoi(argv[++i]);
+        } else if (strcmp(a, "--ws-clients") == 0 && has_value) {
+            cfg.ws_clients = atoi(argv[++i]);
+        } else if (strcmp(a, "--duration") == 0 && has_value) {
+            cfg.duration_s = atof(argv[++i]);
+        } else if (strcmp(a, "--mix") == 0 && has_value) {
+            const char *name = argv[++i];
+            cfg.mix = NULL;
+            for (size_t k = 0; k < MIX_COUNT; k++) {
+                if (strcmp(mixes[k].name, name) == 0) {
+                    cfg.mix = &mixes[k];
+                }
+            }
+            if (cfg.mix == NULL) {
+                fprintf(stderr, "Unknown mix '%s'\n", name);
+                usage();
+                return 2;
+            }
+        } else if (strcmp(a, "--timeout-ms") == 0 && has_value) {
+            cfg.timeout_ms = atoi(argv[++i]);
+        } else if (strcmp(a, "--think-ms") == 0 && has_value) {
+            cfg.think_ms = atoi(argv[++i]);
+        } else if (strcmp(a, "--close") == 0) {
+            cfg.close_each = true;
+        } else if (strcmp(a, "--max-sockets") == 0 && has_value) {
+            ov.max_open_sockets = atoi(argv[++i]);
+        } else if (strcmp(a, "--no-lru") == 0) {
+            ov.lru_purge = 0;
+        } else if (strcmp(a, "--backlog") == 0 && has_value) {
+            ov.backlog = atoi(argv[++i]);
+        } else if (strcmp(a, "--lwip-sockets") == 0 && has_value) {
+            ov.lwip_max_sockets = atoi(argv[++i]);
+        } else if (strcmp(a, "--request-cost-us") == 0 && has_value) {
+            ov.request_cost_us = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(a, "--max-error-rate") == 0 && has_value) {
+            checks.max_error_rate = atof(argv[++i]);
+        } else if (strcmp(a, "--expect-exhaustion") == 0) {
+            checks.expect_exhaustion = true;
+        } else if (strcmp(a, "--min-requests") == 0 && has_value) {
+            checks.min_requests = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(a, "--ws-burst") == 0 && has_value) {
+            burst_result.bursts = atoi(argv[++i]);
+        } else if (strcmp(a, "-v") == 0) {
+            sim_log_level = ESP_LOG_INFO;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (cfg.clients < 0 || cfg.clients > MAX_CLIENTS ||
+        cfg.ws_clients < 0 || cfg.ws_clients > MAX_WS_CLIENTS) {
+        fprintf(stderr, "At most %d HTTP and %d WebSocket clients\n", MAX_CLIENTS, MAX_WS_CLIENTS);
+        return 2;
+    }
+
+    sim_httpd_override(&ov);
+    sim_set_realtime(true);
+    start_firmware(burst_result.bursts == 0);
+
+    if (serve) {
+        if (sim_log_level < ESP_LOG_INFO) {
+            sim_log_level = ESP_LOG_WARN;
+        }
+        while (sim_httpd_port() == 0) {
+            sim_run_realtime(sim_now_us() + 100000);
+        }
+        printf("Dashboard: http://127.0.0.1:%u/ (Ctrl+C to stop)\n", sim_httpd_port());
+        fflush(stdout);
+        while (1) {
+            sim_run_realtime(sim_now_us() + 1000000);
+        }
+    }
+
+    pthread_t controller;
+    pthread_create(&controller, NULL, burst_result.bursts > 0 ? ws_burst_controller : load_controller,
+                   &cfg);
+    while (!atomic_load(&load_done)) {
+        sim_run_realtime(sim_now_us() + 100000);
+    }
+    pthread_join(controller, NULL);
+    if (load_failed) {
+        fprintf(stderr, "❌ Web server did not start\n");
+        return 1;
+    }
+    if (burst_result.bursts > 0) {
+        printf("{\"ws_bursts\":%d,\"delivered\":%d,\"max_ms\":%.1f}\n",
+               burst_result.bursts, burst_result.delivered, burst_result.max_ms);
+        return burst_result.delivered == burst_result.bursts ? 0 : 1;
+    }
+    return report(&cfg, &checks);
+}
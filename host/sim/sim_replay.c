@@ -0,0 +1,495 @@
+// Deterministic replay of a capture (main/capture.h) through the real
+// hx711.c, sampling loop and control task on the virtual clock. The
+// recorded conversions are shifted out bit by bit on DOUT/SCK when they
+// are due, recorded commands are applied by an "api" task at their
+// recorded time, and the resulting samples and motor decisions are diffed
+// against a golden file or against the ones the device recorded.
+//
+//   ./sim_replay incident.cap                        # diff against the device
+//   ./sim_replay incident.cap --golden incident.golden
+//   ./sim_replay incident.cap --write-golden incident.golden
+//   ./sim_replay incident.cap --dump                 # print the records
+//
+// Prints one JSON result line and exits non-zero on a mismatch.
+
+#include "sim_app.h"
+#include "sim_hw.h"
+#include "sim_sched.h"
+#include "capture.h"
+#include "control_policy.h"
+#include "control_task.h"
+#include "hx711_config.h"
+#include "esp_log.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Replay time is capture time shifted so the first replayed conversion is
+// due REPLAY_BOOT_US after boot, together with a synthetic one for the read
+// in hx711_init(): the sampling loop then starts its first sample right on
+// it, in the same phase as on the device
+#define REPLAY_BOOT_US 400000
+#define REPLAY_TAIL_US 200000        // Run on after the last record
+#define DEFAULT_TOLERANCE_MS 250
+
+typedef struct {
+    int64_t t_us;                    // Capture time
+    char kind;                       // 'd' decision, 's' sample
+    int32_t value;                   // control_action_t or grams
+} event_t;
+
+typedef struct {
+    event_t *ev;
+    size_t count;
+    size_t cap;
+} event_list_t;
+
+typedef struct {
+    int64_t t_us;                    // Time the conversion is due (capture, then replay time)
+    int32_t raw;
+    bool timeout;                    // Device gave up waiting at t_us
+} conversion_t;
+
+// Playback HX711
+static conversion_t *conv;
+static size_t conv_count;
+static size_t conv_next;
+static int32_t conv_data;
+static int pulses;
+static bool sck_high;
+
+static void list_add(event_list_t *l, int64_t t_us, char kind, int32_t value)
+{
+    if (l->count == l->cap) {
+        l->cap = l->cap ? l->cap * 2 : 64;
+        l->ev = realloc(l->ev, l->cap * sizeof(event_t));
+    }
+    l->ev[l->count++] = (event_t) { t_us, kind, value };
+}
+
+// Drop timeout markers that are due: the firmware timed out there too
+static void skip_timeouts(void)
+{
+    while (conv_next < conv_count && conv[conv_next].timeout &&
+           conv[conv_next].t_us <= sim_now_us()) {
+        conv_next++;
+    }
+}
+
+static int playback_dout(void *ctx)
+{
+    if (pulses >= 25) {
+        pulses = 0;                  // Gain pulses done, readout complete
+    }
+    if (pulses == 0) {
+        skip_timeouts();
+        bool ready = conv_next < conv_count && !conv[conv_next].timeout &&
+                     conv[conv_next].t_us <= sim_now_us();
+        return ready ? 0 : 1;
+    }
+    if (pulses <= 24) {
+        return (conv_data >> (24 - pulses)) & 1;
+    }
+    return 1;
+}
+
+static void playback_sck(void *ctx, int level)
+{
+    if (level && !sck_high) {
+        if (pulses == 0) {
+            if (playback_dout(NULL) != 0) {
+                sck_high = true;
+                return;              // Clocked while not ready: ignored
+            }
+            conv_data = conv[conv_next].raw;
+        }
+        pulses++;
+        if (pulses == 24) {
+            conv_next++;
+        }
+    }
+    sck_high = level != 0;
+}
+
+static uint8_t *read_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = malloc(size > 0 ? size : 1);
+    *len = fread(data, 1, size, f);
+    fclose(f);
+    return data;
+}
+
+static const char *action_name(int32_t action)
+{
+    return control_action_name((control_action_t)action);
+}
+
+static void dump(const uint8_t *data, size_t len)
+{
+    capture_reader_t r;
+    capture_header_t h;
+    capture_record_t rec;
+    uint8_t flags;
+    capture_reader_init(&r, data, len, &h, &flags);
+    printf("# start %.3f s, scale %.2f, offset %ld, threshold %.3f kg, auto %d, triggered %d, "
+           "readings %u, interval %u ms, flags 0x%02x\n",
+           h.start_us / 1e6, h.calibration_factor, (long)h.offset, h.threshold, h.auto_mode,
+           h.motor_triggered, h.readings_per_sample, h.update_interval_ms, flags);
+    while (capture_reader_next(&r, &rec)) {
+        printf("%10.3f  ", rec.t_us / 1e3);
+        switch (rec.type) {
+            case CAPTURE_REC_CONVERSION: printf("conversion %ld\n", (long)rec.value); break;
+            case CAPTURE_REC_TIMEOUT:    printf("timeout\n"); break;
+            case CAPTURE_REC_SAMPLE:     printf("sample %.3f kg\n", rec.value / 1000.0); break;
+            case CAPTURE_REC_DECISION:   printf("decision %s\n", action_name(rec.value)); break;
+            case CAPTURE_REC_COMMAND:
+                if (capture_cmd_is_float(rec.cmd)) {
+                    printf("command %s %g\n", capture_cmd_name(rec.cmd), rec.fvalue);
+                } else {
+                    printf("command %s %ld\n", capture_cmd_name(rec.cmd), (long)rec.value);
+                }
+                break;
+        }
+    }
+    if (r.pos != r.len) {
+        printf("# malformed record at byte %zu\n", r.pos);
+    }
+}
+
+// Golden file: one "<t_ms> sample <grams>" / "<t_ms> decision <action>" per line
+static bool load_golden(const char *path, event_list_t *out)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+    char line[128], kind[16], value[16];
+    long long t_ms;
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || sscanf(line, "%lld %15s %15s", &t_ms, kind, value) != 3) {
+            continue;
+        }
+        if (strcmp(kind, "sample") == 0) {
+            list_add(out, t_ms * 1000, 's', atoi(value));
+        } else if (strcmp(kind, "decision") == 0) {
+            int32_t action = CONTROL_ACTION_NONE;
+            for (int a = CONTROL_ACTION_START; a <= CONTROL_ACTION_STOP; a++) {
+                if (strcmp(value, action_name(a)) == 0) {
+                    action = a;
+                }
+            }
+            list_add(out, t_ms * 1000, 'd', action);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+static bool write_golden(const char *path, const char *capture, const event_list_t *l)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+    const char *name = strrchr(capture, '/');
+    fprintf(f, "# sim_replay golden output for %s\n", name ? name + 1 : capture);
+    for (size_t i = 0; i < l->count; i++) {
+        if (l->ev[i].kind == 's') {
+            fprintf(f, "%lld sample %ld\n", (long long)(l->ev[i].t_us / 1000), (long)l->ev[i].value);
+        } else {
+            fprintf(f, "%lld decision %s\n", (long long)(l->ev[i].t_us / 1000),
+                    action_name(l->ev[i].value));
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+// Sample -> decision latency (decision time minus the sample before it)
+static void decision_latency(const event_list_t *l, int64_t *max_us, int64_t *mean_us)
+{
+    int64_t last_sample = -1, sum = 0, n = 0;
+    *max_us = 0;
+    for (size_t i = 0; i < l->count; i++) {
+        if (l->ev[i].kind == 's') {
+            last_sample = l->ev[i].t_us;
+        } else if (last_sample >= 0) {
+            int64_t d = l->ev[i].t_us - last_sample;
+            sum += d;
+            n++;
+            if (d > *max_us) *max_us = d;
+        }
+    }
+    *mean_us = n ? sum / n : 0;
+}
+
+typedef struct {
+    size_t compared;
+    size_t mismatches;
+    int64_t max_skew_us;
+} diff_t;
+
+// Compare the events of one kind in order: values must match exactly and
+// times within the tolerance
+static diff_t diff_kind(const event_list_t *expected, const event_list_t *actual, char kind,
+                        int64_t tolerance_us, const char *label)
+{
+    diff_t d = {0};
+    size_t i = 0, j = 0;
+    while (1) {
+        while (i < expected->count && expected->ev[i].kind != kind) i++;
+        while (j < actual->count && actual->ev[j].kind != kind) j++;
+        if (i == expected->count && j == actual->count) {
+            break;
+        }
+        if (i == expected->count || j == actual->count) {
+            const event_t *e = i < expected->count ? &expected->ev[i] : &actual->ev[j];
+            fprintf(stderr, "❌ %s %s at %.3f s: only in the %s\n", label,
+                    kind == 'd' ? action_name(e->value) : "sample", e->t_us / 1e6,
+                    i < expected->count ? "expected output" : "replay");
+            d.mismatches++;
+            if (i < expected->count) i++; else j++;
+            continue;
+        }
+        const event_t *e = &expected->ev[i++], *a = &actual->ev[j++];
+        int64_t skew = a->t_us - e->t_us;
+        if (skew < 0) skew = -skew;
+        if (skew > d.max_skew_us) d.max_skew_us = skew;
+        d.compared++;
+        if (e->value != a->value || skew > tolerance_us) {
+            d.mismatches++;
+            if (kind == 'd') {
+                fprintf(stderr, "❌ %s decision #%zu: expected %s at %.3f s, replay %s at %.3f s\n",
+                        label, d.compared, action_name(e->value), e->t_us / 1e6,
+                        action_name(a->value), a->t_us / 1e6);
+            } else {
+                fprintf(stderr, "❌ %s sample #%zu: expected %.3f kg at %.3f s, replay %.3f kg at %.3f s\n",
+                        label, d.compared, e->value / 1000.0, e->t_us / 1e6,
+                        a->value / 1000.0, a->t_us / 1e6);
+            }
+        }
+    }
+    return d;
+}
+
+static double wall_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL, *golden = NULL, *golden_out = NULL;
+    int64_t tolerance_us = DEFAULT_TOLERANCE_MS * 1000;
+    bool dump_only = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+            golden = argv[++i];
+        } else if (strcmp(argv[i], "--write-golden") == 0 && i + 1 < argc) {
+            golden_out = argv[++i];
+        } else if (strcmp(argv[i], "--tolerance-ms") == 0 && i + 1 < argc) {
+            tolerance_us = atoll(argv[++i]) * 1000;
+        } else if (strcmp(argv[i], "--dump") == 0) {
+            dump_only = true;
+        } else if (strcmp(argv[i], "-v") == 0) {
+            sim_log_level = ESP_LOG_INFO;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (path == NULL) {
+        fprintf(stderr, "usage: %s capture.cap [--golden f | --write-golden f] "
+                        "[--tolerance-ms n] [--dump] [-v]\n", argv[0]);
+        return 2;
+    }
+
+    size_t len;
+    uint8_t *data = read_file(path, &len);
+    capture_reader_t r;
+    capture_header_t h;
+    uint8_t flags;
+    if (data == NULL || !capture_reader_init(&r, data, len, &h, &flags)) {
+        fprintf(stderr, "%s: not a capture file\n", path);
+        return 2;
+    }
+    if (dump_only) {
+        dump(data, len);
+        return 0;
+    }
+
+    // Split the capture into HX711 input, API commands and device output
+    conv = malloc((len / 2 + 1) * sizeof(conversion_t));
+    sim_app_cmd_t *cmds = malloc((len / 3 + 1) * sizeof(sim_app_cmd_t));
+    size_t cmd_count = 0;
+    event_list_t device = {0};
+    capture_record_t rec;
+    int64_t end_us = 0;
+    size_t before_first_sample = 0;
+    bool seen_sample = false;
+    // Slot 0: the conversion hx711_init() reads at boot
+    conv[conv_count++] = (conversion_t) { 0, h.offset, false };
+    while (capture_reader_next(&r, &rec)) {
+        end_us = rec.t_us;
+        switch (rec.type) {
+            case CAPTURE_REC_CONVERSION:
+            case CAPTURE_REC_TIMEOUT:
+                conv[conv_count++] = (conversion_t) { rec.t_us, rec.value, rec.type == CAPTURE_REC_TIMEOUT };
+                before_first_sample += !seen_sample && rec.type == CAPTURE_REC_CONVERSION;
+                break;
+            case CAPTURE_REC_COMMAND:
+                cmds[cmd_count++] = (sim_app_cmd_t) { rec.t_us, (capture_cmd_t)rec.cmd, rec.value, rec.fvalue };
+                break;
+            case CAPTURE_REC_SAMPLE:
+                seen_sample = true;
+                list_add(&device, rec.t_us, 's', rec.value);
+                break;
+            case CAPTURE_REC_DECISION:
+                list_add(&device, rec.t_us, 'd', rec.value);
+                break;
+        }
+    }
+    if (r.pos != r.len) {
+        fprintf(stderr, "⚠️  %s: malformed record at byte %zu, replaying the part before it\n",
+                path, r.pos);
+    }
+
+    // A capture started mid-sample: its first conversions belong to a
+    // sample the replay cannot reproduce, so skip them and compare from
+    // the first whole sample on
+    size_t per_sample = 2 * (size_t)h.readings_per_sample;
+    size_t skip = before_first_sample >= per_sample ? before_first_sample - per_sample
+                                                    : before_first_sample;
+    size_t skipped_device = 0;
+    if (before_first_sample < per_sample && device.count > 0) {
+        int64_t first_whole = -1;
+        for (size_t i = 0, samples = 0; i < device.count; i++) {
+            if (device.ev[i].kind == 's' && samples++ == 1) {
+                first_whole = device.ev[i].t_us;
+                break;
+            }
+        }
+        while (skipped_device < device.count &&
+               (first_whole < 0 || device.ev[skipped_device].t_us < first_whole)) {
+            skipped_device++;
+        }
+    }
+    size_t first = 1;
+    for (size_t n = 0; n < skip; first++) {
+        n += !conv[first].timeout;
+    }
+    memmove(&conv[1], &conv[first], (conv_count - first) * sizeof(conversion_t));
+    conv_count -= first - 1;
+    event_list_t device_cmp = { device.ev + skipped_device, device.count - skipped_device, 0 };
+    if (conv_count < 2) {
+        fprintf(stderr, "%s: no complete sample to replay\n", path);
+        return 2;
+    }
+
+    // Move everything to replay time; commands from before the first
+    // replayed sample are applied right after boot
+    int64_t shift_us = REPLAY_BOOT_US - conv[1].t_us;
+    conv[0].t_us = REPLAY_BOOT_US;
+    for (size_t i = 1; i < conv_count; i++) {
+        conv[i].t_us += shift_us;
+    }
+    for (size_t i = 0; i < cmd_count; i++) {
+        cmds[i].t_us += shift_us;
+        if (cmds[i].t_us < REPLAY_BOOT_US) {
+            cmds[i].t_us = REPLAY_BOOT_US;
+        }
+    }
+
+    // Boot the firmware with the recorded starting conditions
+    sim_gpio_attach_input(HX711_DT_PIN, playback_dout, NULL);
+    sim_gpio_attach_output(HX711_SCK_PIN, playback_sck, NULL);
+    sim_app_config_t cfg = {
+        .readings_per_sample = h.readings_per_sample,
+        .update_interval_ms = h.update_interval_ms,
+        .threshold = h.threshold,
+        .auto_mode = h.auto_mode,
+        .motor_triggered = h.motor_triggered,
+        .calibration_factor = h.calibration_factor,
+        .offset = h.offset,
+    };
+    // The replay records itself: same format, same hooks as on the device
+    capture_start(&h);
+    double t0 = wall_ms();
+    sim_app_start(&cfg);
+    sim_app_run_commands(cmds, cmd_count);
+    int64_t sim_end_us = end_us + shift_us + REPLAY_TAIL_US;
+    sim_run_until(sim_end_us);
+    capture_stop();
+    double wall = wall_ms() - t0;
+
+    static uint8_t out[CAPTURE_BUF_SIZE];
+    size_t out_len = capture_copy(0, out, sizeof(out));
+    event_list_t replay = {0};
+    capture_reader_init(&r, out, out_len, NULL, &flags);
+    while (capture_reader_next(&r, &rec)) {
+        // Back to capture time; past the end the input has run out
+        int64_t t = rec.t_us - shift_us;
+        if (t > end_us) {
+            break;
+        }
+        if (rec.type == CAPTURE_REC_SAMPLE) {
+            list_add(&replay, t, 's', rec.value);
+        } else if (rec.type == CAPTURE_REC_DECISION) {
+            list_add(&replay, t, 'd', rec.value);
+        }
+    }
+    if (flags & CAPTURE_FLAG_TRUNCATED) {
+        fprintf(stderr, "⚠️  replay output truncated (CAPTURE_BUF_SIZE)\n");
+    }
+
+    event_list_t expected = {0};
+    const char *against = "device";
+    if (golden != NULL) {
+        if (!load_golden(golden, &expected)) {
+            return 2;
+        }
+        against = "golden";
+    } else {
+        expected = device_cmp;
+    }
+    diff_t ds = diff_kind(&expected, &replay, 's', tolerance_us, against);
+    diff_t dd = diff_kind(&expected, &replay, 'd', tolerance_us, against);
+
+    int rc = ds.mismatches || dd.mismatches;
+    if (golden_out != NULL) {
+        rc = write_golden(golden_out, path, &replay) ? 0 : 2;
+    }
+
+    int64_t dev_max, dev_mean, rep_max, rep_mean;
+    decision_latency(&device_cmp, &dev_max, &dev_mean);
+    decision_latency(&replay, &rep_max, &rep_mean);
+    double sim_s = sim_end_us / 1e6;
+    size_t replay_samples = 0;
+    for (size_t i = 0; i < replay.count; i++) {
+        replay_samples += replay.ev[i].kind == 's';
+    }
+    printf("{\"capture\":\"%s\",\"result\":\"%s\",\"against\":\"%s\",\"conversions\":%zu,"
+           "\"skipped\":%zu,\"commands\":%zu,\"samples\":%zu,\"sample_mismatches\":%zu,"
+           "\"decisions\":%zu,\"decision_mismatches\":%zu,\"max_decision_skew_ms\":%.1f,"
+           "\"device_decision_latency_ms\":{\"mean\":%.1f,\"max\":%.1f},"
+           "\"replay_decision_latency_ms\":{\"mean\":%.1f,\"max\":%.1f},"
+           "\"wall_us_per_sample\":%.1f,\"sim_s\":%.1f,\"wall_ms\":%.1f,\"speedup\":%.0f}\n",
+           path, golden_out ? "written" : rc ? "fail" : "pass", against, conv_count - 1, skip,
+           cmd_count, ds.compared, ds.mismatches, dd.compared, dd.mismatches,
+           dd.max_skew_us / 1e3, dev_mean / 1e3, dev_max / 1e3, rep_mean / 1e3, rep_max / 1e3,
+           replay_samples ? wall * 1000.0 / replay_samples : 0.0, sim_s, wall, wall > 0 ? sim_s * 1000.0 / wall : 0.0);
+    return rc;
+}
@@ -0,0 +1,440 @@
+// Binary serial telemetry (serial_telemetry.c) over a pty loopback: the
+// firmware's sender task runs on the UART shim in real time, its output is
+// paced at the UART baud rate (through a TX ring the size of the driver's)
+// into a pseudo-terminal, and a reader on the other end decodes it.
+//
+//   ./sim_serial --rate 1000 --duration 5            # built-in reader, JSON result
+//   ./sim_serial --rate 5000 --baud 115200           # overload: device-side drops
+//   ./sim_serial --pty --duration 10                 # print the pty, read it with
+//                                                    # serial_telemetry.py
+//
+// The generator queues samples at --rate with the sample index in raw, so
+// the reader counts every lost sample, plus --events-per-s events and an
+// auto-mode toggle every second (MOTOR frames). The JSON line reports
+// frames/s, samples/s, link utilization, frames lost on the link (sequence
+// gaps, CRC errors) and samples lost end to end; the device's own drop
+// counter (queue full) comes from its STATS frames.
+
+#define _XOPEN_SOURCE 600   // posix_openpt, ptsname
+#define _DEFAULT_SOURCE     // cfmakeraw
+
+#include "sim_sched.h"
+#include "sim_hw.h"
+#include "serial_telemetry.h"
+#include "shared_state.h"
+#include "telemetry_codec.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TX_RING_SIZE SERIAL_TELEMETRY_TX_BUF
+#define READ_GRACE_MS 300           // Reader keeps going after the generator stops
+
+typedef struct {
+    double rate_hz;
+    double duration_s;
+    uint32_t baud;
+    double events_per_s;
+    bool pty_only;
+    double max_loss;                // < 0: no check
+    uint32_t min_samples;
+    bool expect_drops;
+} serial_config_t;
+
+static serial_config_t cfg = {
+    .rate_hz = 1000,
+    .duration_s = 3.0,
+    .baud = 115200,
+    .events_per_s = 10,
+    .max_loss = -1.0,
+};
+
+static int master_fd = -1;
+static int slave_fd = -1;
+
+// UART wire: TX ring filled by the sender task, drained at the baud rate
+static uint8_t tx_ring[TX_RING_SIZE];
+static size_t tx_head = 0;
+static size_t tx_len = 0;
+static uint64_t wire_bytes = 0;
+
+static atomic_bool generating = true;
+static atomic_bool reader_done = false;
+
+static void uart_tx(void *ctx, const uint8_t *data, size_t len)
+{
+    // The real driver blocks the caller while its TX ring is full
+    while (len > 0) {
+        while (tx_len == TX_RING_SIZE) {
+            vTaskDelay(1);
+        }
+        size_t tail = (tx_head + tx_len) % TX_RING_SIZE;
+        size_t n = TX_RING_SIZE - tx_len;
+        if (n > TX_RING_SIZE - tail) {
+            n = TX_RING_SIZE - tail;
+        }
+        if (n > len) {
+            n = len;
+        }
+        memcpy(tx_ring + tail, data, n);
+        tx_len += n;
+        data += n;
+        len -= n;
+    }
+}
+
+// Moves bytes between the UART shim and the pty master: TX at 10 bits per
+// byte (8N1), host -> device bytes into the RX FIFO
+static void wire_task(void *arg)
+{
+    double budget = 0;
+    int64_t last = sim_now_us();
+    while (1) {
+        int64_t now = sim_now_us();
+        budget += (now - last) * (cfg.baud / 10.0) / 1e6;
+        last = now;
+        if (budget > TX_RING_SIZE) {
+            budget = TX_RING_SIZE;      // Idle line does not save up bytes
+        }
+        while (tx_len > 0 && budget >= 1) {
+            size_t n = tx_len < TX_RING_SIZE - tx_head ? tx_len : TX_RING_SIZE - tx_head;
+            if (n > (size_t)budget) {
+                n = (size_t)budget;
+            }
+            ssize_t w = write(master_fd, tx_ring + tx_head, n);
+            if (w <= 0) {
+                break;                  // pty full: the reader is behind
+            }
+            tx_head = (tx_head + (size_t)w) % TX_RING_SIZE;
+            tx_len -= (size_t)w;
+            budget -= (double)w;
+            wire_bytes += (uint64_t)w;
+        }
+        uint8_t rx[64];
+        ssize_t r = read(master_fd, rx, sizeof(rx));
+        if (r > 0) {
+            sim_uart_inject(SERIAL_TELEMETRY_UART, rx, (size_t)r);
+        }
+        vTaskDelay(1);
+    }
+}
+
+// Samples at cfg.rate_hz (raw = sample index), events, auto-mode toggles
+static void generator_task(void *arg)
+{
+    int64_t start = sim_now_us();
+    uint64_t produced = 0;
+    uint64_t events = 0;
+    int64_t next_toggle = start + 1000000;
+    while (atomic_load(&generating)) {
+        int64_t now = sim_now_us();
+        double elapsed = (now - start) / 1e6;
+        uint64_t due = (uint64_t)(elapsed * cfg.rate_hz);
+        for (; produced < due; produced++) {
+            telemetry_sample_t s = {
+                .t_ms = (uint32_t)(now / 1000),
+                .weight_g = 250000 + (int32_t)(produced % 7) * 3,
+                .raw = (int32_t)produced,
+                .flags = TELEMETRY_FLAG_SENSOR_READY | TELEMETRY_FLAG_STABLE
+            };
+            serial_telemetry_sample(&s);
+        }
+        uint64_t events_due = (uint64_t)(elapsed * cfg.events_per_s);
+        for (; events < events_due; events++) {
+            serial_telemetry_event(SERIAL_EVENT_DECISION, (int32_t)(events % 3), NULL);
+        }
+        if (now >= next_toggle) {
+            elevator_state_t *st = shared_state_begin_update();
+            st->auto_mode = !st->auto_mode;
+            shared_state_end_update();
+            next_toggle += 1000000;
+        }
+        vTaskDelay(1);
+    }
+    vTaskDelete(NULL);
+}
+
+// Reader side (host), on the pty slave
+
+typedef struct {
+    uint64_t frames;
+    uint64_t frames_by_type[5];
+    uint64_t bad_frames;            // COBS or CRC failures (includes log text)
+    uint64_t lost_frames;           // Sequence gaps
+    uint64_t samples;
+    uint64_t lost_samples;          // Gaps in the sample index
+    uint64_t bytes;
+    uint32_t device_dropped;        // Last STATS frame: samples dropped on the device
+    uint32_t device_samples_sent;
+    double elapsed_s;
+} reader_stats_t;
+
+static reader_stats_t rs;
+
+static uint64_t wall_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void send_control(int fd, uint8_t start)
+{
+    uint8_t frame[SERIAL_TELEMETRY_HEADER_SIZE + 3];
+    uint8_t wire[sizeof(frame) + 3];
+    size_t n = serial_telemetry_frame_build(frame, sizeof(frame), SERIAL_FRAME_CONTROL, 0, 0,
+                                            &start, 1);
+    size_t w = 0;
+    wire[w++] = 0;
+    w += serial_telemetry_cobs_encode(frame, n, wire + w);
+    wire[w++] = 0;
+    if (write(fd, wire, w) != (ssize_t)w) {
+        perror("control frame");
+    }
+}
+
+static void handle_frame(const uint8_t *enc, size_t len)
+{
+    static uint8_t decoded[SERIAL_TELEMETRY_WIRE_MAX];
+    static bool have_seq = false;
+    static uint16_t next_seq;
+    static bool have_sample = false;
+    static int32_t next_raw;
+
+    serial_frame_t f;
+    size_t n = len <= sizeof(decoded) ? serial_telemetry_cobs_decode(enc, len, decoded) : 0;
+    if (n == 0 || !serial_telemetry_frame_parse(decoded, n, &f)) {
+        rs.bad_frames++;
+        return;
+    }
+    rs.frames++;
+    if (f.type < 5) {
+        rs.frames_by_type[f.type]++;
+    }
+    if (have_seq) {
+        rs.lost_frames += (uint16_t)(f.seq - next_seq);
+    }
+    have_seq = true;
+    next_seq = (uint16_t)(f.seq + 1);
+
+    if (f.type == SERIAL_FRAME_TELEMETRY) {
+        telemetry_sample_t samples[TELEMETRY_MAX_SAMPLES];
+        int count = telemetry_decode(f.payload, f.len, samples, TELEMETRY_MAX_SAMPLES, NULL);
+        if (count < 0) {
+            rs.bad_frames++;
+            return;
+        }
+        for (int i = 0; i < count; i++) {
+            if (have_sample && samples[i].raw != next_raw) {
+                rs.lost_samples += (uint32_t)(samples[i].raw - next_raw);
+            }
+            have_sample = true;
+            next_raw = samples[i].raw + 1;
+            rs.samples++;
+        }
+    } else if (f.type == SERIAL_FRAME_STATS && f.len >= 20) {
+        rs.device_samples_sent = get_u32(f.payload + 8);
+        rs.device_dropped = get_u32(f.payload + 12);
+    }
+}
+
+static void *reader_thread(void *arg)
+{
+    int fd = open(ptsname(master_fd), O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        perror("pty slave");
+        atomic_store(&reader_done, true);
+        return NULL;
+    }
+    send_control(fd, 1);
+
+    static uint8_t acc[SERIAL_TELEMETRY_WIRE_MAX];
+    size_t acc_len = 0;
+    uint64_t start = wall_us();
+    uint64_t end = start + (uint64_t)(cfg.duration_s * 1e6) + READ_GRACE_MS * 1000u;
+    uint8_t buf[4096];
+    while (wall_us() < end) {
+        struct pollfd p = { .fd = fd, .events = POLLIN };
+        if (poll(&p, 1, 20) <= 0) {
+            continue;
+        }
+        ssize_t r = read(fd, buf, sizeof(buf));
+        if (r <= 0) {
+            continue;
+        }
+        rs.bytes += (uint64_t)r;
+        for (ssize_t i = 0; i < r; i++) {
+            if (buf[i] != 0) {
+                if (acc_len < sizeof(acc)) {
+                    acc[acc_len] = buf[i];
+                }
+                acc_len++;
+                continue;
+            }
+            if (acc_len > 0) {
+                handle_frame(acc, acc_len);
+            }
+            acc_len = 0;
+        }
+    }
+    rs.elapsed_s = (wall_us() - start) / 1e6;
+    send_control(fd, 0);
+    close(fd);
+    atomic_store(&reader_done, true);
+    return NULL;
+}
+
+static bool open_pty(void)
+{
+    master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master_fd < 0 || grantpt(master_fd) != 0 || unlockpt(master_fd) != 0) {
+        perror("posix_openpt");
+        return false;
+    }
+    // Raw line discipline (no echo, no CR/LF mapping): 0x00 and 0x0A pass
+    // through untouched. Keep a slave fd open so the master never sees EIO.
+    slave_fd = open(ptsname(master_fd), O_RDWR | O_NOCTTY);
+    if (slave_fd < 0) {
+        perror("pty slave");
+        return false;
+    }
+    struct termios t;
+    tcgetattr(slave_fd, &t);
+    cfmakeraw(&t);
+    tcsetattr(slave_fd, TCSANOW, &t);
+    fcntl(master_fd, F_SETFL, fcntl(master_fd, F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: sim_serial [--rate HZ] [--duration S] [--baud B] [--events-per-s N]\n"
+            "                  [--pty] [--max-loss F] [--min-samples N] [--expect-drops] [-v]\n");
+}
+
+static int report(void)
+{
+    serial_telemetry_stats_t ds;
+    serial_telemetry_get_stats(&ds);
+    double t = rs.elapsed_s > 0 ? rs.elapsed_s : 1;
+    uint64_t expected = rs.samples + rs.lost_samples;
+    double loss = expected ? (double)rs.lost_samples / (double)expected : 0;
+    printf("{\"serial\":{\"baud\":%u,\"rate_hz\":%.0f,\"duration_s\":%.2f,"
+           "\"frames\":%llu,\"frames_per_s\":%.1f,\"telemetry_frames\":%llu,\"motor_frames\":%llu,"
+           "\"event_frames\":%llu,\"stats_frames\":%llu,\"samples\":%llu,\"samples_per_s\":%.1f,"
+           "\"bytes_per_sample\":%.2f,\"link_utilization\":%.3f,"
+           "\"bad_frames\":%llu,\"lost_frames\":%llu,\"lost_samples\":%llu,\"loss_rate\":%.5f,"
+           "\"device_dropped\":%u,\"device_events_dropped\":%u}}\n",
+           cfg.baud, cfg.rate_hz, t,
+           (unsigned long long)rs.frames, rs.frames / t,
+           (unsigned long long)rs.frames_by_type[SERIAL_FRAME_TELEMETRY],
+           (unsigned long long)rs.frames_by_type[SERIAL_FRAME_MOTOR],
+           (unsigned long long)rs.frames_by_type[SERIAL_FRAME_EVENT],
+           (unsigned long long)rs.frames_by_type[SERIAL_FRAME_STATS],
+           (unsigned long long)rs.samples, rs.samples / t,
+           rs.samples ? (double)rs.bytes / rs.samples : 0.0,
+           rs.bytes * 10.0 / (cfg.baud * t),
+           (unsigned long long)rs.bad_frames, (unsigned long long)rs.lost_frames,
+           (unsigned long long)rs.lost_samples, loss, ds.samples_dropped, ds.events_dropped);
+
+    int failed = 0;
+    if (rs.bad_frames > 0 || rs.lost_frames > 0) {
+        fprintf(stderr, "❌ Link errors: %llu bad frames, %llu lost frames\n",
+                (unsigned long long)rs.bad_frames, (unsigned long long)rs.lost_frames);
+        failed = 1;
+    }
+    if (cfg.max_loss >= 0 && loss > cfg.max_loss) {
+        fprintf(stderr, "❌ Sample loss %.5f above %.5f\n", loss, cfg.max_loss);
+        failed = 1;
+    }
+    if (rs.samples < cfg.min_samples) {
+        fprintf(stderr, "❌ Only %llu samples (expected >= %u)\n",
+                (unsigned long long)rs.samples, cfg.min_samples);
+        failed = 1;
+    }
+    if (cfg.expect_drops && (ds.samples_dropped == 0 || rs.lost_samples > ds.samples_dropped)) {
+        fprintf(stderr, "❌ Expected device-side drops accounting for every lost sample "
+                "(dropped %u, lost %llu)\n", ds.samples_dropped, (unsigned long long)rs.lost_samples);
+        failed = 1;
+    }
+    return failed;
+}
+
+int main(int argc, char **argv)
+{
+    sim_log_level = ESP_LOG_ERROR;
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(a, "--rate") == 0 && has_value) {
+            cfg.rate_hz = atof(argv[++i]);
+        } else if (strcmp(a, "--duration") == 0 && has_value) {
+            cfg.duration_s = atof(argv[++i]);
+        } else if (strcmp(a, "--baud") == 0 && has_value) {
+            cfg.baud = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(a, "--events-per-s") == 0 && has_value) {
+            cfg.events_per_s = atof(argv[++i]);
+        } else if (strcmp(a, "--pty") == 0) {
+            cfg.pty_only = true;
+        } else if (strcmp(a, "--max-loss") == 0 && has_value) {
+            cfg.max_loss = atof(argv[++i]);
+        } else if (strcmp(a, "--min-samples") == 0 && has_value) {
+            cfg.min_samples = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(a, "--expect-drops") == 0) {
+            cfg.expect_drops = true;
+        } else if (strcmp(a, "-v") == 0) {
+            sim_log_level = ESP_LOG_INFO;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (cfg.baud == 0 || cfg.rate_hz < 0 || !open_pty()) {
+        return 2;
+    }
+
+    sim_set_realtime(true);
+    elevator_state_t initial = { .stable = true, .auto_mode = true };
+    shared_state_init(&initial);
+    sim_uart_attach(SERIAL_TELEMETRY_UART, uart_tx, NULL);
+    serial_telemetry_start();
+    xTaskCreatePinnedToCore(wire_task, "uart_wire", 4096, NULL, 10, NULL, 0);
+    xTaskCreatePinnedToCore(generator_task, "generator", 4096, NULL, 4, NULL, 1);
+
+    if (cfg.pty_only) {
+        // serial_telemetry.py --loopback reads this line, then opens the pty
+        printf("{\"pty\":\"%s\"}\n", ptsname(master_fd));
+        fflush(stdout);
+        sim_run_realtime(sim_now_us() + (int64_t)(cfg.duration_s * 1e6));
+        return 0;
+    }
+
+    pthread_t reader;
+    pthread_create(&reader, NULL, reader_thread, NULL);
+    int64_t stop_at = sim_now_us() + (int64_t)(cfg.duration_s * 1e6);
+    while (!atomic_load(&reader_done)) {
+        if (sim_now_us() >= stop_at) {
+            atomic_store(&generating, false);
+        }
+        sim_run_realtime(sim_now_us() + 50000);
+    }
+    pthread_join(reader, NULL);
+    return report();
+}
@@ -0,0 +1,76 @@
+// wifi_manager.h for the host build: always connected over loopback, so
+// /api/status, /api/wifi and the RTT statistics have something to report
+#include "wifi_manager.h"
+#include <string.h>
+
+static wifi_profile_t profile = WIFI_PROFILE_LOW_LATENCY;
+
+void wifi_init(void)
+{
+}
+
+bool wifi_wait_connected(uint32_t timeout_ms)
+{
+    return true;
+}
+
+bool wifi_is_connected(void)
+{
+    return true;
+}
+
+const char* wifi_get_ip(void)
+{
+    return "127.0.0.1";
+}
+
+int wifi_get_rssi(void)
+{
+    return -55;
+}
+
+bool wifi_set_profile(wifi_profile_t p)
+{
+    if (p >= WIFI_PROFILE_COUNT) {
+        return false;
+    }
+    profile = p;
+    return true;
+}
+
+wifi_profile_t wifi_get_profile(void)
+{
+    return profile;
+}
+
+const char *wifi_profile_name(wifi_profile_t p)
+{
+    switch (p) {
+        case WIFI_PROFILE_LOW_LATENCY: return "low_latency";
+        case WIFI_PROFILE_BALANCED: return "balanced";
+        case WIFI_PROFILE_LOW_POWER: return "low_power";
+        default: return "unknown";
+    }
+}
+
+bool wifi_profile_from_name(const char *name, wifi_profile_t *out)
+{
+    for (int i = 0; i < WIFI_PROFILE_COUNT; i++) {
+        if (strcmp(name, wifi_profile_name((wifi_profile_t)i)) == 0) {
+            *out = (wifi_profile_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void wifi_get_stats(wifi_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->connects = 1;
+}
+
+size_t wifi_get_history(wifi_conn_record_t *out, size_t max)
+{
+    return 0;
+}
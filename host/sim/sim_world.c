@@ -0,0 +1,267 @@
+#include "sim_world.h"
+#include "sim_hw.h"
+#include "sim_sched.h"
+#include "hx711_config.h"
+#include "motor_control_bts7960.h"
+#include <math.h>
+#include <string.h>
+
+#define GRAVITY 9.81f
+#define PHYSICS_STEP_US 500
+#define HX711_POWER_DOWN_US 60
+
+static sim_world_params_t params;
+static sim_world_state_t state;
+static int64_t world_us = 0;      // Time the physics state is valid for
+static float cell_rate = 0.0f;    // d(cell_kg)/dt
+static double cell_sum = 0.0;     // Integral of cell_kg over the running conversion
+static double cell_sum_s = 0.0;
+static uint32_t rng;
+
+// HX711 device
+static struct {
+    int64_t next_conversion_us;
+    int32_t data;               // Conversion being shifted out
+    bool ready;                 // DOUT low: unread conversion available
+    int pulses;                 // SCK pulses in the current readout
+    int gain_pulses;            // 1 = channel A/128 (25 pulses), 2 = B/32, 3 = A/64
+    int64_t sck_high_since;
+    bool sck;
+} adc;
+
+void sim_world_default_params(sim_world_params_t *p)
+{
+    *p = (sim_world_params_t) {
+        .supply_v = 12.0f,
+        .winding_ohm = 2.0f,
+        .kt = 0.02f,
+        .rotor_inertia = 2e-6f,
+        .gear_ratio = 30.0f,
+        .gear_efficiency = 0.7f,
+        .drum_radius_m = 0.01f,
+        .cabin_kg = 0.5f,
+        .counterweight_kg = 0.0f,
+        .friction_n = 0.5f,
+        .travel_m = 2.0f,
+        .cell_natural_hz = 8.0f,
+        .cell_damping = 0.3f,
+        .cell_noise_kg = 0.001f,
+        .cal_factor = (float)HX711_CALIBRATION_FACTOR,
+        .cal_offset = HX711_OFFSET,
+        .sample_period_us = 100000,
+        .seed = 12345,
+    };
+}
+
+// xorshift32 + Box-Muller: reproducible Gaussian noise
+static float noise(void)
+{
+    float u[2];
+    for (int i = 0; i < 2; i++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        u[i] = ((rng >> 8) + 1.0f) / 16777217.0f;
+    }
+    return sqrtf(-2.0f * logf(u[0])) * cosf(6.2831853f * u[1]);
+}
+
+// Voltage across the motor from the H-bridge inputs
+static float drive_voltage(void)
+{
+    if (!sim_gpio_output_level(BTS7960_LEN_PIN) || !sim_gpio_output_level(BTS7960_REN_PIN)) {
+        return 0.0f;
+    }
+    float max = (float)sim_ledc_max_duty(BTS7960_PWM_CHANNEL_FORWARD);
+    float fwd = sim_ledc_duty(BTS7960_PWM_CHANNEL_FORWARD) / max;
+    float rev = sim_ledc_duty(BTS7960_PWM_CHANNEL_REVERSE) / max;
+    return params.supply_v * (fwd - rev);
+}
+
+static void physics_step(float dt)
+{
+    const sim_world_params_t *p = &params;
+    float v = state.velocity_mps;
+    float volts = drive_voltage();
+    float k = p->gear_ratio / p->drum_radius_m;            // Motor rad per cabin metre
+    float mass = p->cabin_kg + state.load_kg + p->counterweight_kg +
+                 p->rotor_inertia * k * k;
+    float gravity = (p->cabin_kg + state.load_kg - p->counterweight_kg) * GRAVITY;
+
+    state.drive_v = volts;
+    if (volts == 0.0f) {
+        // Worm gear is self-locking: an unpowered motor holds the cabin
+        state.velocity_mps = 0.0f;
+        state.accel_mps2 = 0.0f;
+        state.motor_current_a = 0.0f;
+    } else {
+        // Motor force on the cabin, F = F0 - b*v (back-EMF), integrated
+        // semi-implicitly because b/m is much stiffer than the step
+        float f0 = p->kt * volts / p->winding_ohm * k * p->gear_efficiency;
+        float b = p->kt * p->kt / p->winding_ohm * k * k * p->gear_efficiency;
+        float friction = v > 0.0f ? p->friction_n : (v < 0.0f ? -p->friction_n : 0.0f);
+        float v_new = (v + dt * (f0 - gravity - friction) / mass) / (1.0f + dt * b / mass);
+        if (v == 0.0f && fabsf(f0 - gravity) <= p->friction_n) {
+            v_new = 0.0f;    // Static friction holds
+        }
+        state.accel_mps2 = (v_new - v) / dt;
+        state.velocity_mps = v_new;
+        state.motor_current_a = (volts - p->kt * v_new * k) / p->winding_ohm;
+    }
+
+    state.position_m += state.velocity_mps * dt;
+    if (state.position_m < 0.0f || state.position_m > p->travel_m) {
+        // End stop: cabin stops dead, motor stalls
+        state.position_m = state.position_m < 0.0f ? 0.0f : p->travel_m;
+        state.accel_mps2 = -state.velocity_mps / dt;
+        state.velocity_mps = 0.0f;
+        state.motor_current_a = volts / p->winding_ohm;
+    }
+
+    // Load cell: second-order response to the apparent weight of the load
+    float target = state.load_kg * (GRAVITY + state.accel_mps2) / GRAVITY;
+    float w0 = 6.2831853f * p->cell_natural_hz;
+    float acc = w0 * w0 * (target - state.cell_kg) - 2.0f * p->cell_damping * w0 * cell_rate;
+    cell_rate += acc * dt;
+    state.cell_kg += cell_rate * dt;
+    cell_sum += state.cell_kg * dt;
+    cell_sum_s += dt;
+}
+
+static void adc_convert(void)
+{
+    // Sigma-delta: the result is the mean input over the conversion period
+    float mean = cell_sum_s > 0.0 ? (float)(cell_sum / cell_sum_s) : state.cell_kg;
+    cell_sum = 0.0;
+    cell_sum_s = 0.0;
+    if (!state.sensor_connected) {
+        return;
+    }
+    if (adc.pulses > 0 && adc.pulses < 25) {
+        state.conversions_missed++;    // Readout in progress: result dropped
+        return;
+    }
+    if (adc.ready) {
+        state.conversions_missed++;    // Previous result never read
+    }
+    float kg = mean + params.cell_noise_kg * noise();
+    double counts = params.cal_offset + (double)kg * params.cal_factor;
+    if (counts > 0x7FFFFF) counts = 0x7FFFFF;
+    if (counts < -0x800000) counts = -0x800000;
+    adc.data = (int32_t)lrint(counts);
+    adc.ready = true;
+    adc.pulses = 0;
+    state.last_raw = adc.data;
+    state.conversions++;
+}
+
+// Bring physics and the ADC up to the virtual clock
+static void world_sync(void)
+{
+    int64_t now = sim_now_us();
+    while (world_us < now) {
+        int64_t step_end = world_us + PHYSICS_STEP_US;
+        if (step_end > now) {
+            step_end = now;
+        }
+        if (adc.next_conversion_us <= step_end) {
+            step_end = adc.next_conversion_us > world_us ? adc.next_conversion_us : step_end;
+        }
+        physics_step((float)(step_end - world_us) / 1e6f);
+        world_us = step_end;
+        if (world_us >= adc.next_conversion_us) {
+            adc_convert();
+            adc.next_conversion_us += params.sample_period_us;
+        }
+    }
+}
+
+static bool adc_powered_down(void)
+{
+    return adc.sck && sim_now_us() - adc.sck_high_since > HX711_POWER_DOWN_US;
+}
+
+static int adc_dout(void *ctx)
+{
+    world_sync();
+    if (!state.sensor_connected || adc_powered_down()) {
+        return 1;
+    }
+    if (adc.pulses == 0) {
+        return adc.ready ? 0 : 1;
+    }
+    if (adc.pulses <= 24) {
+        return (adc.data >> (24 - adc.pulses)) & 1;    // MSB first, valid while SCK high
+    }
+    return 1;                                          // Pulses 25-27: DOUT back high
+}
+
+static void adc_sck(void *ctx, int level)
+{
+    world_sync();
+    int64_t now = sim_now_us();
+    if (level && !adc.sck) {
+        adc.sck = true;
+        adc.sck_high_since = now;
+        if (adc.pulses > 0 || adc.ready) {
+            adc.pulses++;
+            if (adc.pulses == 24) {
+                state.conversions_read++;
+            }
+            if (adc.pulses >= 25) {
+                // Pulses after the data select the next gain (25: A/128,
+                // 26: B/32, 27: A/64) and release DOUT
+                adc.ready = false;
+                adc.gain_pulses = adc.pulses - 24;
+            }
+        }
+    } else if (!level && adc.sck) {
+        adc.sck = false;
+        if (now - adc.sck_high_since > HX711_POWER_DOWN_US) {
+            // Was powered down: restart, first result after settling
+            adc.ready = false;
+            adc.pulses = 0;
+            adc.next_conversion_us = now + 4 * params.sample_period_us;
+        }
+    }
+}
+
+void sim_world_init(const sim_world_params_t *p)
+{
+    params = *p;
+    memset(&state, 0, sizeof(state));
+    state.sensor_connected = true;
+    world_us = sim_now_us();
+    cell_rate = 0.0f;
+    cell_sum = 0.0;
+    cell_sum_s = 0.0;
+    rng = p->seed ? p->seed : 1;
+    memset(&adc, 0, sizeof(adc));
+    adc.next_conversion_us = world_us + params.sample_period_us;
+
+    sim_gpio_attach_input(HX711_DT_PIN, adc_dout, NULL);
+    sim_gpio_attach_output(HX711_SCK_PIN, adc_sck, NULL);
+    sim_hw_set_sync_hook(world_sync);
+}
+
+void sim_world_set_load(float kg)
+{
+    world_sync();
+    state.load_kg = kg;
+}
+
+void sim_world_set_sensor_connected(bool connected)
+{
+    world_sync();
+    state.sensor_connected = connected;
+    if (!connected) {
+        adc.ready = false;
+        adc.pulses = 0;
+    }
+}
+
+void sim_world_get(sim_world_state_t *out)
+{
+    world_sync();
+    *out = state;
+}
@@ -0,0 +1,70 @@
+#ifndef SIM_WORLD_H
+#define SIM_WORLD_H
+
+// Simulated elevator hardware for host runs:
+//   - cabin on a cable drum driven by a DC motor through a self-locking
+//     worm gear, powered by the BTS7960 H-bridge (enable pins + 2 PWM)
+//   - load cell under the cabin floor: second-order mechanical response
+//     to the load's apparent weight m * (g + a), plus noise
+//   - HX711 at 10 SPS, bit-level on the DOUT/SCK pins (24 data pulses,
+//     1-3 gain pulses, power-down when SCK stays high > 60 us); each
+//     conversion is the mean load cell output over its period
+// The state is integrated lazily up to the virtual clock whenever the
+// firmware touches a pin or the scenario reads it.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    // Motor and drive train
+    float supply_v;             // H-bridge supply
+    float winding_ohm;
+    float kt;                   // Torque constant (N*m/A) = back-EMF constant (V*s/rad)
+    float rotor_inertia;        // kg*m^2
+    float gear_ratio;           // Motor turns per drum turn (worm gear, self-locking)
+    float gear_efficiency;
+    float drum_radius_m;
+    // Cabin
+    float cabin_kg;
+    float counterweight_kg;
+    float friction_n;           // Coulomb friction of the guides
+    float travel_m;             // Shaft height (end stops at 0 and travel_m)
+    // Load cell and HX711
+    float cell_natural_hz;      // Platform + cell resonance
+    float cell_damping;         // Damping ratio
+    float cell_noise_kg;        // 1-sigma noise per conversion
+    float cal_factor;           // Counts per kg (firmware calibration)
+    int32_t cal_offset;         // Counts at zero load
+    uint32_t sample_period_us;  // 100000 = 10 SPS
+    uint32_t seed;              // Noise seed (runs are reproducible)
+} sim_world_params_t;
+
+typedef struct {
+    float load_kg;              // Mass placed in the cabin
+    float cell_kg;              // Load cell output (apparent kg)
+    float position_m;           // Cabin height above the bottom stop
+    float velocity_mps;
+    float accel_mps2;
+    float motor_current_a;
+    float drive_v;              // Voltage across the motor
+    int32_t last_raw;           // Last HX711 conversion result
+    uint32_t conversions;
+    uint32_t conversions_read;
+    uint32_t conversions_missed; // Overwritten before the firmware read them
+    bool sensor_connected;
+} sim_world_state_t;
+
+// Defaults: small model elevator, calibration from hx711_config.h
+void sim_world_default_params(sim_world_params_t *p);
+
+// Attach the models to the HX711 and BTS7960 pins; call before the firmware starts
+void sim_world_init(const sim_world_params_t *p);
+
+// Scenario inputs
+void sim_world_set_load(float kg);
+void sim_world_set_sensor_connected(bool connected);   // false: DOUT stuck high
+
+// Integrate up to the current virtual time and return the state
+void sim_world_get(sim_world_state_t *out);
+
+#endif // SIM_WORLD_H
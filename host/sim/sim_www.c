@@ -0,0 +1,22 @@
+// Dashboard assets for the host build: the gzip files gzip_assets.py wrote
+// into WWW_GZ_DIR, under the symbol names target_add_binary_data() gives
+// them in the firmware (web_server.c refers to them by those names)
+
+#ifdef __APPLE__
+#define RODATA_SECTION ".const"
+#else
+#define RODATA_SECTION ".section .rodata"
+#endif
+
+#define EMBED(sym, file)                                    \
+    __asm__(RODATA_SECTION "\n"                             \
+            ".global _binary_" sym "_start\n"               \
+            ".global _binary_" sym "_end\n"                 \
+            "_binary_" sym "_start:\n"                      \
+            ".incbin \"" WWW_GZ_DIR "/" file "\"\n"         \
+            "_binary_" sym "_end:\n"                        \
+            ".previous\n")
+
+EMBED("index_html_gz", "index.html.gz");
+EMBED("app_js_gz", "app.js.gz");
+EMBED("style_css_gz", "style.css.gz");
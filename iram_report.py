@@ -0,0 +1,281 @@
+#!/usr/bin/env python3
+"""
+Where did the code end up? Reads the linker map of a build and reports,
+for one archive (the main component by default):
+
+  - every entry of the linker fragment (main/linker.lf) with its memory
+    region and size - with --check, exits 1 if one was left in flash
+  - per-object bytes in IRAM, DRAM, flash text and flash rodata
+  - IRAM / DRAM totals of the whole image
+
+Runs after every firmware build (CMakeLists.txt), writing
+build/iram_report.txt. Also works on host (GNU ld) maps, where .text
+counts as flash.
+
+  python3 iram_report.py build/esp32-elevator.map --fragment main/linker.lf
+  python3 iram_report.py build/esp32-elevator.map --fragment main/linker.lf --check -o report.txt
+"""
+
+import argparse
+import re
+import sys
+from collections import defaultdict
+
+REGIONS = ("iram", "dram", "flash_text", "flash_rodata", "rtc", "psram")
+RAM_REGIONS = ("iram", "dram")
+
+# Input section prefixes that carry the function / variable name
+NAMED_PREFIXES = (".text.", ".literal.", ".rodata.", ".data.", ".bss.", ".sdata.", ".sbss.",
+                  ".srodata.", ".iram1.", ".dram1.")
+
+OUTPUT_SECTION = re.compile(r"^(\.\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+))?\s*$")
+INPUT_SECTION = re.compile(r"^ (\.\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*))?$")
+ADDR_SIZE_OBJ = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+SYMBOL = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+([A-Za-z_][\w.$]*)\s*$")
+OBJECT = re.compile(r"([^/\\(]+\.a)\(([^)]+)\)\s*$")
+
+
+def region_of(output_section):
+    """Memory region of an output section (None: not loaded, e.g. debug info)."""
+    s = output_section
+    if s.startswith(".iram"):
+        return "iram"
+    if s.startswith((".dram", ".noinit")) or s in (".data", ".bss", ".tbss", ".tdata"):
+        return "dram"
+    if s.startswith(".rtc"):
+        return "rtc"
+    if s.startswith(".ext_ram"):
+        return "psram"
+    if s.startswith(".flash.text") or s in (".text", ".init", ".fini", ".plt"):
+        return "flash_text"
+    if s.startswith((".flash", ".rodata")) or s in (".eh_frame", ".init_array", ".fini_array"):
+        return "flash_rodata"
+    return None
+
+
+def object_name(obj):
+    """hx711.c.obj / hx711.c.o / hx711.o -> hx711 (the fragment's object name)."""
+    for suffix in (".c.obj", ".c.o", ".cpp.obj", ".cpp.o", ".obj", ".o"):
+        if obj.endswith(suffix):
+            return obj[: -len(suffix)]
+    return obj
+
+
+class Placement:
+    def __init__(self):
+        # (archive, object) -> region -> bytes
+        self.objects = defaultdict(lambda: defaultdict(int))
+        # (archive, object, name) -> region -> bytes
+        self.names = defaultdict(lambda: defaultdict(int))
+        self.totals = defaultdict(int)
+
+
+def parse_map(lines):
+    """Input sections from the 'Linker script and memory map' part of a GNU ld map."""
+    p = Placement()
+    it = iter(lines)
+    for line in it:
+        if line.startswith("Linker script and memory map"):
+            break
+    else:
+        raise ValueError("not a GNU ld map file (no 'Linker script and memory map')")
+
+    region = None
+    pending_section = None      # Input section name waiting for its address line
+    current = None              # [archive, object, section, addr, size, symbols, region]
+    sections = []
+
+    def close():
+        if current is not None:
+            sections.append(current)
+
+    for line in it:
+        line = line.rstrip("\n")
+        if not line.strip():
+            continue
+        if not line.startswith(" "):
+            m = OUTPUT_SECTION.match(line)
+            if m:
+                close()
+                current = None
+                pending_section = None
+                region = region_of(m.group(1))
+            continue
+        if pending_section is not None:
+            m = ADDR_SIZE_OBJ.match(line)
+            pending, pending_section = pending_section, None
+            if m:
+                close()
+                current = _input_section(region, pending, m.group(1), m.group(2), m.group(3))
+                continue
+        m = INPUT_SECTION.match(line)
+        if m and not line.startswith("  "):
+            if m.group(2) is None:
+                pending_section = m.group(1)
+            else:
+                close()
+                current = _input_section(region, m.group(1), m.group(2), m.group(3), m.group(4))
+            continue
+        m = SYMBOL.match(line)
+        if m and current is not None:
+            current[5].append((int(m.group(1), 16), m.group(2)))
+    close()
+
+    for sec in sections:
+        archive, obj, name, addr, size, symbols, reg = sec
+        if reg is None or size == 0 or addr == 0:
+            continue
+        p.totals[reg] += size
+        if obj is None:
+            continue
+        p.objects[(archive, obj)][reg] += size
+        for sym, sym_size in _names(name, addr, size, symbols):
+            p.names[(archive, obj, sym)][reg] += sym_size
+    return p
+
+
+def _input_section(region, section, addr, size, origin):
+    m = OBJECT.search(origin)
+    archive, obj = (m.group(1), object_name(m.group(2))) if m else (None, None)
+    return [archive, obj, section, int(addr, 16), int(size, 16), [], region]
+
+
+def _names(section, addr, size, symbols):
+    """(name, bytes) pairs for one input section."""
+    for prefix in NAMED_PREFIXES:
+        if section.startswith(prefix):
+            name = section[len(prefix):]
+            if name and not name.isdigit():
+                return [(name, size)]
+            break
+    # .iram1.N and friends: split the section between its listed symbols
+    symbols = sorted(s for s in symbols if addr <= s[0] < addr + size)
+    out = []
+    for i, (sym_addr, sym) in enumerate(symbols):
+        end = symbols[i + 1][0] if i + 1 < len(symbols) else addr + size
+        out.append((sym, end - sym_addr))
+    return out
+
+
+def parse_fragment(text):
+    """archive and [(object, symbol or None, scheme)] from an ESP-IDF linker fragment."""
+    archive = None
+    entries = []
+    in_entries = False
+    for raw in text.splitlines():
+        line = raw.split("#", 1)[0].rstrip()
+        if not line.strip():
+            continue
+        stripped = line.strip()
+        if stripped.startswith("["):
+            in_entries = False
+            continue
+        if stripped.startswith("archive:"):
+            archive = stripped.split(":", 1)[1].strip()
+            continue
+        if stripped.startswith("entries:"):
+            in_entries = True
+            continue
+        if in_entries:
+            m = re.match(r"([\w*]+)(?::([\w*]+))?\s*\((\w+)\)", stripped)
+            if m:
+                entries.append((m.group(1), m.group(2), m.group(3)))
+    return archive, entries
+
+
+def fmt_bytes(n):
+    return "%8d" % n if n else "       -"
+
+
+def report(p, archive, entries, map_path, fragment_path):
+    lines = []
+    failures = []
+    lines.append("Placement of %s (%s)" % (archive, map_path))
+    lines.append("")
+
+    if entries:
+        lines.append("Timing-critical entries (%s):" % fragment_path)
+        for obj, sym, scheme in entries:
+            label = "%s:%s" % (obj, sym) if sym else obj
+            if sym:
+                placed = p.names.get((archive, obj, sym))
+            else:
+                placed = p.objects.get((archive, obj))
+            if not placed:
+                lines.append("  %-48s %-12s %s" % (label, "NOT FOUND", scheme))
+                failures.append("%s not found in the map" % label)
+                continue
+            where = " + ".join("%s %d B" % (r, placed[r]) for r in REGIONS if placed.get(r))
+            ok = all(r in RAM_REGIONS for r in placed if placed[r])
+            lines.append("  %-48s %-34s %s%s" % (label, where, scheme, "" if ok else "  <-- FLASH"))
+            if not ok:
+                failures.append("%s is (partly) in flash" % label)
+        lines.append("")
+
+    lines.append("By object (bytes):")
+    lines.append("  %-28s %8s %8s %8s %8s" % ("object", "iram", "dram", "f.text", "f.rodata"))
+    sums = defaultdict(int)
+    for (arch, obj), regions in sorted(p.objects.items()):
+        if arch != archive:
+            continue
+        lines.append("  %-28s %s %s %s %s" % (obj, fmt_bytes(regions.get("iram", 0)),
+                                               fmt_bytes(regions.get("dram", 0)),
+                                               fmt_bytes(regions.get("flash_text", 0)),
+                                               fmt_bytes(regions.get("flash_rodata", 0))))
+        for r, n in regions.items():
+            sums[r] += n
+    lines.append("  %-28s %s %s %s %s" % ("total", fmt_bytes(sums["iram"]), fmt_bytes(sums["dram"]),
+                                           fmt_bytes(sums["flash_text"]),
+                                           fmt_bytes(sums["flash_rodata"])))
+    lines.append("")
+    lines.append("Whole image: iram %d B, dram %d B, flash text %d B, flash rodata %d B" %
+                 (p.totals["iram"], p.totals["dram"], p.totals["flash_text"],
+                  p.totals["flash_rodata"]))
+    return lines, failures, sums
+
+
+def main():
+    ap = argparse.ArgumentParser(description="IRAM/DRAM/flash placement report from a linker map")
+    ap.add_argument("map", help="linker map (build/<project>.map)")
+    ap.add_argument("--fragment", help="ESP-IDF linker fragment listing the timing-critical entries")
+    ap.add_argument("--archive", help="archive to report (default: the fragment's, else libmain.a)")
+    ap.add_argument("--check", action="store_true",
+                    help="exit 1 if a fragment entry is in flash (missing entries always fail)")
+    ap.add_argument("-o", "--output", help="write the report here and print a summary line")
+    args = ap.parse_args()
+
+    entries = []
+    archive = None
+    if args.fragment:
+        with open(args.fragment) as f:
+            archive, entries = parse_fragment(f.read())
+    archive = args.archive or archive or "libmain.a"
+
+    try:
+        with open(args.map, errors="replace") as f:
+            placement = parse_map(f)
+    except (OSError, ValueError) as e:
+        print("iram_report: %s" % e, file=sys.stderr)
+        return 2
+
+    lines, failures, sums = report(placement, archive, entries, args.map, args.fragment)
+    text = "\n".join(lines) + "\n"
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text)
+        print("iram_report: %s in IRAM %d B, DRAM %d B, flash %d B; %d/%d critical entries in RAM -> %s" %
+              (archive, sums["iram"], sums["dram"], sums["flash_text"] + sums["flash_rodata"],
+               len(entries) - len(failures), len(entries), args.output))
+    else:
+        sys.stdout.write(text)
+
+    missing = [f for f in failures if f.endswith("not found in the map")]
+    for f in (failures if args.check else missing):
+        print("iram_report: %s" % f, file=sys.stderr)
+    if missing or (args.check and failures):
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
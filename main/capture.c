@@ -0,0 +1,339 @@
+#include "capture.h"
+#include "esp_timer.h"
+#include <math.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+static portMUX_TYPE capture_lock = portMUX_INITIALIZER_UNLOCKED;
+#define CAPTURE_LOCK()   portENTER_CRITICAL(&capture_lock)
+#define CAPTURE_UNLOCK() portEXIT_CRITICAL(&capture_lock)
+#else
+#include <pthread.h>
+static pthread_mutex_t capture_lock = PTHREAD_MUTEX_INITIALIZER;
+#define CAPTURE_LOCK()   pthread_mutex_lock(&capture_lock)
+#define CAPTURE_UNLOCK() pthread_mutex_unlock(&capture_lock)
+#endif
+
+static uint8_t buf[CAPTURE_BUF_SIZE];
+static size_t len = 0;
+static volatile bool active = false;
+
+// Encoder state (only touched with capture_lock held)
+static int64_t last_us;
+static int32_t last_raw;
+static int32_t last_grams;
+
+static size_t put_varint(uint8_t *p, uint32_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+static uint32_t float_bits(float f)
+{
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static float bits_float(uint32_t u)
+{
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+void capture_start(const capture_header_t *header)
+{
+    CAPTURE_LOCK();
+    memset(buf, 0, CAPTURE_HEADER_SIZE);
+    buf[0] = CAPTURE_MAGIC_0;
+    buf[1] = CAPTURE_MAGIC_1;
+    buf[2] = CAPTURE_VERSION;
+    last_us = esp_timer_get_time();
+    put_u32(buf + 4, (uint32_t)last_us);
+    put_u32(buf + 8, (uint32_t)((uint64_t)last_us >> 32));
+    put_u32(buf + 12, float_bits(header->calibration_factor));
+    put_u32(buf + 16, (uint32_t)header->offset);
+    put_u32(buf + 20, float_bits(header->threshold));
+    put_u16(buf + 24, header->update_interval_ms);
+    buf[26] = header->readings_per_sample;
+    buf[27] = header->auto_mode;
+    buf[28] = header->motor_triggered;
+    len = CAPTURE_HEADER_SIZE;
+    last_raw = 0;
+    last_grams = 0;
+    active = true;
+    CAPTURE_UNLOCK();
+}
+
+void capture_stop(void)
+{
+    CAPTURE_LOCK();
+    active = false;
+    CAPTURE_UNLOCK();
+}
+
+bool capture_active(void)
+{
+    return active;
+}
+
+#define NO_BYTE -1
+
+// Append one record: type, dt, optional byte, optional varint argument.
+// With delta_base the argument is stored as a zigzag delta to *delta_base,
+// computed under the lock so concurrent writers keep the chain consistent.
+static void append(capture_record_type_t type, int byte, bool has_arg, uint32_t arg,
+                   int32_t *delta_base)
+{
+    int64_t now = esp_timer_get_time();
+
+    CAPTURE_LOCK();
+    if (!active) {
+        CAPTURE_UNLOCK();
+        return;
+    }
+    if (len + CAPTURE_RECORD_MAX_SIZE > sizeof(buf)) {
+        buf[3] |= CAPTURE_FLAG_TRUNCATED;
+        active = false;
+        CAPTURE_UNLOCK();
+        return;
+    }
+    // A record stamped just before another task's record that won the lock
+    // is kept in lock order with dt 0
+    int64_t dt = now > last_us ? now - last_us : 0;
+    if (delta_base != NULL) {
+        int32_t value = (int32_t)arg;
+        arg = zigzag((int32_t)((uint32_t)value - (uint32_t)*delta_base));
+        *delta_base = value;
+    }
+    uint8_t *p = buf + len;
+    size_t n = 0;
+    p[n++] = (uint8_t)type;
+    n += put_varint(p + n, dt > UINT32_MAX ? UINT32_MAX : (uint32_t)dt);
+    if (byte != NO_BYTE) {
+        p[n++] = (uint8_t)byte;
+    }
+    if (has_arg) {
+        n += put_varint(p + n, arg);
+    }
+    len += n;
+    last_us += dt;
+    CAPTURE_UNLOCK();
+}
+
+void capture_conversion(int32_t raw)
+{
+    if (active) {
+        append(CAPTURE_REC_CONVERSION, NO_BYTE, true, (uint32_t)raw, &last_raw);
+    }
+}
+
+void capture_timeout(void)
+{
+    if (active) {
+        append(CAPTURE_REC_TIMEOUT, NO_BYTE, false, 0, NULL);
+    }
+}
+
+void capture_command(capture_cmd_t cmd, int32_t arg)
+{
+    if (active) {
+        append(CAPTURE_REC_COMMAND, cmd, true, (uint32_t)arg, NULL);
+    }
+}
+
+void capture_command_float(capture_cmd_t cmd, float arg)
+{
+    if (active) {
+        append(CAPTURE_REC_COMMAND, cmd, true, float_bits(arg), NULL);
+    }
+}
+
+void capture_sample(float weight_kg)
+{
+    if (active) {
+        append(CAPTURE_REC_SAMPLE, NO_BYTE, true, (uint32_t)(int32_t)lrintf(weight_kg * 1000.0f),
+               &last_grams);
+    }
+}
+
+void capture_decision(uint8_t action)
+{
+    if (active) {
+        append(CAPTURE_REC_DECISION, action, false, 0, NULL);
+    }
+}
+
+size_t capture_size(void)
+{
+    return len;
+}
+
+size_t capture_copy(size_t offset, uint8_t *dst, size_t n)
+{
+    CAPTURE_LOCK();
+    if (offset >= len) {
+        n = 0;
+    } else if (n > len - offset) {
+        n = len - offset;
+    }
+    memcpy(dst, buf + offset, n);
+    if (offset <= 3 && offset + n > 3 && active) {
+        dst[3 - offset] |= CAPTURE_FLAG_RUNNING;
+    }
+    CAPTURE_UNLOCK();
+    return n;
+}
+
+bool capture_cmd_is_float(uint8_t cmd)
+{
+    return cmd == CAPTURE_CMD_THRESHOLD || cmd == CAPTURE_CMD_SCALE;
+}
+
+const char *capture_cmd_name(uint8_t cmd)
+{
+    static const char *names[] = {
+        "?", "forward", "backward", "stop", "reset", "auto_mode", "threshold",
+        "zero", "scale", "offset", "readings", "interval"
+    };
+    return cmd < sizeof(names) / sizeof(names[0]) ? names[cmd] : "?";
+}
+
+bool capture_reader_init(capture_reader_t *r, const uint8_t *data, size_t size,
+                         capture_header_t *header, uint8_t *flags)
+{
+    if (size < CAPTURE_HEADER_SIZE || data[0] != CAPTURE_MAGIC_0 ||
+        data[1] != CAPTURE_MAGIC_1 || data[2] != CAPTURE_VERSION) {
+        return false;
+    }
+    if (header) {
+        header->start_us = (int64_t)((uint64_t)get_u32(data + 4) | ((uint64_t)get_u32(data + 8) << 32));
+        header->calibration_factor = bits_float(get_u32(data + 12));
+        header->offset = (int32_t)get_u32(data + 16);
+        header->threshold = bits_float(get_u32(data + 20));
+        header->update_interval_ms = get_u16(data + 24);
+        header->readings_per_sample = data[26];
+        header->auto_mode = data[27] != 0;
+        header->motor_triggered = data[28] != 0;
+    }
+    if (flags) {
+        *flags = data[3];
+    }
+    *r = (capture_reader_t) { .buf = data, .len = size, .pos = CAPTURE_HEADER_SIZE };
+    return true;
+}
+
+static bool get_varint(capture_reader_t *r, uint32_t *out)
+{
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (r->pos >= r->len) {
+            return false;
+        }
+        uint8_t b = r->buf[r->pos++];
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) {
+            *out = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool capture_reader_next(capture_reader_t *r, capture_record_t *rec)
+{
+    uint32_t dt, v = 0;
+    if (r->pos >= r->len) {
+        return false;
+    }
+    memset(rec, 0, sizeof(*rec));
+    rec->type = (capture_record_type_t)r->buf[r->pos++];
+    if (!get_varint(r, &dt)) {
+        return false;
+    }
+    r->t_us += dt;
+    rec->t_us = r->t_us;
+
+    switch (rec->type) {
+        case CAPTURE_REC_CONVERSION:
+            if (!get_varint(r, &v)) {
+                return false;
+            }
+            r->last_raw = (int32_t)((uint32_t)r->last_raw + (uint32_t)unzigzag(v));
+            rec->value = r->last_raw;
+            return true;
+
+        case CAPTURE_REC_TIMEOUT:
+            return true;
+
+        case CAPTURE_REC_COMMAND:
+            if (r->pos >= r->len) {
+                return false;
+            }
+            rec->cmd = r->buf[r->pos++];
+            if (!get_varint(r, &v)) {
+                return false;
+            }
+            rec->value = (int32_t)v;
+            rec->fvalue = capture_cmd_is_float(rec->cmd) ? bits_float(v) : (float)rec->value;
+            return true;
+
+        case CAPTURE_REC_SAMPLE:
+            if (!get_varint(r, &v)) {
+                return false;
+            }
+            r->last_grams = (int32_t)((uint32_t)r->last_grams + (uint32_t)unzigzag(v));
+            rec->value = r->last_grams;
+            return true;
+
+        case CAPTURE_REC_DECISION:
+            if (r->pos >= r->len) {
+                return false;
+            }
+            rec->value = r->buf[r->pos++];
+            return true;
+
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,136 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Record of everything that drives the motor decisions: every HX711
+// conversion, every command from the API, every published sample and every
+// auto-control decision, timestamped. Download it from GET /api/capture and
+// feed it to the host replay (host/sim/sim_replay.c), which runs the same
+// hx711.c, sampling loop and control task on it and diffs the decisions.
+//
+// Capture format, version 1 (little-endian):
+//
+//   offset size  field
+//   0      2     magic 'E','C'
+//   2      1     version (1)
+//   3      1     flags (CAPTURE_FLAG_*)
+//   4      8     start time, us since boot
+//   12     4     calibration factor (float)
+//   16     4     offset (raw counts)
+//   20     4     auto threshold, kg (float)
+//   24     2     update interval, ms
+//   26     1     readings per sample
+//   27     1     auto mode
+//   28     1     motor triggered
+//   29     3     reserved (0)
+//   32     ...   records: u8 type | varint dt_us (since previous record) | payload
+//
+//   CAPTURE_REC_CONVERSION  zz-varint raw delta to the previous conversion
+//   CAPTURE_REC_TIMEOUT     -               (hx711_read gave up waiting)
+//   CAPTURE_REC_COMMAND     u8 command | varint argument (float bits for
+//                           CAPTURE_CMD_THRESHOLD and CAPTURE_CMD_SCALE)
+//   CAPTURE_REC_SAMPLE      zz-varint weight delta in grams to the previous sample
+//   CAPTURE_REC_DECISION    u8 control_action_t
+//
+// Conversions cost ~6 bytes, so the default buffer holds ~4 minutes at
+// 10 SPS. Recording stops when the buffer is full (CAPTURE_FLAG_TRUNCATED).
+
+#ifndef CAPTURE_BUF_SIZE
+#define CAPTURE_BUF_SIZE 16384
+#endif
+
+#define CAPTURE_MAGIC_0 'E'
+#define CAPTURE_MAGIC_1 'C'
+#define CAPTURE_VERSION 1
+#define CAPTURE_HEADER_SIZE 32
+#define CAPTURE_RECORD_MAX_SIZE 12   // Worst-case encoded record
+
+#define CAPTURE_FLAG_TRUNCATED 0x01  // Buffer filled up, later events are missing
+#define CAPTURE_FLAG_RUNNING   0x02  // Downloaded while still recording
+
+typedef enum {
+    CAPTURE_REC_CONVERSION = 1,
+    CAPTURE_REC_TIMEOUT,
+    CAPTURE_REC_COMMAND,
+    CAPTURE_REC_SAMPLE,
+    CAPTURE_REC_DECISION
+} capture_record_type_t;
+
+typedef enum {
+    CAPTURE_CMD_FORWARD = 1,    // Manual forward (auto mode off)
+    CAPTURE_CMD_BACKWARD,       // Manual backward (auto mode off)
+    CAPTURE_CMD_STOP,           // Manual stop (auto mode back on)
+    CAPTURE_CMD_RESET,          // Motor system reset
+    CAPTURE_CMD_AUTO_MODE,      // arg: new auto mode (0/1)
+    CAPTURE_CMD_THRESHOLD,      // arg: threshold, kg (float)
+    CAPTURE_CMD_ZERO,           // Tare started (its conversions follow)
+    CAPTURE_CMD_SCALE,          // arg: calibration factor (float)
+    CAPTURE_CMD_OFFSET,         // arg: offset, raw counts
+    CAPTURE_CMD_READINGS,       // arg: readings per sample
+    CAPTURE_CMD_INTERVAL        // arg: update interval, ms
+} capture_cmd_t;
+
+// Starting conditions, stored in the header
+typedef struct {
+    int64_t start_us;
+    float calibration_factor;
+    int32_t offset;
+    float threshold;
+    uint16_t update_interval_ms;
+    uint8_t readings_per_sample;
+    bool auto_mode;
+    bool motor_triggered;
+} capture_header_t;
+
+// One decoded record; time is us since the capture started
+typedef struct {
+    int64_t t_us;
+    capture_record_type_t type;
+    int32_t value;      // Conversion raw value, sample grams, command argument or action
+    uint8_t cmd;        // CAPTURE_REC_COMMAND only
+    float fvalue;       // Float command argument (threshold, scale)
+} capture_record_t;
+
+// Start a new capture (drops the previous one); start_us is taken now
+void capture_start(const capture_header_t *header);
+void capture_stop(void);
+bool capture_active(void);
+
+// Recording hooks - a flag test when no capture is running
+void capture_conversion(int32_t raw);
+void capture_timeout(void);
+void capture_command(capture_cmd_t cmd, int32_t arg);
+void capture_command_float(capture_cmd_t cmd, float arg);
+void capture_sample(float weight_kg);
+void capture_decision(uint8_t action);
+
+// Captured bytes so far (header included, 0 if never started)
+size_t capture_size(void);
+
+// Copy up to len bytes starting at offset; returns the number copied
+size_t capture_copy(size_t offset, uint8_t *dst, size_t len);
+
+// Decoding (host replay, tools)
+typedef struct {
+    const uint8_t *buf;
+    size_t len;
+    size_t pos;
+    int64_t t_us;
+    int32_t last_raw;
+    int32_t last_grams;
+} capture_reader_t;
+
+// Parse the header; returns false if buf is not a version 1 capture
+bool capture_reader_init(capture_reader_t *r, const uint8_t *buf, size_t len,
+                         capture_header_t *header, uint8_t *flags);
+
+// Next record; false at the end or on a malformed record
+bool capture_reader_next(capture_reader_t *r, capture_record_t *rec);
+
+bool capture_cmd_is_float(uint8_t cmd);
+const char *capture_cmd_name(uint8_t cmd);
+
+#endif // CAPTURE_H
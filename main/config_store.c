@@ -0,0 +1,243 @@
+#include "config_store.h"
+#include "hx711_config.h"
+#include "control_policy.h"
+#include "load_estimator.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <math.h>
+#include <string.h>
+
+static const char *TAG = "CONFIG";
+
+#define NVS_NAMESPACE "elevator"
+#define NVS_KEY       "cfg"
+
+// Stored blob: version + size guard against loading a stale layout
+typedef struct {
+    uint16_t version;
+    uint16_t size;
+    elevator_config_t cfg;
+} config_blob_t;
+
+static elevator_config_t config;
+static bool loaded = false;
+static bool dirty = false;
+static uint32_t write_count = 0;
+static portMUX_TYPE config_lock = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t change_sem = NULL;     // Given on every change
+static SemaphoreHandle_t write_lock = NULL;     // One NVS write at a time
+
+static void config_defaults(elevator_config_t *cfg)
+{
+    *cfg = (elevator_config_t) {
+        .calibration_factor = HX711_CALIBRATION_FACTOR,
+        .offset = HX711_OFFSET,
+        .threshold = CONTROL_DEFAULT_THRESHOLD,
+        .auto_mode = CONTROL_DEFAULT_AUTO_MODE,
+        .readings_per_sample = READINGS_PER_SAMPLE,
+        .update_interval_ms = UPDATE_INTERVAL_MS,
+        .fast_boot = true,
+        .cabin_speed_mps = CABIN_MODEL_SPEED_MPS,
+        .cabin_accel_ms = (uint16_t)CABIN_MODEL_ACCEL_MS,
+        .cabin_cell_hz = CABIN_MODEL_CELL_HZ,
+        .cabin_cell_damping = CABIN_MODEL_CELL_DAMPING
+    };
+}
+
+bool config_store_threshold_valid(float threshold_kg)
+{
+    return isfinite(threshold_kg) && threshold_kg >= 0.0f &&
+           threshold_kg <= CONFIG_STORE_THRESHOLD_MAX_KG;
+}
+
+// NaN never passes, so config_equal() always sees comparable values and a
+// repeated set does not wake the writer again
+bool config_store_valid(const elevator_config_t *cfg)
+{
+    return isfinite(cfg->calibration_factor) && cfg->calibration_factor != 0.0f &&
+           config_store_threshold_valid(cfg->threshold) &&
+           cfg->readings_per_sample >= 1 && cfg->readings_per_sample <= 32 &&
+           cfg->update_interval_ms >= 50 && cfg->update_interval_ms <= 60000 &&
+           cfg->cabin_speed_mps >= 0.0f && cfg->cabin_speed_mps <= 10.0f &&
+           cfg->cabin_accel_ms >= 1 && cfg->cabin_accel_ms <= 10000 &&
+           cfg->cabin_cell_hz >= 0.1f && cfg->cabin_cell_hz <= 100.0f &&
+           cfg->cabin_cell_damping >= 0.01f && cfg->cabin_cell_damping <= 2.0f;
+}
+
+// Field by field: memcmp would also compare the padding bytes, which a
+// copy or an initializer leaves undefined
+static bool config_equal(const elevator_config_t *a, const elevator_config_t *b)
+{
+    return a->calibration_factor == b->calibration_factor &&
+           a->offset == b->offset &&
+           a->threshold == b->threshold &&
+           a->auto_mode == b->auto_mode &&
+           a->readings_per_sample == b->readings_per_sample &&
+           a->update_interval_ms == b->update_interval_ms &&
+           a->fast_boot == b->fast_boot &&
+           a->cabin_speed_mps == b->cabin_speed_mps &&
+           a->cabin_accel_ms == b->cabin_accel_ms &&
+           a->cabin_cell_hz == b->cabin_cell_hz &&
+           a->cabin_cell_damping == b->cabin_cell_damping;
+}
+
+static esp_err_t config_write(void)
+{
+    // Zeroed so the padding written to flash is deterministic
+    config_blob_t blob;
+    memset(&blob, 0, sizeof(blob));
+    blob.version = CONFIG_STORE_VERSION;
+    blob.size = sizeof(elevator_config_t);
+
+    // Serialize the writer task and config_store_flush(): a later snapshot
+    // must not be overwritten by an earlier one committed after it
+    if (write_lock != NULL) {
+        xSemaphoreTake(write_lock, portMAX_DELAY);
+    }
+    portENTER_CRITICAL(&config_lock);
+    if (!dirty) {
+        portEXIT_CRITICAL(&config_lock);
+        if (write_lock != NULL) {
+            xSemaphoreGive(write_lock);
+        }
+        return ESP_OK;
+    }
+    blob.cfg = config;
+    dirty = false;
+    portEXIT_CRITICAL(&config_lock);
+
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(nvs, NVS_KEY, &blob, sizeof(blob));
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+
+    if (err == ESP_OK) {
+        write_count++;
+        ESP_LOGI(TAG, "💾 Configuration saved (write #%u)", (unsigned)write_count);
+    } else {
+        ESP_LOGE(TAG, "Failed to save configuration: %s", esp_err_to_name(err));
+        portENTER_CRITICAL(&config_lock);
+        dirty = true;
+        portEXIT_CRITICAL(&config_lock);
+    }
+    if (write_lock != NULL) {
+        xSemaphoreGive(write_lock);
+    }
+    return err;
+}
+
+// Flash writes stall the cache for milliseconds, so they run here rather
+// than in the esp_timer task, which would hold up every other timer. Every
+// change restarts the quiet period.
+static void config_writer_task(void *arg)
+{
+    while (1) {
+        xSemaphoreTake(change_sem, portMAX_DELAY);
+        while (xSemaphoreTake(change_sem, pdMS_TO_TICKS(CONFIG_STORE_DEBOUNCE_MS)) == pdTRUE) {
+        }
+        config_write();
+    }
+}
+
+esp_err_t config_store_init(void)
+{
+    // Initialize NVS
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    config_defaults(&config);
+
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+        config_blob_t blob;
+        size_t len = sizeof(blob);
+        if (nvs_get_blob(nvs, NVS_KEY, &blob, &len) == ESP_OK && len == sizeof(blob) &&
+            blob.version == CONFIG_STORE_VERSION && blob.size == sizeof(elevator_config_t) &&
+            config_store_valid(&blob.cfg)) {
+            config = blob.cfg;
+            loaded = true;
+        }
+        nvs_close(nvs);
+    }
+
+    change_sem = xSemaphoreCreateBinary();
+    write_lock = xSemaphoreCreateMutex();
+    if (change_sem == NULL || write_lock == NULL ||
+        xTaskCreatePinnedToCore(config_writer_task, "config_save", CONFIG_STORE_TASK_STACK, NULL,
+                                CONFIG_STORE_TASK_PRIORITY, NULL,
+                                CONFIG_STORE_TASK_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create the configuration writer");
+        change_sem = NULL;
+        ret = ESP_ERR_NO_MEM;
+    }
+
+    if (loaded) {
+        ESP_LOGI(TAG, "✅ Configuration restored: scale=%.2f offset=%ld threshold=%.2f kg auto=%s",
+                 config.calibration_factor, (long)config.offset, config.threshold,
+                 config.auto_mode ? "on" : "off");
+    } else {
+        // Written by the first config_store_flush() / change
+        dirty = true;
+        ESP_LOGI(TAG, "No stored configuration - using defaults");
+    }
+    return ret;
+}
+
+bool config_store_loaded(void)
+{
+    return loaded;
+}
+
+void config_store_get(elevator_config_t *out)
+{
+    portENTER_CRITICAL(&config_lock);
+    *out = config;
+    portEXIT_CRITICAL(&config_lock);
+}
+
+void config_store_set(const elevator_config_t *cfg)
+{
+    if (!config_store_valid(cfg)) {
+        ESP_LOGW(TAG, "Ignoring invalid configuration");
+        return;
+    }
+
+    portENTER_CRITICAL(&config_lock);
+    bool changed = !config_equal(&config, cfg);
+    if (changed) {
+        config = *cfg;
+        dirty = true;
+    }
+    portEXIT_CRITICAL(&config_lock);
+
+    // Wake the writer: the write happens once changes stop
+    if (changed && change_sem != NULL) {
+        xSemaphoreGive(change_sem);
+    }
+}
+
+esp_err_t config_store_flush(void)
+{
+    // A pending wake-up finds nothing dirty and writes nothing
+    return config_write();
+}
+
+uint32_t config_store_write_count(void)
+{
+    return write_count;
+}
@@ -0,0 +1,59 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Persistent configuration in NVS (namespace "elevator").
+// Changes are kept in RAM and written after CONFIG_STORE_DEBOUNCE_MS of
+// quiet, so dragging a threshold slider costs one flash write, not fifty.
+// The write runs in a low-priority writer task.
+
+#define CONFIG_STORE_DEBOUNCE_MS 2000
+#define CONFIG_STORE_TASK_STACK    3072
+#define CONFIG_STORE_TASK_PRIORITY 1       // Just above idle
+#define CONFIG_STORE_TASK_CORE     0
+#define CONFIG_STORE_VERSION     2     // Bump when elevator_config_t changes
+#define CONFIG_STORE_THRESHOLD_MAX_KG 500.0f   // Largest common load cell
+
+typedef struct {
+    float calibration_factor;       // HX711 scale (raw counts per kg)
+    int32_t offset;                 // HX711 zero point (raw)
+    float threshold;                // Auto start threshold, kg
+    bool auto_mode;                 // Auto motor control enabled
+    uint8_t readings_per_sample;    // Filter: HX711 readings averaged per sample
+    uint16_t update_interval_ms;    // Filter: time between samples
+    bool fast_boot;                 // Skip the motor self-test at boot
+    float cabin_speed_mps;          // Cabin model (load_estimator.h): speed at full duty
+    uint16_t cabin_accel_ms;        // Cabin model: drive time constant
+    float cabin_cell_hz;            // Cabin model: platform + load cell resonance
+    float cabin_cell_damping;       // Cabin model: damping ratio of the resonance
+} elevator_config_t;
+
+// Initialize NVS flash (erasing it if the layout is incompatible) and load
+// the stored configuration, falling back to defaults. Call first in app_main.
+esp_err_t config_store_init(void);
+
+// true if a valid configuration was loaded from flash
+bool config_store_loaded(void);
+
+// Current configuration
+void config_store_get(elevator_config_t *out);
+
+// Range check (zero scale, filter settings out of range)
+bool config_store_valid(const elevator_config_t *cfg);
+
+// Finite and within 0..CONFIG_STORE_THRESHOLD_MAX_KG
+bool config_store_threshold_valid(float threshold_kg);
+
+// Replace the configuration; written to flash after the debounce delay
+void config_store_set(const elevator_config_t *cfg);
+
+// Write a pending change now
+esp_err_t config_store_flush(void);
+
+// Number of flash writes since boot
+uint32_t config_store_write_count(void);
+
+#endif // CONFIG_STORE_H
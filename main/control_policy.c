@@ -0,0 +1,29 @@
+#include "control_policy.h"
+
+control_action_t control_policy_decide(const elevator_state_t *st)
+{
+    // Manual mode: motor is driven only by API commands
+    if (!st->auto_mode) {
+        return CONTROL_ACTION_NONE;
+    }
+
+    // Load on the platform: start once, until the load drops again. The
+    // motion-compensated load, so a start/stop ramp read mid-trip does not
+    // count as unloading
+    if (st->load >= st->threshold && !st->motor_triggered) {
+        return CONTROL_ACTION_START;
+    }
+    if (st->load < st->threshold && st->motor_triggered) {
+        return CONTROL_ACTION_STOP;
+    }
+    return CONTROL_ACTION_NONE;
+}
+
+const char *control_action_name(control_action_t action)
+{
+    switch (action) {
+        case CONTROL_ACTION_START: return "start";
+        case CONTROL_ACTION_STOP:  return "stop";
+        default:                   return "none";
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef CONTROL_POLICY_H
+#define CONTROL_POLICY_H
+
+#include "shared_state.h"
+
+// Auto motor control policy. Pure function of the state snapshot - no
+// hardware access, no timing - so it can run on the host as well.
+
+// Defaults until the user changes them via the API
+#define CONTROL_DEFAULT_AUTO_MODE true    // Auto mode enabled
+#define CONTROL_DEFAULT_THRESHOLD 0.2f    // kg - auto trigger threshold
+
+typedef enum {
+    CONTROL_ACTION_NONE = 0,
+    CONTROL_ACTION_START,    // Start the motor forward
+    CONTROL_ACTION_STOP      // Stop the motor
+} control_action_t;
+
+// Decide what to do for the latest sample in st
+control_action_t control_policy_decide(const elevator_state_t *st);
+
+const char *control_action_name(control_action_t action);
+
+#endif // CONTROL_POLICY_H
@@ -0,0 +1,234 @@
+#include "control_task.h"
+#include "control_policy.h"
+#include "shared_state.h"
+#include "warm_state.h"
+#include "metrics.h"
+#include "trace.h"
+#include "capture.h"
+#include "serial_telemetry.h"
+#include "deferred_log.h"
+#include "deadline_monitor.h"
+#include "motor_control_bts7960.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdbool.h>
+
+static const char *TAG = "CONTROL";
+
+static TaskHandle_t control_handle = NULL;
+static void (*change_cb)(void) = NULL;
+
+static control_stats_t stats;
+static int64_t jitter_sum_us = 0;
+static int64_t exec_sum_us = 0;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Control loop state (only touched by the control task)
+static int64_t last_sample_ms = 0;
+static bool first_decision = true;
+static bool start_pending = false;
+
+// Auto decision is only applied while auto mode is still on, so a
+// manual command that raced with the decision is not overwritten.
+static void set_triggered(bool triggered)
+{
+    elevator_state_t *st = shared_state_begin_update();
+    if (st->auto_mode) {
+        st->motor_triggered = triggered;
+    }
+    shared_state_end_update();
+}
+
+// One control iteration; returns true if the motor state changed
+static bool control_step(void)
+{
+    bool changed = false;
+    elevator_state_t st;
+    shared_state_read(&st);
+
+    // Second half of a start: driver was re-initialized one period ago
+    if (start_pending) {
+        start_pending = false;
+        if (st.auto_mode && st.motor_triggered) {
+            motor_start_forward();
+            DLOGI(TAG, "🚀 Motor started - load %.2f kg >= threshold %.2f kg",
+                  st.load, st.threshold);
+            changed = true;
+        }
+    }
+
+    // Decide once per new sample
+    if (st.sample_ms == last_sample_ms) {
+        return changed;
+    }
+    last_sample_ms = st.sample_ms;
+
+    control_action_t action = control_policy_decide(&st);
+    TRACE_INSTANT("decision", action);
+    if (action != CONTROL_ACTION_NONE) {
+        capture_decision((uint8_t)action);
+        serial_telemetry_event(SERIAL_EVENT_DECISION, action, NULL);
+    }
+    switch (action) {
+        case CONTROL_ACTION_START:
+            set_triggered(true);
+            if (first_decision) {
+                motor_start_forward();
+                DLOGI(TAG, "🚀 Motor started - load %.2f kg >= threshold %.2f kg",
+                      st.load, st.threshold);
+            } else {
+                // Re-initialize motor driver before starting (in case it was
+                // physically stopped); the start follows on the next period
+                // instead of blocking this one
+                DLOGI(TAG, "🔄 Re-initializing motor driver before start");
+                TRACE_BEGIN("motor_init");
+                motor_control_init();
+                TRACE_END("motor_init");
+                start_pending = true;
+            }
+            changed = true;
+            break;
+
+        case CONTROL_ACTION_STOP:
+            set_triggered(false);
+            start_pending = false;
+            motor_stop();
+            DLOGI(TAG, "🛑 Motor stopped - load %.2f kg < threshold %.2f kg",
+                  st.load, st.threshold);
+            changed = true;
+            break;
+
+        default:
+            break;
+    }
+    metrics_observe(METRIC_SAMPLE_TO_DECISION,
+                    (uint32_t)(esp_timer_get_time() - st.sample_ms * 1000));
+    if (first_decision) {
+        first_decision = false;
+        int64_t now_ms = esp_timer_get_time() / 1000;
+        portENTER_CRITICAL(&stats_lock);
+        stats.first_decision_ms = now_ms;
+        portEXIT_CRITICAL(&stats_lock);
+        DLOGI(TAG, "⏱️  First control decision %lld ms after boot", (long long)now_ms);
+    }
+    return changed;
+}
+
+// Keep the RTC copy current so a warm reset can resume the trip
+static void save_warm_state(void)
+{
+    elevator_state_t st;
+    shared_state_read(&st);
+    motor_state_t motor = motor_get_state();
+
+    warm_trip_phase_t phase = WARM_TRIP_IDLE;
+    if (start_pending) {
+        phase = WARM_TRIP_STARTING;
+    } else if (motor != MOTOR_STATE_STOPPED) {
+        phase = (st.auto_mode && st.motor_triggered) ? WARM_TRIP_RUNNING : WARM_TRIP_MANUAL;
+    }
+    warm_state_save_control(st.weight, st.threshold, st.auto_mode, st.motor_triggered,
+                            (uint8_t)motor, phase);
+}
+
+static void record_iteration(int32_t jitter_us, uint32_t exec_us, bool decided)
+{
+    portENTER_CRITICAL(&stats_lock);
+    stats.iterations++;
+    if (stats.iterations == 1 || jitter_us < stats.jitter_min_us) {
+        stats.jitter_min_us = jitter_us;
+    }
+    if (stats.iterations == 1 || jitter_us > stats.jitter_max_us) {
+        stats.jitter_max_us = jitter_us;
+    }
+    jitter_sum_us += jitter_us;
+    stats.jitter_mean_us = (int32_t)(jitter_sum_us / stats.iterations);
+
+    stats.exec_last_us = exec_us;
+    if (exec_us > stats.exec_max_us) {
+        stats.exec_max_us = exec_us;
+    }
+    exec_sum_us += exec_us;
+    stats.exec_mean_us = (uint32_t)(exec_sum_us / stats.iterations);
+    if (exec_us > CONTROL_PERIOD_MS * 1000) {
+        stats.overruns++;
+    }
+    if (decided) {
+        stats.decisions++;
+        stats.last_decision_ms = esp_timer_get_time() / 1000;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+static void control_task(void *arg)
+{
+    const TickType_t period = pdMS_TO_TICKS(CONTROL_PERIOD_MS);
+    TickType_t last_wake = xTaskGetTickCount();
+    int64_t epoch_us = esp_timer_get_time();
+    uint32_t n = 0;
+    int deadline_id = deadline_register("control", CONTROL_PERIOD_MS * 1000,
+                                        CONTROL_DEADLINE_BUDGET_MS * 1000);
+
+    ESP_LOGI(TAG, "✅ Control task running on core %d (period %d ms, priority %d)",
+             xPortGetCoreID(), CONTROL_PERIOD_MS, CONTROL_TASK_PRIORITY);
+
+    while (1) {
+        vTaskDelayUntil(&last_wake, period);
+        deadline_checkin(deadline_id);
+        n++;
+
+        int64_t start_us = esp_timer_get_time();
+        int32_t jitter_us = (int32_t)(start_us - (epoch_us + (int64_t)n * CONTROL_PERIOD_MS * 1000));
+
+        TRACE_BEGIN("control_step");
+        bool changed = control_step();
+        TRACE_END("control_step");
+        if (changed && change_cb != NULL) {
+            change_cb();
+        }
+        save_warm_state();
+        if (n == WARM_HEALTHY_MS / CONTROL_PERIOD_MS) {
+            warm_state_mark_healthy();
+        }
+
+        uint32_t exec_us = (uint32_t)(esp_timer_get_time() - start_us);
+        record_iteration(jitter_us, exec_us, changed);
+        metrics_observe(METRIC_CONTROL_EXEC, exec_us);
+    }
+}
+
+void control_task_start(void (*on_change)(void))
+{
+    if (control_handle != NULL) {
+        return;
+    }
+    change_cb = on_change;
+    BaseType_t ok = xTaskCreatePinnedToCore(control_task, "control", CONTROL_TASK_STACK, NULL,
+                                            CONTROL_TASK_PRIORITY, &control_handle,
+                                            CONTROL_TASK_CORE);
+    if (ok != pdPASS) {
+        control_handle = NULL;
+        ESP_LOGE(TAG, "Failed to create control task");
+    }
+}
+
+void control_task_get_stats(control_stats_t *out)
+{
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+void control_task_reset_stats(void)
+{
+    portENTER_CRITICAL(&stats_lock);
+    stats = (control_stats_t) {
+        .last_decision_ms = stats.last_decision_ms,
+        .first_decision_ms = stats.first_decision_ms
+    };
+    jitter_sum_us = 0;
+    exec_sum_us = 0;
+    portEXIT_CRITICAL(&stats_lock);
+}
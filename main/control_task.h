@@ -0,0 +1,41 @@
+#ifndef CONTROL_TASK_H
+#define CONTROL_TASK_H
+
+#include <stdint.h>
+
+// Periodic auto motor control, decoupled from the sampling loop and httpd.
+// Runs pinned to the application core at high priority with a fixed
+// vTaskDelayUntil period; WiFi, lwIP and httpd stay on core 0.
+
+#define CONTROL_PERIOD_MS      100   // Control loop period
+#define CONTROL_TASK_PRIORITY  10    // Above httpd (5) and the main loop (1)
+#define CONTROL_TASK_STACK     4096
+#define CONTROL_TASK_CORE      (portNUM_PROCESSORS - 1)  // Core 1 on dual-core chips
+#define CONTROL_DEADLINE_BUDGET_MS 200   // Lateness before the deadline monitor stops the motor
+
+typedef struct {
+    uint32_t iterations;        // Loop iterations since start
+    uint32_t decisions;         // Motor actions taken
+    uint32_t overruns;          // Iterations longer than one period
+    int32_t jitter_min_us;      // Wake-up time minus scheduled time
+    int32_t jitter_max_us;
+    int32_t jitter_mean_us;
+    uint32_t exec_last_us;      // Loop body execution time
+    uint32_t exec_mean_us;
+    uint32_t exec_max_us;       // Worst case observed
+    int64_t last_decision_ms;   // Time of the latest motor action, 0 if none
+    int64_t first_decision_ms;  // Boot to the first policy evaluation, 0 if none yet
+} control_stats_t;
+
+// Start the control task; on_change is called (from the control task)
+// after every motor action so the new state can be published. It runs
+// inside the control deadline: signal only, publish elsewhere.
+void control_task_start(void (*on_change)(void));
+
+// Copy of the current loop statistics
+void control_task_get_stats(control_stats_t *out);
+
+// Reset jitter / execution time statistics
+void control_task_reset_stats(void);
+
+#endif // CONTROL_TASK_H
@@ -0,0 +1,268 @@
+#include "deadline_monitor.h"
+#include "config_store.h"
+#include "metrics.h"
+#include "motor_control_bts7960.h"
+#include "serial_telemetry.h"
+#include "shared_state.h"
+#include "driver/gptimer.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static const char *TAG = "DEADLINE";
+
+typedef struct {
+    deadline_task_stats_t stats;
+    int64_t last_us;            // Latest check-in
+    int metrics_slot;
+    bool armed;                 // Checked in at least once
+    uint8_t paused;             // Nesting depth of deadline_pause()
+    bool missed;                // Flagged for the current stall
+    bool report;                // Miss waiting for the handler task
+    uint32_t overrun_us;        // Lateness of the pending miss
+} deadline_task_t;
+
+static deadline_task_t tasks[DEADLINE_MAX_TASKS];
+static int task_count = 0;
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+static gptimer_handle_t timer = NULL;
+static SemaphoreHandle_t miss_sem = NULL;
+static void (*stop_cb)(void) = NULL;
+
+int deadline_register(const char *name, uint32_t period_us, uint32_t budget_us)
+{
+    portENTER_CRITICAL(&lock);
+    if (task_count >= DEADLINE_MAX_TASKS) {
+        portEXIT_CRITICAL(&lock);
+        ESP_LOGE(TAG, "No deadline slot left for %s", name);
+        return -1;
+    }
+    int id = task_count;
+    deadline_task_t *t = &tasks[id];
+    memset(t, 0, sizeof(*t));
+    t->stats.name = name;
+    t->stats.period_us = period_us;
+    t->stats.budget_us = budget_us;
+    task_count++;
+    portEXIT_CRITICAL(&lock);
+
+    tasks[id].metrics_slot = metrics_loop_register(name);
+    ESP_LOGI(TAG, "⏱️  %s: period %lu ms, budget %lu ms", name,
+             (unsigned long)(period_us / 1000), (unsigned long)(budget_us / 1000));
+    return id;
+}
+
+void deadline_set_period(int id, uint32_t period_us)
+{
+    if (id < 0 || id >= task_count) {
+        return;
+    }
+    portENTER_CRITICAL(&lock);
+    tasks[id].stats.period_us = period_us;
+    portEXIT_CRITICAL(&lock);
+}
+
+void deadline_checkin(int id)
+{
+    if (id < 0 || id >= task_count) {
+        return;
+    }
+    deadline_task_t *t = &tasks[id];
+    int64_t now = esp_timer_get_time();
+    int64_t jitter_us = -1;
+
+    portENTER_CRITICAL(&lock);
+    if (t->armed && !t->paused) {
+        jitter_us = now - t->last_us - t->stats.period_us;
+        if (jitter_us < 0) {
+            jitter_us = -jitter_us;
+        }
+        if (jitter_us > t->stats.jitter_max_us) {
+            t->stats.jitter_max_us = (uint32_t)jitter_us;
+        }
+    }
+    t->last_us = now;
+    t->armed = true;
+    t->missed = false;
+    t->stats.checkins++;
+    portEXIT_CRITICAL(&lock);
+
+    if (jitter_us >= 0) {
+        metrics_loop_observe(t->metrics_slot, jitter_us > UINT32_MAX ? UINT32_MAX : (uint32_t)jitter_us);
+    }
+}
+
+int deadline_find(const char *name)
+{
+    for (int i = 0; i < task_count; i++) {
+        if (strcmp(tasks[i].stats.name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void deadline_pause(int id)
+{
+    if (id < 0 || id >= task_count) {
+        return;
+    }
+    portENTER_CRITICAL(&lock);
+    tasks[id].paused++;
+    tasks[id].stats.pauses++;
+    portEXIT_CRITICAL(&lock);
+}
+
+void deadline_resume(int id)
+{
+    if (id < 0 || id >= task_count) {
+        return;
+    }
+    portENTER_CRITICAL(&lock);
+    deadline_task_t *t = &tasks[id];
+    if (t->paused > 0 && --t->paused == 0) {
+        // The interval spanning the pause is neither a miss nor jitter
+        t->armed = false;
+        t->missed = false;
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+// Alarm ISR: flag every loop past its deadline and drop the motor enables
+// before anything else gets to run (in IRAM via linker.lf)
+static bool deadline_alarm_isr(gptimer_handle_t t, const gptimer_alarm_event_data_t *edata,
+                               void *ctx)
+{
+    int64_t now = esp_timer_get_time();
+    bool late = false;
+
+    portENTER_CRITICAL_ISR(&lock);
+    for (int i = 0; i < task_count; i++) {
+        deadline_task_t *d = &tasks[i];
+        if (!d->armed || d->missed || d->paused) {
+            continue;
+        }
+        int64_t over = now - d->last_us - d->stats.period_us - d->stats.budget_us;
+        if (over > 0) {
+            d->missed = true;
+            d->report = true;
+            d->overrun_us = (uint32_t)(over + d->stats.budget_us);
+            late = true;
+        }
+    }
+    portEXIT_CRITICAL_ISR(&lock);
+
+    if (!late) {
+        return false;
+    }
+    motor_emergency_stop_isr();
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(miss_sem, &woken);
+    return woken == pdTRUE;
+}
+
+// Finish the stop and report outside the ISR. Auto mode stays off (also
+// across a reboot) until an operator turns it back on: whatever stalled the
+// loop may stall it again mid-trip.
+static void deadline_task(void *arg)
+{
+    while (1) {
+        xSemaphoreTake(miss_sem, portMAX_DELAY);
+
+        motor_stop();
+        elevator_state_t *st = shared_state_begin_update();
+        st->motor_triggered = false;
+        st->auto_mode = false;
+        shared_state_end_update();
+
+        elevator_config_t cfg;
+        config_store_get(&cfg);
+        cfg.auto_mode = false;
+        config_store_set(&cfg);
+
+        for (int i = 0; i < task_count; i++) {
+            deadline_task_t *d = &tasks[i];
+            portENTER_CRITICAL(&lock);
+            bool report = d->report;
+            uint32_t overrun_us = d->overrun_us;
+            d->report = false;
+            if (report) {
+                d->stats.misses++;
+                d->stats.last_miss_ms = esp_timer_get_time() / 1000;
+                if (overrun_us > d->stats.worst_overrun_us) {
+                    d->stats.worst_overrun_us = overrun_us;
+                }
+            }
+            portEXIT_CRITICAL(&lock);
+            if (!report) {
+                continue;
+            }
+            metrics_count(METRIC_DEADLINE_MISSES);
+            serial_telemetry_event(SERIAL_EVENT_DEADLINE, (int32_t)(overrun_us / 1000), d->stats.name);
+            ESP_LOGE(TAG, "🚨 %s missed its deadline: %lu ms late (period %lu ms, budget %lu ms) - motor stopped, auto mode off",
+                     d->stats.name, (unsigned long)(overrun_us / 1000),
+                     (unsigned long)(d->stats.period_us / 1000),
+                     (unsigned long)(d->stats.budget_us / 1000));
+        }
+        if (stop_cb != NULL) {
+            stop_cb();
+        }
+    }
+}
+
+void deadline_monitor_start(void (*on_stop)(void))
+{
+    if (timer != NULL) {
+        return;
+    }
+    stop_cb = on_stop;
+    miss_sem = xSemaphoreCreateBinary();
+    if (miss_sem == NULL ||
+        xTaskCreatePinnedToCore(deadline_task, "deadline", DEADLINE_TASK_STACK, NULL,
+                                DEADLINE_TASK_PRIORITY, NULL, DEADLINE_TASK_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create deadline handler task");
+        return;
+    }
+
+    gptimer_config_t config = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = DEADLINE_TIMER_RESOLUTION,
+    };
+    gptimer_event_callbacks_t cbs = { .on_alarm = deadline_alarm_isr };
+    gptimer_alarm_config_t alarm = {
+        .alarm_count = (uint64_t)DEADLINE_CHECK_PERIOD_US * DEADLINE_TIMER_RESOLUTION / 1000000,
+        .reload_count = 0,
+        .flags.auto_reload_on_alarm = true,
+    };
+    esp_err_t err = gptimer_new_timer(&config, &timer);
+    if (err == ESP_OK) err = gptimer_register_event_callbacks(timer, &cbs, NULL);
+    if (err == ESP_OK) err = gptimer_set_alarm_action(timer, &alarm);
+    if (err == ESP_OK) err = gptimer_enable(timer);
+    if (err == ESP_OK) err = gptimer_start(timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "GPTimer setup failed: %s", esp_err_to_name(err));
+        return;
+    }
+    ESP_LOGI(TAG, "✅ Deadline monitor running (check every %d ms)", DEADLINE_CHECK_PERIOD_US / 1000);
+}
+
+int deadline_task_count(void)
+{
+    return task_count;
+}
+
+bool deadline_get_stats(int id, deadline_task_stats_t *out)
+{
+    if (id < 0 || id >= task_count) {
+        return false;
+    }
+    portENTER_CRITICAL(&lock);
+    *out = tasks[id].stats;
+    portEXIT_CRITICAL(&lock);
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef DEADLINE_MONITOR_H
+#define DEADLINE_MONITOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Deadline watchdog for the periodic loops (control task, sampling loop).
+// Each loop registers its period and a lateness budget and checks in once
+// per iteration. A GPTimer alarm checks every DEADLINE_CHECK_PERIOD_US
+// from interrupt context, so it still fires when the late task is stuck
+// at high priority: a loop silent for longer than period + budget gets the
+// motor enables dropped right in the ISR, then a handler task finishes the
+// stop (PWM off, auto mode latched off and persisted until an operator
+// turns it back on), logs which loop overran and by how much, and reports
+// it over the serial telemetry link.
+//
+// Check-ins also feed a per-loop jitter histogram (|interval - period|),
+// exported at /metrics as elevator_loop_jitter_seconds{task="..."}.
+
+#define DEADLINE_MAX_TASKS          4
+#define DEADLINE_CHECK_PERIOD_US    10000     // GPTimer alarm period
+#define DEADLINE_TIMER_RESOLUTION   1000000   // 1 MHz: one tick per microsecond
+#define DEADLINE_TASK_PRIORITY      12        // Above the control task (10)
+#define DEADLINE_TASK_STACK         3072
+#define DEADLINE_TASK_CORE          (portNUM_PROCESSORS - 1)
+
+typedef struct {
+    const char *name;
+    uint32_t period_us;
+    uint32_t budget_us;         // Allowed lateness past one period
+    uint32_t checkins;
+    uint32_t misses;            // Deadlines missed (one per stall)
+    uint32_t worst_overrun_us;  // Largest lateness past period + budget
+    int64_t last_miss_ms;       // Time of the latest miss, 0 if none
+    uint32_t jitter_max_us;     // Largest |interval - period| between check-ins
+    uint32_t pauses;            // deadline_pause() calls
+} deadline_task_stats_t;
+
+// Register a periodic loop; returns its id (-1 if the table is full).
+// Monitoring starts with the first check-in.
+int deadline_register(const char *name, uint32_t period_us, uint32_t budget_us);
+
+// Change the expected period (e.g. after a configuration change)
+void deadline_set_period(int id, uint32_t period_us);
+
+// Called once per loop iteration from the monitored task
+void deadline_checkin(int id);
+
+// Id of a registered loop by name, -1 if none
+int deadline_find(const char *name);
+
+// Suspend a loop's deadline while something it waits on is busy on
+// purpose (a tare holding the HX711). Pauses nest; the last resume
+// restarts monitoring from the loop's next check-in.
+void deadline_pause(int id);
+void deadline_resume(int id);
+
+// Start the GPTimer and the handler task; on_stop is called from the
+// handler task after an emergency stop (e.g. to request a status
+// publish; signal only, the handler must stay quick)
+void deadline_monitor_start(void (*on_stop)(void));
+
+// Registered loops and their statistics; false for an unknown id
+int deadline_task_count(void);
+bool deadline_get_stats(int id, deadline_task_stats_t *out);
+
+#endif // DEADLINE_MONITOR_H
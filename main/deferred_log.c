@@ -0,0 +1,329 @@
+#include "deferred_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "DLOG";
+
+#define RING_MASK (DEFERRED_LOG_RING_LEN - 1)
+
+// Bounded MPMC ring (Vyukov): each slot's sequence says whose turn it is.
+// A writer at position pos owns the slot when seq == pos, publishes it with
+// seq = pos + 1; the reader frees it for the next lap with seq = pos + LEN.
+// Sequences are stored minus the slot index so the zeroed ring is valid
+// without an init call (records may arrive before deferred_log_start()).
+typedef struct {
+    atomic_uint seq;
+    deferred_log_record_t rec;
+} ring_slot_t;
+
+static ring_slot_t ring[DEFERRED_LOG_RING_LEN];
+static atomic_uint tail;                    // Next position to write
+static atomic_uint head;                    // Next position to read
+
+static atomic_uint written;
+static atomic_uint dropped;
+static atomic_uint drained;
+static atomic_uint high_water;
+
+static TaskHandle_t drain_task_handle = NULL;
+
+static inline uint32_t slot_seq(const ring_slot_t *slot, uint32_t pos)
+{
+    return atomic_load_explicit(&slot->seq, memory_order_acquire) + (pos & RING_MASK);
+}
+
+static inline void slot_set_seq(ring_slot_t *slot, uint32_t pos, uint32_t seq)
+{
+    atomic_store_explicit(&slot->seq, seq - (pos & RING_MASK), memory_order_release);
+}
+
+void deferred_log_write(esp_log_level_t level, const char *tag, const char *fmt,
+                        int nargs, const deferred_arg_t *args)
+{
+    uint32_t pos = atomic_load_explicit(&tail, memory_order_relaxed);
+    ring_slot_t *slot;
+    while (1) {
+        slot = &ring[pos & RING_MASK];
+        int32_t diff = (int32_t)(slot_seq(slot, pos) - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&tail, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Full: the drain task is behind, never wait for it
+            atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+            return;
+        } else {
+            pos = atomic_load_explicit(&tail, memory_order_relaxed);
+        }
+    }
+
+    deferred_log_record_t *rec = &slot->rec;
+    rec->ts_us = esp_timer_get_time();
+    rec->tag = tag;
+    rec->fmt = fmt;
+    rec->level = (uint8_t)level;
+    if (nargs > DEFERRED_LOG_MAX_ARGS) {
+        nargs = DEFERRED_LOG_MAX_ARGS;
+    }
+    rec->nargs = (uint8_t)nargs;
+    for (int i = 0; i < nargs; i++) {
+        rec->args[i] = args[i];
+    }
+    slot_set_seq(slot, pos, pos + 1);
+
+    atomic_fetch_add_explicit(&written, 1, memory_order_relaxed);
+    uint32_t waiting = pos + 1 - atomic_load_explicit(&head, memory_order_relaxed);
+    uint32_t hw = atomic_load_explicit(&high_water, memory_order_relaxed);
+    while (waiting > hw && waiting <= DEFERRED_LOG_RING_LEN &&
+           !atomic_compare_exchange_weak_explicit(&high_water, &hw, waiting,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+// Take the oldest record; false if the ring is empty
+static bool ring_pop(deferred_log_record_t *out)
+{
+    uint32_t pos = atomic_load_explicit(&head, memory_order_relaxed);
+    ring_slot_t *slot;
+    while (1) {
+        slot = &ring[pos & RING_MASK];
+        int32_t diff = (int32_t)(slot_seq(slot, pos) - (pos + 1));
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&head, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = atomic_load_explicit(&head, memory_order_relaxed);
+        }
+    }
+    *out = slot->rec;
+    slot_set_seq(slot, pos, pos + DEFERRED_LOG_RING_LEN);
+    return true;
+}
+
+// Append snprintf output, keeping len at most cap - 1
+static size_t append(char *out, size_t cap, size_t len, const char *spec, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static size_t append(char *out, size_t cap, size_t len, const char *spec, ...)
+{
+    if (len + 1 >= cap) {
+        return len;
+    }
+    va_list ap;
+    va_start(ap, spec);
+    int n = vsnprintf(out + len, cap - len, spec, ap);
+    va_end(ap);
+    if (n < 0) {
+        return len;
+    }
+    return len + (size_t)n < cap ? len + (size_t)n : cap - 1;
+}
+
+static int64_t arg_as_int(const deferred_arg_t *a)
+{
+    switch (a->type) {
+        case DEFERRED_ARG_DOUBLE: return (int64_t)a->d;
+        case DEFERRED_ARG_STR:
+        case DEFERRED_ARG_PTR:    return (int64_t)(intptr_t)a->p;
+        default:                  return a->i;
+    }
+}
+
+// Integer conversions: truncate like printf would for the length modifier
+static size_t format_int(char *out, size_t cap, size_t len, char *spec, size_t spec_len,
+                         const char *length, char conv, const deferred_arg_t *a)
+{
+    int64_t v = arg_as_int(a);
+    bool is_signed = conv == 'd' || conv == 'i';
+    if (strcmp(length, "hh") == 0) {
+        v = is_signed ? (int64_t)(signed char)v : (int64_t)(unsigned char)v;
+    } else if (strcmp(length, "h") == 0) {
+        v = is_signed ? (int64_t)(short)v : (int64_t)(unsigned short)v;
+    } else if (length[0] == '\0') {
+        v = is_signed ? (int64_t)(int)v : (int64_t)(unsigned int)v;
+    } else if (strcmp(length, "l") == 0 || strcmp(length, "z") == 0 || strcmp(length, "t") == 0) {
+        v = is_signed ? (int64_t)(long)v : (int64_t)(unsigned long)v;
+    }
+    spec[spec_len++] = 'l';
+    spec[spec_len++] = 'l';
+    spec[spec_len++] = conv;
+    spec[spec_len] = '\0';
+    if (is_signed) {
+        return append(out, cap, len, spec, (long long)v);
+    }
+    return append(out, cap, len, spec, (unsigned long long)v);
+}
+
+size_t deferred_log_format(const deferred_log_record_t *rec, char *out, size_t cap)
+{
+    if (cap == 0) {
+        return 0;
+    }
+    size_t len = 0;
+    int next_arg = 0;
+    const char *p = rec->fmt;
+    out[0] = '\0';
+
+    while (*p != '\0' && len + 1 < cap) {
+        if (*p != '%') {
+            out[len++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[len++] = '%';
+            p += 2;
+            continue;
+        }
+
+        // %[flags][width][.precision][length]conversion
+        char spec[24];
+        size_t spec_len = 0;
+        spec[spec_len++] = *p++;
+        while (*p != '\0' && strchr("-+ #0", *p) != NULL && spec_len < 8) {
+            spec[spec_len++] = *p++;
+        }
+        while (*p >= '0' && *p <= '9' && spec_len < 12) {
+            spec[spec_len++] = *p++;
+        }
+        if (*p == '.') {
+            spec[spec_len++] = *p++;
+            while (*p >= '0' && *p <= '9' && spec_len < 16) {
+                spec[spec_len++] = *p++;
+            }
+        }
+        char length[3] = { 0 };
+        size_t length_len = 0;
+        while (*p != '\0' && strchr("hlLqjzt", *p) != NULL && length_len < 2) {
+            length[length_len++] = *p++;
+        }
+        char conv = *p;
+        if (conv == '\0') {
+            break;
+        }
+        p++;
+
+        if (next_arg >= rec->nargs) {
+            len = append(out, cap, len, "?");
+            continue;
+        }
+        const deferred_arg_t *a = &rec->args[next_arg++];
+        switch (conv) {
+            case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+                len = format_int(out, cap, len, spec, spec_len, length, conv, a);
+                break;
+            case 'c':
+                spec[spec_len++] = 'c';
+                spec[spec_len] = '\0';
+                len = append(out, cap, len, spec, (int)arg_as_int(a));
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': {
+                double d = a->type == DEFERRED_ARG_DOUBLE ? a->d :
+                           a->type == DEFERRED_ARG_UINT ? (double)a->u : (double)arg_as_int(a);
+                spec[spec_len++] = conv;
+                spec[spec_len] = '\0';
+                len = append(out, cap, len, spec, d);
+                break;
+            }
+            case 's':
+                spec[spec_len++] = 's';
+                spec[spec_len] = '\0';
+                len = append(out, cap, len, spec,
+                             a->type == DEFERRED_ARG_STR && a->s != NULL ? a->s : "(null)");
+                break;
+            case 'p':
+                len = append(out, cap, len, "%p", (void *)(intptr_t)arg_as_int(a));
+                break;
+            default:
+                len = append(out, cap, len, "?");
+                break;
+        }
+    }
+    out[len] = '\0';
+    return len;
+}
+
+static void print_record(const deferred_log_record_t *rec)
+{
+    // Same runtime filter as ESP_LOGx, checked before paying for formatting
+#ifdef ESP_PLATFORM
+    if (rec->level > esp_log_level_get(rec->tag)) {
+        return;
+    }
+#else
+    if (rec->level > sim_log_level) {
+        return;
+    }
+#endif
+    char msg[DEFERRED_LOG_LINE_MAX];
+    deferred_log_format(rec, msg, sizeof(msg));
+#ifdef ESP_PLATFORM
+    static const char letters[] = "NEWIDV";
+    esp_log_write((esp_log_level_t)rec->level, rec->tag, "%c (%lu) %s: %s\n",
+                  letters[rec->level < 6 ? rec->level : 0],
+                  (unsigned long)(rec->ts_us / 1000), rec->tag, msg);
+#else
+    sim_log((esp_log_level_t)rec->level, rec->tag, "%s", msg);
+#endif
+}
+
+size_t deferred_log_flush(void)
+{
+    deferred_log_record_t rec;
+    size_t n = 0;
+    while (ring_pop(&rec)) {
+        print_record(&rec);
+        n++;
+    }
+    atomic_fetch_add_explicit(&drained, (unsigned)n, memory_order_relaxed);
+    return n;
+}
+
+static void drain_task(void *arg)
+{
+    uint32_t reported = 0;
+    while (1) {
+        deferred_log_flush();
+        uint32_t d = atomic_load_explicit(&dropped, memory_order_relaxed);
+        if (d != reported) {
+            ESP_LOGW(TAG, "⚠️  %lu log records dropped (ring full, %lu total)",
+                     (unsigned long)(d - reported), (unsigned long)d);
+            reported = d;
+        }
+        vTaskDelay(pdMS_TO_TICKS(DEFERRED_LOG_DRAIN_MS));
+    }
+}
+
+void deferred_log_start(void)
+{
+    if (drain_task_handle != NULL) {
+        return;
+    }
+    if (xTaskCreatePinnedToCore(drain_task, "log_drain", DEFERRED_LOG_TASK_STACK, NULL,
+                                DEFERRED_LOG_TASK_PRIORITY, &drain_task_handle,
+                                DEFERRED_LOG_TASK_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create log drain task");
+        drain_task_handle = NULL;
+    }
+}
+
+void deferred_log_get_stats(deferred_log_stats_t *out)
+{
+    out->written = atomic_load_explicit(&written, memory_order_relaxed);
+    out->dropped = atomic_load_explicit(&dropped, memory_order_relaxed);
+    out->drained = atomic_load_explicit(&drained, memory_order_relaxed);
+    out->high_water = atomic_load_explicit(&high_water, memory_order_relaxed);
+}
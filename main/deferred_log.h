@@ -0,0 +1,172 @@
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_log.h"
+
+// Deferred logging for hot paths (sampling, control, motor commands).
+// DLOGI/DLOGW/DLOGE take the same arguments as ESP_LOGx but only store the
+// format pointer, tag and raw argument values into a lock-free ring (a few
+// stores and one compare-and-swap); a low-priority task formats the
+// records and writes them to the console. When the ring is full the record
+// is dropped and counted - the caller never waits for the UART.
+//
+// Restrictions compared to ESP_LOGx:
+//   - up to DEFERRED_LOG_MAX_ARGS arguments (integers, floats, strings, pointers)
+//   - %s arguments are stored as pointers: string literals or other storage
+//     that outlives the record (esp_err_to_name() is fine, stack buffers are not)
+//   - %n and '*' width/precision are not supported
+//
+// Lines come out up to DEFERRED_LOG_DRAIN_MS late, so they can interleave
+// with later ESP_LOGx output; the printed timestamp is the time of the call.
+
+#define DEFERRED_LOG_RING_LEN 128           // Records (power of two)
+#define DEFERRED_LOG_MAX_ARGS 6
+#define DEFERRED_LOG_LINE_MAX 160           // Formatted message, longer lines are cut
+#define DEFERRED_LOG_TASK_STACK 3072
+#define DEFERRED_LOG_TASK_PRIORITY 1        // Just above idle
+#define DEFERRED_LOG_TASK_CORE 0
+#define DEFERRED_LOG_DRAIN_MS 20            // Drain period when the ring was empty
+
+// Compile-time filter: records above this level are not even stored
+#ifndef DEFERRED_LOG_LEVEL
+#define DEFERRED_LOG_LEVEL ESP_LOG_INFO
+#endif
+
+typedef enum {
+    DEFERRED_ARG_INT = 0,
+    DEFERRED_ARG_UINT,
+    DEFERRED_ARG_DOUBLE,
+    DEFERRED_ARG_STR,
+    DEFERRED_ARG_PTR
+} deferred_arg_type_t;
+
+typedef struct {
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        const char *s;
+        const void *p;
+    };
+    uint8_t type;                           // deferred_arg_type_t
+} deferred_arg_t;
+
+typedef struct {
+    int64_t ts_us;                          // esp_timer_get_time() at the call
+    const char *tag;
+    const char *fmt;
+    uint8_t level;                          // esp_log_level_t
+    uint8_t nargs;
+    deferred_arg_t args[DEFERRED_LOG_MAX_ARGS];
+} deferred_log_record_t;
+
+typedef struct {
+    uint32_t written;                       // Records stored
+    uint32_t dropped;                       // Ring full
+    uint32_t drained;                       // Records printed
+    uint32_t high_water;                    // Most records waiting at once
+} deferred_log_stats_t;
+
+// Start the drain task. Records stored before it runs wait in the ring.
+void deferred_log_start(void);
+
+// Store one record (use the DLOGx macros); safe from any task on either core
+void deferred_log_write(esp_log_level_t level, const char *tag, const char *fmt,
+                        int nargs, const deferred_arg_t *args);
+
+// Format and print everything waiting, from the calling task (e.g. before
+// a restart); returns the number of records printed
+size_t deferred_log_flush(void);
+
+void deferred_log_get_stats(deferred_log_stats_t *out);
+
+// Format a record's message (without the level/timestamp/tag prefix) like
+// snprintf would; returns the length written (truncated to cap - 1)
+size_t deferred_log_format(const deferred_log_record_t *rec, char *out, size_t cap);
+
+// Never called: lets the compiler check DLOGx formats like ESP_LOGx ones
+int deferred_log_check_format(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+// Argument capture: the static type of each argument picks the slot type
+static inline deferred_arg_t deferred_arg_int(int64_t v)
+{
+    return (deferred_arg_t){ .i = v, .type = DEFERRED_ARG_INT };
+}
+
+static inline deferred_arg_t deferred_arg_uint(uint64_t v)
+{
+    return (deferred_arg_t){ .u = v, .type = DEFERRED_ARG_UINT };
+}
+
+static inline deferred_arg_t deferred_arg_double(double v)
+{
+    return (deferred_arg_t){ .d = v, .type = DEFERRED_ARG_DOUBLE };
+}
+
+static inline deferred_arg_t deferred_arg_str(const char *v)
+{
+    return (deferred_arg_t){ .s = v, .type = DEFERRED_ARG_STR };
+}
+
+static inline deferred_arg_t deferred_arg_ptr(const void *v)
+{
+    return (deferred_arg_t){ .p = v, .type = DEFERRED_ARG_PTR };
+}
+
+#define DEFERRED_ARG(x) _Generic((x),                                   \
+    _Bool: deferred_arg_int, char: deferred_arg_int,                    \
+    signed char: deferred_arg_int, short: deferred_arg_int,             \
+    int: deferred_arg_int, long: deferred_arg_int,                      \
+    long long: deferred_arg_int,                                        \
+    unsigned char: deferred_arg_uint, unsigned short: deferred_arg_uint, \
+    unsigned int: deferred_arg_uint, unsigned long: deferred_arg_uint,  \
+    unsigned long long: deferred_arg_uint,                              \
+    float: deferred_arg_double, double: deferred_arg_double,            \
+    char *: deferred_arg_str, const char *: deferred_arg_str,           \
+    default: deferred_arg_ptr)(x)
+
+// Number of arguments after the format (0..6)
+#define DEFERRED_NARGS_(_f, _1, _2, _3, _4, _5, _6, n, ...) n
+#define DEFERRED_NARGS(...) DEFERRED_NARGS_(__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0, _)
+
+#define DEFERRED_CAT_(a, b) a##b
+#define DEFERRED_CAT(a, b) DEFERRED_CAT_(a, b)
+
+#define DEFERRED_WRITE_0(l, t, f) \
+    deferred_log_write(l, t, f, 0, NULL)
+#define DEFERRED_WRITE_1(l, t, f, a) \
+    deferred_log_write(l, t, f, 1, (deferred_arg_t[]){ DEFERRED_ARG(a) })
+#define DEFERRED_WRITE_2(l, t, f, a, b) \
+    deferred_log_write(l, t, f, 2, (deferred_arg_t[]){ DEFERRED_ARG(a), DEFERRED_ARG(b) })
+#define DEFERRED_WRITE_3(l, t, f, a, b, c) \
+    deferred_log_write(l, t, f, 3, (deferred_arg_t[]){ DEFERRED_ARG(a), DEFERRED_ARG(b), \
+                                                       DEFERRED_ARG(c) })
+#define DEFERRED_WRITE_4(l, t, f, a, b, c, d) \
+    deferred_log_write(l, t, f, 4, (deferred_arg_t[]){ DEFERRED_ARG(a), DEFERRED_ARG(b), \
+                                                       DEFERRED_ARG(c), DEFERRED_ARG(d) })
+#define DEFERRED_WRITE_5(l, t, f, a, b, c, d, e) \
+    deferred_log_write(l, t, f, 5, (deferred_arg_t[]){ DEFERRED_ARG(a), DEFERRED_ARG(b), \
+                                                       DEFERRED_ARG(c), DEFERRED_ARG(d), \
+                                                       DEFERRED_ARG(e) })
+#define DEFERRED_WRITE_6(l, t, f, a, b, c, d, e, g) \
+    deferred_log_write(l, t, f, 6, (deferred_arg_t[]){ DEFERRED_ARG(a), DEFERRED_ARG(b), \
+                                                       DEFERRED_ARG(c), DEFERRED_ARG(d), \
+                                                       DEFERRED_ARG(e), DEFERRED_ARG(g) })
+
+#define DEFERRED_LOG(level, tag, ...) do {                                          \
+        (void)sizeof(deferred_log_check_format(__VA_ARGS__));                       \
+        if ((level) <= DEFERRED_LOG_LEVEL) {                                        \
+            DEFERRED_CAT(DEFERRED_WRITE_, DEFERRED_NARGS(__VA_ARGS__))(level, tag,  \
+                                                                  __VA_ARGS__);    \
+        }                                                                           \
+    } while (0)
+
+#define DLOGE(tag, ...) DEFERRED_LOG(ESP_LOG_ERROR, tag, __VA_ARGS__)
+#define DLOGW(tag, ...) DEFERRED_LOG(ESP_LOG_WARN, tag, __VA_ARGS__)
+#define DLOGI(tag, ...) DEFERRED_LOG(ESP_LOG_INFO, tag, __VA_ARGS__)
+#define DLOGD(tag, ...) DEFERRED_LOG(ESP_LOG_DEBUG, tag, __VA_ARGS__)
+
+#endif // DEFERRED_LOG_H
@@ -0,0 +1,279 @@
+#include "history.h"
+#include <stdbool.h>
+#include <string.h>
+
+typedef struct {
+    int64_t t_ms;
+    float value;
+} raw_sample_t;
+
+typedef struct {
+    float min;
+    float max;
+    float mean;
+    uint32_t count;
+} bucket_t;
+
+typedef struct {
+    bucket_t *slots;
+    uint16_t len;
+    int64_t width_ms;
+    int64_t first;    // First bucket number ever written
+    int64_t newest;   // Newest bucket number
+} bucket_ring_t;
+
+#define HISTORY_SCRATCH_LEN HISTORY_MIN_LEN  // Longest ring
+
+static raw_sample_t raw[HISTORY_RAW_LEN];
+static uint16_t raw_head = 0;    // Next slot to write
+static uint16_t raw_count = 0;
+
+static bucket_t sec_slots[HISTORY_SEC_LEN];
+static bucket_t min_slots[HISTORY_MIN_LEN];
+static bucket_t hour_slots[HISTORY_HOUR_LEN];
+
+static bucket_ring_t rings[3] = {
+    { sec_slots,  HISTORY_SEC_LEN,  1000,    0, 0 },
+    { min_slots,  HISTORY_MIN_LEN,  60000,   0, 0 },
+    { hour_slots, HISTORY_HOUR_LEN, 3600000, 0, 0 },
+};
+static bool started = false;
+
+// Query scratch: candidate positions (raw index or bucket offset) in range
+static uint16_t scratch[HISTORY_SCRATCH_LEN];
+
+void history_reset(void)
+{
+    raw_head = 0;
+    raw_count = 0;
+    for (int r = 0; r < 3; r++) {
+        memset(rings[r].slots, 0, rings[r].len * sizeof(bucket_t));
+        rings[r].first = 0;
+        rings[r].newest = 0;
+    }
+    started = false;
+}
+
+static void ring_add(bucket_ring_t *ring, int64_t t_ms, float value)
+{
+    int64_t b = t_ms / ring->width_ms;
+
+    if (!started) {
+        ring->first = b;
+        ring->newest = b;
+    } else if (b > ring->newest) {
+        // Clear the slots we skip over (buckets with no samples)
+        int64_t steps = b - ring->newest;
+        if (steps >= ring->len) {
+            memset(ring->slots, 0, ring->len * sizeof(bucket_t));
+        } else {
+            for (int64_t k = 1; k <= steps; k++) {
+                memset(&ring->slots[(ring->newest + k) % ring->len], 0, sizeof(bucket_t));
+            }
+        }
+        ring->newest = b;
+    } else if (b <= ring->newest - ring->len) {
+        return;  // Older than retention
+    }
+
+    bucket_t *slot = &ring->slots[b % ring->len];
+    if (slot->count == 0) {
+        slot->min = value;
+        slot->max = value;
+        slot->mean = value;
+    } else {
+        if (value < slot->min) slot->min = value;
+        if (value > slot->max) slot->max = value;
+        slot->mean += (value - slot->mean) / (float)(slot->count + 1);
+    }
+    slot->count++;
+}
+
+void history_add(int64_t t_ms, float value)
+{
+    raw[raw_head].t_ms = t_ms;
+    raw[raw_head].value = value;
+    raw_head = (raw_head + 1) % HISTORY_RAW_LEN;
+    if (raw_count < HISTORY_RAW_LEN) {
+        raw_count++;
+    }
+
+    for (int r = 0; r < 3; r++) {
+        ring_add(&rings[r], t_ms, value);
+    }
+    started = true;
+}
+
+int64_t history_tier_width_ms(history_tier_t tier)
+{
+    return tier == HISTORY_TIER_RAW ? 0 : rings[tier - 1].width_ms;
+}
+
+const char *history_tier_name(history_tier_t tier)
+{
+    static const char *names[] = { "raw", "1s", "1m", "1h" };
+    return tier < HISTORY_TIER_COUNT ? names[tier] : "?";
+}
+
+size_t history_memory_bytes(void)
+{
+    return sizeof(raw) + sizeof(sec_slots) + sizeof(min_slots) +
+           sizeof(hour_slots) + sizeof(rings) + sizeof(scratch);
+}
+
+static uint16_t raw_oldest_index(void)
+{
+    return (raw_head + HISTORY_RAW_LEN - raw_count) % HISTORY_RAW_LEN;
+}
+
+static int64_t ring_oldest_bucket(const bucket_ring_t *ring)
+{
+    int64_t oldest = ring->newest - ring->len + 1;
+    return oldest > ring->first ? oldest : ring->first;
+}
+
+// Oldest time a tier still covers
+static int64_t tier_oldest_ms(history_tier_t tier)
+{
+    if (tier == HISTORY_TIER_RAW) {
+        return raw[raw_oldest_index()].t_ms;
+    }
+    const bucket_ring_t *ring = &rings[tier - 1];
+    return ring_oldest_bucket(ring) * ring->width_ms;
+}
+
+// Collect candidate positions in [from_ms, to_ms] into scratch
+static size_t collect(history_tier_t tier, int64_t from_ms, int64_t to_ms, int64_t *base)
+{
+    size_t n = 0;
+
+    if (tier == HISTORY_TIER_RAW) {
+        uint16_t idx = raw_oldest_index();
+        for (uint16_t i = 0; i < raw_count; i++, idx = (idx + 1) % HISTORY_RAW_LEN) {
+            if (raw[idx].t_ms >= from_ms && raw[idx].t_ms <= to_ms) {
+                scratch[n++] = idx;
+            }
+        }
+        *base = 0;
+        return n;
+    }
+
+    const bucket_ring_t *ring = &rings[tier - 1];
+    int64_t lo = ring_oldest_bucket(ring);
+    int64_t hi = ring->newest;
+    if (from_ms / ring->width_ms > lo) lo = from_ms / ring->width_ms;
+    if (to_ms / ring->width_ms < hi) hi = to_ms / ring->width_ms;
+
+    *base = lo;
+    for (int64_t b = lo; b <= hi; b++) {
+        if (ring->slots[b % ring->len].count > 0) {
+            scratch[n++] = (uint16_t)(b - lo);
+        }
+    }
+    return n;
+}
+
+static void get_point(history_tier_t tier, int64_t base, uint16_t pos, history_point_t *pt)
+{
+    if (tier == HISTORY_TIER_RAW) {
+        pt->t_ms = raw[pos].t_ms;
+        pt->mean = pt->min = pt->max = raw[pos].value;
+        pt->count = 1;
+        return;
+    }
+
+    const bucket_ring_t *ring = &rings[tier - 1];
+    int64_t b = base + pos;
+    const bucket_t *slot = &ring->slots[b % ring->len];
+    pt->t_ms = b * ring->width_ms;
+    pt->mean = slot->mean;
+    pt->min = slot->min;
+    pt->max = slot->max;
+    pt->count = slot->count;
+}
+
+size_t history_query(int64_t from_ms, int64_t to_ms, size_t max_points,
+                     history_point_t *out, history_tier_t *tier_out)
+{
+    if (!started || max_points == 0 || to_ms < from_ms) {
+        return 0;
+    }
+    if (max_points > HISTORY_MAX_POINTS) {
+        max_points = HISTORY_MAX_POINTS;
+    }
+
+    // Finest tier that reaches back to from_ms (within one bucket), else the coarsest one
+    history_tier_t tier = HISTORY_TIER_HOUR;
+    for (int t = HISTORY_TIER_RAW; t < HISTORY_TIER_COUNT; t++) {
+        if (tier_oldest_ms((history_tier_t)t) <= from_ms + history_tier_width_ms((history_tier_t)t)) {
+            tier = (history_tier_t)t;
+            break;
+        }
+    }
+    if (tier_out) {
+        *tier_out = tier;
+    }
+
+    int64_t base;
+    size_t n = collect(tier, from_ms, to_ms, &base);
+
+    if (n <= max_points || max_points < 3) {
+        if (n > max_points) {
+            n = max_points;
+        }
+        for (size_t i = 0; i < n; i++) {
+            get_point(tier, base, scratch[i], &out[i]);
+        }
+        return n;
+    }
+
+    // Largest-Triangle-Three-Buckets downsampling (Steinarsson, 2013)
+    history_point_t a, p, next;
+    size_t count = 0;
+    double every = (double)(n - 2) / (double)(max_points - 2);
+
+    get_point(tier, base, scratch[0], &a);
+    out[count++] = a;
+
+    for (size_t i = 0; i < max_points - 2; i++) {
+        // Average of the next bucket
+        size_t avg_start = (size_t)((i + 1) * every) + 1;
+        size_t avg_end = (size_t)((i + 2) * every) + 1;
+        if (avg_end > n) {
+            avg_end = n;
+        }
+        double avg_x = 0, avg_y = 0;
+        for (size_t j = avg_start; j < avg_end; j++) {
+            get_point(tier, base, scratch[j], &next);
+            avg_x += (double)next.t_ms;
+            avg_y += next.mean;
+        }
+        size_t avg_len = avg_end - avg_start;
+        if (avg_len > 0) {
+            avg_x /= avg_len;
+            avg_y /= avg_len;
+        }
+
+        // Point in this bucket forming the largest triangle with a and the average
+        size_t range_start = (size_t)(i * every) + 1;
+        size_t range_end = (size_t)((i + 1) * every) + 1;
+        double ax = (double)a.t_ms, ay = a.mean;
+        double max_area = -1.0;
+        size_t max_idx = range_start;
+        for (size_t j = range_start; j < range_end; j++) {
+            get_point(tier, base, scratch[j], &p);
+            double area = (ax - avg_x) * (p.mean - ay) - (ax - (double)p.t_ms) * (avg_y - ay);
+            if (area < 0) area = -area;
+            if (area > max_area) {
+                max_area = area;
+                max_idx = j;
+            }
+        }
+
+        get_point(tier, base, scratch[max_idx], &a);
+        out[count++] = a;
+    }
+
+    get_point(tier, base, scratch[n - 1], &out[count++]);
+    return count;
+}
@@ -0,0 +1,61 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Fixed-memory weight history with automatic rollups.
+//
+// Every sample goes into a raw ring and is folded into 1 s, 1 min and 1 h
+// bucket rings (min/max/mean/count). Bucket rings store no timestamps: the
+// slot index is the bucket number modulo ring length, so memory is exactly
+// the sizes below. Not thread-safe - callers serialize access.
+
+// Ring sizes (retention = length * bucket width)
+#define HISTORY_RAW_LEN  256   // Last 256 raw samples
+#define HISTORY_SEC_LEN  300   // 1 s buckets  -> 5 minutes
+#define HISTORY_MIN_LEN  360   // 1 min buckets -> 6 hours
+#define HISTORY_HOUR_LEN 168   // 1 h buckets  -> 7 days
+
+// Largest number of points a query may return
+#define HISTORY_MAX_POINTS 200
+
+typedef enum {
+    HISTORY_TIER_RAW = 0,
+    HISTORY_TIER_SEC,
+    HISTORY_TIER_MIN,
+    HISTORY_TIER_HOUR,
+    HISTORY_TIER_COUNT
+} history_tier_t;
+
+// One query result point. For raw samples min == max == mean and count == 1.
+typedef struct {
+    int64_t t_ms;      // Bucket start (or sample time), ms since boot
+    float mean;
+    float min;
+    float max;
+    uint32_t count;
+} history_point_t;
+
+// Clear all history
+void history_reset(void);
+
+// Record one sample; timestamps must be non-decreasing
+void history_add(int64_t t_ms, float value);
+
+// Return up to max_points points covering [from_ms, to_ms], downsampled
+// with LTTB from the finest tier that still covers from_ms. The tier used
+// is stored in *tier (may be NULL). Returns the number of points written.
+size_t history_query(int64_t from_ms, int64_t to_ms, size_t max_points,
+                     history_point_t *out, history_tier_t *tier);
+
+// Bucket width of a tier in ms (0 for raw)
+int64_t history_tier_width_ms(history_tier_t tier);
+
+// Name of a tier ("raw", "1s", "1m", "1h")
+const char *history_tier_name(history_tier_t tier);
+
+// Static memory used by the history store, in bytes
+size_t history_memory_bytes(void);
+
+#endif // HISTORY_H
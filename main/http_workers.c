@@ -0,0 +1,109 @@
+#include "http_workers.h"
+#include "metrics.h"
+#include "trace.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <stdatomic.h>
+
+static const char *TAG = "HTTP_WORKERS";
+
+typedef struct {
+    httpd_req_t *req;               // Detached copy, owned by the worker
+    http_worker_handler_t handler;
+    int64_t queued_us;
+} http_job_t;
+
+static QueueHandle_t job_queue = NULL;
+static TaskHandle_t workers[HTTP_WORKER_COUNT];
+static atomic_uint queued, rejected, completed, busy;
+
+bool http_workers_on_worker(void)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (int i = 0; i < HTTP_WORKER_COUNT; i++) {
+        if (workers[i] == self) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void worker_task(void *arg)
+{
+    http_job_t job;
+    while (1) {
+        if (xQueueReceive(job_queue, &job, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        atomic_fetch_add(&busy, 1);
+        metrics_observe(METRIC_HTTP_QUEUE_WAIT, (uint32_t)(esp_timer_get_time() - job.queued_us));
+
+        TRACE_BEGIN("http_worker");
+        job.handler(job.req);
+        TRACE_END("http_worker");
+        if (httpd_req_async_handler_complete(job.req) != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to complete async request");
+        }
+
+        atomic_fetch_sub(&busy, 1);
+        atomic_fetch_add(&completed, 1);
+    }
+}
+
+esp_err_t http_workers_init(void)
+{
+    if (job_queue != NULL) {
+        return ESP_OK;
+    }
+    job_queue = xQueueCreate(HTTP_WORKER_QUEUE_LEN, sizeof(http_job_t));
+    if (job_queue == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < HTTP_WORKER_COUNT; i++) {
+        if (xTaskCreatePinnedToCore(worker_task, "http_worker", HTTP_WORKER_STACK, NULL,
+                                    HTTP_WORKER_PRIORITY, &workers[i], HTTP_WORKER_CORE) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to start worker %d", i);
+            return ESP_FAIL;
+        }
+    }
+    ESP_LOGI(TAG, "✅ %d HTTP workers, queue of %d", HTTP_WORKER_COUNT, HTTP_WORKER_QUEUE_LEN);
+    return ESP_OK;
+}
+
+esp_err_t http_workers_submit(httpd_req_t *req, http_worker_handler_t handler)
+{
+    // Only the httpd task submits, so free space can only grow between
+    // this check and the send below
+    if (job_queue == NULL || uxQueueSpacesAvailable(job_queue) == 0) {
+        atomic_fetch_add(&rejected, 1);
+        return ESP_ERR_NO_MEM;
+    }
+
+    http_job_t job = { .handler = handler, .queued_us = esp_timer_get_time() };
+    esp_err_t err = httpd_req_async_handler_begin(req, &job.req);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (xQueueSend(job_queue, &job, 0) != pdTRUE) {
+        // Not expected (see above); the request is detached now, so answer on the copy
+        httpd_resp_set_status(job.req, "503 Service Unavailable");
+        httpd_resp_sendstr(job.req, "{\"status\":\"error\",\"message\":\"Server busy\"}");
+        httpd_req_async_handler_complete(job.req);
+        atomic_fetch_add(&rejected, 1);
+        return ESP_OK;
+    }
+    atomic_fetch_add(&queued, 1);
+    return ESP_OK;
+}
+
+void http_workers_get_stats(http_workers_stats_t *out)
+{
+    out->queued = atomic_load(&queued);
+    out->rejected = atomic_load(&rejected);
+    out->completed = atomic_load(&completed);
+    out->busy = (uint8_t)atomic_load(&busy);
+    out->waiting = job_queue ? (uint8_t)uxQueueMessagesWaiting(job_queue) : 0;
+}
@@ -0,0 +1,42 @@
+#ifndef HTTP_WORKERS_H
+#define HTTP_WORKERS_H
+
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+// Worker pool for slow HTTP handlers (HX711 tare, motor driver reset).
+// The httpd task only detaches the request (httpd_req_async_handler_begin)
+// and queues it, so other clients are not stalled while a worker runs the
+// handler. When the queue is full the request is refused with 503.
+
+#define HTTP_WORKER_COUNT 2
+#define HTTP_WORKER_QUEUE_LEN 4
+#define HTTP_WORKER_STACK 4096
+#define HTTP_WORKER_PRIORITY 5     // Same as httpd
+#define HTTP_WORKER_CORE 0         // Network core, away from the control task
+
+typedef esp_err_t (*http_worker_handler_t)(httpd_req_t *req);
+
+// Create the queue and worker tasks (call before httpd_start)
+esp_err_t http_workers_init(void);
+
+// True when called from a worker task, i.e. the handler should do the work
+bool http_workers_on_worker(void);
+
+// Detach req and queue handler(req) for a worker. Returns ESP_ERR_NO_MEM
+// when the queue is full (req untouched, caller answers 503) or another
+// error if the request could not be detached; ESP_OK means req is handled.
+esp_err_t http_workers_submit(httpd_req_t *req, http_worker_handler_t handler);
+
+typedef struct {
+    uint32_t queued;        // Requests accepted
+    uint32_t rejected;      // Refused with 503 (queue full)
+    uint32_t completed;
+    uint8_t busy;           // Workers running a handler now
+    uint8_t waiting;        // Requests in the queue
+} http_workers_stats_t;
+
+void http_workers_get_stats(http_workers_stats_t *out);
+
+#endif // HTTP_WORKERS_H
@@ -1,13 +1,43 @@
 #include "hx711.h"
+#include "metrics.h"
+#include "capture.h"
+#include "trace.h"
+#include "deferred_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_cpu.h"
 #include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
 #include "rom/ets_sys.h"
+#include <string.h>
+#if CONFIG_IDF_TARGET_ESP32S3
+#include "esp32s3/rom/cache.h"
+#endif
 
 static const char *TAG = "HX711";
 
+// Interrupts off during the bit-bang; shared by every HX711 so the two
+// cores serialize on it too
+static portMUX_TYPE shift_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void hx711_lock(hx711_t* hx711)
+{
+    if (hx711->lock != NULL) {
+        xSemaphoreTake(hx711->lock, portMAX_DELAY);
+    }
+}
+
+static void hx711_unlock(hx711_t* hx711)
+{
+    if (hx711->lock != NULL) {
+        xSemaphoreGive(hx711->lock);
+    }
+}
+
 void hx711_init(hx711_t* hx711, gpio_num_t dout, gpio_num_t sck)
 {
+    hx711->lock = xSemaphoreCreateMutex();
     hx711->dout_pin = dout;
     hx711->sck_pin = sck;
     hx711->gain = HX711_GAIN_128;
@@ -38,9 +68,15 @@ void hx711_init(hx711_t* hx711, gpio_num_t dout, gpio_num_t sck)
     
     ESP_LOGI(TAG, "HX711 initialized on DT=GPIO%d, SCK=GPIO%d", dout, sck);
     
-    // Wait for HX711 to stabilize after power-up
+    // Wait for the first conversion after power-up (DOUT goes low) instead
+    // of a fixed delay; at 10 SPS this is typically ~400 ms
     ESP_LOGI(TAG, "Waiting for HX711 to stabilize...");
-    vTaskDelay(pdMS_TO_TICKS(1000));
+    int64_t start_us = esp_timer_get_time();
+    while (!hx711_is_ready(hx711) &&
+           esp_timer_get_time() - start_us < HX711_POWERUP_TIMEOUT_MS * 1000) {
+        vTaskDelay(1);
+    }
+    ESP_LOGI(TAG, "HX711 ready after %lld ms", (long long)((esp_timer_get_time() - start_us) / 1000));
     
     // Read once to set gain
     hx711_read(hx711);
@@ -51,30 +87,32 @@ bool hx711_is_ready(hx711_t* hx711)
     return gpio_get_level(hx711->dout_pin) == 0;
 }
 
-long hx711_read(hx711_t* hx711)
+int32_t hx711_decode_raw(const uint8_t data[3])
 {
-    // Wait for the chip to become ready (increased timeout for slower modules)
-    int timeout = 0;
-    while (!hx711_is_ready(hx711)) {
-        vTaskDelay(pdMS_TO_TICKS(10));  // Increased delay
-        timeout++;
-        if (timeout > 100) {  // 1000ms total timeout
-            ESP_LOGW(TAG, "HX711 not ready timeout");
-            return 0;
-        }
-    }
-    
-    unsigned long value = 0;
-    uint8_t data[3] = {0};
-    uint8_t filler = 0x00;
+    // Construct the 24-bit value
+    uint32_t value = ((uint32_t)data[2] << 16) | ((uint32_t)data[1] << 8) | (uint32_t)data[0];
     
-    // Disable interrupts during bit-banging
-    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
-    portENTER_CRITICAL(&mux);
+    // Convert from 2's complement if negative
+    if (data[2] & 0x80) {
+        value |= 0xFF000000;
+    }
+    return (int32_t)value;
+}
+
+// 24 data pulses plus the gain pulses, with interrupts already off. SCK
+// must fall within 50 us of rising or the HX711 powers down, so this runs
+// from IRAM (linker.lf): a flash cache miss here stalls the CPU mid-pulse.
+// pulse_cycles (NULL in normal reads) gets each SCK high time in CPU cycles.
+static inline __attribute__((always_inline)) void shift_in(const hx711_t* hx711, uint8_t data[3],
+                                                           uint32_t *pulse_cycles)
+{
+    int pulse = 0;
+    uint32_t rise = 0;
     
     // Pulse the clock pin 24 times to read the data
     for (int j = 3; j > 0; j--) {
         for (int i = 8; i > 0; i--) {
+            if (pulse_cycles) rise = esp_cpu_get_cycle_count();
             gpio_set_level(hx711->sck_pin, 1);
             ets_delay_us(1);
             
@@ -84,83 +122,238 @@ long hx711_read(hx711_t* hx711)
             }
             
             gpio_set_level(hx711->sck_pin, 0);
+            if (pulse_cycles) pulse_cycles[pulse++] = esp_cpu_get_cycle_count() - rise;
             ets_delay_us(1);
         }
     }
     
     // Set the gain for next reading
     for (int i = 0; i < (int)hx711->gain; i++) {
+        if (pulse_cycles) rise = esp_cpu_get_cycle_count();
         gpio_set_level(hx711->sck_pin, 1);
         ets_delay_us(1);
         gpio_set_level(hx711->sck_pin, 0);
+        if (pulse_cycles) pulse_cycles[pulse++] = esp_cpu_get_cycle_count() - rise;
         ets_delay_us(1);
     }
+}
+
+// noinline: a copy inlined into a flash-resident caller would run from flash
+__attribute__((noinline)) void hx711_shift_in(const hx711_t* hx711, uint8_t data[3])
+{
+    shift_in(hx711, data, NULL);
+}
+
+__attribute__((noinline)) void hx711_shift_in_timed(const hx711_t* hx711, uint8_t data[3], uint32_t *pulse_cycles)
+{
+    shift_in(hx711, data, pulse_cycles);
+}
+
+// Same code left in flash: the reference for hx711_pulse_bench() (noipa
+// so identical-code folding cannot merge it with the IRAM copy)
+__attribute__((noipa)) void hx711_shift_in_timed_flash(const hx711_t* hx711, uint8_t data[3], uint32_t *pulse_cycles)
+{
+    shift_in(hx711, data, pulse_cycles);
+}
+
+// Drop the instruction cache so the flash copy starts cold (in IRAM itself)
+__attribute__((noinline)) void hx711_bench_flush_cache(void)
+{
+#if CONFIG_IDF_TARGET_ESP32S3
+    Cache_Invalidate_ICache_All();
+#endif
+}
+
+// One conversion, with hx711->lock held by the caller
+static long read_locked(hx711_t* hx711)
+{
+    int64_t start_us = esp_timer_get_time();
+    TRACE_BEGIN("hx711_wait");
+    
+    // Wait for the chip to become ready (increased timeout for slower modules)
+    int timeout = 0;
+    while (!hx711_is_ready(hx711)) {
+        vTaskDelay(pdMS_TO_TICKS(10));  // Increased delay
+        timeout++;
+        if (timeout > 100) {  // 1000ms total timeout
+            DLOGW(TAG, "HX711 not ready timeout");
+            metrics_count(METRIC_HX711_TIMEOUTS);
+            capture_timeout();
+            TRACE_END("hx711_wait");
+            TRACE_INSTANT("hx711_timeout", timeout);
+            return 0;
+        }
+    }
     
-    portEXIT_CRITICAL(&mux);
+    TRACE_END("hx711_wait");
+    TRACE_BEGIN("hx711_shift");
     
-    // Construct the 24-bit value
-    value = ((unsigned long)data[2] << 16) | ((unsigned long)data[1] << 8) | (unsigned long)data[0];
+    uint8_t data[3] = {0};
     
-    // Convert from 2's complement if negative
-    if (data[2] & 0x80) {
-        value |= 0xFF000000;
-    }
+    // Disable interrupts during bit-banging
+    portENTER_CRITICAL(&shift_lock);
+    hx711_shift_in(hx711, data);
+    portEXIT_CRITICAL(&shift_lock);
+    
+    int32_t raw = hx711_decode_raw(data);
     
-    return (long)value;
+    TRACE_END("hx711_shift");
+    metrics_observe(METRIC_HX711_CONVERSION, (uint32_t)(esp_timer_get_time() - start_us));
+    capture_conversion(raw);
+    return (long)raw;
 }
 
-long hx711_read_average(hx711_t* hx711, int times)
+long hx711_read(hx711_t* hx711)
+{
+    hx711_lock(hx711);
+    long raw = read_locked(hx711);
+    hx711_unlock(hx711);
+    return raw;
+}
+
+void hx711_pulse_bench(hx711_t* hx711, int conversions, bool from_flash, hx711_pulse_stats_t *out)
 {
+    uint32_t pulse_cycles[HX711_MAX_PULSES];
+    uint64_t total_cycles = 0;
+    uint32_t max_cycles = 0;
+    uint32_t ticks_per_us = esp_rom_get_cpu_ticks_per_us();
+    memset(out, 0, sizeof(*out));
+    
+    for (int n = 0; n < conversions; n++) {
+        hx711_lock(hx711);
+        int timeout = 0;
+        while (!hx711_is_ready(hx711) && timeout++ < 100) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        if (!hx711_is_ready(hx711)) {
+            hx711_unlock(hx711);
+            out->timeouts++;
+            continue;
+        }
+        
+        uint8_t data[3] = {0};
+        portENTER_CRITICAL(&shift_lock);
+        hx711_bench_flush_cache();
+        if (from_flash) {
+            hx711_shift_in_timed_flash(hx711, data, pulse_cycles);
+        } else {
+            hx711_shift_in_timed(hx711, data, pulse_cycles);
+        }
+        portEXIT_CRITICAL(&shift_lock);
+        hx711_unlock(hx711);
+        
+        int pulses = 24 + (int)hx711->gain;
+        for (int i = 0; i < pulses; i++) {
+            total_cycles += pulse_cycles[i];
+            if (pulse_cycles[i] > max_cycles) {
+                max_cycles = pulse_cycles[i];
+            }
+            if (pulse_cycles[i] > HX711_SCK_HIGH_MAX_US * ticks_per_us) {
+                out->over_limit++;
+            }
+        }
+        out->pulses += pulses;
+        out->conversions++;
+    }
+    if (out->pulses > 0) {
+        out->mean_ns = (uint32_t)(total_cycles * 1000 / ticks_per_us / out->pulses);
+        out->max_ns = (uint32_t)((uint64_t)max_cycles * 1000 / ticks_per_us);
+    }
+}
+
+// Average of several conversions, with hx711->lock held by the caller
+static long average_locked(hx711_t* hx711, int times)
+{
+    TRACE_BEGIN("hx711_filter");
     long sum = 0;
     for (int i = 0; i < times; i++) {
-        sum += hx711_read(hx711);
+        sum += read_locked(hx711);
         vTaskDelay(pdMS_TO_TICKS(1));
     }
+    TRACE_END("hx711_filter");
     return sum / times;
 }
 
+long hx711_read_average(hx711_t* hx711, int times)
+{
+    hx711_lock(hx711);
+    long raw = average_locked(hx711, times);
+    hx711_unlock(hx711);
+    return raw;
+}
+
 void hx711_set_gain(hx711_t* hx711, hx711_gain_t gain)
 {
+    hx711_lock(hx711);
     hx711->gain = gain;
     gpio_set_level(hx711->sck_pin, 0);
-    hx711_read(hx711);
+    read_locked(hx711);
+    hx711_unlock(hx711);
 }
 
 void hx711_tare(hx711_t* hx711, int times)
 {
-    long sum = hx711_read_average(hx711, times);
+    hx711_lock(hx711);
+    long sum = average_locked(hx711, times);
     hx711->offset = sum;
-    ESP_LOGI(TAG, "Tare completed. Offset: %ld", hx711->offset);
+    hx711_unlock(hx711);
+    ESP_LOGI(TAG, "Tare completed. Offset: %ld", sum);
 }
 
 void hx711_set_scale(hx711_t* hx711, float scale)
 {
+    hx711_lock(hx711);
     hx711->scale = scale;
+    hx711_unlock(hx711);
     ESP_LOGI(TAG, "Scale set to: %.2f", scale);
 }
 
 void hx711_set_offset(hx711_t* hx711, long offset)
 {
+    hx711_lock(hx711);
     hx711->offset = offset;
+    hx711_unlock(hx711);
     ESP_LOGI(TAG, "Offset set to: %ld", offset);
 }
 
+void hx711_set_calibration(hx711_t* hx711, float scale, long offset)
+{
+    hx711_lock(hx711);
+    hx711->scale = scale;
+    hx711->offset = offset;
+    hx711_unlock(hx711);
+    ESP_LOGI(TAG, "Calibration set to: scale %.2f, offset %ld", scale, offset);
+}
+
 void hx711_zero_scale(hx711_t* hx711)
 {
     // Read current raw value and set it as the new offset
-    long raw_value = hx711_read_average(hx711, 10);
+    hx711_lock(hx711);
+    long raw_value = average_locked(hx711, 10);
     hx711->offset = raw_value;
+    hx711_unlock(hx711);
     ESP_LOGI(TAG, "Scale zeroed. New offset: %ld", raw_value);
 }
 
 float hx711_get_value(hx711_t* hx711, int times)
 {
-    return (float)(hx711_read_average(hx711, times) - hx711->offset);
+    hx711_lock(hx711);
+    float value = (float)(average_locked(hx711, times) - hx711->offset);
+    hx711_unlock(hx711);
+    return value;
+}
+
+float hx711_raw_to_units(const hx711_t* hx711, long raw)
+{
+    return (float)(raw - hx711->offset) / hx711->scale;
 }
 
 float hx711_get_units(hx711_t* hx711, int times)
 {
-    return hx711_get_value(hx711, times) / hx711->scale;
+    hx711_lock(hx711);
+    float units = hx711_raw_to_units(hx711, average_locked(hx711, times));
+    hx711_unlock(hx711);
+    return units;
 }
 
 void hx711_power_down(hx711_t* hx711)
@@ -2,7 +2,17 @@
 #define HX711_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// Max wait for the first conversion in hx711_init()
+#define HX711_POWERUP_TIMEOUT_MS 1000
+
+// SCK high longer than this powers the HX711 down (datasheet: 60 us)
+#define HX711_SCK_HIGH_MAX_US 50
+#define HX711_MAX_PULSES 27     // 24 data bits + up to 3 gain pulses
 
 // HX711 Gain settings
 typedef enum {
@@ -18,9 +28,15 @@ typedef struct {
     hx711_gain_t gain;
     long offset;
     float scale;
+    SemaphoreHandle_t lock;     // One reader at a time (sampling loop, tare, bench)
 } hx711_t;
 
-// Function prototypes
+// Reads take hx711->lock: hx711_read() for one conversion, the averaging
+// functions (and so hx711_tare() / hx711_zero_scale()) for all of theirs,
+// so a tare from an HTTP worker makes the sampling loop wait instead of
+// splitting conversions with it. Offset and scale are only changed under
+// the lock (hx711_set_offset() / hx711_set_scale(), tare), and
+// hx711_get_units() converts before releasing it.
 void hx711_init(hx711_t* hx711, gpio_num_t dout, gpio_num_t sck);
 bool hx711_is_ready(hx711_t* hx711);
 long hx711_read(hx711_t* hx711);
@@ -29,11 +45,41 @@ void hx711_set_gain(hx711_t* hx711, hx711_gain_t gain);
 void hx711_tare(hx711_t* hx711, int times);
 void hx711_set_scale(hx711_t* hx711, float scale);
 void hx711_set_offset(hx711_t* hx711, long offset);
+void hx711_set_calibration(hx711_t* hx711, float scale, long offset);   // Both at once
 void hx711_zero_scale(hx711_t* hx711);
 float hx711_get_units(hx711_t* hx711, int times);
 float hx711_get_value(hx711_t* hx711, int times);
 void hx711_power_down(hx711_t* hx711);
 void hx711_power_up(hx711_t* hx711);
 
+// Clock out one conversion with interrupts already disabled; placed in
+// IRAM by linker.lf (see iram_report.py for where it ended up)
+void hx711_shift_in(const hx711_t* hx711, uint8_t data[3]);
+void hx711_shift_in_timed(const hx711_t* hx711, uint8_t data[3], uint32_t *pulse_cycles);
+void hx711_shift_in_timed_flash(const hx711_t* hx711, uint8_t data[3], uint32_t *pulse_cycles);
+void hx711_bench_flush_cache(void);
+
+// SCK pulse-width benchmark: reads conversions through the IRAM shifter or
+// its flash copy, with the instruction cache flushed before each one
+// (ESP32-S3), and times every SCK high phase (set-high call to set-low
+// return). Takes the lock per conversion, so it alternates conversions
+// with the sampling loop while it runs.
+typedef struct {
+    uint32_t conversions;
+    uint32_t timeouts;
+    uint32_t pulses;
+    uint32_t mean_ns;
+    uint32_t max_ns;            // Worst-case SCK high time
+    uint32_t over_limit;        // Pulses longer than HX711_SCK_HIGH_MAX_US
+} hx711_pulse_stats_t;
+
+void hx711_pulse_bench(hx711_t* hx711, int conversions, bool from_flash, hx711_pulse_stats_t *out);
+
+// Pure helpers (no pin access), also used by the host benchmarks:
+// 24-bit two's complement readout (data[2] = MSB) to a signed value
+int32_t hx711_decode_raw(const uint8_t data[3]);
+// Raw reading to calibrated units (kg)
+float hx711_raw_to_units(const hx711_t* hx711, long raw);
+
 #endif // HX711_H
 
@@ -15,5 +15,12 @@
 #define READINGS_PER_SAMPLE 3   // Number of readings to average (reduced for faster response)
 #define UPDATE_INTERVAL_MS 2000 // How often to read weight (milliseconds) (increased to give HX711 more time)
 
+// Sampling loop deadline (deadline_monitor.h): one iteration is two
+// averaged reads (weight + raw) plus the update interval
+#define HX711_CONVERSION_MS 100         // 10 SPS (RATE pin low)
+#define SAMPLE_DEADLINE_BUDGET_MS 500   // Allowed lateness before the motor is stopped
+#define SAMPLE_PERIOD_US(readings, interval_ms) \
+    (((uint32_t)(interval_ms) + 2u * (uint32_t)(readings) * HX711_CONVERSION_MS) * 1000u)
+
 #endif // HX711_CONFIG_H
 
@@ -0,0 +1,289 @@
+#include "load_estimator.h"
+#include "freertos/FreeRTOS.h"
+#include <math.h>
+#include <string.h>
+
+#define GRAVITY 9.81f
+
+static cabin_model_t model = {
+    .speed_mps = CABIN_MODEL_SPEED_MPS,
+    .accel_ms = CABIN_MODEL_ACCEL_MS,
+    .cell_hz = CABIN_MODEL_CELL_HZ,
+    .cell_damping = CABIN_MODEL_CELL_DAMPING,
+    .noise_kg = CABIN_MODEL_NOISE_KG,
+    .drift_kg = CABIN_MODEL_DRIFT_KG
+};
+static load_estimate_t estimate;
+static float variance = 0.0f;       // Kalman P, kg^2
+static int64_t last_us = 0;         // End of the previous sample window
+static bool initialized = false;
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+void cabin_model_default(cabin_model_t *out)
+{
+    *out = (cabin_model_t) {
+        .speed_mps = CABIN_MODEL_SPEED_MPS,
+        .accel_ms = CABIN_MODEL_ACCEL_MS,
+        .cell_hz = CABIN_MODEL_CELL_HZ,
+        .cell_damping = CABIN_MODEL_CELL_DAMPING,
+        .noise_kg = CABIN_MODEL_NOISE_KG,
+        .drift_kg = CABIN_MODEL_DRIFT_KG
+    };
+}
+
+bool cabin_model_valid(const cabin_model_t *m)
+{
+    // Same ranges as config_store_valid()
+    return m->speed_mps >= 0.0f && m->speed_mps <= 10.0f &&
+           m->accel_ms >= 1.0f && m->accel_ms <= 10000.0f &&
+           m->cell_hz >= 0.1f && m->cell_hz <= 100.0f &&
+           m->cell_damping >= 0.01f && m->cell_damping <= 2.0f &&
+           m->noise_kg > 0.0f && m->drift_kg > 0.0f;
+}
+
+void load_estimator_set_model(const cabin_model_t *m)
+{
+    if (!cabin_model_valid(m)) {
+        return;
+    }
+    portENTER_CRITICAL(&lock);
+    model = *m;
+    portEXIT_CRITICAL(&lock);
+}
+
+void load_estimator_get_model(cabin_model_t *out)
+{
+    portENTER_CRITICAL(&lock);
+    *out = model;
+    portEXIT_CRITICAL(&lock);
+}
+
+void load_estimator_reset(float load_kg)
+{
+    portENTER_CRITICAL(&lock);
+    estimate = (load_estimate_t) {
+        .load_kg = load_kg,
+        .sigma_kg = model.noise_kg,
+        .measured_kg = load_kg,
+        .corrected_kg = load_kg,
+        .gain = 1.0f
+    };
+    variance = model.noise_kg * model.noise_kg;
+    last_us = 0;
+    initialized = true;
+    portEXIT_CRITICAL(&lock);
+}
+
+static int direction(motor_state_t state)
+{
+    switch (state) {
+        case MOTOR_STATE_FORWARD:  return 1;    // Cabin up
+        case MOTOR_STATE_BACKWARD: return -1;
+        default:                   return 0;
+    }
+}
+
+// Time after a change until the cabin and the platform are at rest again, s
+static float settle_time(const cabin_model_t *m)
+{
+    float w0 = 6.2831853f * m->cell_hz;
+    return LOAD_ESTIMATOR_SETTLED * (m->accel_ms / 1000.0f + 1.0f / (m->cell_damping * w0));
+}
+
+// Cabin model as a linear system z' = M z in the state
+//   z = (y, y' / w0, a / g, integral of y)
+// with y the relative load cell response. Scaling y' by w0 keeps the
+// entries of M at the size of w0, so the matrix exponential needs few
+// squarings.
+static void model_matrix(const cabin_model_t *m, float out[4][4])
+{
+    float w0 = 6.2831853f * m->cell_hz;
+    float tau = m->accel_ms / 1000.0f;
+    memset(out, 0, sizeof(float[4][4]));
+    out[0][1] = w0;
+    out[1][0] = -w0;
+    out[1][1] = -2.0f * m->cell_damping * w0;
+    out[1][2] = w0;
+    out[2][2] = -1.0f / tau;
+    out[3][0] = 1.0f;
+}
+
+static void mat_mul(const float a[4][4], const float b[4][4], float out[4][4])
+{
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                sum += a[i][k] * b[k][j];
+            }
+            out[i][j] = sum;
+        }
+    }
+}
+
+// z <- e^(M t) z: scaling and squaring with a Taylor series, so the cost
+// is the same for any t and any model in range (about 30 4x4 products)
+static void propagate(const float m[4][4], float t, float z[4])
+{
+    if (t <= 0.0f) {
+        return;
+    }
+    float norm = 0.0f;
+    for (int i = 0; i < 4; i++) {
+        float row = 0.0f;
+        for (int j = 0; j < 4; j++) {
+            row += fabsf(m[i][j]);
+        }
+        if (row > norm) {
+            norm = row;
+        }
+    }
+    int squarings = 0;
+    norm *= t;
+    while (norm > 0.5f && squarings < 40) {
+        norm *= 0.5f;
+        squarings++;
+    }
+    float h = ldexpf(t, -squarings);
+
+    float e[4][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } };
+    float term[4][4];
+    float next[4][4];
+    memcpy(term, e, sizeof(term));
+    for (int k = 1; k <= LOAD_ESTIMATOR_TAYLOR_ORDER; k++) {
+        mat_mul(term, m, next);
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                term[i][j] = next[i][j] * h / k;
+                e[i][j] += term[i][j];
+            }
+        }
+    }
+    for (int s = 0; s < squarings; s++) {
+        mat_mul(e, e, next);
+        memcpy(e, next, sizeof(e));
+    }
+
+    float out[4];
+    for (int i = 0; i < 4; i++) {
+        out[i] = e[i][0] * z[0] + e[i][1] * z[1] + e[i][2] * z[2] + e[i][3] * z[3];
+    }
+    memcpy(z, out, sizeof(out));
+}
+
+// z from time from to time to after the change. Once the drive has
+// decayed (a / g below e^-30 of its start) the rest runs without it, so
+// the slow ring-down is not squared at the pace of a fast drive.
+static void advance(const float full[4][4], const float ring[4][4], float drive,
+                    float from, float to, float z[4])
+{
+    if (from < drive) {
+        float mid = to < drive ? to : drive;
+        propagate(full, mid - from, z);
+        from = mid;
+    }
+    if (to > from) {
+        z[2] = 0.0f;
+        propagate(ring, to - from, z);
+    }
+}
+
+// Mean relative load cell response (apparent / true weight - 1) over
+// [since0, since1] seconds after a velocity change of dv: the drive's
+// exponential acceleration through the platform resonance, solved exactly
+// from the change on (nothing left to integrate past settle_time())
+static float window_response(const cabin_model_t *m, float dv, float since0, float since1)
+{
+    float full[4][4];
+    float ring[4][4];
+    model_matrix(m, full);
+    memcpy(ring, full, sizeof(ring));
+    ring[1][2] = 0.0f;
+    ring[2][2] = 0.0f;
+
+    float tau = m->accel_ms / 1000.0f;
+    float drive = LOAD_ESTIMATOR_DRIVE_TAUS * tau;
+    float settle = settle_time(m);
+    float t0 = since0 > 0.0f ? since0 : 0.0f;
+    float t1 = since1 < settle ? since1 : settle;
+
+    float z[4] = { 0.0f, 0.0f, dv / (tau * GRAVITY), 0.0f };
+    advance(full, ring, drive, 0.0f, t0, z);
+    float area0 = z[3];
+    advance(full, ring, drive, t0, t1, z);
+    return (z[3] - area0) / (since1 - since0);
+}
+
+float load_estimator_update(float measured_kg, int64_t t0_us, int64_t t1_us,
+                            const motor_motion_t *motion)
+{
+    cabin_model_t m;
+    load_estimator_get_model(&m);
+
+    // Velocity step of the latest change: a start gains it, a stop (worm
+    // gear) or a reversal loses it
+    float dv = 0.0f;
+    if (motion->change_us != 0) {
+        dv = (direction(motion->state) - direction(motion->previous)) *
+             m.speed_mps * motion->duty / 255.0f;
+    }
+
+    // Modelled response over the window (outside the lock: two matrix
+    // exponentials, whatever the model)
+    if (t1_us <= t0_us) {
+        t1_us = t0_us + LOAD_ESTIMATOR_MIN_WINDOW_US;
+    }
+    float since0 = (t0_us - motion->change_us) / 1e6f;
+    float since1 = (t1_us - motion->change_us) / 1e6f;
+    float response = 0.0f;
+    bool transient = false;
+    if (dv != 0.0f && since1 > 0.0f && since0 < settle_time(&m)) {
+        response = window_response(&m, dv, since0, since1);
+        transient = true;
+    }
+    float apparent = 1.0f + response;
+    if (apparent < 0.1f) {
+        apparent = 0.1f;
+    }
+    float corrected = measured_kg / apparent;
+
+    // Sample variance: noise plus half the applied correction as model error
+    float model_err = 0.5f * (corrected - measured_kg);
+    float r = m.noise_kg * m.noise_kg + model_err * model_err;
+
+    portENTER_CRITICAL(&lock);
+    if (!initialized) {
+        estimate.load_kg = corrected;
+        variance = r;
+        estimate.gain = 1.0f;
+        initialized = true;
+    } else {
+        // Process noise: free at rest, bounded drift during a trip
+        bool at_rest = motion->state == MOTOR_STATE_STOPPED && !transient;
+        float dt = last_us != 0 && t1_us > last_us ? (t1_us - last_us) / 1e6f
+                                                   : (t1_us - t0_us) / 1e6f;
+        variance += at_rest ? LOAD_ESTIMATOR_REST_VAR : m.drift_kg * m.drift_kg * dt;
+        float k = variance / (variance + r);
+        estimate.load_kg += k * (corrected - estimate.load_kg);
+        variance *= 1.0f - k;
+        estimate.gain = k;
+    }
+    last_us = t1_us;
+
+    estimate.sigma_kg = sqrtf(variance);
+    estimate.measured_kg = measured_kg;
+    estimate.corrected_kg = corrected;
+    estimate.response = response;
+    estimate.transient = transient;
+    estimate.updates++;
+    float load = estimate.load_kg;
+    portEXIT_CRITICAL(&lock);
+    return load;
+}
+
+void load_estimator_get(load_estimate_t *out)
+{
+    portENTER_CRITICAL(&lock);
+    *out = estimate;
+    portEXIT_CRITICAL(&lock);
+}
@@ -0,0 +1,85 @@
+#ifndef LOAD_ESTIMATOR_H
+#define LOAD_ESTIMATOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "motor_control_bts7960.h"
+
+// Motion-aware load estimate for the auto control decisions.
+//
+// While the cabin accelerates the load cell reads m * (g + a) / g, and after
+// every start or stop the platform rings for a while. The estimator knows
+// when the commanded motion last changed (motor_get_motion()) and runs a
+// cabin model over that change:
+//   - the drive changes the cabin speed by dv with a(t) = dv / tau * e^(-t / tau)
+//   - the platform and load cell are a second-order system (natural
+//     frequency, damping ratio) driven by the apparent weight m * (1 + a / g)
+// The model is linear, so its response is solved exactly (matrix
+// exponential) at the window edges: the same cost for any sample time and
+// any model in range. The response averaged over the sample window is
+// divided out of the sample. A scalar Kalman filter then fuses the corrected samples:
+// half of the applied correction counts as model error, so samples taken
+// during a ramp or the ring-down move the estimate less than settled ones.
+// At rest the load may change at any moment (someone steps in), so the
+// estimate follows every sample; during a trip it may only drift by
+// drift_kg per sqrt(s) between samples.
+//
+// Only the latest change is modelled. No hardware access, so the same code
+// runs in the host simulator. One writer (the sampling loop); readers get a
+// consistent copy.
+
+#define CABIN_MODEL_SPEED_MPS   0.18f   // Cabin speed at full duty
+#define CABIN_MODEL_ACCEL_MS    15.0f   // Drive time constant (the worm gear stops dead)
+#define CABIN_MODEL_CELL_HZ     8.0f    // Platform + load cell resonance
+#define CABIN_MODEL_CELL_DAMPING 0.3f   // Damping ratio of that resonance
+#define CABIN_MODEL_NOISE_KG    0.005f  // 1-sigma sample noise at rest
+#define CABIN_MODEL_DRIFT_KG    0.02f   // Load change allowed during a trip, kg per sqrt(s)
+
+#define LOAD_ESTIMATOR_REST_VAR 100.0f  // Process variance at rest, kg^2 (follow every sample)
+#define LOAD_ESTIMATOR_SETTLED  5.0f    // Time constants after a change until at rest again
+#define LOAD_ESTIMATOR_MIN_WINDOW_US 1000   // Shortest sample window
+#define LOAD_ESTIMATOR_TAYLOR_ORDER  8      // Matrix exponential series terms
+#define LOAD_ESTIMATOR_DRIVE_TAUS    30.0f  // Drive time constants until its acceleration is gone
+
+typedef struct {
+    float speed_mps;        // Cabin speed at full duty, m/s
+    float accel_ms;         // Drive time constant, ms
+    float cell_hz;          // Platform + load cell natural frequency, Hz
+    float cell_damping;     // Damping ratio
+    float noise_kg;         // Sample noise, kg (1 sigma)
+    float drift_kg;         // Load drift while moving, kg per sqrt(s)
+} cabin_model_t;
+
+typedef struct {
+    float load_kg;          // Fused, motion-compensated load
+    float sigma_kg;         // Its uncertainty (1 sigma)
+    float measured_kg;      // Latest sample as read
+    float corrected_kg;     // Latest sample with the modelled inertial force removed
+    float response;         // Modelled apparent weight / weight over the window, minus 1
+    float gain;             // Weight of the latest sample in the estimate (0..1)
+    bool transient;         // Latest sample overlapped a ramp or its ring-down
+    uint32_t updates;
+} load_estimate_t;
+
+// Model defaults (CABIN_MODEL_*)
+void cabin_model_default(cabin_model_t *model);
+
+// false if a parameter is out of range (non-positive time constant, ...)
+bool cabin_model_valid(const cabin_model_t *model);
+
+// Replace the model (ignored if invalid); takes effect with the next sample
+void load_estimator_set_model(const cabin_model_t *model);
+void load_estimator_get_model(cabin_model_t *out);
+
+// Start over from a known load (e.g. the last weight before a warm reset)
+void load_estimator_reset(float load_kg);
+
+// Feed one sample averaged over [t0_us, t1_us] (esp_timer time) with the
+// motion at the end of the window; returns the new load estimate
+float load_estimator_update(float measured_kg, int64_t t0_us, int64_t t1_us,
+                            const motor_motion_t *motion);
+
+// Latest estimate
+void load_estimator_get(load_estimate_t *out);
+
+#endif // LOAD_ESTIMATOR_H
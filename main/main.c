@@ -2,15 +2,99 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "hx711.h"
 #include "hx711_config.h"
 #include "wifi_manager.h"
 #include "web_server.h"
 #include "motor_control_bts7960.h"
+#include "control_task.h"
+#include "config_store.h"
+#include "warm_state.h"
+#include "shared_state.h"
+#include "trace.h"
+#include "capture.h"
+#include "sample_log.h"
+#include "serial_telemetry.h"
+#include "deferred_log.h"
+#include "deadline_monitor.h"
+#include "load_estimator.h"
+#include <math.h>
 
 static const char *TAG = "HX711_DEMO";
 static hx711_t scale;
 
+#define NETWORK_TASK_STACK    4096
+#define NETWORK_TASK_PRIORITY 5
+
+// State byte of a sample log entry
+static uint8_t sample_log_state(bool sensor_ok)
+{
+    elevator_state_t es;
+    shared_state_read(&es);
+    uint8_t state = (uint8_t)motor_get_state() & SAMPLE_LOG_STATE_MOTOR_MASK;
+    if (es.motor_triggered) {
+        state |= SAMPLE_LOG_STATE_TRIGGERED;
+    }
+    if (es.auto_mode) {
+        state |= SAMPLE_LOG_STATE_AUTO_MODE;
+    }
+    if (sensor_ok) {
+        state |= SAMPLE_LOG_STATE_SENSOR_OK;
+    }
+    return state;
+}
+
+// Same sample as the dashboard gets, on the binary serial channel
+static void serial_sample(float weight, long raw, int64_t sample_ms)
+{
+    elevator_state_t es;
+    shared_state_read(&es);
+    telemetry_sample_t sample = {
+        .t_ms = (uint32_t)sample_ms,
+        .weight_g = (int32_t)lroundf(weight * 1000.0f),
+        .raw = (int32_t)raw,
+        .flags = (motor_get_state() & TELEMETRY_FLAG_MOTOR_MASK) |
+                 (es.auto_mode ? TELEMETRY_FLAG_AUTO_MODE : 0) |
+                 (es.stable ? TELEMETRY_FLAG_STABLE : 0) |
+                 TELEMETRY_FLAG_SENSOR_READY
+    };
+    serial_telemetry_sample(&sample);
+}
+
+// Cabin model of the load estimator from the stored configuration
+static void cabin_model_from_config(const elevator_config_t *cfg, cabin_model_t *model)
+{
+    cabin_model_default(model);
+    model->speed_mps = cfg->cabin_speed_mps;
+    model->accel_ms = cfg->cabin_accel_ms;
+    model->cell_hz = cfg->cabin_cell_hz;
+    model->cell_damping = cfg->cabin_cell_damping;
+}
+
+// WiFi and web server bring-up, in parallel with the control path.
+// Nothing on the sensor/motor side waits for this task.
+static void network_task(void *arg)
+{
+    // Initialize WiFi (returns immediately, connects in the background)
+    ESP_LOGI(TAG, "Connecting to WiFi...");
+    wifi_init();
+    
+    // Start web server (listens on all interfaces, usable as soon as we get an IP)
+    ESP_LOGI(TAG, "Starting web server...");
+    web_server_init();
+    
+    wifi_wait_connected(UINT32_MAX);
+    ESP_LOGI(TAG, "WiFi connected! IP: %s", wifi_get_ip());
+    ESP_LOGI(TAG, "");
+    ESP_LOGI(TAG, "========================================");
+    ESP_LOGI(TAG, "  Dashboard: http://%s", wifi_get_ip());
+    ESP_LOGI(TAG, "========================================");
+    ESP_LOGI(TAG, "");
+    
+    vTaskDelete(NULL);
+}
+
 void app_main(void)
 {
     ESP_LOGI(TAG, "===========================================");
@@ -20,18 +104,65 @@ void app_main(void)
     ESP_LOGI(TAG, "SCK Pin: GPIO%d (Yellow)", HX711_SCK_PIN);
     ESP_LOGI(TAG, "===========================================");
     
-    // Initialize WiFi
-    ESP_LOGI(TAG, "Connecting to WiFi...");
-    wifi_init();
-    ESP_LOGI(TAG, "WiFi connected! IP: %s", wifi_get_ip());
+    // Hot-path log lines (DLOGx) are formatted by a low-priority task
+    deferred_log_start();
+    
+    // Binary telemetry on the console UART (idle until a host asks for it)
+    serial_telemetry_start();
+    
+    // Persistent configuration (also initializes NVS for WiFi)
+    ESP_ERROR_CHECK(config_store_init());
+    elevator_config_t cfg;
+    config_store_get(&cfg);
+    
+    // Warm reset (brownout, watchdog, panic): resume from the RTC copy.
+    // Only a clean reset drives the motor again right away; after a fault
+    // the trip restarts on the first real sample above the threshold.
+    warm_state_t warm;
+    bool warm_boot = warm_state_restore(&warm);
+    bool resume_trip = warm_boot && warm_state_resume_trip(&warm);
+    int32_t offset = warm_boot ? warm.offset : cfg.offset;
+    
+    // Shared state read by the control task and the web server
+    elevator_state_t initial = {
+        .stable = true,
+        .auto_mode = cfg.auto_mode,
+        .threshold = cfg.threshold
+    };
+    if (warm_boot) {
+        // Last weight is shown until the first sample; sample_ms stays 0 so
+        // the control task waits for a real reading before deciding
+        initial.weight = warm.last_weight;
+        initial.load = warm.last_weight;
+        initial.auto_mode = warm.auto_mode;
+        initial.threshold = warm.threshold;
+        initial.motor_triggered = resume_trip;
+    }
+    shared_state_init(&initial);
+    cabin_model_t cabin;
+    cabin_model_from_config(&cfg, &cabin);
+    load_estimator_set_model(&cabin);
+    if (warm_boot) {
+        // A resumed trip starts moving before the first sample: its ramp
+        // is weighed against the load from before the reset
+        load_estimator_reset(warm.last_weight);
+    }
+    
+    // Network comes up on core 0 while we bring up sensor and motor
+    xTaskCreatePinnedToCore(network_task, "network", NETWORK_TASK_STACK, NULL,
+                            NETWORK_TASK_PRIORITY, NULL, 0);
     
     // Initialize HX711
     ESP_LOGI(TAG, "Initializing HX711...");
     hx711_init(&scale, HX711_DT_PIN, HX711_SCK_PIN);
     
-    // Set calibration values from config
-    hx711_set_scale(&scale, HX711_CALIBRATION_FACTOR);
-    hx711_set_offset(&scale, HX711_OFFSET);
+    // Set calibration values from the stored configuration
+    hx711_set_scale(&scale, cfg.calibration_factor);
+    hx711_set_offset(&scale, offset);
+    warm_state_save_offset(offset);
+    if (!hx711_is_ready(&scale)) {
+        warm_state_latch_fault(WARM_FAULT_SENSOR);
+    }
     
     ESP_LOGI(TAG, "HX711 initialized successfully!");
     
@@ -40,81 +171,126 @@ void app_main(void)
     motor_control_init();
     ESP_LOGI(TAG, "Motor control initialized!");
     
-    // Test motor commands
-    ESP_LOGI(TAG, "Testing BTS7960 motor commands...");
-    ESP_LOGI(TAG, "Test 1: Forward command");
-    motor_start_forward();
-    vTaskDelay(pdMS_TO_TICKS(2000));
-    motor_stop();
-    vTaskDelay(pdMS_TO_TICKS(1000));
-    
-    ESP_LOGI(TAG, "Test 2: Backward command");
-    motor_start_backward();
-    vTaskDelay(pdMS_TO_TICKS(2000));
-    motor_stop();
-    vTaskDelay(pdMS_TO_TICKS(1000));
+    // Warm reset mid-trip: the driver pins were reset, drive the motor again.
+    // The control task stops it on the first sample below the threshold.
+    if (resume_trip) {
+        motor_start_forward();
+        ESP_LOGI(TAG, "♻️  Trip resumed %lld ms after reset",
+                 (long long)(esp_timer_get_time() / 1000));
+    }
     
-    ESP_LOGI(TAG, "BTS7960 motor tests completed!");
+    // Fast boot: a stored configuration means the hardware has been through
+    // a full boot before, so the self-test is skipped (run it via /api/selftest)
+    bool fast_boot = warm_boot || (cfg.fast_boot && config_store_loaded());
+    if (fast_boot) {
+        ESP_LOGI(TAG, "⚡ Fast boot - motor self-test skipped (POST /api/selftest to run it)");
+    } else {
+        motor_self_test();
+        // Persist the defaults so the next boot can take the fast path
+        config_store_flush();
+    }
     
     // Check motor power status
     ESP_LOGI(TAG, "Checking BTS7960 power status...");
     motor_check_power();
     
-    // Start web server
-    ESP_LOGI(TAG, "Starting web server...");
-    web_server_init();
-    
-    // Reset motor state on system startup (in case of power restoration)
-    ESP_LOGI(TAG, "Resetting motor state on startup...");
-    web_server_reset_motor_state();
+    // Reset motor state on a cold start (in case of power restoration);
+    // a warm reset keeps the restored intent
+    if (!warm_boot) {
+        ESP_LOGI(TAG, "Resetting motor state on startup...");
+        web_server_reset_motor_state();
+    }
     
     // Set HX711 pointer for web server zeroing functionality
     web_server_set_hx711(&scale);
     
-    ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "========================================");
-    ESP_LOGI(TAG, "  Dashboard: http://%s", wifi_get_ip());
-    ESP_LOGI(TAG, "========================================");
-    ESP_LOGI(TAG, "");
+    // Start auto motor control (own task, pinned to core 1)
+    ESP_LOGI(TAG, "Starting control task...");
+    control_task_start(web_server_request_status);
+    
+    // Control and sampling loop deadlines (GPTimer ISR, stops the motor)
+    deadline_monitor_start(web_server_request_status);
     
     // Calibration mode - DISABLED (final calibration completed)
     ESP_LOGI(TAG, "HX711 final calibration completed and ready!");
+    ESP_LOGI(TAG, "⏱️  Boot-to-ready: %lld ms (%s boot)",
+             (long long)(esp_timer_get_time() / 1000),
+             warm_boot ? "warm" : fast_boot ? "fast" : "full");
+    
+    // Long-term sample log in flash (after boot-to-ready: it scans the partition)
+    sample_log_init();
     
     // Main loop - continuous weight reading and web updates
     ESP_LOGI(TAG, "Starting continuous weight monitoring...");
     ESP_LOGI(TAG, "");
     
     int reading_count = 0;
+    long last_raw = 0;
+    uint32_t sample_period_us = SAMPLE_PERIOD_US(cfg.readings_per_sample, cfg.update_interval_ms);
+    int deadline_id = deadline_register("sample", sample_period_us, SAMPLE_DEADLINE_BUDGET_MS * 1000);
     
     while (1) {
+        deadline_checkin(deadline_id);
+        
         // Check if HX711 is ready
         if (hx711_is_ready(&scale)) {
+            TRACE_BEGIN("sample");
+            
             // Read weight in configured units (kg)
-            float weight = hx711_get_units(&scale, READINGS_PER_SAMPLE);
+            config_store_get(&cfg);
+            if (SAMPLE_PERIOD_US(cfg.readings_per_sample, cfg.update_interval_ms) != sample_period_us) {
+                sample_period_us = SAMPLE_PERIOD_US(cfg.readings_per_sample, cfg.update_interval_ms);
+                deadline_set_period(deadline_id, sample_period_us);
+            }
+            cabin_model_from_config(&cfg, &cabin);
+            load_estimator_set_model(&cabin);
+            // The first reading was converted during the period before the call
+            int64_t window_start_us = esp_timer_get_time() - HX711_CONVERSION_MS * 1000;
+            float weight = hx711_get_units(&scale, cfg.readings_per_sample);
+            int64_t window_end_us = esp_timer_get_time();
+            motor_motion_t motion;
+            motor_get_motion(&motion);
+            float load = load_estimator_update(weight, window_start_us, window_end_us, &motion);
             
             // Read raw value for debugging
-            long raw_value = hx711_read_average(&scale, READINGS_PER_SAMPLE);
+            long raw_value = hx711_read_average(&scale, cfg.readings_per_sample);
             
             // Display results
             reading_count++;
-            ESP_LOGI(TAG, "[%d] Weight: %.2f kg | Raw: %ld",
-                     reading_count, weight, raw_value);
+            DLOGI(TAG, "[%d] Weight: %.2f kg | Load: %.2f kg | Raw: %ld",
+                  reading_count, weight, load, raw_value);
 
-            // Process weight with smart averaging
-            if (wifi_is_connected()) {
-                web_server_process_weight(weight, raw_value);
-            }
+            // Publish sample to the control task, then to history / dashboard
+            elevator_state_t *st = shared_state_begin_update();
+            st->weight = weight;
+            st->load = load;
+            st->raw = raw_value;
+            st->sample_ms = esp_timer_get_time() / 1000;
+            int64_t sample_ms = st->sample_ms;
+            shared_state_end_update();
+            capture_sample(weight);
+            serial_sample(weight, raw_value, sample_ms);
+            web_server_process_weight(weight, raw_value);
+            TRACE_END("sample");
+            
+            // Flash log; a full block is written here (sector erase ~45 ms
+            // every 8 blocks), never on the control task
+            sample_log_set_calibration(scale.scale, (int32_t)scale.offset);
+            sample_log_add(esp_timer_get_time() / 1000, raw_value, sample_log_state(true));
+            last_raw = raw_value;
             
             // Check for extreme values (possible error)
             if (weight < -10.0 || weight > 10000.0) {
-                ESP_LOGW(TAG, "⚠️  Unusual reading - check sensor or calibration!");
+                DLOGW(TAG, "⚠️  Unusual reading - check sensor or calibration!");
             }
             
         } else {
-            ESP_LOGW(TAG, "HX711 not ready!");
+            DLOGW(TAG, "HX711 not ready!");
+            serial_telemetry_event(SERIAL_EVENT_SENSOR, 0, "HX711 not ready");
+            sample_log_add(esp_timer_get_time() / 1000, last_raw, sample_log_state(false));
         }
         
         // Wait before next reading
-        vTaskDelay(pdMS_TO_TICKS(UPDATE_INTERVAL_MS));
+        vTaskDelay(pdMS_TO_TICKS(cfg.update_interval_ms));
     }
 }
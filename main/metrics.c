@@ -0,0 +1,287 @@
+#include "metrics.h"
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+
+// Bucket upper bounds in microseconds (+Inf is implicit)
+static const uint32_t bounds_sensor[] = { 1000, 5000, 10000, 25000, 50000, 100000, 150000, 250000, 500000, 1000000 };
+static const uint32_t bounds_fast[] = { 10, 25, 50, 100, 250, 500, 1000, 5000, 10000, 100000 };
+static const uint32_t bounds_http[] = { 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 500000, 1000000 };
+static const uint32_t bounds_jitter[] = { 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000 };
+
+#define MAX_BOUNDS 12
+
+typedef struct {
+    const uint32_t *bounds;
+    uint8_t nbounds;
+    atomic_uint buckets[MAX_BOUNDS + 1];
+    // 64-bit sum in two 32-bit words: Xtensa has no 64-bit atomics, so an
+    // atomic_ullong would fall back to a libatomic lock
+    atomic_uint sum_lo;
+    atomic_uint sum_hi;
+} histogram_t;
+
+_Static_assert(ATOMIC_INT_LOCK_FREE == 2, "metrics recording relies on lock-free 32-bit atomics");
+
+typedef struct {
+    const char *name;
+    const char *help;
+} metric_desc_t;
+
+static histogram_t hists[METRIC_HIST_COUNT] = {
+    [METRIC_HX711_CONVERSION]   = { bounds_sensor, sizeof(bounds_sensor) / sizeof(uint32_t) },
+    [METRIC_SAMPLE_TO_DECISION] = { bounds_sensor, sizeof(bounds_sensor) / sizeof(uint32_t) },
+    [METRIC_MOTOR_COMMAND]      = { bounds_fast,   sizeof(bounds_fast) / sizeof(uint32_t) },
+    [METRIC_CONTROL_EXEC]       = { bounds_fast,   sizeof(bounds_fast) / sizeof(uint32_t) },
+    [METRIC_HTTP_QUEUE_WAIT]    = { bounds_http,   sizeof(bounds_http) / sizeof(uint32_t) },
+};
+
+static const metric_desc_t hist_desc[METRIC_HIST_COUNT] = {
+    [METRIC_HX711_CONVERSION]   = { "elevator_hx711_conversion_seconds", "HX711 read time including the wait for DOUT" },
+    [METRIC_SAMPLE_TO_DECISION] = { "elevator_sample_to_decision_seconds", "Time from sample to control decision" },
+    [METRIC_MOTOR_COMMAND]      = { "elevator_motor_command_seconds", "Motor driver command duration" },
+    [METRIC_CONTROL_EXEC]       = { "elevator_control_loop_exec_seconds", "Control loop body execution time" },
+    [METRIC_HTTP_QUEUE_WAIT]    = { "elevator_http_worker_queue_wait_seconds", "Time a slow request waited for an HTTP worker" },
+};
+
+static atomic_uint counters[METRIC_COUNTER_COUNT];
+
+static const metric_desc_t counter_desc[METRIC_COUNTER_COUNT] = {
+    [METRIC_HX711_TIMEOUTS]    = { "elevator_hx711_timeouts_total", "HX711 reads that timed out waiting for DOUT" },
+    [METRIC_MODBUS_CRC_ERRORS] = { "elevator_modbus_crc_errors_total", "Modbus frames rejected because of a bad CRC" },
+    [METRIC_DEADLINE_MISSES]   = { "elevator_deadline_misses_total", "Periodic loops that missed their deadline (motor stopped)" },
+};
+
+// Per-URI HTTP handler durations
+typedef struct {
+    const char *uri;
+    const char *method;
+    histogram_t hist;
+} http_slot_t;
+
+static http_slot_t http_slots[METRICS_HTTP_MAX_URIS];
+static atomic_int http_slot_count;
+
+// Per-loop period jitter
+typedef struct {
+    const char *task;
+    histogram_t hist;
+} loop_slot_t;
+
+static loop_slot_t loop_slots[METRICS_MAX_LOOPS];
+static atomic_int loop_slot_count;
+
+static void hist_observe(histogram_t *h, uint32_t value_us)
+{
+    uint8_t i = 0;
+    while (i < h->nbounds && value_us > h->bounds[i]) {
+        i++;
+    }
+    atomic_fetch_add_explicit(&h->buckets[i], 1, memory_order_relaxed);
+    // The adder that wraps the low word carries into the high word
+    uint32_t lo = atomic_fetch_add_explicit(&h->sum_lo, value_us, memory_order_relaxed);
+    if (lo + value_us < lo) {
+        atomic_fetch_add_explicit(&h->sum_hi, 1, memory_order_relaxed);
+    }
+}
+
+// Reads hi before and after lo; a carry in between retries. A reader that
+// lands between the wrap and its carry sees the sum 2^32 us short once.
+static uint64_t hist_sum(histogram_t *h)
+{
+    uint32_t hi, lo;
+    do {
+        hi = atomic_load_explicit(&h->sum_hi, memory_order_acquire);
+        lo = atomic_load_explicit(&h->sum_lo, memory_order_acquire);
+    } while (hi != atomic_load_explicit(&h->sum_hi, memory_order_acquire));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+void metrics_observe(metrics_hist_t id, uint32_t value_us)
+{
+    if (id < METRIC_HIST_COUNT) {
+        hist_observe(&hists[id], value_us);
+    }
+}
+
+void metrics_count(metrics_counter_t id)
+{
+    if (id < METRIC_COUNTER_COUNT) {
+        atomic_fetch_add_explicit(&counters[id], 1, memory_order_relaxed);
+    }
+}
+
+int metrics_http_register(const char *uri, const char *method)
+{
+    int slot = atomic_fetch_add(&http_slot_count, 1);
+    if (slot >= METRICS_HTTP_MAX_URIS) {
+        atomic_store(&http_slot_count, METRICS_HTTP_MAX_URIS);
+        return -1;
+    }
+    http_slots[slot].uri = uri;
+    http_slots[slot].method = method;
+    http_slots[slot].hist.bounds = bounds_http;
+    http_slots[slot].hist.nbounds = sizeof(bounds_http) / sizeof(uint32_t);
+    return slot;
+}
+
+void metrics_http_observe(int slot, uint32_t value_us)
+{
+    if (slot >= 0 && slot < METRICS_HTTP_MAX_URIS) {
+        hist_observe(&http_slots[slot].hist, value_us);
+    }
+}
+
+int metrics_loop_register(const char *task)
+{
+    int slot = atomic_fetch_add(&loop_slot_count, 1);
+    if (slot >= METRICS_MAX_LOOPS) {
+        atomic_store(&loop_slot_count, METRICS_MAX_LOOPS);
+        return -1;
+    }
+    loop_slots[slot].task = task;
+    loop_slots[slot].hist.bounds = bounds_jitter;
+    loop_slots[slot].hist.nbounds = sizeof(bounds_jitter) / sizeof(uint32_t);
+    return slot;
+}
+
+void metrics_loop_observe(int slot, uint32_t value_us)
+{
+    if (slot >= 0 && slot < METRICS_MAX_LOOPS) {
+        hist_observe(&loop_slots[slot].hist, value_us);
+    }
+}
+
+// Rendering
+
+typedef struct {
+    metrics_write_fn write;
+    void *ctx;
+} sink_t;
+
+static void __attribute__((format(printf, 2, 3))) emitf(sink_t *s, const char *fmt, ...)
+{
+    char line[192];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        s->write(s->ctx, line, n < (int)sizeof(line) ? (size_t)n : sizeof(line) - 1);
+    }
+}
+
+static void render_header(sink_t *s, const char *name, const char *type, const char *help)
+{
+    emitf(s, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// labels: "" or `uri="/x",method="GET"` (without braces)
+static void render_hist(sink_t *s, const char *name, const char *labels, histogram_t *h)
+{
+    const char *sep = labels[0] ? "," : "";
+    uint64_t cumulative = 0;
+    for (uint8_t i = 0; i <= h->nbounds; i++) {
+        cumulative += atomic_load_explicit(&h->buckets[i], memory_order_relaxed);
+        if (i < h->nbounds) {
+            emitf(s, "%s_bucket{%s%sle=\"%g\"} %llu\n", name, labels, sep,
+                  h->bounds[i] / 1e6, (unsigned long long)cumulative);
+        } else {
+            emitf(s, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name, labels, sep,
+                  (unsigned long long)cumulative);
+        }
+    }
+    double sum = hist_sum(h) / 1e6;
+    if (labels[0]) {
+        emitf(s, "%s_sum{%s} %.6f\n%s_count{%s} %llu\n", name, labels, sum, name, labels,
+              (unsigned long long)cumulative);
+    } else {
+        emitf(s, "%s_sum %.6f\n%s_count %llu\n", name, sum, name, (unsigned long long)cumulative);
+    }
+}
+
+void metrics_render_value(metrics_write_fn write, void *ctx, const char *name,
+                          const char *type, const char *help, double value)
+{
+    sink_t s = { write, ctx };
+    render_header(&s, name, type, help);
+    emitf(&s, "%s %.17g\n", name, value);
+}
+
+#ifdef ESP_PLATFORM
+static void render_system(sink_t *s)
+{
+    render_header(s, "elevator_heap_free_bytes", "gauge", "Free heap");
+    emitf(s, "elevator_heap_free_bytes %u\n", (unsigned)heap_caps_get_free_size(MALLOC_CAP_DEFAULT));
+    render_header(s, "elevator_heap_min_free_bytes", "gauge", "Lowest free heap since boot");
+    emitf(s, "elevator_heap_min_free_bytes %u\n",
+          (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT));
+
+#if configUSE_TRACE_FACILITY
+    // Per-task stack high-water mark (needs CONFIG_FREERTOS_USE_TRACE_FACILITY)
+    UBaseType_t n = uxTaskGetNumberOfTasks() + 4;
+    TaskStatus_t *tasks = pvPortMalloc(n * sizeof(TaskStatus_t));
+    if (tasks != NULL) {
+        n = uxTaskGetSystemState(tasks, n, NULL);
+        render_header(s, "elevator_task_stack_free_min_bytes", "gauge",
+                      "Minimum free stack per task since start (high-water mark)");
+        for (UBaseType_t i = 0; i < n; i++) {
+            emitf(s, "elevator_task_stack_free_min_bytes{task=\"%s\"} %u\n", tasks[i].pcTaskName,
+                  (unsigned)tasks[i].usStackHighWaterMark * (unsigned)sizeof(StackType_t));
+        }
+        vPortFree(tasks);
+    }
+#endif
+}
+#endif
+
+void metrics_render(metrics_write_fn write, void *ctx)
+{
+    sink_t s = { write, ctx };
+
+    for (int i = 0; i < METRIC_HIST_COUNT; i++) {
+        render_header(&s, hist_desc[i].name, "histogram", hist_desc[i].help);
+        render_hist(&s, hist_desc[i].name, "", &hists[i]);
+    }
+
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        render_header(&s, counter_desc[i].name, "counter", counter_desc[i].help);
+        emitf(&s, "%s %u\n", counter_desc[i].name,
+              atomic_load_explicit(&counters[i], memory_order_relaxed));
+    }
+
+    int n = atomic_load(&http_slot_count);
+    if (n > 0) {
+        const char *name = "elevator_http_request_duration_seconds";
+        render_header(&s, name, "histogram", "HTTP handler duration per URI");
+        for (int i = 0; i < n && i < METRICS_HTTP_MAX_URIS; i++) {
+            char labels[96];
+            snprintf(labels, sizeof(labels), "uri=\"%s\",method=\"%s\"",
+                     http_slots[i].uri, http_slots[i].method);
+            render_hist(&s, name, labels, &http_slots[i].hist);
+        }
+    }
+
+    n = atomic_load(&loop_slot_count);
+    if (n > 0) {
+        const char *name = "elevator_loop_jitter_seconds";
+        render_header(&s, name, "histogram", "Periodic loop interval minus its period (absolute)");
+        for (int i = 0; i < n && i < METRICS_MAX_LOOPS; i++) {
+            char labels[48];
+            snprintf(labels, sizeof(labels), "task=\"%s\"", loop_slots[i].task);
+            render_hist(&s, name, labels, &loop_slots[i].hist);
+        }
+    }
+
+#ifdef ESP_PLATFORM
+    render_system(&s);
+#endif
+}
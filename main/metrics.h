@@ -0,0 +1,54 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed-bucket latency histograms and counters, rendered in Prometheus text
+// format at /metrics. Recording is lock-free on 32-bit atomics only: one
+// atomic increment for the bucket and one atomic add for the sum (plus a
+// carry every 2^32 us), safe from any task.
+
+// Histograms (values in microseconds)
+typedef enum {
+    METRIC_HX711_CONVERSION = 0,   // hx711_read(): wait for DOUT + 24-bit shift
+    METRIC_SAMPLE_TO_DECISION,     // Sample timestamp -> control policy evaluated
+    METRIC_MOTOR_COMMAND,          // Motor driver call (GPIO + LEDC update)
+    METRIC_CONTROL_EXEC,           // Control loop body
+    METRIC_HTTP_QUEUE_WAIT,        // Slow request queued -> picked up by an HTTP worker
+    METRIC_HIST_COUNT
+} metrics_hist_t;
+
+// Monotonic counters
+typedef enum {
+    METRIC_HX711_TIMEOUTS = 0,     // hx711_read() gave up waiting for DOUT
+    METRIC_MODBUS_CRC_ERRORS,      // Modbus frames with a bad CRC
+    METRIC_DEADLINE_MISSES,        // Periodic loops that missed their deadline (deadline_monitor.h)
+    METRIC_COUNTER_COUNT
+} metrics_counter_t;
+
+#define METRICS_HTTP_MAX_URIS 32   // Distinct (URI, method) pairs timed
+#define METRICS_MAX_LOOPS 4        // Periodic loops with a jitter histogram
+
+void metrics_observe(metrics_hist_t id, uint32_t value_us);
+void metrics_count(metrics_counter_t id);
+
+// HTTP handler duration per URI: register once, returns a slot (-1 if full)
+int metrics_http_register(const char *uri, const char *method);
+void metrics_http_observe(int slot, uint32_t value_us);
+
+// Period jitter per periodic loop: register once, returns a slot (-1 if full)
+int metrics_loop_register(const char *task);
+void metrics_loop_observe(int slot, uint32_t value_us);
+
+// Output sink for rendering (e.g. httpd chunk writer)
+typedef void (*metrics_write_fn)(void *ctx, const char *data, size_t len);
+
+// Render everything (plus heap and per-task stack gauges on the target)
+void metrics_render(metrics_write_fn write, void *ctx);
+
+// Helper for callers appending their own values in the same format
+void metrics_render_value(metrics_write_fn write, void *ctx, const char *name,
+                          const char *type, const char *help, double value);
+
+#endif // METRICS_H
@@ -0,0 +1,18 @@
+#include "modbus_crc.h"
+
+// Modbus RTU CRC-16 calculation
+uint16_t modbus_crc16(const uint8_t *buffer, uint16_t length) {
+    uint16_t crc = 0xFFFF;
+    
+    for (int i = 0; i < length; i++) {
+        crc ^= buffer[i];
+        for (int j = 0; j < 8; j++) {
+            if (crc & 0x0001) {
+                crc = (crc >> 1) ^ 0xA001;
+            } else {
+                crc >>= 1;
+            }
+        }
+    }
+    return crc;
+}
@@ -0,0 +1,10 @@
+#ifndef MODBUS_CRC_H
+#define MODBUS_CRC_H
+
+#include <stdint.h>
+
+// Modbus RTU CRC-16 (poly 0xA001 reflected, init 0xFFFF). Appended to a
+// frame low byte first. Shared by the DRI0050 driver and the host benchmarks.
+uint16_t modbus_crc16(const uint8_t *buffer, uint16_t length);
+
+#endif // MODBUS_CRC_H
@@ -1,11 +1,38 @@
 #include "motor_control_bts7960.h"
+#include "metrics.h"
+#include "trace.h"
+#include "deferred_log.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 #define TAG "MOTOR_BTS7960"
 
 static motor_state_t current_state = MOTOR_STATE_STOPPED;
 static uint8_t current_speed = 128; // default half speed
+static motor_state_t previous_state = MOTOR_STATE_STOPPED;
+static uint8_t change_duty = 0;      // Duty of the motion that started or ended
+static int64_t change_us = 0;
+// State and motion fields: written by tasks on both cores and the deadline ISR
+static portMUX_TYPE motion_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Remember when the motion changed, for the load estimator
+static void set_state(motor_state_t state)
+{
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&motion_lock);
+    if (state != current_state) {
+        previous_state = current_state;
+        change_us = now_us;
+        if (state != MOTOR_STATE_STOPPED) {
+            change_duty = current_speed;
+        }
+    }
+    current_state = state;
+    portEXIT_CRITICAL(&motion_lock);
+}
 
 esp_err_t motor_control_init(void)
 {
@@ -57,51 +84,81 @@ esp_err_t motor_control_init(void)
     ESP_LOGI(TAG, "BTS7960 motor control initialized (LPWM=GPIO %d, RPWM=GPIO %d)", 
              BTS7960_LPWM_PIN, BTS7960_RPWM_PIN);
 
+    portENTER_CRITICAL(&motion_lock);
     current_state = MOTOR_STATE_STOPPED;
+    portEXIT_CRITICAL(&motion_lock);
     return ESP_OK;
 }
 
 void motor_start_forward(void)
 {
-    ESP_LOGI(TAG, "Motor FORWARD at duty %d", current_speed);
+    int64_t start_us = esp_timer_get_time();
+    TRACE_BEGIN("motor_forward");
+    DLOGI(TAG, "Motor FORWARD at duty %d", current_speed);
     gpio_set_level(BTS7960_LEN_PIN, 1);
     gpio_set_level(BTS7960_REN_PIN, 1);
     ledc_set_duty(LEDC_LOW_SPEED_MODE, BTS7960_PWM_CHANNEL_FORWARD, current_speed);
     ledc_update_duty(LEDC_LOW_SPEED_MODE, BTS7960_PWM_CHANNEL_FORWARD);
     ledc_set_duty(LEDC_LOW_SPEED_MODE, BTS7960_PWM_CHANNEL_REVERSE, 0);
     ledc_update_duty(LEDC_LOW_SPEED_MODE, BTS7960_PWM_CHANNEL_REVERSE);
-    current_state = MOTOR_STATE_FORWARD;
+    set_state(MOTOR_STATE_FORWARD);
+    metrics_observe(METRIC_MOTOR_COMMAND, (uint32_t)(esp_timer_get_time() - start_us));
+    TRACE_END("motor_forward");
 }
 
 void motor_start_backward(void)
 {
-    ESP_LOGI(TAG, "Motor BACKWARD at duty %d", current_speed);
+    int64_t start_us = esp_timer_get_time();
+    TRACE_BEGIN("motor_backward");
+    DLOGI(TAG, "Motor BACKWARD at duty %d", current_speed);
     gpio_set_level(BTS7960_LEN_PIN, 1);
     gpio_set_level(BTS7960_REN_PIN, 1);
     ledc_set_duty(LEDC_LOW_SPEED_MODE, BTS7960_PWM_CHANNEL_REVERSE, current_speed);
     ledc_update_duty(LEDC_LOW_SPEED_MODE, BTS7960_PWM_CHANNEL_REVERSE);
     ledc_set_duty(LEDC_LOW_SPEED_MODE, BTS7960_PWM_CHANNEL_FORWARD, 0);
     ledc_update_duty(LEDC_LOW_SPEED_MODE, BTS7960_PWM_CHANNEL_FORWARD);
-    current_state = MOTOR_STATE_BACKWARD;
+    set_state(MOTOR_STATE_BACKWARD);
+    metrics_observe(METRIC_MOTOR_COMMAND, (uint32_t)(esp_timer_get_time() - start_us));
+    TRACE_END("motor_backward");
 }
 
 void motor_stop(void)
 {
-    ESP_LOGI(TAG, "Motor STOPPED");
+    int64_t start_us = esp_timer_get_time();
+    TRACE_BEGIN("motor_stop");
+    DLOGI(TAG, "Motor STOPPED");
     ledc_set_duty(LEDC_LOW_SPEED_MODE, BTS7960_PWM_CHANNEL_FORWARD, 0);
     ledc_set_duty(LEDC_LOW_SPEED_MODE, BTS7960_PWM_CHANNEL_REVERSE, 0);
     ledc_update_duty(LEDC_LOW_SPEED_MODE, BTS7960_PWM_CHANNEL_FORWARD);
     ledc_update_duty(LEDC_LOW_SPEED_MODE, BTS7960_PWM_CHANNEL_REVERSE);
     gpio_set_level(BTS7960_LEN_PIN, 0);
     gpio_set_level(BTS7960_REN_PIN, 0);
+    set_state(MOTOR_STATE_STOPPED);
+    metrics_observe(METRIC_MOTOR_COMMAND, (uint32_t)(esp_timer_get_time() - start_us));
+    TRACE_END("motor_stop");
+}
+
+// Interrupt-safe part of a stop: both half-bridges disabled, PWM is left to
+// the motor_stop() that must follow from a task (in IRAM via linker.lf)
+void motor_emergency_stop_isr(void)
+{
+    gpio_set_level(BTS7960_LEN_PIN, 0);
+    gpio_set_level(BTS7960_REN_PIN, 0);
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL_ISR(&motion_lock);
+    if (current_state != MOTOR_STATE_STOPPED) {
+        previous_state = current_state;
+        change_us = now_us;
+    }
     current_state = MOTOR_STATE_STOPPED;
+    portEXIT_CRITICAL_ISR(&motion_lock);
 }
 
 void motor_set_speed(uint8_t speed_percent)
 {
     if (speed_percent > 100) speed_percent = 100;
     current_speed = (255 * speed_percent) / 100;
-    ESP_LOGI(TAG, "Motor speed set to %d%% (duty %d)", speed_percent, current_speed);
+    DLOGI(TAG, "Motor speed set to %d%% (duty %d)", speed_percent, current_speed);
 }
 
 motor_state_t motor_get_state(void)
@@ -109,11 +166,42 @@ motor_state_t motor_get_state(void)
     return current_state;
 }
 
+// One consistent snapshot: the 64-bit time is not read atomically on its own
+void motor_get_motion(motor_motion_t *out)
+{
+    portENTER_CRITICAL(&motion_lock);
+    *out = (motor_motion_t) {
+        .state = current_state,
+        .previous = previous_state,
+        .duty = change_duty,
+        .change_us = change_us
+    };
+    portEXIT_CRITICAL(&motion_lock);
+}
+
 void motor_forward_fast(void)    { motor_set_speed(100); motor_start_forward(); }
 void motor_backward_fast(void)   { motor_set_speed(100); motor_start_backward(); }
 void motor_forward_medium(void)  { motor_set_speed(60);  motor_start_forward(); }
 void motor_backward_medium(void) { motor_set_speed(60);  motor_start_backward(); }
 
+void motor_self_test(void)
+{
+    ESP_LOGI(TAG, "Testing BTS7960 motor commands...");
+    ESP_LOGI(TAG, "Test 1: Forward command");
+    motor_start_forward();
+    vTaskDelay(pdMS_TO_TICKS(2000));
+    motor_stop();
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    
+    ESP_LOGI(TAG, "Test 2: Backward command");
+    motor_start_backward();
+    vTaskDelay(pdMS_TO_TICKS(2000));
+    motor_stop();
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    
+    ESP_LOGI(TAG, "BTS7960 motor tests completed!");
+}
+
 void motor_check_power(void)
 {
     // Placeholder for future current/voltage sense if HX711 is repurposed
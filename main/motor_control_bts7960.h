@@ -3,6 +3,7 @@
 
 #include "esp_err.h"
 #include "driver/ledc.h"
+#include <stdint.h>
 
 // === BTS7960 Pin Mapping (ESP32-S3 Safe Pins) ===
 #define BTS7960_LPWM_PIN GPIO_NUM_8    // PWM Reverse (L_S)
@@ -23,13 +24,23 @@ typedef enum {
     MOTOR_STATE_BACKWARD
 } motor_state_t;
 
+// Latest change of the commanded motion (load estimator input)
+typedef struct {
+    motor_state_t state;        // Current state
+    motor_state_t previous;     // State before the latest change
+    uint8_t duty;               // PWM duty of the motion that started or ended
+    int64_t change_us;          // esp_timer time of the latest change, 0 if none
+} motor_motion_t;
+
 // === Function Prototypes ===
 esp_err_t motor_control_init(void);
 void motor_start_forward(void);
 void motor_start_backward(void);
 void motor_stop(void);
+void motor_emergency_stop_isr(void);     // Enables off only; call motor_stop() afterwards
 void motor_set_speed(uint8_t speed_percent);
 motor_state_t motor_get_state(void);
+void motor_get_motion(motor_motion_t *out);
 
 // === Predefined Speed Presets ===
 void motor_forward_fast(void);
@@ -37,6 +48,9 @@ void motor_backward_fast(void);
 void motor_forward_medium(void);
 void motor_backward_medium(void);
 
+// === Self-test: 2 s forward, 2 s backward (blocks ~6 s) ===
+void motor_self_test(void);
+
 // === Power Check ===
 void motor_check_power(void);
 
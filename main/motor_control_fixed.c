@@ -9,28 +9,13 @@
  */
 
 #include "motor_control.h"
+#include "modbus_crc.h"
+#include "trace.h"
 #include "driver/uart.h"
 #include "driver/gpio.h"
 #include <stdio.h>
 #include <string.h>
 
-// Modbus RTU CRC-16 calculation
-uint16_t modbus_crc16(const uint8_t *buffer, uint16_t length) {
-    uint16_t crc = 0xFFFF;
-    
-    for (int i = 0; i < length; i++) {
-        crc ^= buffer[i];
-        for (int j = 0; j < 8; j++) {
-            if (crc & 0x0001) {
-                crc = (crc >> 1) ^ 0xA001;
-            } else {
-                crc >>= 1;
-            }
-        }
-    }
-    return crc;
-}
-
 // Send Modbus RTU command to DRI0050
 void send_modbus_cmd(uint8_t dev, uint8_t func, uint16_t reg, uint16_t val) {
     uint8_t frame[8];
@@ -49,7 +34,9 @@ void send_modbus_cmd(uint8_t dev, uint8_t func, uint16_t reg, uint16_t val) {
     frame[7] = crc >> 8;      // CRC High byte
     
     // Send frame via UART
+    TRACE_BEGIN("modbus_tx");
     uart_write_bytes(MOTOR_UART_NUM, (const char*)frame, 8);
+    TRACE_END("modbus_tx");
     
     // Debug output
     printf("Sent Modbus frame: ");
@@ -11,6 +11,7 @@
 #include <stdint.h>
 #include "driver/uart.h"
 #include "driver/gpio.h"
+#include "modbus_crc.h"
 
 // UART Configuration
 #define MOTOR_UART_NUM UART_NUM_1
@@ -40,14 +41,6 @@
 
 // Function Declarations
 
-/**
- * @brief Calculate Modbus RTU CRC-16 checksum
- * @param buffer Data buffer
- * @param length Buffer length
- * @return CRC-16 checksum
- */
-uint16_t modbus_crc16(const uint8_t *buffer, uint16_t length);
-
 /**
  * @brief Send Modbus RTU command to motor driver
  * @param dev Device address
@@ -0,0 +1,516 @@
+#include "sample_log.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Flash writes may block for tens of ms (sector erase), so the lock is a
+// mutex rather than a spinlock: a flash operation must not run inside a
+// critical section.
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+static SemaphoreHandle_t log_mutex = NULL;
+#define LOG_LOCK()   xSemaphoreTake(log_mutex, portMAX_DELAY)
+#define LOG_UNLOCK() xSemaphoreGive(log_mutex)
+#else
+#include <pthread.h>
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define LOG_LOCK()   pthread_mutex_lock(&log_mutex)
+#define LOG_UNLOCK() pthread_mutex_unlock(&log_mutex)
+#endif
+
+static const char *TAG = "SAMPLE_LOG";
+
+#define BLOCKS_PER_SECTOR (SAMPLE_LOG_SECTOR_SIZE / SAMPLE_LOG_BLOCK_SIZE)
+
+static const esp_partition_t *partition = NULL;
+static uint32_t capacity = 0;       // Blocks in the partition (whole sectors)
+static uint32_t head = 0;           // Slot the next block is written to
+
+// Block being filled (only touched with log_mutex held)
+static uint8_t block[SAMPLE_LOG_BLOCK_SIZE];
+static size_t block_len = 0;
+static uint16_t block_count = 0;    // 0: no block open
+static int64_t block_t0_ms;
+static float cal_scale = 1.0f;
+static int32_t cal_offset = 0;
+
+// Encoder state
+static int64_t last_t_ms;
+static int32_t last_raw;
+static uint8_t last_state;
+static int32_t last_dt;
+
+static sample_log_stats_t stats;
+
+static size_t put_varint(uint8_t *p, uint32_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static size_t get_varint(const uint8_t *p, size_t len, uint32_t *out)
+{
+    uint32_t v = 0;
+    for (size_t n = 0; n < len && n < 5; n++) {
+        v |= (uint32_t)(p[n] & 0x7F) << (7 * n);
+        if (!(p[n] & 0x80)) {
+            *out = v;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+static uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+static uint32_t block_crc(const uint8_t *b, size_t payload_len)
+{
+    uint32_t crc = esp_rom_crc32_le(0, b, 32);
+    return esp_rom_crc32_le(crc, b + SAMPLE_LOG_HEADER_SIZE, (uint32_t)payload_len);
+}
+
+// Fill in count, payload length and CRC of an open block (in place or a copy)
+static void finalize(uint8_t *b, size_t len, uint16_t count)
+{
+    size_t payload_len = len - SAMPLE_LOG_HEADER_SIZE;
+    put_u16(b + 10, count);
+    put_u16(b + 28, (uint16_t)payload_len);
+    put_u32(b + 32, block_crc(b, payload_len));
+}
+
+static bool slot_erased(uint32_t slot, uint8_t *buf)
+{
+    if (esp_partition_read(partition, slot * SAMPLE_LOG_BLOCK_SIZE, buf,
+                           SAMPLE_LOG_BLOCK_SIZE) != ESP_OK) {
+        return false;
+    }
+    for (size_t i = 0; i < SAMPLE_LOG_BLOCK_SIZE; i++) {
+        if (buf[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Read one slot; returns the block length, 0 if it holds no valid block
+static size_t read_slot(uint32_t slot, uint8_t *buf)
+{
+    if (esp_partition_read(partition, slot * SAMPLE_LOG_BLOCK_SIZE, buf,
+                           SAMPLE_LOG_BLOCK_SIZE) != ESP_OK) {
+        return 0;
+    }
+    return sample_log_block_valid(buf, SAMPLE_LOG_BLOCK_SIZE);
+}
+
+// Write the open block to the head slot. The first block of a sector
+// erases the sector first: ~45 ms on a 4 KB sector (once every
+// BLOCKS_PER_SECTOR blocks), during which the flash cache is off on both
+// cores. It runs on the sampler task; the control task keeps running from
+// IRAM only if its code is there, so keep blocks large and erases rare.
+static void write_block(void)
+{
+    finalize(block, block_len, block_count);
+
+    uint32_t offset = head * SAMPLE_LOG_BLOCK_SIZE;
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = ESP_OK;
+    if (offset % SAMPLE_LOG_SECTOR_SIZE == 0) {
+        err = esp_partition_erase_range(partition, offset, SAMPLE_LOG_SECTOR_SIZE);
+        stats.sectors_erased++;
+        // The oldest sector's blocks are gone
+        if (stats.used_blocks > capacity - BLOCKS_PER_SECTOR) {
+            stats.used_blocks = capacity - BLOCKS_PER_SECTOR;
+        }
+    }
+    if (err == ESP_OK) {
+        // Unused tail stays 0xFF, so the whole slot is one aligned write
+        err = esp_partition_write(partition, offset, block, SAMPLE_LOG_BLOCK_SIZE);
+    }
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+    if (elapsed > stats.write_us_max) {
+        stats.write_us_max = elapsed;
+    }
+
+    if (err == ESP_OK) {
+        stats.blocks_written++;
+        stats.used_blocks++;
+    } else {
+        // Skip the slot; the next lap erases it again
+        stats.write_errors++;
+        ESP_LOGW(TAG, "⚠️  Block %lu write failed: %s",
+                 (unsigned long)stats.seq, esp_err_to_name(err));
+    }
+    stats.seq++;
+    head = (head + 1) % capacity;
+    block_count = 0;
+}
+
+static void start_block(int64_t t_ms, int32_t raw, uint8_t state)
+{
+    memset(block, 0xFF, sizeof(block));
+    block[0] = SAMPLE_LOG_MAGIC_0;
+    block[1] = SAMPLE_LOG_MAGIC_1;
+    block[2] = SAMPLE_LOG_VERSION;
+    block[3] = state;
+    put_u32(block + 4, stats.seq);
+    put_u16(block + 8, stats.boot);
+    put_u32(block + 12, (uint32_t)t_ms);
+    put_u32(block + 16, (uint32_t)raw);
+    uint32_t scale_bits;
+    memcpy(&scale_bits, &cal_scale, sizeof(scale_bits));
+    put_u32(block + 20, scale_bits);
+    put_u32(block + 24, (uint32_t)cal_offset);
+    put_u16(block + 30, (uint16_t)(last_dt < 0 ? 0 : last_dt > 0xFFFF ? 0xFFFF : last_dt));
+    block_len = SAMPLE_LOG_HEADER_SIZE;
+    block_count = 1;
+    block_t0_ms = t_ms;
+    stats.payload_bytes += SAMPLE_LOG_HEADER_SIZE;
+}
+
+bool sample_log_init(void)
+{
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                         (esp_partition_subtype_t)SAMPLE_LOG_PARTITION_SUBTYPE,
+                                         SAMPLE_LOG_PARTITION_LABEL);
+    if (partition == NULL) {
+        ESP_LOGW(TAG, "⚠️  No '%s' partition - sample log disabled", SAMPLE_LOG_PARTITION_LABEL);
+        return false;
+    }
+    capacity = (partition->size / SAMPLE_LOG_SECTOR_SIZE) * BLOCKS_PER_SECTOR;
+    if (capacity < 2 * BLOCKS_PER_SECTOR) {
+        ESP_LOGW(TAG, "⚠️  '%s' partition too small - sample log disabled", SAMPLE_LOG_PARTITION_LABEL);
+        partition = NULL;
+        return false;
+    }
+#ifdef ESP_PLATFORM
+    if (log_mutex == NULL) {
+        log_mutex = xSemaphoreCreateMutex();
+    }
+#endif
+
+    uint8_t *buf = malloc(SAMPLE_LOG_BLOCK_SIZE);
+    if (buf == NULL) {
+        partition = NULL;
+        return false;
+    }
+
+    // Sectors are filled in order, so the newest block is in the sector
+    // whose first block has the highest sequence number: one read per
+    // sector, then one per block of that sector
+    int64_t start = esp_timer_get_time();
+    uint32_t sectors = capacity / BLOCKS_PER_SECTOR;
+    bool found = false;
+    uint32_t newest_sector = 0;
+    uint32_t newest_seq = 0;
+    for (uint32_t s = 0; s < sectors; s++) {
+        if (read_slot(s * BLOCKS_PER_SECTOR, buf) == 0) {
+            continue;
+        }
+        uint32_t seq = get_u32(buf + 4);
+        if (!found || seq > newest_seq) {
+            found = true;
+            newest_sector = s;
+            newest_seq = seq;
+        }
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    head = 0;
+    block_count = 0;
+    last_dt = 0;
+    if (found) {
+        uint32_t newest = newest_sector * BLOCKS_PER_SECTOR;
+        uint16_t boot = 0;
+        for (uint32_t k = 0; k < BLOCKS_PER_SECTOR; k++) {
+            uint32_t slot = newest_sector * BLOCKS_PER_SECTOR + k;
+            if (read_slot(slot, buf) == 0 || get_u32(buf + 4) < newest_seq) {
+                continue;
+            }
+            newest = slot;
+            newest_seq = get_u32(buf + 4);
+            boot = get_u16(buf + 8);
+        }
+        stats.seq = newest_seq + 1;
+        stats.boot = (uint16_t)(boot + 1);
+
+        // Torn or stray data after the newest block cannot be programmed
+        // over; skip to the next erased slot (or the next sector)
+        head = (newest + 1) % capacity;
+        while (head % BLOCKS_PER_SECTOR != 0 && !slot_erased(head, buf)) {
+            head = (head + 1) % capacity;
+        }
+
+        // Wrapped if the sector after the newest one holds a block
+        uint32_t next_sector = (newest_sector + 1) % sectors;
+        bool wrapped = read_slot(next_sector * BLOCKS_PER_SECTOR, buf) != 0;
+        stats.used_blocks = wrapped ? capacity - (BLOCKS_PER_SECTOR - 1 - newest % BLOCKS_PER_SECTOR)
+                                    : newest + 1;
+    }
+    free(buf);
+
+    stats.capacity_blocks = capacity;
+    stats.ready = true;
+    ESP_LOGI(TAG, "📒 Sample log: %lu/%lu blocks used, boot %u, next block %lu (scan %lld ms)",
+             (unsigned long)stats.used_blocks, (unsigned long)capacity, stats.boot,
+             (unsigned long)stats.seq, (long long)((esp_timer_get_time() - start) / 1000));
+    return true;
+}
+
+bool sample_log_ready(void)
+{
+    return partition != NULL;
+}
+
+void sample_log_set_calibration(float scale, int32_t offset)
+{
+    if (partition == NULL) {
+        return;
+    }
+    LOG_LOCK();
+    if (scale != cal_scale || offset != cal_offset) {
+        if (block_count > 0) {
+            write_block();
+            stats.partial_blocks++;
+        }
+        cal_scale = scale;
+        cal_offset = offset;
+    }
+    LOG_UNLOCK();
+}
+
+void sample_log_add(int64_t t_ms, int32_t raw, uint8_t state)
+{
+    if (partition == NULL) {
+        return;
+    }
+    LOG_LOCK();
+    if (block_count == 0) {
+        if (stats.samples > 0) {
+            last_dt = (int32_t)(t_ms - last_t_ms);
+        }
+        start_block(t_ms, raw, state);
+    } else {
+        int32_t dt = (int32_t)(t_ms - last_t_ms);
+        int32_t ddt = dt - last_dt;
+        uint8_t entry[SAMPLE_LOG_ENTRY_MAX];
+        uint32_t head_bits = zigzag((int32_t)((uint32_t)raw - (uint32_t)last_raw)) << 2;
+        if (ddt != 0) {
+            head_bits |= 2;
+        }
+        if (state != last_state) {
+            head_bits |= 1;
+        }
+        size_t n = put_varint(entry, head_bits);
+        if (ddt != 0) {
+            n += put_varint(entry + n, zigzag(ddt));
+        }
+        if (state != last_state) {
+            entry[n++] = state;
+        }
+
+        last_dt = dt;
+        if (block_len + n > SAMPLE_LOG_BLOCK_SIZE) {
+            // Full: the sample opens the next block instead
+            write_block();
+            start_block(t_ms, raw, state);
+        } else {
+            memcpy(block + block_len, entry, n);
+            block_len += n;
+            block_count++;
+            stats.payload_bytes += n;
+        }
+    }
+    last_t_ms = t_ms;
+    last_raw = raw;
+    last_state = state;
+    stats.samples++;
+
+    if (t_ms - block_t0_ms >= SAMPLE_LOG_FLUSH_MS) {
+        write_block();
+        stats.partial_blocks++;
+    }
+    LOG_UNLOCK();
+}
+
+void sample_log_flush(void)
+{
+    if (partition == NULL) {
+        return;
+    }
+    LOG_LOCK();
+    if (block_count > 0) {
+        write_block();
+        stats.partial_blocks++;
+    }
+    LOG_UNLOCK();
+}
+
+size_t sample_log_read(size_t max_blocks,
+                       bool (*emit)(void *ctx, const uint8_t *block, size_t len), void *ctx)
+{
+    if (partition == NULL) {
+        return 0;
+    }
+    uint8_t *buf = malloc(SAMPLE_LOG_BLOCK_SIZE);
+    if (buf == NULL) {
+        return 0;
+    }
+
+    LOG_LOCK();
+    uint32_t first_new_seq = stats.seq;
+    uint32_t n = stats.used_blocks;
+    uint32_t end = head;
+    LOG_UNLOCK();
+    if (max_blocks > 0 && max_blocks < n) {
+        n = (uint32_t)max_blocks;
+    }
+
+    // Blocks written while the download runs overwrite the oldest slots;
+    // those (seq >= first_new_seq) are skipped to keep the stream ordered
+    size_t emitted = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t slot = (end + capacity - n + i) % capacity;
+        LOG_LOCK();
+        size_t len = read_slot(slot, buf);
+        LOG_UNLOCK();
+        if (len == 0 || get_u32(buf + 4) >= first_new_seq) {
+            continue;
+        }
+        if (!emit(ctx, buf, len)) {
+            free(buf);
+            return emitted;
+        }
+        emitted++;
+    }
+
+    // The block still in RAM, finalized in a copy
+    size_t len = 0;
+    LOG_LOCK();
+    if (block_count > 0 && get_u32(block + 4) == first_new_seq) {
+        memcpy(buf, block, block_len);
+        len = block_len;
+        finalize(buf, len, block_count);
+    }
+    LOG_UNLOCK();
+    if (len > 0 && emit(ctx, buf, len)) {
+        emitted++;
+    }
+    free(buf);
+    return emitted;
+}
+
+void sample_log_get_stats(sample_log_stats_t *out)
+{
+    if (partition == NULL) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    LOG_LOCK();
+    *out = stats;
+    LOG_UNLOCK();
+}
+
+size_t sample_log_block_valid(const uint8_t *buf, size_t len)
+{
+    if (len < SAMPLE_LOG_HEADER_SIZE || buf[0] != SAMPLE_LOG_MAGIC_0 ||
+        buf[1] != SAMPLE_LOG_MAGIC_1 || buf[2] != SAMPLE_LOG_VERSION) {
+        return 0;
+    }
+    size_t payload_len = get_u16(buf + 28);
+    size_t total = SAMPLE_LOG_HEADER_SIZE + payload_len;
+    if (total > SAMPLE_LOG_BLOCK_SIZE || total > len || get_u16(buf + 10) == 0) {
+        return 0;
+    }
+    if (block_crc(buf, payload_len) != get_u32(buf + 32)) {
+        return 0;
+    }
+    return total;
+}
+
+size_t sample_log_decode(const uint8_t *buf, size_t len,
+                         void (*fn)(void *ctx, const sample_log_entry_t *e), void *ctx)
+{
+    size_t total = sample_log_block_valid(buf, len);
+    if (total == 0) {
+        return 0;
+    }
+    sample_log_entry_t e;
+    uint32_t scale_bits = get_u32(buf + 20);
+    memcpy(&e.scale, &scale_bits, sizeof(e.scale));
+    e.seq = get_u32(buf + 4);
+    e.boot = get_u16(buf + 8);
+    e.offset = (int32_t)get_u32(buf + 24);
+    e.t_ms = get_u32(buf + 12);
+    e.raw = (int32_t)get_u32(buf + 16);
+    e.state = buf[3];
+    int32_t dt = get_u16(buf + 30);
+    uint16_t count = get_u16(buf + 10);
+    fn(ctx, &e);
+
+    size_t pos = SAMPLE_LOG_HEADER_SIZE;
+    for (uint16_t i = 1; i < count; i++) {
+        uint32_t v, ddt;
+        size_t n = get_varint(buf + pos, total - pos, &v);
+        if (n == 0) {
+            return 0;
+        }
+        pos += n;
+        if (v & 2) {
+            n = get_varint(buf + pos, total - pos, &ddt);
+            if (n == 0) {
+                return 0;
+            }
+            pos += n;
+            dt += unzigzag(ddt);
+        }
+        if (v & 1) {
+            if (pos >= total) {
+                return 0;
+            }
+            e.state = buf[pos++];
+        }
+        e.raw = (int32_t)((uint32_t)e.raw + (uint32_t)unzigzag(v >> 2));
+        e.t_ms += dt;
+        fn(ctx, &e);
+    }
+    return pos == total ? total : 0;
+}
@@ -0,0 +1,124 @@
+#ifndef SAMPLE_LOG_H
+#define SAMPLE_LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Long-term sample log on the raw "samplelog" flash partition
+// (partitions.csv): every published sample (raw HX711 value, calibration,
+// motor state), kept for days for post-mortem analysis. Download it from
+// GET /api/log and decode it with sample_log.py.
+//
+// Samples are delta encoded into a block in RAM; a full block (or one
+// older than SAMPLE_LOG_FLUSH_MS) is written with one page-aligned flash
+// write. Blocks go round the partition as a circular log, so every sector
+// is erased once per lap (wear leveling without a file system) and the
+// oldest sector is erased just before it is overwritten. A power cut
+// loses at most the block in RAM; a torn write fails its CRC and is
+// skipped.
+//
+// Block format, version 1 (little-endian):
+//
+//   offset size  field
+//   0      2     magic 'S','L'
+//   2      1     version (1)
+//   3      1     state of the first sample (SAMPLE_LOG_STATE_*)
+//   4      4     sequence number (+1 per block, survives reboots)
+//   8      2     boot number (+1 per boot)
+//   10     2     samples in the block, first one included
+//   12     4     time of the first sample, ms since boot
+//   16     4     raw value of the first sample
+//   20     4     calibration factor (float) for the whole block
+//   24     4     offset (raw counts) for the whole block
+//   28     2     payload length
+//   30     2     interval before the first sample, ms (base of dt deltas)
+//   32     4     CRC32 of bytes 0-31 and the payload
+//   36     ...   payload: one entry per further sample
+//
+//   entry:  varint (zigzag(raw delta) << 2 | dt_changed << 1 | state_changed)
+//           [zz-varint dt delta, ms]  if dt_changed (dt = previous dt + delta)
+//           [u8 state]                if state_changed
+//
+// At a steady sample rate and HX711 noise an entry is 2 bytes. A
+// calibration change (tare, new scale) closes the block.
+
+#define SAMPLE_LOG_PARTITION_LABEL   "samplelog"
+#define SAMPLE_LOG_PARTITION_SUBTYPE 0x40    // Custom data subtype (partitions.csv)
+
+#define SAMPLE_LOG_MAGIC_0 'S'
+#define SAMPLE_LOG_MAGIC_1 'L'
+#define SAMPLE_LOG_VERSION 1
+#define SAMPLE_LOG_HEADER_SIZE 36
+#define SAMPLE_LOG_BLOCK_SIZE 512       // Two 256-byte flash pages, one write
+#define SAMPLE_LOG_SECTOR_SIZE 4096     // Flash erase unit
+#define SAMPLE_LOG_ENTRY_MAX 11         // Worst-case encoded entry
+#define SAMPLE_LOG_FLUSH_MS 300000      // Write a partial block after 5 minutes
+
+// State byte
+#define SAMPLE_LOG_STATE_MOTOR_MASK 0x03    // motor_state_t
+#define SAMPLE_LOG_STATE_TRIGGERED  0x04    // Auto trip in progress
+#define SAMPLE_LOG_STATE_AUTO_MODE  0x08
+#define SAMPLE_LOG_STATE_SENSOR_OK  0x10    // HX711 was ready
+
+// Find the partition and the newest block (for the sequence and boot
+// numbers). Without the partition the log stays disabled and the other
+// calls do nothing.
+bool sample_log_init(void);
+
+bool sample_log_ready(void);
+
+// Calibration of the following samples (closes the block if it changed)
+void sample_log_set_calibration(float scale, int32_t offset);
+
+// Append one sample; writes the block to flash when it fills up
+void sample_log_add(int64_t t_ms, int32_t raw, uint8_t state);
+
+// Write the block in RAM now (partial block)
+void sample_log_flush(void);
+
+// Stream the log oldest first: up to max_blocks of the newest blocks
+// (0 = all) followed by the block in RAM. emit gets one encoded block at a
+// time (header + payload); returning false stops. Returns the number of
+// blocks emitted. Reads flash, so run it off the httpd task.
+size_t sample_log_read(size_t max_blocks,
+                       bool (*emit)(void *ctx, const uint8_t *block, size_t len), void *ctx);
+
+typedef struct {
+    bool ready;
+    uint32_t capacity_blocks;
+    uint32_t used_blocks;           // Valid blocks in flash
+    uint32_t seq;                   // Sequence number of the block in RAM
+    uint16_t boot;
+    uint32_t samples;               // Logged since boot
+    uint32_t payload_bytes;         // Encoded bytes of those samples (headers included)
+    uint32_t blocks_written;
+    uint32_t partial_blocks;        // Written before they were full
+    uint32_t sectors_erased;
+    uint32_t write_errors;
+    uint32_t write_us_max;          // Slowest block write, erase included
+} sample_log_stats_t;
+
+void sample_log_get_stats(sample_log_stats_t *out);
+
+// Decoding (host benchmark, tools)
+typedef struct {
+    uint32_t seq;
+    uint16_t boot;
+    int64_t t_ms;
+    int32_t raw;
+    uint8_t state;
+    float scale;
+    int32_t offset;
+} sample_log_entry_t;
+
+// Check one block (magic, version, length, CRC); returns its encoded
+// length, 0 if buf does not start with a valid block
+size_t sample_log_block_valid(const uint8_t *buf, size_t len);
+
+// Decode one block, calling fn per sample; returns the encoded length
+// (0 if invalid)
+size_t sample_log_decode(const uint8_t *buf, size_t len,
+                         void (*fn)(void *ctx, const sample_log_entry_t *e), void *ctx);
+
+#endif // SAMPLE_LOG_H
@@ -0,0 +1,416 @@
+#include "serial_telemetry.h"
+#include "modbus_crc.h"
+#include "motor_control_bts7960.h"
+#include "shared_state.h"
+#include "driver/uart.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_idf_version.h"
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0)
+#include "driver/uart_vfs.h"
+#define console_use_driver(port) uart_vfs_dev_use_driver(port)
+#else
+#include "esp_vfs_dev.h"
+#define console_use_driver(port) esp_vfs_dev_uart_use_driver(port)
+#endif
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+#define STATS_LOCK()   portENTER_CRITICAL(&stats_lock)
+#define STATS_UNLOCK() portEXIT_CRITICAL(&stats_lock)
+#else
+#include <pthread.h>
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+#define STATS_LOCK()   pthread_mutex_lock(&stats_lock)
+#define STATS_UNLOCK() pthread_mutex_unlock(&stats_lock)
+#endif
+
+static const char *TAG = "SERIAL_TLM";
+
+// Queue entry: a sample or an event
+typedef struct {
+    uint8_t type;                   // SERIAL_FRAME_TELEMETRY or SERIAL_FRAME_EVENT
+    union {
+        telemetry_sample_t sample;
+        struct {
+            uint32_t t_ms;
+            int32_t arg;
+            uint8_t code;
+            char text[SERIAL_TELEMETRY_TEXT_MAX];
+        } event;
+    };
+} serial_item_t;
+
+static QueueHandle_t queue = NULL;
+static volatile bool streaming = false;
+static serial_telemetry_stats_t stats;
+
+// Sender task state
+static uint16_t seq = 0;
+static uint8_t frame[SERIAL_TELEMETRY_FRAME_MAX];
+static uint8_t wire[SERIAL_TELEMETRY_WIRE_MAX];
+static uint8_t payload[SERIAL_TELEMETRY_PAYLOAD_MAX];
+static bool motor_sent = false;
+static uint8_t last_motor_state;
+static uint8_t last_motor_flags;
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+size_t serial_telemetry_cobs_encode(const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t code_pos = 0;
+    size_t o = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[code_pos] = code;
+            code_pos = o++;
+            code = 1;
+            continue;
+        }
+        out[o++] = in[i];
+        if (++code == 0xFF) {
+            out[code_pos] = code;
+            code_pos = o++;
+            code = 1;
+        }
+    }
+    out[code_pos] = code;
+    return o;
+}
+
+size_t serial_telemetry_cobs_decode(const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t i = 0;
+    size_t o = 0;
+    while (i < len) {
+        uint8_t code = in[i++];
+        if (code == 0) {
+            return 0;
+        }
+        for (uint8_t k = 1; k < code; k++) {
+            if (i >= len || in[i] == 0) {
+                return 0;
+            }
+            out[o++] = in[i++];
+        }
+        if (code != 0xFF && i < len) {
+            out[o++] = 0;
+        }
+    }
+    return o;
+}
+
+size_t serial_telemetry_frame_build(uint8_t *out, size_t cap, uint8_t type, uint16_t seq_no,
+                                    uint32_t t_ms, const uint8_t *data, size_t len)
+{
+    size_t total = SERIAL_TELEMETRY_HEADER_SIZE + len + 2;
+    if (total > cap) {
+        return 0;
+    }
+    out[0] = type;
+    put_u16(out + 1, seq_no);
+    put_u32(out + 3, t_ms);
+    if (len > 0) {
+        memcpy(out + SERIAL_TELEMETRY_HEADER_SIZE, data, len);
+    }
+    put_u16(out + total - 2, modbus_crc16(out, (uint16_t)(total - 2)));
+    return total;
+}
+
+bool serial_telemetry_frame_parse(const uint8_t *buf, size_t len, serial_frame_t *out)
+{
+    if (len < SERIAL_TELEMETRY_HEADER_SIZE + 2 ||
+        modbus_crc16(buf, (uint16_t)(len - 2)) != get_u16(buf + len - 2)) {
+        return false;
+    }
+    out->type = buf[0];
+    out->seq = get_u16(buf + 1);
+    out->t_ms = get_u32(buf + 3);
+    out->payload = buf + SERIAL_TELEMETRY_HEADER_SIZE;
+    out->len = len - SERIAL_TELEMETRY_HEADER_SIZE - 2;
+    return true;
+}
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+// Frame, COBS, delimiters, one UART write (blocks while the TX ring is full)
+static void send_frame(uint8_t type, uint32_t t_ms, const uint8_t *data, size_t len)
+{
+    size_t n = serial_telemetry_frame_build(frame, sizeof(frame), type, seq, t_ms, data, len);
+    if (n == 0) {
+        return;
+    }
+    size_t w = 0;
+    wire[w++] = 0;
+    w += serial_telemetry_cobs_encode(frame, n, wire + w);
+    wire[w++] = 0;
+    uart_write_bytes(SERIAL_TELEMETRY_UART, wire, w);
+    seq++;
+    STATS_LOCK();
+    stats.frames_sent++;
+    stats.bytes_sent += (uint32_t)w;
+    STATS_UNLOCK();
+}
+
+static void send_stats(void)
+{
+    serial_telemetry_stats_t s;
+    serial_telemetry_get_stats(&s);
+    uint8_t p[20];
+    put_u32(p, s.frames_sent);
+    put_u32(p + 4, s.bytes_sent);
+    put_u32(p + 8, s.samples_sent);
+    put_u32(p + 12, s.samples_dropped);
+    put_u32(p + 16, s.events_dropped);
+    send_frame(SERIAL_FRAME_STATS, now_ms(), p, sizeof(p));
+}
+
+static void send_event(const serial_item_t *item)
+{
+    size_t text_len = strnlen(item->event.text, SERIAL_TELEMETRY_TEXT_MAX);
+    payload[0] = item->event.code;
+    put_u32(payload + 1, (uint32_t)item->event.arg);
+    memcpy(payload + 5, item->event.text, text_len);
+    send_frame(SERIAL_FRAME_EVENT, item->event.t_ms, payload, 5 + text_len);
+}
+
+// Send the sample in item together with every sample already queued behind
+// it (one TELEMETRY frame). Returns true with *next filled if a non-sample
+// item (or a sample that did not fit) was taken from the queue.
+static bool send_samples(const serial_item_t *item, serial_item_t *next)
+{
+    telemetry_encoder_t enc;
+    telemetry_encoder_begin(&enc, payload, sizeof(payload), seq, item->sample.t_ms);
+    telemetry_encoder_add(&enc, &item->sample);
+    uint32_t count = 1;
+    bool have_next = false;
+    while (xQueueReceive(queue, next, 0) == pdTRUE) {
+        if (next->type != SERIAL_FRAME_TELEMETRY || !telemetry_encoder_add(&enc, &next->sample)) {
+            have_next = true;
+            break;
+        }
+        count++;
+    }
+    send_frame(SERIAL_FRAME_TELEMETRY, now_ms(), payload, telemetry_encoder_finish(&enc));
+    STATS_LOCK();
+    stats.samples_sent += count;
+    STATS_UNLOCK();
+    return have_next;
+}
+
+// Motor state is polled rather than hooked into every place that drives
+// the motor; a change shows up within SERIAL_TELEMETRY_POLL_MS
+static void poll_motor(void)
+{
+    elevator_state_t es;
+    shared_state_read(&es);
+    uint8_t state = (uint8_t)motor_get_state();
+    uint8_t flags = (es.motor_triggered ? SERIAL_MOTOR_TRIGGERED : 0) |
+                    (es.auto_mode ? SERIAL_MOTOR_AUTO_MODE : 0);
+    if (motor_sent && state == last_motor_state && flags == last_motor_flags) {
+        return;
+    }
+    uint8_t p[2] = { state, flags };
+    send_frame(SERIAL_FRAME_MOTOR, now_ms(), p, sizeof(p));
+    motor_sent = true;
+    last_motor_state = state;
+    last_motor_flags = flags;
+}
+
+// Host -> device: 0x00-delimited COBS frames, only CONTROL is understood
+static void poll_rx(TickType_t wait)
+{
+    static uint8_t acc[32];
+    static size_t acc_len = 0;
+    static bool overflow = false;
+    uint8_t buf[32];
+    int n = uart_read_bytes(SERIAL_TELEMETRY_UART, buf, sizeof(buf), wait);
+    for (int i = 0; i < n; i++) {
+        if (buf[i] != 0) {
+            if (acc_len < sizeof(acc)) {
+                acc[acc_len++] = buf[i];
+            } else {
+                overflow = true;
+            }
+            continue;
+        }
+        if (acc_len == 0) {
+            continue;
+        }
+        uint8_t decoded[sizeof(acc)];
+        serial_frame_t f;
+        size_t len = overflow ? 0 : serial_telemetry_cobs_decode(acc, acc_len, decoded);
+        acc_len = 0;
+        overflow = false;
+        if (len == 0 || !serial_telemetry_frame_parse(decoded, len, &f) ||
+            f.type != SERIAL_FRAME_CONTROL || f.len < 1) {
+            STATS_LOCK();
+            stats.rx_errors++;
+            STATS_UNLOCK();
+            continue;
+        }
+        STATS_LOCK();
+        stats.rx_frames++;
+        STATS_UNLOCK();
+        bool start = f.payload[0] != 0;
+        if (start && !streaming) {
+            xQueueReset(queue);
+            motor_sent = false;
+        }
+        streaming = start;
+    }
+}
+
+static void serial_telemetry_task(void *arg)
+{
+    serial_item_t item;
+    bool have_item = false;
+    bool was_streaming = false;
+    int64_t next_stats_us = 0;
+
+    while (1) {
+        if (!streaming) {
+            was_streaming = false;
+            have_item = false;
+            poll_rx(pdMS_TO_TICKS(SERIAL_TELEMETRY_POLL_MS));
+            continue;
+        }
+        poll_rx(0);
+        if (!streaming) {
+            continue;
+        }
+        if (!was_streaming) {
+            was_streaming = true;
+            ESP_LOGI(TAG, "📡 Binary telemetry started");
+            serial_item_t hello = { .type = SERIAL_FRAME_EVENT };
+            hello.event.t_ms = now_ms();
+            hello.event.code = SERIAL_EVENT_STREAM;
+            hello.event.arg = 1;
+            send_event(&hello);
+            next_stats_us = 0;
+        }
+
+        if (!have_item) {
+            have_item = xQueueReceive(queue, &item, pdMS_TO_TICKS(SERIAL_TELEMETRY_POLL_MS)) == pdTRUE;
+        }
+        if (have_item) {
+            if (item.type == SERIAL_FRAME_TELEMETRY) {
+                serial_item_t next;
+                have_item = send_samples(&item, &next);
+                if (have_item) {
+                    item = next;
+                }
+            } else {
+                send_event(&item);
+                have_item = false;
+            }
+        }
+
+        poll_motor();
+        int64_t now = esp_timer_get_time();
+        if (now >= next_stats_us) {
+            send_stats();
+            next_stats_us = now + (int64_t)SERIAL_TELEMETRY_STATS_MS * 1000;
+        }
+    }
+}
+
+void serial_telemetry_start(void)
+{
+    if (queue != NULL) {
+        return;
+    }
+    queue = xQueueCreate(SERIAL_TELEMETRY_QUEUE_LEN, sizeof(serial_item_t));
+    if (queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create telemetry queue");
+        return;
+    }
+    esp_err_t err = uart_driver_install(SERIAL_TELEMETRY_UART, SERIAL_TELEMETRY_RX_BUF,
+                                        SERIAL_TELEMETRY_TX_BUF, 0, NULL, 0);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "UART driver install failed: %s", esp_err_to_name(err));
+        return;
+    }
+#ifdef ESP_PLATFORM
+    // Logs go through the driver too, so a log line and a frame are never
+    // interleaved byte by byte (each is one write under the driver's lock)
+    console_use_driver(SERIAL_TELEMETRY_UART);
+#endif
+    xTaskCreatePinnedToCore(serial_telemetry_task, "serial_tlm", SERIAL_TELEMETRY_TASK_STACK,
+                            NULL, SERIAL_TELEMETRY_TASK_PRIORITY, NULL, SERIAL_TELEMETRY_TASK_CORE);
+    ESP_LOGI(TAG, "Binary telemetry ready on UART%d (send a CONTROL frame to start)",
+             SERIAL_TELEMETRY_UART);
+}
+
+bool serial_telemetry_streaming(void)
+{
+    return streaming;
+}
+
+void serial_telemetry_sample(const telemetry_sample_t *sample)
+{
+    if (!streaming || queue == NULL) {
+        return;
+    }
+    serial_item_t item = { .type = SERIAL_FRAME_TELEMETRY, .sample = *sample };
+    if (xQueueSend(queue, &item, 0) != pdTRUE) {
+        STATS_LOCK();
+        stats.samples_dropped++;
+        STATS_UNLOCK();
+    }
+}
+
+void serial_telemetry_event(uint8_t code, int32_t arg, const char *text)
+{
+    if (!streaming || queue == NULL) {
+        return;
+    }
+    serial_item_t item = { .type = SERIAL_FRAME_EVENT };
+    item.event.t_ms = now_ms();
+    item.event.code = code;
+    item.event.arg = arg;
+    if (text != NULL) {
+        // Not NUL terminated when it fills the field (the frame carries a length)
+        memcpy(item.event.text, text, strnlen(text, sizeof(item.event.text)));
+    }
+    if (xQueueSend(queue, &item, 0) != pdTRUE) {
+        STATS_LOCK();
+        stats.events_dropped++;
+        STATS_UNLOCK();
+    }
+}
+
+void serial_telemetry_get_stats(serial_telemetry_stats_t *out)
+{
+    STATS_LOCK();
+    *out = stats;
+    STATS_UNLOCK();
+}
@@ -0,0 +1,119 @@
+#ifndef SERIAL_TELEMETRY_H
+#define SERIAL_TELEMETRY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "telemetry_codec.h"
+
+// Binary telemetry on the console UART (USB-serial bridge), version 1.
+// Shared with the host tools (serial_telemetry.py) - keep both in sync.
+//
+// Frames are COBS encoded and delimited by 0x00, so they share the port
+// with ESP_LOG text (which never contains 0x00): a reader splits the
+// stream at 0x00 and anything that fails COBS / CRC is log text or a
+// damaged frame. The stream is off until the host sends a CONTROL frame,
+// so idf.py monitor shows plain logs.
+//
+// Frame before COBS (little-endian):
+//
+//   offset size  field
+//   0      1     type (SERIAL_FRAME_*)
+//   1      2     sequence number (+1 per frame sent; a gap = frames lost on the link)
+//   3      4     timestamp, ms since boot
+//   7      ...   payload
+//   end-2  2     CRC-16/MODBUS of all previous bytes
+//
+//   TELEMETRY  telemetry_codec frame: the samples queued since the last frame
+//   MOTOR      u8 motor_state_t | u8 SERIAL_MOTOR_* flags (sent on change)
+//   EVENT      u8 code (SERIAL_EVENT_*) | i32 arg | text (rest, no NUL)
+//   STATS      u32 frames sent | u32 bytes sent | u32 samples sent |
+//              u32 samples dropped | u32 events dropped (every second)
+//   CONTROL    u8 1 = start streaming, 0 = stop (host -> device)
+
+#define SERIAL_TELEMETRY_VERSION 1
+#define SERIAL_TELEMETRY_UART 0                 // UART_NUM_0: console / USB bridge
+#define SERIAL_TELEMETRY_RX_BUF 256
+#define SERIAL_TELEMETRY_TX_BUF 2048            // Driver ring; the task blocks when it is full
+#define SERIAL_TELEMETRY_QUEUE_LEN 64           // Samples/events waiting for the task
+#define SERIAL_TELEMETRY_POLL_MS 50             // Motor state / RX poll period
+#define SERIAL_TELEMETRY_STATS_MS 1000
+#define SERIAL_TELEMETRY_TEXT_MAX 32
+#define SERIAL_TELEMETRY_HEADER_SIZE 7
+#define SERIAL_TELEMETRY_PAYLOAD_MAX 240
+#define SERIAL_TELEMETRY_FRAME_MAX (SERIAL_TELEMETRY_HEADER_SIZE + SERIAL_TELEMETRY_PAYLOAD_MAX + 2)
+// COBS adds one byte per 254, plus the two delimiters
+#define SERIAL_TELEMETRY_WIRE_MAX (SERIAL_TELEMETRY_FRAME_MAX + SERIAL_TELEMETRY_FRAME_MAX / 254 + 3)
+
+#define SERIAL_TELEMETRY_TASK_STACK 3072
+#define SERIAL_TELEMETRY_TASK_PRIORITY 3        // Below network (5), above idle
+#define SERIAL_TELEMETRY_TASK_CORE 0            // Core 1 belongs to the control task
+
+// Frame types
+#define SERIAL_FRAME_TELEMETRY 0x01
+#define SERIAL_FRAME_MOTOR     0x02
+#define SERIAL_FRAME_EVENT     0x03
+#define SERIAL_FRAME_STATS     0x04
+#define SERIAL_FRAME_CONTROL   0x10
+
+// MOTOR flags
+#define SERIAL_MOTOR_TRIGGERED 0x01             // Auto trip in progress
+#define SERIAL_MOTOR_AUTO_MODE 0x02
+
+// Event codes
+#define SERIAL_EVENT_DECISION   1   // arg: control_action_t
+#define SERIAL_EVENT_SENSOR     2   // arg: 0 HX711 not ready
+#define SERIAL_EVENT_TARE       3   // arg: new offset (raw counts)
+#define SERIAL_EVENT_CONFIG     4   // Configuration saved
+#define SERIAL_EVENT_STREAM     5   // arg: 1 stream started
+#define SERIAL_EVENT_DEADLINE   6   // arg: ms late, text: loop name (motor stopped)
+
+// Install the UART driver (console output goes through it too) and start
+// the sender task
+void serial_telemetry_start(void);
+
+bool serial_telemetry_streaming(void);
+
+// Queue a sample / event for the sender task. Never blocks: while the
+// stream is off they are ignored, when the queue is full they are dropped
+// and counted (reported in STATS frames).
+void serial_telemetry_sample(const telemetry_sample_t *sample);
+void serial_telemetry_event(uint8_t code, int32_t arg, const char *text);
+
+typedef struct {
+    uint32_t frames_sent;
+    uint32_t bytes_sent;            // On the wire (COBS + delimiters)
+    uint32_t samples_sent;
+    uint32_t samples_dropped;       // Queue full
+    uint32_t events_dropped;
+    uint32_t rx_frames;             // Valid CONTROL frames from the host
+    uint32_t rx_errors;             // Anything else terminated by 0x00
+} serial_telemetry_stats_t;
+
+void serial_telemetry_get_stats(serial_telemetry_stats_t *out);
+
+// Framing (also used by the host harness)
+
+// COBS: out needs len + len / 254 + 1 bytes; returns the encoded length
+size_t serial_telemetry_cobs_encode(const uint8_t *in, size_t len, uint8_t *out);
+// Decode one frame (without the 0x00 delimiter) into out (len bytes);
+// returns the decoded length, 0 if it is not valid COBS
+size_t serial_telemetry_cobs_decode(const uint8_t *in, size_t len, uint8_t *out);
+
+// Build a frame (header + payload + CRC, before COBS); returns its length,
+// 0 if it does not fit in cap
+size_t serial_telemetry_frame_build(uint8_t *out, size_t cap, uint8_t type, uint16_t seq,
+                                    uint32_t t_ms, const uint8_t *payload, size_t len);
+
+typedef struct {
+    uint8_t type;
+    uint16_t seq;
+    uint32_t t_ms;
+    const uint8_t *payload;         // Points into the decoded frame
+    size_t len;
+} serial_frame_t;
+
+// Check length and CRC of a decoded frame and split it
+bool serial_telemetry_frame_parse(const uint8_t *frame, size_t len, serial_frame_t *out);
+
+#endif // SERIAL_TELEMETRY_H
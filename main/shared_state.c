@@ -0,0 +1,89 @@
+#include "shared_state.h"
+#include <stdatomic.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+static portMUX_TYPE writer_lock = portMUX_INITIALIZER_UNLOCKED;
+#define WRITER_LOCK()   portENTER_CRITICAL(&writer_lock)
+#define WRITER_UNLOCK() portEXIT_CRITICAL(&writer_lock)
+#else
+#include <pthread.h>
+static pthread_mutex_t writer_lock = PTHREAD_MUTEX_INITIALIZER;
+#define WRITER_LOCK()   pthread_mutex_lock(&writer_lock)
+#define WRITER_UNLOCK() pthread_mutex_unlock(&writer_lock)
+#endif
+
+#define STATE_WORDS ((sizeof(elevator_state_t) + sizeof(uint32_t) - 1) / sizeof(uint32_t))
+
+// Sequence counter: odd while a write is in progress
+static atomic_uint seq = 0;
+
+// Published snapshot, stored as atomic words so concurrent copies are well defined
+static atomic_uint words[STATE_WORDS];
+
+// Writer's working copy (only touched with writer_lock held)
+static union {
+    elevator_state_t state;
+    uint32_t words[STATE_WORDS];
+} pending;
+
+static void publish(void)
+{
+    unsigned s = atomic_load_explicit(&seq, memory_order_relaxed);
+    atomic_store_explicit(&seq, s + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    for (size_t i = 0; i < STATE_WORDS; i++) {
+        atomic_store_explicit(&words[i], pending.words[i], memory_order_relaxed);
+    }
+    atomic_store_explicit(&seq, s + 2, memory_order_release);
+}
+
+void shared_state_init(const elevator_state_t *initial)
+{
+    WRITER_LOCK();
+    memset(&pending, 0, sizeof(pending));
+    pending.state = *initial;
+    publish();
+    WRITER_UNLOCK();
+}
+
+void shared_state_read(elevator_state_t *out)
+{
+    union {
+        elevator_state_t state;
+        uint32_t words[STATE_WORDS];
+    } copy;
+    unsigned s1, s2;
+
+    do {
+        s1 = atomic_load_explicit(&seq, memory_order_acquire);
+        if (s1 & 1) {
+            continue;  // Writer active
+        }
+        for (size_t i = 0; i < STATE_WORDS; i++) {
+            copy.words[i] = atomic_load_explicit(&words[i], memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_acquire);
+        s2 = atomic_load_explicit(&seq, memory_order_relaxed);
+    } while ((s1 & 1) || s1 != s2);
+
+    *out = copy.state;
+}
+
+elevator_state_t *shared_state_begin_update(void)
+{
+    WRITER_LOCK();
+    return &pending.state;
+}
+
+void shared_state_end_update(void)
+{
+    publish();
+    WRITER_UNLOCK();
+}
+
+uint32_t shared_state_version(void)
+{
+    return atomic_load_explicit(&seq, memory_order_acquire) / 2;
+}
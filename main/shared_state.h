@@ -0,0 +1,40 @@
+#ifndef SHARED_STATE_H
+#define SHARED_STATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Elevator state shared between the sampling loop, the control logic and
+// the httpd handlers, published through a seqlock.
+//
+// Readers never block and never see a mix of two updates: they copy the
+// snapshot and retry if a writer was active meanwhile. Writers serialize
+// among themselves with a short critical section and never wait for readers.
+
+typedef struct {
+    int64_t sample_ms;       // Time of the latest sample, ms since boot
+    float weight;            // Latest weight, kg
+    float load;              // Motion-compensated load (load_estimator.h), kg
+    long raw;                // Latest raw HX711 reading
+    bool stable;             // false while a stabilization window is running
+    bool auto_mode;          // Auto motor control enabled
+    bool motor_triggered;    // Motor was started (by auto control or manually)
+    float threshold;         // Auto start threshold, kg
+} elevator_state_t;
+
+// Set the initial state (call once before other tasks start)
+void shared_state_init(const elevator_state_t *initial);
+
+// Lock-free consistent snapshot
+void shared_state_read(elevator_state_t *out);
+
+// Writer side: begin returns a private copy of the current state to modify,
+// end publishes it. Keep the code in between short - no logging or blocking
+// (on the ESP32 it runs inside a critical section).
+elevator_state_t *shared_state_begin_update(void);
+void shared_state_end_update(void);
+
+// Number of published updates so far
+uint32_t shared_state_version(void);
+
+#endif // SHARED_STATE_H
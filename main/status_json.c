@@ -0,0 +1,30 @@
+#include "status_json.h"
+#include <stdio.h>
+
+const char *status_motor_name(int motor_state)
+{
+    switch (motor_state) {
+        case 1:  return "forward";   // MOTOR_STATE_FORWARD
+        case 2:  return "backward";  // MOTOR_STATE_BACKWARD
+        default: return "stopped";
+    }
+}
+
+int status_json_format(const system_status_t *s, char *buf, size_t len)
+{
+    return snprintf(buf, len,
+                    "{\"type\":\"status\",\"seq\":%u,\"t\":%lld,"
+                    "\"weight\":%.2f,\"load\":%.2f,\"raw\":%ld,\"status\":\"%s\",\"stable\":%s,"
+                    "\"sensor_ready\":%s,\"motor\":\"%s\",\"auto_mode\":%s,"
+                    "\"threshold\":%.2f,\"wifi\":{\"connected\":%s,\"rssi\":%d},"
+                    "\"uptime_ms\":%lld}",
+                    (unsigned)s->seq, (long long)s->sample_ms,
+                    s->weight, s->load, s->raw, s->stable ? "Stable" : "Calculating...",
+                    s->stable ? "true" : "false",
+                    s->sensor_ready ? "true" : "false",
+                    status_motor_name(s->motor_state),
+                    s->auto_mode ? "true" : "false",
+                    s->threshold,
+                    s->wifi_connected ? "true" : "false", s->rssi,
+                    (long long)s->uptime_ms);
+}
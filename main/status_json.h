@@ -0,0 +1,34 @@
+#ifndef STATUS_JSON_H
+#define STATUS_JSON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Largest serialized status document
+#define STATUS_JSON_MAX 384
+
+// Full system state as served by /api/status and pushed over /ws
+typedef struct {
+    uint32_t seq;            // Incremented on every publish
+    int64_t sample_ms;       // Time of the weight sample, ms since boot
+    float weight;            // kg
+    float load;              // Motion-compensated load the auto control uses, kg
+    long raw;                // Raw HX711 reading
+    bool stable;             // false while a stabilization window is running
+    bool sensor_ready;
+    int motor_state;         // motor_state_t value
+    bool auto_mode;
+    float threshold;         // kg
+    bool wifi_connected;
+    int rssi;                // dBm, 0 when not connected
+    int64_t uptime_ms;
+} system_status_t;
+
+// Name of a motor_state_t value ("stopped", "forward", "backward")
+const char *status_motor_name(int motor_state);
+
+// Serialize status as JSON; returns length (snprintf semantics)
+int status_json_format(const system_status_t *status, char *buf, size_t len);
+
+#endif // STATUS_JSON_H
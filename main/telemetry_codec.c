@@ -0,0 +1,123 @@
+#include "telemetry_codec.h"
+
+static size_t put_varint(uint8_t *p, uint32_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static bool get_varint(const uint8_t *buf, size_t len, size_t *pos, uint32_t *out)
+{
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (*pos >= len) {
+            return false;
+        }
+        uint8_t b = buf[(*pos)++];
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) {
+            *out = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+void telemetry_encoder_begin(telemetry_encoder_t *enc, uint8_t *buf, size_t cap,
+                             uint16_t seq, uint32_t base_t_ms)
+{
+    enc->buf = buf;
+    enc->cap = cap;
+    enc->len = TELEMETRY_HEADER_SIZE;
+    enc->count = 0;
+    enc->last.t_ms = base_t_ms;
+    enc->last.weight_g = 0;
+    enc->last.raw = 0;
+    enc->last.flags = 0;
+
+    buf[0] = TELEMETRY_MAGIC_0;
+    buf[1] = TELEMETRY_MAGIC_1;
+    buf[2] = TELEMETRY_VERSION;
+    buf[3] = 0;
+    buf[4] = (uint8_t)seq;
+    buf[5] = (uint8_t)(seq >> 8);
+    buf[6] = (uint8_t)base_t_ms;
+    buf[7] = (uint8_t)(base_t_ms >> 8);
+    buf[8] = (uint8_t)(base_t_ms >> 16);
+    buf[9] = (uint8_t)(base_t_ms >> 24);
+}
+
+bool telemetry_encoder_add(telemetry_encoder_t *enc, const telemetry_sample_t *s)
+{
+    if (enc->count == TELEMETRY_MAX_SAMPLES ||
+        enc->len + TELEMETRY_SAMPLE_MAX_SIZE > enc->cap) {
+        return false;
+    }
+
+    uint8_t *p = enc->buf + enc->len;
+    size_t n = put_varint(p, s->t_ms - enc->last.t_ms);
+    n += put_varint(p + n, zigzag(s->weight_g - enc->last.weight_g));
+    n += put_varint(p + n, zigzag(s->raw - enc->last.raw));
+    p[n++] = s->flags;
+
+    enc->len += n;
+    enc->count++;
+    enc->last = *s;
+    return true;
+}
+
+size_t telemetry_encoder_finish(telemetry_encoder_t *enc)
+{
+    enc->buf[3] = enc->count;
+    return enc->len;
+}
+
+int telemetry_decode(const uint8_t *buf, size_t len, telemetry_sample_t *out, size_t max,
+                     uint16_t *seq)
+{
+    if (len < TELEMETRY_HEADER_SIZE || buf[0] != TELEMETRY_MAGIC_0 ||
+        buf[1] != TELEMETRY_MAGIC_1 || buf[2] != TELEMETRY_VERSION) {
+        return -1;
+    }
+
+    uint8_t count = buf[3];
+    if (seq) {
+        *seq = (uint16_t)(buf[4] | (buf[5] << 8));
+    }
+    telemetry_sample_t last = {
+        .t_ms = (uint32_t)buf[6] | ((uint32_t)buf[7] << 8) |
+                ((uint32_t)buf[8] << 16) | ((uint32_t)buf[9] << 24),
+    };
+
+    size_t pos = TELEMETRY_HEADER_SIZE;
+    for (uint8_t i = 0; i < count; i++) {
+        uint32_t dt, dw, dr;
+        if (!get_varint(buf, len, &pos, &dt) || !get_varint(buf, len, &pos, &dw) ||
+            !get_varint(buf, len, &pos, &dr) || pos >= len) {
+            return -1;
+        }
+        last.t_ms += dt;
+        last.weight_g += unzigzag(dw);
+        last.raw += unzigzag(dr);
+        last.flags = buf[pos++];
+        if (i < max) {
+            out[i] = last;
+        }
+    }
+    return count < max ? count : (int)max;
+}
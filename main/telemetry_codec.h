@@ -0,0 +1,73 @@
+#ifndef TELEMETRY_CODEC_H
+#define TELEMETRY_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Compact binary telemetry frame, version 1 (little-endian).
+// Shared with the host tools (telemetry_codec.py) - keep both in sync.
+//
+//   offset size  field
+//   0      2     magic 'E','T'
+//   2      1     version (1)
+//   3      1     sample count N
+//   4      2     frame sequence number
+//   6      4     base timestamp, ms since boot (wraps after ~49 days)
+//   10     ...   N samples:
+//                  varint    dt_ms     time since previous sample (first: since base)
+//                  zz-varint d_weight  weight in grams, delta to previous (first: absolute)
+//                  zz-varint d_raw     raw HX711 value, delta to previous (first: absolute)
+//                  u8        flags     TELEMETRY_FLAG_* / motor state in bits 0-1
+//
+// varint = unsigned LEB128; zz-varint = zigzag-mapped signed value in LEB128.
+// A steady 10 SPS stream costs about 5-7 bytes per sample.
+
+#define TELEMETRY_MAGIC_0 'E'
+#define TELEMETRY_MAGIC_1 'T'
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_HEADER_SIZE 10
+#define TELEMETRY_SAMPLE_MAX_SIZE 16   // Worst-case encoded sample
+#define TELEMETRY_MAX_SAMPLES 255
+
+// MIME type for Accept / Content-Type and WebSocket subprotocol name
+#define TELEMETRY_MIME_TYPE "application/x-elevator-telemetry"
+#define TELEMETRY_WS_SUBPROTOCOL "elevator.bin.v1"
+
+// Sample flags (bits 0-1 hold motor_state_t)
+#define TELEMETRY_FLAG_MOTOR_MASK   0x03
+#define TELEMETRY_FLAG_AUTO_MODE    0x04
+#define TELEMETRY_FLAG_STABLE       0x08
+#define TELEMETRY_FLAG_SENSOR_READY 0x10
+
+typedef struct {
+    uint32_t t_ms;       // ms since boot
+    int32_t weight_g;    // grams
+    int32_t raw;         // raw HX711 reading
+    uint8_t flags;
+} telemetry_sample_t;
+
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+    uint8_t count;
+    telemetry_sample_t last;
+} telemetry_encoder_t;
+
+// Start a frame in buf (cap >= TELEMETRY_HEADER_SIZE)
+void telemetry_encoder_begin(telemetry_encoder_t *enc, uint8_t *buf, size_t cap,
+                             uint16_t seq, uint32_t base_t_ms);
+
+// Append a sample; returns false (frame unchanged) when it might not fit
+bool telemetry_encoder_add(telemetry_encoder_t *enc, const telemetry_sample_t *sample);
+
+// Finalize the frame and return its length in bytes
+size_t telemetry_encoder_finish(telemetry_encoder_t *enc);
+
+// Decode a frame into out (up to max samples). Returns the number of samples
+// decoded, or -1 if the frame is malformed or of an unknown version.
+int telemetry_decode(const uint8_t *buf, size_t len, telemetry_sample_t *out, size_t max,
+                     uint16_t *seq);
+
+#endif // TELEMETRY_CODEC_H
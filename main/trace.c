@@ -0,0 +1,184 @@
+#include "trace.h"
+
+#if TRACE_ENABLED
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <time.h>
+#endif
+
+// Each slot carries a sequence stamp: 0 while being written, index + 1
+// once complete. Writers on the same core (task preemption) reserve slots
+// with an atomic increment of head; readers copy a slot and keep it only
+// if the stamp matched before and after the copy.
+typedef struct {
+    atomic_uint seq;
+    trace_event_t ev;
+} trace_slot_t;
+
+typedef struct {
+    atomic_uint head;       // Next index to reserve
+    atomic_uint start;      // First index still visible (trace_clear)
+    trace_slot_t slots[TRACE_RING_LEN];
+} trace_ring_t;
+
+static trace_ring_t rings[TRACE_MAX_CORES];
+static atomic_uint overwritten;
+
+static inline int64_t now_us(void)
+{
+#ifdef ESP_PLATFORM
+    return esp_timer_get_time();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+void trace_record(char phase, const char *name, int32_t arg)
+{
+#ifdef ESP_PLATFORM
+    uint8_t core = (uint8_t)xPortGetCoreID();
+    const char *task = pcTaskGetName(NULL);
+#else
+    uint8_t core = 0;
+    const char *task = "host";
+#endif
+    trace_ring_t *ring = &rings[core % TRACE_MAX_CORES];
+    uint32_t idx = atomic_fetch_add_explicit(&ring->head, 1, memory_order_relaxed);
+    trace_slot_t *slot = &ring->slots[idx % TRACE_RING_LEN];
+
+    atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->ev.ts_us = now_us();
+    slot->ev.name = name;
+    slot->ev.task = task;
+    slot->ev.arg = arg;
+    slot->ev.phase = phase;
+    slot->ev.core = core;
+    atomic_store_explicit(&slot->seq, idx + 1, memory_order_release);
+}
+
+static size_t snapshot_ring(trace_ring_t *ring, trace_event_t *out, size_t max)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t start = atomic_load_explicit(&ring->start, memory_order_relaxed);
+    uint32_t first = head - start > TRACE_RING_LEN ? head - TRACE_RING_LEN : start;
+    size_t n = 0;
+
+    for (uint32_t i = first; i != head && n < max; i++) {
+        trace_slot_t *slot = &ring->slots[i % TRACE_RING_LEN];
+        if (atomic_load_explicit(&slot->seq, memory_order_acquire) != i + 1) {
+            atomic_fetch_add_explicit(&overwritten, 1, memory_order_relaxed);
+            continue;
+        }
+        trace_event_t ev = slot->ev;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != i + 1) {
+            atomic_fetch_add_explicit(&overwritten, 1, memory_order_relaxed);
+            continue;
+        }
+        out[n++] = ev;
+    }
+    return n;
+}
+
+size_t trace_snapshot(trace_event_t *out, size_t max)
+{
+    size_t counts[TRACE_MAX_CORES];
+    size_t n = 0;
+    for (int c = 0; c < TRACE_MAX_CORES; c++) {
+        counts[c] = snapshot_ring(&rings[c], out + n, max - n);
+        n += counts[c];
+    }
+
+    // Merge the per-core runs by timestamp (insertion sort: runs are
+    // already ordered and n <= TRACE_MAX_CORES * TRACE_RING_LEN)
+    for (size_t i = counts[0]; i < n; i++) {
+        trace_event_t ev = out[i];
+        size_t j = i;
+        while (j > 0 && out[j - 1].ts_us > ev.ts_us) {
+            out[j] = out[j - 1];
+            j--;
+        }
+        out[j] = ev;
+    }
+    return n;
+}
+
+void trace_clear(void)
+{
+    for (int c = 0; c < TRACE_MAX_CORES; c++) {
+        atomic_store(&rings[c].start, atomic_load(&rings[c].head));
+    }
+}
+
+uint32_t trace_overwritten(void)
+{
+    return atomic_load_explicit(&overwritten, memory_order_relaxed);
+}
+
+// Chrome trace-event format: pid = core, tid = task (lanes per task)
+static uint32_t task_id(const char *task)
+{
+    uint32_t h = 2166136261u;  // FNV-1a of the name
+    for (const char *p = task; p && *p; p++) {
+        h = (h ^ (uint8_t)*p) * 16777619u;
+    }
+    return h & 0xFFFF;
+}
+
+void trace_render_json(const trace_event_t *events, size_t n, trace_write_fn write, void *ctx)
+{
+    char buf[192];
+    int len = snprintf(buf, sizeof(buf), "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    write(ctx, buf, len);
+
+    for (int c = 0; c < TRACE_MAX_CORES; c++) {
+        len = snprintf(buf, sizeof(buf),
+                       "%s{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"args\":{\"name\":\"core %d\"}}",
+                       c ? "," : "", c, c);
+        write(ctx, buf, len);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        const trace_event_t *ev = &events[i];
+        const char *task = ev->task ? ev->task : "?";
+        len = snprintf(buf, sizeof(buf),
+                       ",{\"ph\":\"%c\",\"name\":\"%s\",\"ts\":%lld,\"pid\":%u,\"tid\":%u%s",
+                       ev->phase, ev->name, (long long)ev->ts_us, (unsigned)ev->core,
+                       (unsigned)task_id(task), ev->phase == 'i' ? ",\"s\":\"t\"" : "");
+        if (len >= (int)sizeof(buf)) {
+            len = sizeof(buf) - 1;
+        }
+        write(ctx, buf, len);
+        len = snprintf(buf, sizeof(buf), ",\"args\":{\"task\":\"%s\",\"arg\":%d}}",
+                       task, (int)ev->arg);
+        write(ctx, buf, len < (int)sizeof(buf) ? len : (int)sizeof(buf) - 1);
+
+        // Name the task lane the first time it shows up on this core
+        bool seen = false;
+        for (size_t j = 0; j < i && !seen; j++) {
+            seen = events[j].core == ev->core && events[j].task == ev->task;
+        }
+        if (!seen) {
+            len = snprintf(buf, sizeof(buf),
+                           ",{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%u,\"tid\":%u,"
+                           "\"args\":{\"name\":\"%s\"}}",
+                           (unsigned)ev->core, (unsigned)task_id(task), task);
+            write(ctx, buf, len < (int)sizeof(buf) ? len : (int)sizeof(buf) - 1);
+        }
+    }
+    write(ctx, "]}", 2);
+}
+
+#endif // TRACE_ENABLED
@@ -0,0 +1,57 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Event tracer: begin/end spans and instant events with esp_timer
+// timestamps, recorded into one lock-free ring per core and exported as
+// Chrome trace-event JSON at /api/trace (chrome://tracing, ui.perfetto.dev).
+//
+// Compiled out unless TRACE_ENABLED is 1 - the TRACE_* macros then expand
+// to nothing. Enable here or with -DTRACE_ENABLED=1.
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 0
+#endif
+
+#define TRACE_RING_LEN 256          // Events kept per core (power of two)
+#define TRACE_MAX_CORES 2
+
+// Event names must be string literals (only the pointer is stored)
+#if TRACE_ENABLED
+#define TRACE_BEGIN(name)         trace_record('B', (name), 0)
+#define TRACE_END(name)           trace_record('E', (name), 0)
+#define TRACE_INSTANT(name, arg)  trace_record('i', (name), (arg))
+#else
+#define TRACE_BEGIN(name)         do { } while (0)
+#define TRACE_END(name)           do { } while (0)
+#define TRACE_INSTANT(name, arg)  do { (void)(arg); } while (0)
+#endif
+
+typedef struct {
+    int64_t ts_us;          // esp_timer_get_time()
+    const char *name;
+    const char *task;       // Recording task name
+    int32_t arg;
+    char phase;             // 'B', 'E' or 'i'
+    uint8_t core;
+} trace_event_t;
+
+// Record one event on the calling core's ring (safe from any task)
+void trace_record(char phase, const char *name, int32_t arg);
+
+// Copy up to max events (oldest first, all cores) recorded since the last
+// trace_clear(); returns the number copied
+size_t trace_snapshot(trace_event_t *out, size_t max);
+
+// Forget everything recorded so far
+void trace_clear(void);
+
+// Events dropped by trace_snapshot() because a ring wrapped while copying
+uint32_t trace_overwritten(void);
+
+// Output sink and renderer for Chrome trace-event JSON
+typedef void (*trace_write_fn)(void *ctx, const char *data, size_t len);
+void trace_render_json(const trace_event_t *events, size_t n, trace_write_fn write, void *ctx);
+
+#endif // TRACE_H
@@ -0,0 +1,192 @@
+#include "warm_state.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include <stddef.h>
+#include <string.h>
+
+static const char *TAG = "WARM_STATE";
+
+#define WARM_MAGIC 0x454C5631  // "ELV1"
+
+typedef struct {
+    uint32_t magic;
+    warm_state_t state;
+    uint32_t crc;            // CRC32 of magic + state
+} warm_block_t;
+
+// Not cleared by the startup code, so it survives resets without power loss
+static RTC_NOINIT_ATTR warm_block_t rtc_block;
+
+static portMUX_TYPE warm_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_reset_reason_t boot_reason = ESP_RST_UNKNOWN;
+static bool resumed = false;
+
+static uint32_t block_crc(const warm_block_t *b)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)b, offsetof(warm_block_t, crc));
+}
+
+// Caller holds warm_lock
+static void block_seal(void)
+{
+    rtc_block.magic = WARM_MAGIC;
+    rtc_block.crc = block_crc(&rtc_block);
+}
+
+static uint32_t faults_for_reason(esp_reset_reason_t reason)
+{
+    switch (reason) {
+        case ESP_RST_BROWNOUT: return WARM_FAULT_BROWNOUT;
+        case ESP_RST_INT_WDT:
+        case ESP_RST_TASK_WDT:
+        case ESP_RST_WDT:      return WARM_FAULT_WATCHDOG;
+        case ESP_RST_PANIC:    return WARM_FAULT_PANIC;
+        default:               return 0;
+    }
+}
+
+// Resets that keep RTC slow memory powered
+static bool reason_is_warm(esp_reset_reason_t reason)
+{
+    return reason == ESP_RST_SW || reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT ||
+           reason == ESP_RST_TASK_WDT || reason == ESP_RST_WDT || reason == ESP_RST_BROWNOUT;
+}
+
+bool warm_state_restore(warm_state_t *out)
+{
+    boot_reason = esp_reset_reason();
+    bool valid = rtc_block.magic == WARM_MAGIC && rtc_block.crc == block_crc(&rtc_block);
+
+    portENTER_CRITICAL(&warm_lock);
+    if (valid && reason_is_warm(boot_reason) &&
+        rtc_block.state.resumes < WARM_MAX_RESUMES &&
+        !(rtc_block.state.faults & WARM_FAULT_RESET_LOOP)) {
+        rtc_block.state.resumes++;
+        rtc_block.state.faults |= faults_for_reason(boot_reason);
+        resumed = true;
+    } else {
+        uint32_t faults = faults_for_reason(boot_reason);
+        if (valid && reason_is_warm(boot_reason)) {
+            // Too many resumes in a row: stop trusting the saved intent
+            // (the latch stays until cleared by a motor reset)
+            faults |= rtc_block.state.faults | WARM_FAULT_RESET_LOOP;
+        }
+        memset(&rtc_block, 0, sizeof(rtc_block));
+        rtc_block.state.faults = faults;
+        resumed = false;
+    }
+    block_seal();
+    *out = rtc_block.state;
+    portEXIT_CRITICAL(&warm_lock);
+
+    if (resumed) {
+        ESP_LOGI(TAG, "♻️  Warm reset (%s): weight=%.2f kg phase=%s resume #%u",
+                 warm_state_reset_reason(), out->last_weight,
+                 warm_trip_phase_name((warm_trip_phase_t)out->trip_phase), (unsigned)out->resumes);
+    } else {
+        ESP_LOGI(TAG, "Cold boot (%s)%s", warm_state_reset_reason(),
+                 (out->faults & WARM_FAULT_RESET_LOOP) ? " - reset loop, saved state discarded" :
+                 valid ? "" : " - no valid RTC state");
+    }
+    return resumed;
+}
+
+bool warm_state_resume_trip(const warm_state_t *warm)
+{
+    return warm->auto_mode &&
+           (warm->trip_phase == WARM_TRIP_RUNNING || warm->trip_phase == WARM_TRIP_STARTING) &&
+           !(warm->faults & WARM_FAULT_NO_RESUME);
+}
+
+void warm_state_get(warm_state_t *out)
+{
+    portENTER_CRITICAL(&warm_lock);
+    *out = rtc_block.state;
+    portEXIT_CRITICAL(&warm_lock);
+}
+
+void warm_state_save_control(float weight, float threshold, bool auto_mode, bool triggered,
+                             uint8_t motor_state, warm_trip_phase_t phase)
+{
+    portENTER_CRITICAL(&warm_lock);
+    warm_state_t *st = &rtc_block.state;
+    st->last_weight = weight;
+    st->threshold = threshold;
+    st->auto_mode = auto_mode;
+    st->motor_triggered = triggered;
+    st->motor_state = motor_state;
+    st->trip_phase = (uint8_t)phase;
+    block_seal();
+    portEXIT_CRITICAL(&warm_lock);
+}
+
+void warm_state_save_offset(int32_t offset)
+{
+    portENTER_CRITICAL(&warm_lock);
+    rtc_block.state.offset = offset;
+    block_seal();
+    portEXIT_CRITICAL(&warm_lock);
+}
+
+void warm_state_latch_fault(uint32_t fault)
+{
+    portENTER_CRITICAL(&warm_lock);
+    bool is_new = (rtc_block.state.faults & fault) != fault;
+    rtc_block.state.faults |= fault;
+    block_seal();
+    portEXIT_CRITICAL(&warm_lock);
+    if (is_new) {
+        ESP_LOGW(TAG, "⚠️  Fault latched: 0x%02x", (unsigned)fault);
+    }
+}
+
+void warm_state_clear_faults(void)
+{
+    portENTER_CRITICAL(&warm_lock);
+    rtc_block.state.faults = 0;
+    block_seal();
+    portEXIT_CRITICAL(&warm_lock);
+}
+
+void warm_state_mark_healthy(void)
+{
+    portENTER_CRITICAL(&warm_lock);
+    rtc_block.state.resumes = 0;
+    block_seal();
+    portEXIT_CRITICAL(&warm_lock);
+}
+
+const char *warm_state_reset_reason(void)
+{
+    switch (boot_reason) {
+        case ESP_RST_POWERON:   return "power-on";
+        case ESP_RST_EXT:       return "external";
+        case ESP_RST_SW:        return "software";
+        case ESP_RST_PANIC:     return "panic";
+        case ESP_RST_INT_WDT:   return "interrupt watchdog";
+        case ESP_RST_TASK_WDT:  return "task watchdog";
+        case ESP_RST_WDT:       return "watchdog";
+        case ESP_RST_DEEPSLEEP: return "deep sleep";
+        case ESP_RST_BROWNOUT:  return "brownout";
+        default:                return "unknown";
+    }
+}
+
+bool warm_state_resumed(void)
+{
+    return resumed;
+}
+
+const char *warm_trip_phase_name(warm_trip_phase_t phase)
+{
+    switch (phase) {
+        case WARM_TRIP_IDLE:     return "idle";
+        case WARM_TRIP_STARTING: return "starting";
+        case WARM_TRIP_RUNNING:  return "running";
+        case WARM_TRIP_MANUAL:   return "manual";
+        default:                 return "?";
+    }
+}
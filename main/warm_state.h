@@ -0,0 +1,79 @@
+#ifndef WARM_STATE_H
+#define WARM_STATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Controller state kept in RTC slow memory (RTC_NOINIT) across resets that
+// do not remove power: software restart, panic, watchdogs, brownout.
+// Protected by a magic word and CRC32; anything that fails validation, or
+// a power-on / external reset, takes the normal cold boot path.
+
+#define WARM_MAX_RESUMES 3   // Consecutive warm resumes before assuming a reset loop
+#define WARM_HEALTHY_MS  60000  // Uptime after which the resume counter is cleared
+
+typedef enum {
+    WARM_TRIP_IDLE = 0,      // Motor off, waiting for load
+    WARM_TRIP_STARTING,      // Auto start in progress (driver re-init)
+    WARM_TRIP_RUNNING,       // Auto trip: motor running because of load
+    WARM_TRIP_MANUAL         // Motor driven by an API command
+} warm_trip_phase_t;
+
+// Fault latches - set on boot from the reset reason or at runtime,
+// cleared only by a motor reset (/api/motor/reset)
+#define WARM_FAULT_BROWNOUT    0x01
+#define WARM_FAULT_WATCHDOG    0x02
+#define WARM_FAULT_PANIC       0x04
+#define WARM_FAULT_RESET_LOOP  0x08
+#define WARM_FAULT_SENSOR      0x10   // HX711 did not become ready
+
+// Resets that may have come from the motor itself (stall, supply sag) or
+// hit mid-command: no restart before a fresh sample
+#define WARM_FAULT_NO_RESUME   (WARM_FAULT_BROWNOUT | WARM_FAULT_WATCHDOG | WARM_FAULT_PANIC)
+
+typedef struct {
+    float last_weight;       // Last published weight, kg
+    int32_t offset;          // HX711 tare offset in use
+    float threshold;         // Auto start threshold, kg
+    bool auto_mode;
+    bool motor_triggered;
+    uint8_t motor_state;     // motor_state_t
+    uint8_t trip_phase;      // warm_trip_phase_t
+    uint32_t faults;         // WARM_FAULT_* latches
+    uint32_t resumes;        // Consecutive warm resumes
+} warm_state_t;
+
+// Validate the RTC copy against the reset reason (call once, early in
+// app_main). Returns true and fills out if the controller can resume;
+// otherwise resets the RTC copy and returns false (cold boot).
+bool warm_state_restore(warm_state_t *out);
+
+// true if a warm boot may drive the motor right away: an auto trip was
+// running and no WARM_FAULT_NO_RESUME fault is latched. Otherwise the
+// control task restarts it on the first sample above the threshold.
+bool warm_state_resume_trip(const warm_state_t *warm);
+
+// Current copy (also valid after a cold boot)
+void warm_state_get(warm_state_t *out);
+
+// Record the control state (called by the control task every period)
+void warm_state_save_control(float weight, float threshold, bool auto_mode, bool triggered,
+                             uint8_t motor_state, warm_trip_phase_t phase);
+
+// Record a new tare offset
+void warm_state_save_offset(int32_t offset);
+
+// Fault latches
+void warm_state_latch_fault(uint32_t fault);
+void warm_state_clear_faults(void);
+
+// System has run long enough: clear the consecutive resume counter
+void warm_state_mark_healthy(void);
+
+// Reset reason of this boot and whether it resumed warm
+const char *warm_state_reset_reason(void);
+bool warm_state_resumed(void);
+
+const char *warm_trip_phase_name(warm_trip_phase_t phase);
+
+#endif // WARM_STATE_H
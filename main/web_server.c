@@ -3,491 +3,1736 @@
 #include "esp_http_server.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "hx711.h"
+#include "history.h"
+#include "shared_state.h"
+#include "control_task.h"
+#include "config_store.h"
+#include "warm_state.h"
+#include "metrics.h"
+#include "trace.h"
+#include "capture.h"
+#include "sample_log.h"
+#include "serial_telemetry.h"
+#include "deferred_log.h"
+#include "deadline_monitor.h"
+#include "load_estimator.h"
+#include "http_workers.h"
+#include "status_json.h"
+#include "telemetry_codec.h"
+#include "wifi_manager.h"
 #include "motor_control_bts7960.h"
+#include "www_assets.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
 #include <math.h>
 
 static const char *TAG = "WEB_SERVER";
 static httpd_handle_t server = NULL;
-static float current_weight = 0.0;
-static long current_raw = 0;
+static volatile bool server_ready = false;  // Set once web_server_init() is done
 static hx711_t* hx711_scale = NULL;
 
-// Smart weight measurement system
-static float stable_weight = 0.0;
-static bool is_calculating = false;
-static float weight_samples[50]; // 5 seconds * 10 samples per second
-static int sample_count = 0;
-static float last_stable_weight = 0.0;
+// Pre-serialized /api/status document, double buffered: the writer formats
+// into the inactive buffer and flips, readers copy the active one. N clients
+// polling /api/status cost one snprintf per state change instead of N.
+static char status_cache[2][STATUS_JSON_MAX];
+static int status_cache_len[2] = {0, 0};
+static int status_cache_active = 0;
+static uint32_t status_seq = 0;
+static portMUX_TYPE status_lock = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t status_writer_mutex = NULL;
 
-// Motor control system
-static bool motor_auto_mode = true;  // Enable auto mode by default
-static float weight_threshold = 0.2; // kg - default threshold for auto trigger
-static bool motor_was_triggered = false;
+
+// On-device weight history (see history.h), shared by sampler and httpd
+static SemaphoreHandle_t history_mutex = NULL;
+
+// WebSocket telemetry push
+#define WS_MAX_CLIENTS 4          // Concurrent dashboard sockets
+#define WS_MIN_INTERVAL_MS 50     // Per-client rate cap (max 20 frames/s)
+#define WS_QUEUE_LEN 4            // Frames buffered per client (oldest dropped)
+#define WS_FRAME_MAX STATUS_JSON_MAX  // Max size of one telemetry frame
+
+typedef struct {
+    int fd;                              // Socket fd, -1 when slot is free
+    bool binary;                         // Negotiated TELEMETRY_WS_SUBPROTOCOL
+    int64_t last_send_us;                // Time of last frame sent
+    uint8_t frames[WS_QUEUE_LEN][WS_FRAME_MAX];
+    uint16_t frame_len[WS_QUEUE_LEN];
+    uint8_t head;                        // Next frame to send
+    uint8_t count;                       // Frames waiting
+    uint32_t dropped;                    // Frames dropped by backpressure
+    telemetry_encoder_t enc;             // Binary clients: samples batched since last frame
+    uint8_t enc_buf[WS_FRAME_MAX];
+    uint16_t seq;
+} ws_client_t;
+
+static ws_client_t ws_clients[WS_MAX_CLIENTS];
+static portMUX_TYPE ws_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool ws_flush_pending = false;    // Flush queued, or its follow-up timer armed
+static esp_timer_handle_t ws_flush_timer = NULL;
+static esp_timer_handle_t publish_timer = NULL;   // web_server_request_status()
+
+// Round-trip time to dashboard clients, measured with WebSocket PING/PONG
+// (the payload carries the send timestamp) and kept per WiFi profile
+#define WS_PING_INTERVAL_MS 2000
+
+typedef struct {
+    uint32_t count;
+    uint32_t last_us;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+} rtt_stats_t;
+
+static rtt_stats_t rtt_stats[WIFI_PROFILE_COUNT];
+static esp_timer_handle_t ws_ping_timer = NULL;
+
+// Manual override / reset of the motor control flags
+static void set_motor_flags(bool triggered, bool auto_mode)
+{
+    elevator_state_t *st = shared_state_begin_update();
+    st->motor_triggered = triggered;
+    st->auto_mode = auto_mode;
+    shared_state_end_update();
+}
+
+// Store auto mode and threshold so they survive a reboot (debounced)
+static void persist_control_settings(void)
+{
+    elevator_state_t es;
+    elevator_config_t cfg;
+    shared_state_read(&es);
+    config_store_get(&cfg);
+    cfg.auto_mode = es.auto_mode;
+    cfg.threshold = es.threshold;
+    config_store_set(&cfg);
+}
 
 // Function to reset motor state (for system startup)
 void web_server_reset_motor_state(void)
 {
-    motor_was_triggered = false;
+    elevator_state_t *st = shared_state_begin_update();
+    st->motor_triggered = false;
+    shared_state_end_update();
     ESP_LOGI(TAG, "🔄 Motor state reset on system startup");
 }
 
-// Motor control API handlers
-static esp_err_t motor_forward_handler(httpd_req_t *req)
+// Motor commands - shared by the HTTP API and the WebSocket channel.
+// Each writes its JSON reply into json and returns its length.
+static int motor_cmd_forward(char *json, size_t len)
+{
+    capture_command(CAPTURE_CMD_FORWARD, 0);
+    motor_start_forward();
+    // Set motor state and temporarily disable auto mode to prevent interference
+    set_motor_flags(true, false);
+    ESP_LOGI(TAG, "🔄 Motor started manually FORWARD - disabling auto mode to prevent interference");
+    web_server_publish_status();
+    return snprintf(json, len, "{\"status\":\"forward\",\"success\":true}");
+}
+
+static int motor_cmd_backward(char *json, size_t len)
+{
+    capture_command(CAPTURE_CMD_BACKWARD, 0);
+    motor_start_backward();
+    // Set motor state and temporarily disable auto mode to prevent interference
+    set_motor_flags(true, false);
+    ESP_LOGI(TAG, "🔄 Motor started manually BACKWARD - disabling auto mode to prevent interference");
+    web_server_publish_status();
+    return snprintf(json, len, "{\"status\":\"backward\",\"success\":true}");
+}
+
+static int motor_cmd_stop(char *json, size_t len)
+{
+    capture_command(CAPTURE_CMD_STOP, 0);
+    motor_stop();
+    // Reset motor state and re-enable auto mode
+    set_motor_flags(false, true);
+    persist_control_settings();
+    ESP_LOGI(TAG, "🛑 Motor stopped manually - re-enabling auto control mode");
+    web_server_publish_status();
+    return snprintf(json, len, "{\"status\":\"stopped\",\"success\":true}");
+}
+
+static int motor_cmd_reset(char *json, size_t len)
+{
+    ESP_LOGI(TAG, "🔄 Motor system reset requested");
+    capture_command(CAPTURE_CMD_RESET, 0);
+    
+    // Stop motor first
+    motor_stop();
+    
+    // Reset all motor states and clear latched faults
+    set_motor_flags(false, true);
+    persist_control_settings();
+    warm_state_clear_faults();
+    
+    // Re-initialize motor driver
+    ESP_LOGI(TAG, "🔄 Re-initializing motor driver...");
+    motor_control_init();
+    vTaskDelay(pdMS_TO_TICKS(100)); // Give time for initialization
+    
+    ESP_LOGI(TAG, "✅ Motor system reset completed");
+    web_server_publish_status();
+    return snprintf(json, len, "{\"status\":\"reset\",\"auto_mode\":true,\"triggered\":false,\"success\":true}");
+}
+
+static int motor_cmd_auto(char *json, size_t len)
+{
+    elevator_state_t *st = shared_state_begin_update();
+    bool auto_mode = st->auto_mode = !st->auto_mode;
+    shared_state_end_update();
+    capture_command(CAPTURE_CMD_AUTO_MODE, auto_mode);
+    persist_control_settings();
+    web_server_publish_status();
+    return snprintf(json, len, "{\"auto_mode\":%s,\"success\":true}", 
+                    auto_mode ? "true" : "false");
+}
+
+// Parses "threshold":<value> out of a JSON body; leaves threshold unchanged
+// if absent or out of range (config_store_threshold_valid())
+static int motor_cmd_threshold(const char *body, char *json, size_t len)
+{
+    bool ok = true;
+    if (body != NULL) {
+        // Simple JSON parsing for threshold
+        const char *threshold_str = strstr(body, "\"threshold\":");
+        float threshold = threshold_str ? atof(threshold_str + 12) : 0.0f; // Skip "threshold":
+        if (threshold_str && !config_store_threshold_valid(threshold)) {
+            ESP_LOGW(TAG, "Invalid threshold ignored: %s", body);
+            ok = false;
+        } else if (threshold_str) {
+            elevator_state_t *st = shared_state_begin_update();
+            st->threshold = threshold;
+            shared_state_end_update();
+            capture_command_float(CAPTURE_CMD_THRESHOLD, threshold);
+            persist_control_settings();
+            ESP_LOGI(TAG, "Weight threshold set to %.2f kg", threshold);
+        } else {
+            ESP_LOGW(TAG, "No threshold found in data: %s", body);
+        }
+    }
+    web_server_publish_status();
+    elevator_state_t es;
+    shared_state_read(&es);
+    return snprintf(json, len, "{\"threshold\":%.2f,\"success\":%s}", es.threshold,
+                    ok ? "true" : "false");
+}
+
+static esp_err_t send_json(httpd_req_t *req, const char *json)
+{
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
+}
+
+// Hand a slow handler to the worker pool so the httpd task stays free for
+// other clients; 503 + Retry-After when the queue is full
+static esp_err_t offload(httpd_req_t *req, http_worker_handler_t handler)
+{
+    esp_err_t err = http_workers_submit(req, handler);
+    if (err == ESP_OK) {
+        return ESP_OK;
+    }
+    if (err == ESP_ERR_NO_MEM) {
+        ESP_LOGW(TAG, "Worker queue full, rejecting %s", req->uri);
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        return send_json(req, "{\"status\":\"error\",\"message\":\"Server busy, retry later\"}");
+    }
+    ESP_LOGE(TAG, "Failed to detach %s: %s", req->uri, esp_err_to_name(err));
+    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Async dispatch failed");
+    return ESP_FAIL;
+}
+
+// Motor control API handlers
+static esp_err_t motor_forward_handler(httpd_req_t *req)
+{
+    char json[64];
+    motor_cmd_forward(json, sizeof(json));
+    return send_json(req, json);
+}
+
+static esp_err_t motor_backward_handler(httpd_req_t *req)
+{
+    char json[64];
+    motor_cmd_backward(json, sizeof(json));
+    return send_json(req, json);
+}
+
+static esp_err_t motor_stop_handler(httpd_req_t *req)
+{
+    char json[64];
+    motor_cmd_stop(json, sizeof(json));
+    return send_json(req, json);
+}
+
+// Driver re-init + 100 ms settle: runs on an HTTP worker
+static esp_err_t motor_reset_handler(httpd_req_t *req)
+{
+    if (!http_workers_on_worker()) {
+        return offload(req, motor_reset_handler);
+    }
+    
+    char json[128];
+    motor_cmd_reset(json, sizeof(json));
+    return send_json(req, json);
+}
+
+static esp_err_t motor_auto_handler(httpd_req_t *req)
+{
+    char json[64];
+    motor_cmd_auto(json, sizeof(json));
+    return send_json(req, json);
+}
+
+static esp_err_t motor_threshold_handler(httpd_req_t *req)
+{
+    char buf[100];
+    const char *body = NULL;
+    if (req->method == HTTP_POST) {
+        int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
+        if (ret > 0) {
+            buf[ret] = '\0';
+            ESP_LOGI(TAG, "Received threshold data: %s", buf);
+            body = buf;
+        } else {
+            ESP_LOGW(TAG, "No data received for threshold");
+        }
+    }
+    
+    char json[64];
+    motor_cmd_threshold(body, json, sizeof(json));
+    return send_json(req, json);
+}
+
+// ---------------------------------------------------------------------------
+// WebSocket channel: telemetry push + motor commands
+// ---------------------------------------------------------------------------
+
+static void ws_client_add(int fd, bool binary)
+{
+    portENTER_CRITICAL(&ws_lock);
+    int free_slot = -1;
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (ws_clients[i].fd == fd) {
+            portEXIT_CRITICAL(&ws_lock);
+            return;
+        }
+        if (ws_clients[i].fd < 0 && free_slot < 0) {
+            free_slot = i;
+        }
+    }
+    if (free_slot >= 0) {
+        ws_clients[free_slot].fd = fd;
+        ws_clients[free_slot].binary = binary;
+        ws_clients[free_slot].seq = 0;
+        ws_clients[free_slot].enc.count = 0;
+        ws_clients[free_slot].last_send_us = 0;
+        ws_clients[free_slot].head = 0;
+        ws_clients[free_slot].count = 0;
+        ws_clients[free_slot].dropped = 0;
+    }
+    portEXIT_CRITICAL(&ws_lock);
+    
+    if (free_slot >= 0) {
+        ESP_LOGI(TAG, "WebSocket client connected (fd=%d, %s)", fd, binary ? "binary" : "json");
+    } else {
+        ESP_LOGW(TAG, "WebSocket client limit reached, fd=%d gets no telemetry", fd);
+    }
+}
+
+static void ws_client_remove(int fd)
+{
+    portENTER_CRITICAL(&ws_lock);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (ws_clients[i].fd == fd) {
+            ws_clients[i].fd = -1;
+            ws_clients[i].count = 0;
+        }
+    }
+    portEXIT_CRITICAL(&ws_lock);
+}
+
+// Called by httpd when any session closes; we own closing the socket
+static void ws_session_closed(httpd_handle_t hd, int sockfd)
+{
+    ws_client_remove(sockfd);
+    close(sockfd);
+}
+
+// Append a frame to a client's queue, dropping the oldest when full (ws_lock held)
+static void ws_enqueue(ws_client_t *c, const void *data, size_t len)
+{
+    if (len > WS_FRAME_MAX) {
+        return;
+    }
+    if (c->count == WS_QUEUE_LEN) {
+        c->head = (c->head + 1) % WS_QUEUE_LEN;
+        c->count--;
+        c->dropped++;
+    }
+    int tail = (c->head + c->count) % WS_QUEUE_LEN;
+    memcpy(c->frames[tail], data, len);
+    c->frame_len[tail] = len;
+    c->count++;
+}
+
+// Close the binary batch of a client into a queued frame (ws_lock held)
+static void ws_flush_encoder(ws_client_t *c)
+{
+    if (c->enc.count == 0) {
+        return;
+    }
+    size_t len = telemetry_encoder_finish(&c->enc);
+    ws_enqueue(c, c->enc_buf, len);
+    c->enc.count = 0;
+}
+
+static void ws_flush_work(void *arg);
+
+// Follow-up flush once a rate cap expires (esp_timer task)
+static void ws_flush_timer_cb(void *arg)
+{
+    if (server == NULL || httpd_queue_work(server, ws_flush_work, NULL) != ESP_OK) {
+        portENTER_CRITICAL(&ws_lock);
+        ws_flush_pending = false;
+        portEXIT_CRITICAL(&ws_lock);
+    }
+}
+
+// Earliest time a client with data left (queued frames or an open binary
+// batch) may send again, 0 if every client is drained (ws_lock held)
+static int64_t ws_next_send_us(void)
+{
+    int64_t next_us = 0;
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        ws_client_t *c = &ws_clients[i];
+        if (c->fd < 0 || (c->count == 0 && c->enc.count == 0)) {
+            continue;
+        }
+        int64_t at_us = c->last_send_us + (int64_t)WS_MIN_INTERVAL_MS * 1000;
+        if (next_us == 0 || at_us < next_us) {
+            next_us = at_us;
+        }
+    }
+    return next_us;
+}
+
+// Runs on the httpd task: sends queued frames to every client whose rate
+// cap allows it, then arms the follow-up flush while any client still has
+// data, so the last frame of a burst goes out without another broadcast
+static void ws_flush_work(void *arg)
+{
+    uint8_t frame[WS_FRAME_MAX];
+    int64_t now_us = esp_timer_get_time();
+    
+    portENTER_CRITICAL(&ws_lock);
+    ws_flush_pending = false;
+    portEXIT_CRITICAL(&ws_lock);
+    
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        int fd = -1;
+        size_t len = 0;
+        bool binary = false;
+        
+        portENTER_CRITICAL(&ws_lock);
+        ws_client_t *c = &ws_clients[i];
+        if (c->fd >= 0 && now_us - c->last_send_us >= (int64_t)WS_MIN_INTERVAL_MS * 1000) {
+            if (c->count == 0) {
+                ws_flush_encoder(c);
+            }
+            if (c->count > 0) {
+                fd = c->fd;
+                binary = c->binary;
+                len = c->frame_len[c->head];
+                memcpy(frame, c->frames[c->head], len);
+                c->head = (c->head + 1) % WS_QUEUE_LEN;
+                c->count--;
+                c->last_send_us = now_us;
+            }
+        }
+        portEXIT_CRITICAL(&ws_lock);
+        
+        if (fd < 0) {
+            continue;
+        }
+        
+        if (httpd_ws_get_fd_info(server, fd) != HTTPD_WS_CLIENT_WEBSOCKET) {
+            ws_client_remove(fd);
+            continue;
+        }
+        
+        httpd_ws_frame_t ws_pkt = {
+            .final = true,
+            .type = binary ? HTTPD_WS_TYPE_BINARY : HTTPD_WS_TYPE_TEXT,
+            .payload = frame,
+            .len = len
+        };
+        if (httpd_ws_send_frame_async(server, fd, &ws_pkt) != ESP_OK) {
+            ESP_LOGW(TAG, "WebSocket send failed (fd=%d), dropping client", fd);
+            ws_client_remove(fd);
+        }
+    }
+    
+    portENTER_CRITICAL(&ws_lock);
+    int64_t next_us = ws_next_send_us();
+    bool arm = next_us != 0 && !ws_flush_pending && ws_flush_timer != NULL;
+    if (arm) {
+        ws_flush_pending = true;
+    }
+    portEXIT_CRITICAL(&ws_lock);
+    
+    if (arm) {
+        int64_t delay_us = next_us - esp_timer_get_time();
+        esp_timer_stop(ws_flush_timer);
+        if (esp_timer_start_once(ws_flush_timer, delay_us > 0 ? (uint64_t)delay_us : 1) != ESP_OK) {
+            portENTER_CRITICAL(&ws_lock);
+            ws_flush_pending = false;
+            portEXIT_CRITICAL(&ws_lock);
+        }
+    }
+}
+
+// Queue a state update for every connected client: JSON clients get the
+// status document, binary clients get the sample appended to their current
+// batch. When a client's queue is full the oldest frame is dropped so slow
+// clients always see the newest data.
+static void ws_broadcast(const char *json, const telemetry_sample_t *sample)
+{
+    if (server == NULL) {
+        return;
+    }
+    
+    bool schedule = false;
+    portENTER_CRITICAL(&ws_lock);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        ws_client_t *c = &ws_clients[i];
+        if (c->fd < 0) {
+            continue;
+        }
+        if (c->binary) {
+            if (c->enc.count > 0 && !telemetry_encoder_add(&c->enc, sample)) {
+                ws_flush_encoder(c);
+            }
+            if (c->enc.count == 0) {
+                telemetry_encoder_begin(&c->enc, c->enc_buf, WS_FRAME_MAX, c->seq++, sample->t_ms);
+                telemetry_encoder_add(&c->enc, sample);
+            }
+        } else {
+            ws_enqueue(c, json, strlen(json));
+        }
+        schedule = true;
+    }
+    if (schedule && !ws_flush_pending) {
+        ws_flush_pending = true;
+    } else {
+        schedule = false;
+    }
+    portEXIT_CRITICAL(&ws_lock);
+    
+    if (schedule && httpd_queue_work(server, ws_flush_work, NULL) != ESP_OK) {
+        portENTER_CRITICAL(&ws_lock);
+        ws_flush_pending = false;
+        portEXIT_CRITICAL(&ws_lock);
+    }
+}
+
+// Dispatches a command frame such as {"cmd":"forward"} or {"cmd":"threshold","threshold":1.5}
+static int ws_handle_command(const char *msg, char *json, size_t len)
+{
+    const char *cmd = strstr(msg, "\"cmd\":\"");
+    if (cmd == NULL) {
+        return snprintf(json, len, "{\"success\":false,\"error\":\"missing cmd\"}");
+    }
+    cmd += 7; // Skip "cmd":"
+    
+    if (strncmp(cmd, "forward\"", 8) == 0) {
+        return motor_cmd_forward(json, len);
+    } else if (strncmp(cmd, "backward\"", 9) == 0) {
+        return motor_cmd_backward(json, len);
+    } else if (strncmp(cmd, "stop\"", 5) == 0) {
+        return motor_cmd_stop(json, len);
+    } else if (strncmp(cmd, "reset\"", 6) == 0) {
+        return motor_cmd_reset(json, len);
+    } else if (strncmp(cmd, "auto\"", 5) == 0) {
+        return motor_cmd_auto(json, len);
+    } else if (strncmp(cmd, "threshold\"", 10) == 0) {
+        return motor_cmd_threshold(msg, json, len);
+    }
+    return snprintf(json, len, "{\"success\":false,\"error\":\"unknown cmd\"}");
+}
+
+static void rtt_record(uint32_t rtt_us)
+{
+    portENTER_CRITICAL(&ws_lock);
+    rtt_stats_t *r = &rtt_stats[wifi_get_profile()];
+    if (r->count == 0 || rtt_us < r->min_us) r->min_us = rtt_us;
+    if (rtt_us > r->max_us) r->max_us = rtt_us;
+    r->last_us = rtt_us;
+    r->sum_us += rtt_us;
+    r->count++;
+    portEXIT_CRITICAL(&ws_lock);
+}
+
+// Runs on the httpd task: PING every client with the current time
+static void ws_ping_work(void *arg)
+{
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        portENTER_CRITICAL(&ws_lock);
+        int fd = ws_clients[i].fd;
+        portEXIT_CRITICAL(&ws_lock);
+        if (fd < 0 || httpd_ws_get_fd_info(server, fd) != HTTPD_WS_CLIENT_WEBSOCKET) {
+            continue;
+        }
+        int64_t now_us = esp_timer_get_time();
+        httpd_ws_frame_t ping = {
+            .final = true,
+            .type = HTTPD_WS_TYPE_PING,
+            .payload = (uint8_t *)&now_us,
+            .len = sizeof(now_us)
+        };
+        httpd_ws_send_frame_async(server, fd, &ping);
+    }
+}
+
+static void ws_ping_timer_cb(void *arg)
+{
+    if (server != NULL) {
+        httpd_queue_work(server, ws_ping_work, NULL);
+    }
+}
+
+// Control frames (handle_ws_control_frames): PONG carries our timestamp back
+static esp_err_t ws_control_frame(httpd_req_t *req, httpd_ws_frame_t *ws_pkt)
+{
+    uint8_t buf[125];  // Max control frame payload
+    if (ws_pkt->len > sizeof(buf)) {
+        return ESP_FAIL;
+    }
+    ws_pkt->payload = buf;
+    esp_err_t ret = httpd_ws_recv_frame(req, ws_pkt, sizeof(buf));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    if (ws_pkt->type == HTTPD_WS_TYPE_PONG) {
+        int64_t sent_us;
+        if (ws_pkt->len == sizeof(sent_us)) {
+            memcpy(&sent_us, buf, sizeof(sent_us));
+            int64_t rtt_us = esp_timer_get_time() - sent_us;
+            if (rtt_us >= 0 && rtt_us < 60 * 1000000LL) {
+                rtt_record((uint32_t)rtt_us);
+            }
+        }
+        return ESP_OK;
+    }
+    
+    httpd_ws_frame_t reply = {
+        .final = true,
+        .type = ws_pkt->type == HTTPD_WS_TYPE_PING ? HTTPD_WS_TYPE_PONG : HTTPD_WS_TYPE_CLOSE,
+        .payload = buf,
+        .len = ws_pkt->type == HTTPD_WS_TYPE_PING ? ws_pkt->len : 0
+    };
+    if (ws_pkt->type == HTTPD_WS_TYPE_CLOSE) {
+        ws_client_remove(httpd_req_to_sockfd(req));
+    }
+    return httpd_ws_send_frame(req, &reply);
+}
+
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        // Handshake done by httpd; register the socket for telemetry push.
+        // Clients asking for TELEMETRY_WS_SUBPROTOCOL get binary frames.
+        char proto[64];
+        bool binary = httpd_req_get_hdr_value_str(req, "Sec-WebSocket-Protocol",
+                                                  proto, sizeof(proto)) == ESP_OK &&
+                      strstr(proto, TELEMETRY_WS_SUBPROTOCOL) != NULL;
+        ws_client_add(httpd_req_to_sockfd(req), binary);
+        return ESP_OK;
+    }
+    
+    httpd_ws_frame_t ws_pkt = {0};
+    ws_pkt.type = HTTPD_WS_TYPE_TEXT;
+    
+    // First call with max_len = 0 to learn the frame length
+    esp_err_t ret = httpd_ws_recv_frame(req, &ws_pkt, 0);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    if (ws_pkt.type == HTTPD_WS_TYPE_PING || ws_pkt.type == HTTPD_WS_TYPE_PONG ||
+        ws_pkt.type == HTTPD_WS_TYPE_CLOSE) {
+        return ws_control_frame(req, &ws_pkt);
+    }
+    
+    char buf[128];
+    if (ws_pkt.type != HTTPD_WS_TYPE_TEXT || ws_pkt.len >= sizeof(buf)) {
+        ESP_LOGW(TAG, "Ignoring WebSocket frame (type=%d, len=%d)", ws_pkt.type, (int)ws_pkt.len);
+        return ESP_OK;
+    }
+    
+    ws_pkt.payload = (uint8_t *)buf;
+    ret = httpd_ws_recv_frame(req, &ws_pkt, sizeof(buf) - 1);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    buf[ws_pkt.len] = '\0';
+    
+    char json[128];
+    int n = ws_handle_command(buf, json, sizeof(json));
+    
+    httpd_ws_frame_t reply = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)json,
+        .len = n
+    };
+    return httpd_ws_send_frame(req, &reply);
+}
+
+// Snapshot the current state
+static void status_collect(system_status_t *st)
+{
+    elevator_state_t es;
+    shared_state_read(&es);
+    *st = (system_status_t) {
+        .seq = status_seq,
+        .sample_ms = es.sample_ms,
+        .weight = es.weight,
+        .load = es.load,
+        .raw = es.raw,
+        .stable = es.stable,
+        .sensor_ready = hx711_scale != NULL && hx711_is_ready(hx711_scale),
+        .motor_state = motor_get_state(),
+        .auto_mode = es.auto_mode,
+        .threshold = es.threshold,
+        .wifi_connected = wifi_is_connected(),
+        .rssi = wifi_get_rssi(),
+        .uptime_ms = esp_timer_get_time() / 1000
+    };
+}
+
+// Format the current state into the inactive cache buffer and flip it live
+static void status_cache_refresh(system_status_t *st)
+{
+    status_collect(st);
+    if (status_writer_mutex == NULL ||
+        xSemaphoreTake(status_writer_mutex, pdMS_TO_TICKS(50)) != pdTRUE) {
+        return;
+    }
+    st->seq = ++status_seq;
+    int next = !status_cache_active;
+    int len = status_json_format(st, status_cache[next], STATUS_JSON_MAX);
+    if (len >= STATUS_JSON_MAX) {
+        len = STATUS_JSON_MAX - 1;
+    }
+    status_cache_len[next] = len;
+    
+    portENTER_CRITICAL(&status_lock);
+    status_cache_active = next;
+    portEXIT_CRITICAL(&status_lock);
+    xSemaphoreGive(status_writer_mutex);
+}
+
+// Copy the live status document into buf (STATUS_JSON_MAX bytes); returns its length
+static int status_cache_read(char *buf)
+{
+    portENTER_CRITICAL(&status_lock);
+    int active = status_cache_active;
+    int len = status_cache_len[active];
+    memcpy(buf, status_cache[active], len + 1);
+    portEXIT_CRITICAL(&status_lock);
+    return len;
+}
+
+// Re-serialize the status after a new sample or state change and push it
+// to all WebSocket clients
+static void status_to_sample(const system_status_t *st, telemetry_sample_t *sample)
+{
+    sample->t_ms = (uint32_t)st->sample_ms;
+    sample->weight_g = (int32_t)lroundf(st->weight * 1000.0f);
+    sample->raw = (int32_t)st->raw;
+    sample->flags = (st->motor_state & TELEMETRY_FLAG_MOTOR_MASK) |
+                    (st->auto_mode ? TELEMETRY_FLAG_AUTO_MODE : 0) |
+                    (st->stable ? TELEMETRY_FLAG_STABLE : 0) |
+                    (st->sensor_ready ? TELEMETRY_FLAG_SENSOR_READY : 0);
+}
+
+void web_server_publish_status(void)
+{
+    char frame[STATUS_JSON_MAX];
+    system_status_t st;
+    telemetry_sample_t sample;
+    
+    if (!server_ready) {
+        return;  // Network still coming up
+    }
+    status_cache_refresh(&st);
+    status_to_sample(&st, &sample);
+    if (status_cache_read(frame) > 0) {
+        ws_broadcast(frame, &sample);
+    }
+}
+
+// Runs on the httpd task, queued by publish_timer_cb()
+static void publish_work(void *arg)
+{
+    web_server_publish_status();
+}
+
+static void publish_timer_cb(void *arg)
+{
+    if (server != NULL) {
+        httpd_queue_work(server, publish_work, NULL);
+    }
+}
+
+void web_server_request_status(void)
+{
+    // Already armed: that publish picks up this change as well
+    if (publish_timer != NULL) {
+        esp_timer_start_once(publish_timer, 1);
+    }
+}
+
+// Dashboard assets - gzipped at build time (www/gzip_assets.py) and embedded in flash
+extern const uint8_t index_html_gz_start[] asm("_binary_index_html_gz_start");
+extern const uint8_t index_html_gz_end[]   asm("_binary_index_html_gz_end");
+extern const uint8_t app_js_gz_start[]     asm("_binary_app_js_gz_start");
+extern const uint8_t app_js_gz_end[]       asm("_binary_app_js_gz_end");
+extern const uint8_t style_css_gz_start[]  asm("_binary_style_css_gz_start");
+extern const uint8_t style_css_gz_end[]    asm("_binary_style_css_gz_end");
+
+#define WWW_CHUNK_SIZE 4096  // Bytes handed to the socket per chunk
+
+typedef struct {
+    const char *type;
+    const uint8_t *start;
+    const uint8_t *end;
+    const char *etag;
+    const char *cache_control;
+} www_asset_t;
+
+// The page itself is revalidated on every load (cheap 304); JS/CSS are
+// referenced with a content hash (?v=...) so they can be cached for a year.
+static const www_asset_t www_index = {
+    "text/html", index_html_gz_start, index_html_gz_end,
+    WWW_ETAG_INDEX_HTML, "no-cache"
+};
+static const www_asset_t www_app_js = {
+    "application/javascript", app_js_gz_start, app_js_gz_end,
+    WWW_ETAG_APP_JS, "public, max-age=31536000, immutable"
+};
+static const www_asset_t www_style_css = {
+    "text/css", style_css_gz_start, style_css_gz_end,
+    WWW_ETAG_STYLE_CSS, "public, max-age=31536000, immutable"
+};
+
+// API handler for weight data
+static esp_err_t weight_api_handler(httpd_req_t *req)
+{
+    // Check if HX711 is ready
+    bool sensor_ready = false;
+    if (hx711_scale != NULL) {
+        sensor_ready = hx711_is_ready(hx711_scale);
+    }
+    
+    // Get current weight and status
+    elevator_state_t es;
+    shared_state_read(&es);
+    char json[256];
+    if (!es.stable) {
+        snprintf(json, sizeof(json), "{\"weight\":%.2f,\"raw\":%ld,\"status\":\"Calculating...\",\"sensor_ready\":%s}", 
+                 es.weight, es.raw, sensor_ready ? "true" : "false");
+    } else {
+        snprintf(json, sizeof(json), "{\"weight\":%.2f,\"raw\":%ld,\"status\":\"Stable\",\"sensor_ready\":%s}", 
+                 es.weight, es.raw, sensor_ready ? "true" : "false");
+    }
+    
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
+
+// API handler for the aggregated status document (served from cache).
+// Clients sending "Accept: application/x-elevator-telemetry" get a
+// one-sample binary telemetry frame instead (see telemetry_codec.h).
+static esp_err_t status_api_handler(httpd_req_t *req)
+{
+    system_status_t st;
+    char accept[64];
+    if (httpd_req_get_hdr_value_str(req, "Accept", accept, sizeof(accept)) == ESP_OK &&
+        strstr(accept, TELEMETRY_MIME_TYPE) != NULL) {
+        uint8_t frame[TELEMETRY_HEADER_SIZE + TELEMETRY_SAMPLE_MAX_SIZE];
+        telemetry_encoder_t enc;
+        telemetry_sample_t sample;
+        status_collect(&st);
+        status_to_sample(&st, &sample);
+        telemetry_encoder_begin(&enc, frame, sizeof(frame), (uint16_t)st.seq, sample.t_ms);
+        telemetry_encoder_add(&enc, &sample);
+        httpd_resp_set_type(req, TELEMETRY_MIME_TYPE);
+        return httpd_resp_send(req, (const char *)frame, telemetry_encoder_finish(&enc));
+    }
+    
+    char json[STATUS_JSON_MAX];
+    int len = status_cache_read(json);
+    if (len == 0) {
+        // Nothing published yet (no sample so far)
+        status_cache_refresh(&st);
+        len = status_cache_read(json);
+    }
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, len);
+}
+
+// API handler for zeroing the scale
+static esp_err_t zero_api_handler(httpd_req_t *req)
+{
+    // Tare averages 10 HX711 conversions (~1 s at 10 SPS): runs on an HTTP worker
+    if (!http_workers_on_worker()) {
+        return offload(req, zero_api_handler);
+    }
+    
+    if (req->method == HTTP_POST) {
+        if (hx711_scale != NULL) {
+            // Call the HX711 zero function and keep the new offset. The
+            // sampling loop waits for the HX711 meanwhile: not a stall.
+            capture_command(CAPTURE_CMD_ZERO, 0);
+            int sample_deadline = deadline_find("sample");
+            deadline_pause(sample_deadline);
+            hx711_zero_scale(hx711_scale);
+            deadline_resume(sample_deadline);
+            elevator_config_t cfg;
+            config_store_get(&cfg);
+            cfg.offset = hx711_scale->offset;
+            config_store_set(&cfg);
+            warm_state_save_offset(cfg.offset);
+            serial_telemetry_event(SERIAL_EVENT_TARE, cfg.offset, NULL);
+            
+            char json[64];
+            snprintf(json, sizeof(json), "{\"status\":\"success\",\"message\":\"Scale zeroed\"}");
+            
+            httpd_resp_set_type(req, "application/json");
+            httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
+            
+            ESP_LOGI(TAG, "Scale zeroed successfully");
+            return ESP_OK;
+        } else {
+            char json[64];
+            snprintf(json, sizeof(json), "{\"status\":\"error\",\"message\":\"HX711 not initialized\"}");
+            
+            httpd_resp_set_type(req, "application/json");
+            httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
+            
+            ESP_LOGE(TAG, "HX711 not initialized for zeroing");
+            return ESP_FAIL;
+        }
+    }
+    
+    httpd_resp_send_404(req);
+    return ESP_FAIL;
+}
+
+// Read an integer query parameter, returning def when absent or malformed
+static long long query_get_ll(const char *query, const char *key, long long def)
+{
+    char val[24];
+    if (query == NULL || httpd_query_key_value(query, key, val, sizeof(val)) != ESP_OK) {
+        return def;
+    }
+    char *end;
+    long long v = strtoll(val, &end, 10);
+    return (end == val) ? def : v;
+}
+
+static int pulse_stats_json(char *out, size_t cap, const hx711_pulse_stats_t *ps)
+{
+    return snprintf(out, cap,
+                    "{\"conversions\":%u,\"timeouts\":%u,\"pulses\":%u,\"mean_ns\":%u,"
+                    "\"max_ns\":%u,\"over_limit\":%u}",
+                    (unsigned)ps->conversions, (unsigned)ps->timeouts, (unsigned)ps->pulses,
+                    (unsigned)ps->mean_ns, (unsigned)ps->max_ns, (unsigned)ps->over_limit);
+}
+
+// POST /api/hx711/pulse?n=<conversions> - SCK high-time benchmark of the
+// IRAM bit-bang against the same code run from flash with a cold cache
+static esp_err_t hx711_pulse_handler(httpd_req_t *req)
+{
+    // 2 x n conversions at 10 SPS: runs on an HTTP worker
+    if (!http_workers_on_worker()) {
+        return offload(req, hx711_pulse_handler);
+    }
+    if (hx711_scale == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "HX711 not initialized");
+        return ESP_FAIL;
+    }
+    
+    char query[32];
+    long long n = 20;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        n = query_get_ll(query, "n", 20);
+    }
+    if (n < 1) n = 1;
+    if (n > 100) n = 100;
+    
+    // Every other conversion goes to the bench: samples take twice as long
+    hx711_pulse_stats_t iram, flash;
+    int sample_deadline = deadline_find("sample");
+    deadline_pause(sample_deadline);
+    hx711_pulse_bench(hx711_scale, (int)n, false, &iram);
+    hx711_pulse_bench(hx711_scale, (int)n, true, &flash);
+    deadline_resume(sample_deadline);
+    ESP_LOGI(TAG, "HX711 SCK high max: %u ns from IRAM, %u ns from flash",
+             (unsigned)iram.max_ns, (unsigned)flash.max_ns);
+    
+    char json[384];
+    int len = snprintf(json, sizeof(json), "{\"limit_us\":%d,\"iram\":", HX711_SCK_HIGH_MAX_US);
+    len += pulse_stats_json(json + len, sizeof(json) - len, &iram);
+    len += snprintf(json + len, sizeof(json) - len, ",\"flash\":");
+    len += pulse_stats_json(json + len, sizeof(json) - len, &flash);
+    snprintf(json + len, sizeof(json) - len, "}");
+    return send_json(req, json);
+}
+
+// GET /api/history?from=<ms>&to=<ms>&points=<n>
+// Times are ms since boot; defaults are the last 5 minutes and 100 points.
+static esp_err_t history_api_handler(httpd_req_t *req)
+{
+    char query[96];
+    const char *q = NULL;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        q = query;
+    }
+    
+    int64_t now_ms = esp_timer_get_time() / 1000;
+    int64_t to_ms = query_get_ll(q, "to", now_ms);
+    int64_t from_ms = query_get_ll(q, "from", to_ms - 5 * 60 * 1000);
+    long long points = query_get_ll(q, "points", 100);
+    if (points < 1) points = 1;
+    if (points > HISTORY_MAX_POINTS) points = HISTORY_MAX_POINTS;
+    
+    history_point_t *out = malloc(points * sizeof(history_point_t));
+    if (out == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    
+    history_tier_t tier = HISTORY_TIER_RAW;
+    size_t n = 0;
+    int64_t query_us = esp_timer_get_time();
+    if (xSemaphoreTake(history_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        n = history_query(from_ms, to_ms, points, out, &tier);
+        xSemaphoreGive(history_mutex);
+    }
+    query_us = esp_timer_get_time() - query_us;
+    
+    httpd_resp_set_type(req, "application/json");
+    
+    // Stream the points in chunks: [t_ms, mean, min, max, count]
+    char buf[512];
+    int len = snprintf(buf, sizeof(buf),
+                       "{\"from\":%lld,\"to\":%lld,\"tier\":\"%s\",\"width_ms\":%lld,"
+                       "\"memory_bytes\":%u,\"query_us\":%lld,\"points\":[",
+                       (long long)from_ms, (long long)to_ms, history_tier_name(tier),
+                       (long long)history_tier_width_ms(tier),
+                       (unsigned)history_memory_bytes(), (long long)query_us);
+    for (size_t i = 0; i < n; i++) {
+        if (len > (int)sizeof(buf) - 96) {
+            httpd_resp_send_chunk(req, buf, len);
+            len = 0;
+        }
+        len += snprintf(buf + len, sizeof(buf) - len, "%s[%lld,%.3f,%.3f,%.3f,%u]",
+                        i ? "," : "", (long long)out[i].t_ms, out[i].mean,
+                        out[i].min, out[i].max, (unsigned)out[i].count);
+    }
+    len += snprintf(buf + len, sizeof(buf) - len, "]}");
+    httpd_resp_send_chunk(req, buf, len);
+    free(out);
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+// GET /api/control - control loop timing (period jitter, execution time),
+// loop deadlines (misses, worst overrun), warm restart state (reset
+// reason, trip phase, fault latches) and the load estimate the auto
+// decisions use (latest sample, its inertial correction and weight)
+// GET /api/control?reset=1 - same, then clear the statistics
+static esp_err_t control_api_handler(httpd_req_t *req)
+{
+    control_stats_t cs;
+    warm_state_t warm;
+    load_estimate_t le;
+    control_task_get_stats(&cs);
+    warm_state_get(&warm);
+    load_estimator_get(&le);
+    
+    char json[1280];
+    int len = snprintf(json, sizeof(json),
+                       "{\"period_ms\":%d,\"core\":%d,\"priority\":%d,\"iterations\":%u,"
+                       "\"decisions\":%u,\"overruns\":%u,\"first_decision_ms\":%lld,"
+                       "\"last_decision_ms\":%lld,"
+                       "\"jitter_us\":{\"min\":%d,\"mean\":%d,\"max\":%d},"
+                       "\"exec_us\":{\"last\":%u,\"mean\":%u,\"max\":%u},"
+                       "\"reset_reason\":\"%s\",\"warm_resume\":%s,\"resumes\":%u,"
+                       "\"trip_phase\":\"%s\",\"faults\":%u,\"deadlines\":[",
+                       CONTROL_PERIOD_MS, CONTROL_TASK_CORE, CONTROL_TASK_PRIORITY,
+                       (unsigned)cs.iterations, (unsigned)cs.decisions, (unsigned)cs.overruns,
+                       (long long)cs.first_decision_ms, (long long)cs.last_decision_ms,
+                       (int)cs.jitter_min_us, (int)cs.jitter_mean_us, (int)cs.jitter_max_us,
+                       (unsigned)cs.exec_last_us, (unsigned)cs.exec_mean_us, (unsigned)cs.exec_max_us,
+                       warm_state_reset_reason(), warm_state_resumed() ? "true" : "false",
+                       (unsigned)warm.resumes, warm_trip_phase_name((warm_trip_phase_t)warm.trip_phase),
+                       (unsigned)warm.faults);
+    for (int i = 0; i < deadline_task_count(); i++) {
+        deadline_task_stats_t ds;
+        if (!deadline_get_stats(i, &ds) || len >= (int)sizeof(json) - 384) {
+            break;
+        }
+        len += snprintf(json + len, sizeof(json) - len,
+                        "%s{\"task\":\"%s\",\"period_ms\":%u,\"budget_ms\":%u,\"checkins\":%u,"
+                        "\"misses\":%u,\"worst_overrun_ms\":%u,\"last_miss_ms\":%lld,"
+                        "\"jitter_max_us\":%u,\"pauses\":%u}",
+                        i ? "," : "", ds.name, (unsigned)(ds.period_us / 1000),
+                        (unsigned)(ds.budget_us / 1000), (unsigned)ds.checkins, (unsigned)ds.misses,
+                        (unsigned)(ds.worst_overrun_us / 1000), (long long)ds.last_miss_ms,
+                        (unsigned)ds.jitter_max_us, (unsigned)ds.pauses);
+    }
+    snprintf(json + len, sizeof(json) - len,
+             "],\"load\":{\"load_kg\":%.3f,\"sigma_kg\":%.3f,\"measured_kg\":%.3f,"
+             "\"corrected_kg\":%.3f,\"response\":%.4f,\"gain\":%.3f,\"transient\":%s,"
+             "\"updates\":%u}}",
+             le.load_kg, le.sigma_kg, le.measured_kg, le.corrected_kg, le.response, le.gain,
+             le.transient ? "true" : "false", (unsigned)le.updates);
+    
+    char query[32];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        query_get_ll(query, "reset", 0) != 0) {
+        control_task_reset_stats();
+    }
+    return send_json(req, json);
+}
+
+// GET /api/wifi - connection quality: reconnect counters, backoff state
+// and the last WIFI_HISTORY_LEN connections (time to IP, RSSI, fast path)
+static esp_err_t wifi_api_handler(httpd_req_t *req)
+{
+    wifi_stats_t ws;
+    wifi_conn_record_t hist[WIFI_HISTORY_LEN];
+    wifi_get_stats(&ws);
+    size_t n = wifi_get_history(hist, WIFI_HISTORY_LEN);
+    
+    char buf[512];
+    int len = snprintf(buf, sizeof(buf),
+                       "{\"connected\":%s,\"ip\":\"%s\",\"rssi\":%d,\"connects\":%u,"
+                       "\"reconnects\":%u,\"disconnects\":%u,\"failed_attempts\":%u,"
+                       "\"backoff_attempt\":%u,\"boot_to_ip_ms\":%lld,\"connected_since_ms\":%lld,"
+                       "\"last_reason\":%d,\"last_disconnect_rssi\":%d,\"cached_ap\":%s,"
+                       "\"history\":[",
+                       wifi_is_connected() ? "true" : "false", wifi_get_ip(), wifi_get_rssi(),
+                       (unsigned)ws.connects, (unsigned)ws.reconnects, (unsigned)ws.disconnects,
+                       (unsigned)ws.failed_attempts, (unsigned)ws.backoff_attempt,
+                       (long long)ws.boot_to_ip_ms, (long long)ws.connected_since_ms,
+                       ws.last_reason, ws.last_disconnect_rssi, ws.cached_ap ? "true" : "false");
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send_chunk(req, buf, len);
+    
+    for (size_t i = 0; i < n; i++) {
+        len = snprintf(buf, sizeof(buf),
+                       "%s{\"t_ms\":%lld,\"time_to_ip_ms\":%u,\"attempts\":%u,"
+                       "\"rssi\":%d,\"channel\":%u,\"fast\":%s}",
+                       i ? "," : "", (long long)hist[i].uptime_ms, (unsigned)hist[i].time_to_ip_ms,
+                       (unsigned)hist[i].attempts, hist[i].rssi, (unsigned)hist[i].channel,
+                       hist[i].fast ? "true" : "false");
+        httpd_resp_send_chunk(req, buf, len);
+    }
+    httpd_resp_send_chunk(req, "]}", 2);
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+// GET /api/wifi/profile - active profile and PING/PONG round-trip time per profile
+// POST /api/wifi/profile {"profile":"low_latency|balanced|low_power"}
+static esp_err_t wifi_profile_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_POST) {
+        char body[64];
+        int ret = httpd_req_recv(req, body, sizeof(body) - 1);
+        if (ret <= 0) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing body");
+            return ESP_FAIL;
+        }
+        body[ret] = '\0';
+        
+        // Simple JSON parsing for "profile":"<name>"
+        char name[24] = "";
+        const char *v = strstr(body, "\"profile\":");
+        if (v != NULL) {
+            v = strchr(v + 10, '"');
+            if (v != NULL) {
+                sscanf(v + 1, "%23[^\"]", name);
+            }
+        }
+        wifi_profile_t profile;
+        if (!wifi_profile_from_name(name, &profile) || !wifi_set_profile(profile)) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown profile");
+            return ESP_FAIL;
+        }
+    }
+    
+    rtt_stats_t rtt[WIFI_PROFILE_COUNT];
+    portENTER_CRITICAL(&ws_lock);
+    memcpy(rtt, rtt_stats, sizeof(rtt));
+    portEXIT_CRITICAL(&ws_lock);
+    
+    char json[512];
+    int len = snprintf(json, sizeof(json), "{\"profile\":\"%s\",\"rtt_us\":{",
+                       wifi_profile_name(wifi_get_profile()));
+    for (int i = 0; i < WIFI_PROFILE_COUNT; i++) {
+        len += snprintf(json + len, sizeof(json) - len,
+                        "%s\"%s\":{\"count\":%u,\"last\":%u,\"min\":%u,\"mean\":%u,\"max\":%u}",
+                        i ? "," : "", wifi_profile_name((wifi_profile_t)i),
+                        (unsigned)rtt[i].count, (unsigned)rtt[i].last_us, (unsigned)rtt[i].min_us,
+                        (unsigned)(rtt[i].count ? rtt[i].sum_us / rtt[i].count : 0),
+                        (unsigned)rtt[i].max_us);
+    }
+    snprintf(json + len, sizeof(json) - len, "}}");
+    return send_json(req, json);
+}
+
+// Finds "key":<value> in a flat JSON body; returns a pointer to the value or NULL
+static const char *json_value(const char *body, const char *key)
+{
+    char pattern[32];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *p = strstr(body, pattern);
+    if (p == NULL) {
+        return NULL;
+    }
+    p += strlen(pattern);
+    while (*p == ' ') {
+        p++;
+    }
+    return p;
+}
+
+static int config_to_json(char *json, size_t len)
+{
+    elevator_config_t cfg;
+    config_store_get(&cfg);
+    return snprintf(json, len,
+                    "{\"calibration_factor\":%.2f,\"offset\":%ld,\"threshold\":%.2f,"
+                    "\"auto_mode\":%s,\"readings_per_sample\":%u,\"update_interval_ms\":%u,"
+                    "\"fast_boot\":%s,\"cabin_speed_mps\":%.3f,\"cabin_accel_ms\":%u,"
+                    "\"cabin_cell_hz\":%.2f,\"cabin_cell_damping\":%.3f,\"stored\":%s,\"flash_writes\":%u}",
+                    cfg.calibration_factor, (long)cfg.offset, cfg.threshold,
+                    cfg.auto_mode ? "true" : "false", (unsigned)cfg.readings_per_sample,
+                    (unsigned)cfg.update_interval_ms, cfg.fast_boot ? "true" : "false",
+                    cfg.cabin_speed_mps, (unsigned)cfg.cabin_accel_ms,
+                    cfg.cabin_cell_hz, cfg.cabin_cell_damping,
+                    config_store_loaded() ? "true" : "false",
+                    (unsigned)config_store_write_count());
+}
+
+// GET /api/config - persisted configuration
+static esp_err_t config_get_handler(httpd_req_t *req)
 {
-    motor_start_forward();
-    // Set motor state to prevent auto control from interfering
-    motor_was_triggered = true;
-    // Temporarily disable auto mode to prevent interference
-    motor_auto_mode = false;
-    ESP_LOGI(TAG, "🔄 Motor started manually FORWARD - disabling auto mode to prevent interference");
-    char json[64];
-    snprintf(json, sizeof(json), "{\"status\":\"forward\",\"success\":true}");
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    char json[320];
+    config_to_json(json, sizeof(json));
+    return send_json(req, json);
 }
 
-static esp_err_t motor_backward_handler(httpd_req_t *req)
+// Everything a config update applies to the control path, for replay
+static void capture_config(const elevator_config_t *cfg)
 {
-    motor_start_backward();
-    // Set motor state to prevent auto control from interfering
-    motor_was_triggered = true;
-    // Temporarily disable auto mode to prevent interference
-    motor_auto_mode = false;
-    ESP_LOGI(TAG, "🔄 Motor started manually BACKWARD - disabling auto mode to prevent interference");
-    char json[64];
-    snprintf(json, sizeof(json), "{\"status\":\"backward\",\"success\":true}");
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    capture_command_float(CAPTURE_CMD_SCALE, cfg->calibration_factor);
+    capture_command(CAPTURE_CMD_OFFSET, cfg->offset);
+    capture_command_float(CAPTURE_CMD_THRESHOLD, cfg->threshold);
+    capture_command(CAPTURE_CMD_AUTO_MODE, cfg->auto_mode);
+    capture_command(CAPTURE_CMD_READINGS, cfg->readings_per_sample);
+    capture_command(CAPTURE_CMD_INTERVAL, cfg->update_interval_ms);
 }
 
-static esp_err_t motor_stop_handler(httpd_req_t *req)
+// POST /api/config - update any subset of the fields returned by GET.
+// Applied immediately, written to flash after CONFIG_STORE_DEBOUNCE_MS.
+static esp_err_t config_post_handler(httpd_req_t *req)
 {
-    motor_stop();
-    // Reset motor state to allow auto control to work again
-    motor_was_triggered = false;
-    // Re-enable auto mode
-    motor_auto_mode = true;
-    ESP_LOGI(TAG, "🛑 Motor stopped manually - re-enabling auto control mode");
-    char json[64];
-    snprintf(json, sizeof(json), "{\"status\":\"stopped\",\"success\":true}");
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    char buf[256];
+    int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
+    if (ret <= 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing body");
+        return ESP_FAIL;
+    }
+    buf[ret] = '\0';
+    
+    elevator_config_t cfg;
+    config_store_get(&cfg);
+    const char *v;
+    if ((v = json_value(buf, "calibration_factor")) != NULL) cfg.calibration_factor = atof(v);
+    if ((v = json_value(buf, "offset")) != NULL) cfg.offset = atol(v);
+    if ((v = json_value(buf, "threshold")) != NULL) cfg.threshold = atof(v);
+    if ((v = json_value(buf, "auto_mode")) != NULL) cfg.auto_mode = strncmp(v, "true", 4) == 0;
+    if ((v = json_value(buf, "readings_per_sample")) != NULL) cfg.readings_per_sample = atoi(v);
+    if ((v = json_value(buf, "update_interval_ms")) != NULL) cfg.update_interval_ms = atoi(v);
+    if ((v = json_value(buf, "fast_boot")) != NULL) cfg.fast_boot = strncmp(v, "true", 4) == 0;
+    if ((v = json_value(buf, "cabin_speed_mps")) != NULL) cfg.cabin_speed_mps = atof(v);
+    if ((v = json_value(buf, "cabin_accel_ms")) != NULL) cfg.cabin_accel_ms = atoi(v);
+    if ((v = json_value(buf, "cabin_cell_hz")) != NULL) cfg.cabin_cell_hz = atof(v);
+    if ((v = json_value(buf, "cabin_cell_damping")) != NULL) cfg.cabin_cell_damping = atof(v);
+    if (!config_store_valid(&cfg)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid configuration");
+        return ESP_FAIL;
+    }
+    config_store_set(&cfg);
+    
+    // Apply to the running system
+    if (hx711_scale != NULL) {
+        hx711_set_calibration(hx711_scale, cfg.calibration_factor, cfg.offset);
+    }
+    warm_state_save_offset(cfg.offset);
+    elevator_state_t *st = shared_state_begin_update();
+    st->threshold = cfg.threshold;
+    st->auto_mode = cfg.auto_mode;
+    shared_state_end_update();
+    capture_config(&cfg);
+    serial_telemetry_event(SERIAL_EVENT_CONFIG, 0, NULL);
+    web_server_publish_status();
+    ESP_LOGI(TAG, "Configuration updated: %s", buf);
+    
+    char json[320];
+    config_to_json(json, sizeof(json));
+    return send_json(req, json);
 }
 
-static esp_err_t motor_reset_handler(httpd_req_t *req)
+// Deferred motor self-test (skipped at fast boot)
+static volatile bool selftest_running = false;
+
+static void selftest_task(void *arg)
 {
-    ESP_LOGI(TAG, "🔄 Motor system reset requested");
+    elevator_state_t es;
+    shared_state_read(&es);
     
-    // Stop motor first
-    motor_stop();
+    // Keep auto control off the motor while the test drives it
+    set_motor_flags(true, false);
+    web_server_publish_status();
+    motor_self_test();
+    set_motor_flags(false, es.auto_mode);
+    web_server_publish_status();
     
-    // Reset all motor states
-    motor_was_triggered = false;
-    motor_auto_mode = true;
+    selftest_running = false;
+    vTaskDelete(NULL);
+}
+
+// POST /api/selftest - run the motor self-test (2 s forward, 2 s backward)
+static esp_err_t selftest_handler(httpd_req_t *req)
+{
+    if (selftest_running) {
+        return send_json(req, "{\"status\":\"busy\",\"success\":false}");
+    }
+    selftest_running = true;
+    if (xTaskCreatePinnedToCore(selftest_task, "selftest", 3072, NULL, 5, NULL, 0) != pdPASS) {
+        selftest_running = false;
+        return send_json(req, "{\"status\":\"error\",\"success\":false}");
+    }
+    ESP_LOGI(TAG, "🔧 Motor self-test started via API");
+    return send_json(req, "{\"status\":\"started\",\"success\":true}");
+}
+
+// Buffered writer so metrics_render() output goes out in ~1 KB chunks
+typedef struct {
+    httpd_req_t *req;
+    size_t len;
+    char buf[1024];
+} chunk_writer_t;
+
+static void chunk_writer_flush(chunk_writer_t *w)
+{
+    if (w->len > 0) {
+        httpd_resp_send_chunk(w->req, w->buf, w->len);
+        w->len = 0;
+    }
+}
+
+static void chunk_writer_write(void *ctx, const char *data, size_t len)
+{
+    chunk_writer_t *w = (chunk_writer_t *)ctx;
+    if (w->len + len > sizeof(w->buf)) {
+        chunk_writer_flush(w);
+    }
+    if (len > sizeof(w->buf)) {
+        httpd_resp_send_chunk(w->req, data, len);
+        return;
+    }
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+// GET /metrics - Prometheus text exposition format (latency histograms,
+// error counters, heap and stack watermarks, WiFi and control loop state)
+static esp_err_t metrics_handler(httpd_req_t *req)
+{
+    chunk_writer_t *w = malloc(sizeof(chunk_writer_t));
+    if (w == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    w->req = req;
+    w->len = 0;
     
-    // Re-initialize motor driver
-    ESP_LOGI(TAG, "🔄 Re-initializing motor driver...");
-    motor_control_init();
-    vTaskDelay(pdMS_TO_TICKS(100)); // Give time for initialization
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    metrics_render(chunk_writer_write, w);
     
-    ESP_LOGI(TAG, "✅ Motor system reset completed");
-    char json[128];
-    snprintf(json, sizeof(json), "{\"status\":\"reset\",\"auto_mode\":true,\"triggered\":false,\"success\":true}");
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    wifi_stats_t ws;
+    control_stats_t cs;
+    wifi_get_stats(&ws);
+    control_task_get_stats(&cs);
+    metrics_render_value(chunk_writer_write, w, "elevator_wifi_reconnects_total", "counter",
+                         "WiFi reconnections after a lost link", ws.reconnects);
+    metrics_render_value(chunk_writer_write, w, "elevator_wifi_disconnects_total", "counter",
+                         "WiFi disconnect events", ws.disconnects);
+    metrics_render_value(chunk_writer_write, w, "elevator_wifi_failed_attempts_total", "counter",
+                         "WiFi connection attempts that failed", ws.failed_attempts);
+    metrics_render_value(chunk_writer_write, w, "elevator_wifi_rssi_dbm", "gauge",
+                         "RSSI of the current AP", wifi_get_rssi());
+    metrics_render_value(chunk_writer_write, w, "elevator_control_overruns_total", "counter",
+                         "Control iterations longer than the period", cs.overruns);
+    metrics_render_value(chunk_writer_write, w, "elevator_control_jitter_max_seconds", "gauge",
+                         "Largest control period jitter", cs.jitter_max_us / 1e6);
+    uint32_t worst_overrun_us = 0;
+    for (int i = 0; i < deadline_task_count(); i++) {
+        deadline_task_stats_t ds;
+        if (deadline_get_stats(i, &ds) && ds.worst_overrun_us > worst_overrun_us) {
+            worst_overrun_us = ds.worst_overrun_us;
+        }
+    }
+    metrics_render_value(chunk_writer_write, w, "elevator_deadline_worst_overrun_seconds", "gauge",
+                         "Largest lateness of a missed loop deadline", worst_overrun_us / 1e6);
+    metrics_render_value(chunk_writer_write, w, "elevator_config_writes_total", "counter",
+                         "Configuration writes to NVS", config_store_write_count());
+    http_workers_stats_t hw;
+    http_workers_get_stats(&hw);
+    metrics_render_value(chunk_writer_write, w, "elevator_http_worker_queued_total", "counter",
+                         "Slow requests handed to HTTP workers", hw.queued);
+    metrics_render_value(chunk_writer_write, w, "elevator_http_worker_rejected_total", "counter",
+                         "Slow requests refused with 503 (worker queue full)", hw.rejected);
+    metrics_render_value(chunk_writer_write, w, "elevator_http_worker_busy", "gauge",
+                         "HTTP workers running a handler", hw.busy);
+    metrics_render_value(chunk_writer_write, w, "elevator_http_worker_queue_depth", "gauge",
+                         "Slow requests waiting for a worker", hw.waiting);
+    deferred_log_stats_t ls;
+    deferred_log_get_stats(&ls);
+    metrics_render_value(chunk_writer_write, w, "elevator_log_records_total", "counter",
+                         "Deferred log records stored by hot paths", ls.written);
+    metrics_render_value(chunk_writer_write, w, "elevator_log_dropped_total", "counter",
+                         "Deferred log records dropped (ring full)", ls.dropped);
+    metrics_render_value(chunk_writer_write, w, "elevator_log_ring_high_water", "gauge",
+                         "Most deferred log records waiting at once", ls.high_water);
+    metrics_render_value(chunk_writer_write, w, "elevator_uptime_seconds", "gauge",
+                         "Time since boot", esp_timer_get_time() / 1e6);
+    
+    chunk_writer_flush(w);
+    free(w);
+    return httpd_resp_send_chunk(req, NULL, 0);
 }
 
-static esp_err_t motor_auto_handler(httpd_req_t *req)
+// GET /api/trace - recorded events as Chrome trace-event JSON (open in
+// chrome://tracing or ui.perfetto.dev); ?clear=1 starts a new recording
+static esp_err_t trace_api_handler(httpd_req_t *req)
 {
-    motor_auto_mode = !motor_auto_mode;
-    char json[64];
-    snprintf(json, sizeof(json), "{\"auto_mode\":%s,\"success\":true}", 
-             motor_auto_mode ? "true" : "false");
+#if TRACE_ENABLED
+    trace_event_t *events = malloc(TRACE_MAX_CORES * TRACE_RING_LEN * sizeof(trace_event_t));
+    chunk_writer_t *w = malloc(sizeof(chunk_writer_t));
+    if (events == NULL || w == NULL) {
+        free(events);
+        free(w);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    size_t n = trace_snapshot(events, TRACE_MAX_CORES * TRACE_RING_LEN);
+    
+    char query[32];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        query_get_ll(query, "clear", 0) != 0) {
+        trace_clear();
+    }
+    
+    w->req = req;
+    w->len = 0;
     httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    httpd_resp_set_hdr(req, "Content-Disposition", "inline; filename=\"elevator_trace.json\"");
+    trace_render_json(events, n, chunk_writer_write, w);
+    chunk_writer_flush(w);
+    free(w);
+    free(events);
+    return httpd_resp_send_chunk(req, NULL, 0);
+#else
+    httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Tracing disabled (build with TRACE_ENABLED=1)");
+    return ESP_FAIL;
+#endif
 }
 
-static esp_err_t motor_threshold_handler(httpd_req_t *req)
+// GET /api/capture - download the sensor/command capture (see capture.h)
+// for host replay; POST {"action":"start"} or {"action":"stop"} controls it
+static esp_err_t capture_api_handler(httpd_req_t *req)
 {
     if (req->method == HTTP_POST) {
-        char buf[100];
-        int ret = httpd_req_recv(req, buf, sizeof(buf));
-        if (ret > 0) {
-            buf[ret] = '\0';
-            ESP_LOGI(TAG, "Received threshold data: %s", buf);
-            
-            // Simple JSON parsing for threshold
-            char *threshold_str = strstr(buf, "\"threshold\":");
-            if (threshold_str) {
-                threshold_str += 12; // Skip "threshold":
-                weight_threshold = atof(threshold_str);
-                ESP_LOGI(TAG, "Weight threshold set to %.2f kg", weight_threshold);
-            } else {
-                ESP_LOGW(TAG, "No threshold found in data: %s", buf);
-            }
+        char buf[64];
+        int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
+        buf[ret > 0 ? ret : 0] = '\0';
+        const char *action = json_value(buf, "action");
+        if (action != NULL && strncmp(action, "\"start\"", 7) == 0) {
+            elevator_config_t cfg;
+            elevator_state_t es;
+            config_store_get(&cfg);
+            shared_state_read(&es);
+            capture_header_t header = {
+                .calibration_factor = hx711_scale ? hx711_scale->scale : cfg.calibration_factor,
+                .offset = hx711_scale ? (int32_t)hx711_scale->offset : cfg.offset,
+                .threshold = es.threshold,
+                .update_interval_ms = cfg.update_interval_ms,
+                .readings_per_sample = cfg.readings_per_sample,
+                .auto_mode = es.auto_mode,
+                .motor_triggered = es.motor_triggered
+            };
+            capture_start(&header);
+            ESP_LOGI(TAG, "⏺️  Capture started (%u bytes buffer)", (unsigned)CAPTURE_BUF_SIZE);
+        } else if (action != NULL && strncmp(action, "\"stop\"", 6) == 0) {
+            capture_stop();
+            ESP_LOGI(TAG, "⏹️  Capture stopped (%u bytes)", (unsigned)capture_size());
         } else {
-            ESP_LOGW(TAG, "No data received for threshold");
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected {\"action\":\"start\"|\"stop\"}");
+            return ESP_FAIL;
         }
+        char json[96];
+        snprintf(json, sizeof(json), "{\"active\":%s,\"bytes\":%u,\"capacity\":%u}",
+                 capture_active() ? "true" : "false", (unsigned)capture_size(),
+                 (unsigned)CAPTURE_BUF_SIZE);
+        return send_json(req, json);
     }
     
-    char json[64];
-    snprintf(json, sizeof(json), "{\"threshold\":%.2f,\"success\":true}", weight_threshold);
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    if (capture_size() == 0) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No capture (POST {\"action\":\"start\"} first)");
+        return ESP_FAIL;
+    }
+    chunk_writer_t *w = malloc(sizeof(chunk_writer_t));
+    if (w == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"elevator.cap\"");
+    // Append-only buffer: the size taken now is a consistent prefix
+    size_t total = capture_size();
+    esp_err_t err = ESP_OK;
+    for (size_t off = 0; off < total && err == ESP_OK; ) {
+        size_t n = capture_copy(off, (uint8_t *)w->buf, total - off < sizeof(w->buf) ? total - off : sizeof(w->buf));
+        if (n == 0) {
+            break;
+        }
+        err = httpd_resp_send_chunk(req, w->buf, n);
+        off += n;
+    }
+    free(w);
+    return err == ESP_OK ? httpd_resp_send_chunk(req, NULL, 0) : err;
 }
 
-// HTML Dashboard - embedded in firmware
-static const char *html_dashboard = 
-"<!DOCTYPE html>"
-"<html>"
-"<head>"
-"<meta charset='UTF-8'>"
-"<meta name='viewport' content='width=device-width, initial-scale=1.0'>"
-"<title>HX711 Load Cell Monitor</title>"
-"<style>"
-"body{font-family:Arial,sans-serif;margin:0;padding:20px;background:#f5f5f5}"
-".container{max-width:800px;margin:0 auto;background:white;border-radius:10px;box-shadow:0 2px 10px rgba(0,0,0,0.1);padding:20px}"
-"h1{color:#333;text-align:center;margin-bottom:30px}"
-".status{display:flex;justify-content:space-around;margin-bottom:30px}"
-".metric{text-align:center;padding:20px;background:#f8f9fa;border-radius:8px;border:2px solid #e9ecef}"
-".metric h3{margin:0 0 10px 0;color:#666;font-size:14px;text-transform:uppercase}"
-".metric .value{font-size:32px;font-weight:bold;color:#007bff;margin:0}"
-".chart-container{background:#f8f9fa;border-radius:8px;padding:20px;margin-bottom:20px}"
-"canvas{border:1px solid #ddd;border-radius:4px;background:white}"
-".controls{text-align:center}"
-"button{background:#007bff;color:white;border:none;padding:12px 24px;border-radius:6px;cursor:pointer;margin:0 10px;font-size:16px}"
-"button:hover{background:#0056b3}"
-"button:disabled{background:#6c757d;cursor:not-allowed}"
-"</style>"
-"</head>"
-"<body>"
-"<div class='container'>"
-"<h1>🔧 HX711 Load Cell Monitor</h1>"
-"<div class='status'>"
-"<div class='metric'>"
-"<h3>Real-time Weight</h3>"
-"<div class='value' id='weight'>0.00</div>"
-"</div>"
-"<div class='metric'>"
-"<h3>Stable Weight</h3>"
-"<div class='value' id='stable-weight'>0.00</div>"
-"<div class='status' id='status' style='font-size:12px;color:#666;margin-top:5px;'></div>"
-"</div>"
-"<div class='metric'>"
-"<h3>Raw Value</h3>"
-"<div class='value' id='raw'>0</div>"
-"</div>"
-"</div>"
-"<div class='status' style='margin-top:20px;'>"
-"<div class='metric' style='background:#f8f9fa;border:2px solid #e9ecef;'>"
-"<h3>🔧 HX711 Sensor</h3>"
-"<div class='value' id='sensor-status' style='font-size:18px;color:#28a745;'>Ready</div>"
-"</div>"
-"<div class='metric' style='background:#f8f9fa;border:2px solid #e9ecef;'>"
-"<h3>📡 ESP32 Status</h3>"
-"<div class='value' id='esp-status' style='font-size:18px;color:#28a745;'>Online</div>"
-"</div>"
-"<div class='metric' style='background:#f8f9fa;border:2px solid #e9ecef;'>"
-"<h3>🌐 WiFi</h3>"
-"<div class='value' id='wifi-status' style='font-size:18px;color:#28a745;'>Connected</div>"
-"</div>"
-"</div>"
-"<div class='chart-container'>"
-"<canvas id='chart' width='760' height='200'></canvas>"
-"</div>"
-"<div class='controls'>"
-"<button onclick='zeroScale()'>Zero Scale</button>"
-"<button onclick='clearChart()'>Clear Chart</button>"
-"</div>"
-"<div class='status' style='margin-top:20px;'>"
-"<div class='metric' style='background:#fff3cd;border:2px solid #ffeaa7;'>"
-"<h3>🚀 Motor Control</h3>"
-"<div class='value' id='motor-status' style='font-size:18px;color:#856404;'>Stopped</div>"
-"<div style='margin-top:10px;'>"
-"<button onclick='motorForward()' id='btn-forward'>Forward</button>"
-"<button onclick='motorBackward()' id='btn-backward'>Backward</button>"
-"<button onclick='motorStop()' id='btn-stop'>Stop</button>"
-"<button onclick='motorReset()' id='btn-reset' style='background:#dc3545;color:white;'>Reset Motor</button>"
-"</div>"
-"</div>"
-"<div class='metric' style='background:#d1ecf1;border:2px solid #bee5eb;'>"
-"<h3>⚙️ Auto Control</h3>"
-"<div class='value' id='auto-status' style='font-size:18px;color:#0c5460;'>Manual</div>"
-"<div style='margin-top:10px;'>"
-"<button onclick='toggleAutoMode()' id='btn-auto'>Enable Auto</button>"
-"<div style='margin-top:10px;'>"
-"<label>Threshold: <input type='number' id='threshold' value='3.0' step='0.1' style='width:60px;'> kg</label>"
-"<button onclick='setThreshold()'>Set</button>"
-"</div>"
-"</div>"
-"</div>"
-"</div>"
-"</div>"
-"<script>"
-"let data=[];"
-"let zeroOffset=0;"
-"const canvas=document.getElementById('chart');"
-"const ctx=canvas.getContext('2d');"
-"function updateData(){"
-"  fetch('/api/weight')"
-"    .then(response=>response.json())"
-"    .then(result=>{"
-"      document.getElementById('weight').textContent=result.weight.toFixed(2);"
-"      document.getElementById('raw').textContent=result.raw;"
-"      if(result.status==='Stable'){"
-"        document.getElementById('stable-weight').textContent=result.weight.toFixed(2);"
-"        document.getElementById('status').textContent='Stable';"
-"        document.getElementById('status').style.color='#28a745';"
-"      }else if(result.status==='Calculating...'){"
-"        document.getElementById('status').textContent='Calculating...';"
-"        document.getElementById('status').style.color='#ff6b35';"
-"      }"
-"      if(result.sensor_ready){"
-"        document.getElementById('sensor-status').textContent='Ready';"
-"        document.getElementById('sensor-status').style.color='#28a745';"
-"      }else{"
-"        document.getElementById('sensor-status').textContent='Not Ready';"
-"        document.getElementById('sensor-status').style.color='#dc3545';"
-"      }"
-"      document.getElementById('esp-status').textContent='Online';"
-"      document.getElementById('esp-status').style.color='#28a745';"
-"      document.getElementById('wifi-status').textContent='Connected';"
-"      document.getElementById('wifi-status').style.color='#28a745';"
-"      data.push({weight:result.weight,time:Date.now()});"
-"      if(data.length>100)data.shift();"
-"      drawChart();"
-"    })"
-"    .catch(error=>{"
-"      console.error('Error:',error);"
-"      document.getElementById('esp-status').textContent='Offline';"
-"      document.getElementById('esp-status').style.color='#dc3545';"
-"      document.getElementById('wifi-status').textContent='Disconnected';"
-"      document.getElementById('wifi-status').style.color='#dc3545';"
-"    });"
-"}"
-"function drawChart(){"
-"const w=canvas.width;const h=canvas.height;"
-"ctx.clearRect(0,0,w,h);"
-"if(data.length<2)return;"
-"const maxW=Math.max(...data.map(d=>d.weight),1);"
-"const minW=Math.min(...data.map(d=>d.weight),0);"
-"const range=maxW-minW||1;"
-"ctx.beginPath();"
-"ctx.strokeStyle='#007bff';"
-"ctx.lineWidth=2;"
-"data.forEach((d,i)=>{"
-"const x=(i/(data.length-1))*w;"
-"const y=h-(((d.weight-minW)/range)*h*0.8+h*0.1);"
-"i===0?ctx.moveTo(x,y):ctx.lineTo(x,y);"
-"});"
-"ctx.stroke();"
-"ctx.fillStyle='#666';"
-"ctx.font='12px Arial';"
-"ctx.fillText(maxW.toFixed(2)+' kg',5,15);"
-"ctx.fillText(minW.toFixed(2)+' kg',5,h-5);"
-"}"
-"function clearChart(){data.length=0;drawChart();}"
-"function zeroScale(){"
-"  fetch('/api/zero',{method:'POST'})"
-"    .then(response=>response.json())"
-"    .then(result=>{"
-"      console.log('Scale zeroed:',result);"
-"      alert('Scale zeroed successfully!');"
-"    })"
-"    .catch(error=>{"
-"      console.error('Error zeroing scale:',error);"
-"      alert('Error zeroing scale');"
-"    });"
-"}"
-"function motorForward(){"
-"  fetch('/api/motor/forward',{method:'POST'})"
-"    .then(response=>response.json())"
-"    .then(result=>{"
-"      console.log('Motor forward:',result);"
-"      document.getElementById('motor-status').textContent='Forward';"
-"      document.getElementById('motor-status').style.color='#28a745';"
-"    })"
-"    .catch(error=>{"
-"      console.error('Error starting motor:',error);"
-"    });"
-"}"
-"function motorBackward(){"
-"  fetch('/api/motor/backward',{method:'POST'})"
-"    .then(response=>response.json())"
-"    .then(result=>{"
-"      console.log('Motor backward:',result);"
-"      document.getElementById('motor-status').textContent='Backward';"
-"      document.getElementById('motor-status').style.color='#ffc107';"
-"    })"
-"    .catch(error=>{"
-"      console.error('Error starting motor:',error);"
-"    });"
-"}"
-"function motorStop(){"
-"  fetch('/api/motor/stop',{method:'POST'})"
-"    .then(response=>response.json())"
-"    .then(result=>{"
-"      console.log('Motor stop:',result);"
-"      document.getElementById('motor-status').textContent='Stopped';"
-"      document.getElementById('motor-status').style.color='#dc3545';"
-"    })"
-"    .catch(error=>{"
-"      console.error('Error stopping motor:',error);"
-"    });"
-"}"
-"function motorReset(){"
-"  if(confirm('Reset motor system? This will reinitialize the motor driver.')){"
-"    fetch('/api/motor/reset',{method:'POST'})"
-"      .then(response=>response.json())"
-"      .then(result=>{"
-"        console.log('Motor reset:',result);"
-"        document.getElementById('motor-status').textContent='Reset';"
-"        document.getElementById('motor-status').style.color='#6c757d';"
-"        document.getElementById('auto-status').textContent='Auto ON';"
-"        document.getElementById('auto-status').style.color='#28a745';"
-"        document.getElementById('btn-auto').textContent='Disable Auto';"
-"        alert('Motor system reset completed!');"
-"      })"
-"      .catch(error=>{"
-"        console.error('Error resetting motor:',error);"
-"        alert('Error resetting motor system');"
-"      });"
-"  }"
-"}"
-"function toggleAutoMode(){"
-"  fetch('/api/motor/auto',{method:'POST'})"
-"    .then(response=>response.json())"
-"    .then(result=>{"
-"      console.log('Auto mode:',result);"
-"      if(result.auto_mode){"
-"        document.getElementById('auto-status').textContent='Auto ON';"
-"        document.getElementById('auto-status').style.color='#28a745';"
-"        document.getElementById('btn-auto').textContent='Disable Auto';"
-"      }else{"
-"        document.getElementById('auto-status').textContent='Manual';"
-"        document.getElementById('auto-status').style.color='#0c5460';"
-"        document.getElementById('btn-auto').textContent='Enable Auto';"
-"      }"
-"    })"
-"    .catch(error=>{"
-"      console.error('Error toggling auto mode:',error);"
-"    });"
-"}"
-"function setThreshold(){"
-"  const threshold=document.getElementById('threshold').value;"
-"  fetch('/api/motor/threshold',{"
-"    method:'POST',"
-"    headers:{'Content-Type':'application/json'},"
-"    body:JSON.stringify({threshold:parseFloat(threshold)})"
-"  })"
-"    .then(response=>response.json())"
-"    .then(result=>{"
-"      console.log('Threshold set:',result);"
-"      alert('Threshold set to '+threshold+' kg');"
-"    })"
-"    .catch(error=>{"
-"      console.error('Error setting threshold:',error);"
-"    });"
-"}"
-"window.onload=function(){"
-"  updateData();"
-"  setInterval(updateData,2000);"
-"};"
-"</script>"
-"</body>"
-"</html>";
+static bool sample_log_emit(void *ctx, const uint8_t *block, size_t len)
+{
+    chunk_writer_write(ctx, (const char *)block, len);
+    return true;
+}
 
-// API handler for weight data
-static esp_err_t weight_api_handler(httpd_req_t *req)
+// GET /api/log - download the flash sample log (see sample_log.h), oldest
+// block first; ?blocks=N limits it to the newest N blocks, ?stats=1 returns
+// the log counters instead. Reading ~2.5 MB of flash runs on an HTTP worker.
+static esp_err_t sample_log_api_handler(httpd_req_t *req)
 {
-    // Check if HX711 is ready
-    bool sensor_ready = false;
-    if (hx711_scale != NULL) {
-        sensor_ready = hx711_is_ready(hx711_scale);
+    if (!sample_log_ready()) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No samplelog partition");
+        return ESP_FAIL;
     }
     
-    // Get current weight and status
-    char json[256];
-    if (is_calculating) {
-        snprintf(json, sizeof(json), "{\"weight\":%.2f,\"raw\":%ld,\"status\":\"Calculating...\",\"sensor_ready\":%s}", 
-                 current_weight, current_raw, sensor_ready ? "true" : "false");
-    } else {
-        snprintf(json, sizeof(json), "{\"weight\":%.2f,\"raw\":%ld,\"status\":\"Stable\",\"sensor_ready\":%s}", 
-                 current_weight, current_raw, sensor_ready ? "true" : "false");
+    char query[32] = "";
+    httpd_req_get_url_query_str(req, query, sizeof(query));
+    if (query_get_ll(query, "stats", 0) != 0) {
+        sample_log_stats_t st;
+        sample_log_get_stats(&st);
+        char json[320];
+        snprintf(json, sizeof(json),
+                 "{\"capacity_blocks\":%lu,\"used_blocks\":%lu,\"seq\":%lu,\"boot\":%u,"
+                 "\"samples\":%lu,\"bytes_per_sample\":%.2f,\"blocks_written\":%lu,"
+                 "\"partial_blocks\":%lu,\"sectors_erased\":%lu,\"write_errors\":%lu,"
+                 "\"write_us_max\":%lu}",
+                 (unsigned long)st.capacity_blocks, (unsigned long)st.used_blocks,
+                 (unsigned long)st.seq, st.boot, (unsigned long)st.samples,
+                 st.samples ? (double)st.payload_bytes / st.samples : 0.0,
+                 (unsigned long)st.blocks_written, (unsigned long)st.partial_blocks,
+                 (unsigned long)st.sectors_erased, (unsigned long)st.write_errors,
+                 (unsigned long)st.write_us_max);
+        return send_json(req, json);
     }
     
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    if (!http_workers_on_worker()) {
+        return offload(req, sample_log_api_handler);
+    }
+    
+    chunk_writer_t *w = malloc(sizeof(chunk_writer_t));
+    if (w == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    w->req = req;
+    w->len = 0;
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"sample_log.bin\"");
+    long long max_blocks = query_get_ll(query, "blocks", 0);
+    size_t blocks = sample_log_read(max_blocks > 0 ? (size_t)max_blocks : 0, sample_log_emit, w);
+    chunk_writer_flush(w);
+    free(w);
+    ESP_LOGI(TAG, "📒 Sample log download: %u blocks", (unsigned)blocks);
+    return httpd_resp_send_chunk(req, NULL, 0);
 }
 
-// API handler for zeroing the scale
-static esp_err_t zero_api_handler(httpd_req_t *req)
+// Static asset handler (user_ctx = www_asset_t). Answers 304 when the
+// browser already has this ETag, otherwise streams the gzipped asset in
+// chunks straight from flash without copying it to RAM.
+static esp_err_t www_asset_handler(httpd_req_t *req)
 {
-    if (req->method == HTTP_POST) {
-        if (hx711_scale != NULL) {
-            // Call the HX711 zero function
-            hx711_zero_scale(hx711_scale);
-            
-            char json[64];
-            snprintf(json, sizeof(json), "{\"status\":\"success\",\"message\":\"Scale zeroed\"}");
-            
-            httpd_resp_set_type(req, "application/json");
-            httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
-            
-            ESP_LOGI(TAG, "Scale zeroed successfully");
-            return ESP_OK;
-        } else {
-            char json[64];
-            snprintf(json, sizeof(json), "{\"status\":\"error\",\"message\":\"HX711 not initialized\"}");
-            
-            httpd_resp_set_type(req, "application/json");
-            httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
-            
-            ESP_LOGE(TAG, "HX711 not initialized for zeroing");
+    const www_asset_t *asset = (const www_asset_t *)req->user_ctx;
+    
+    httpd_resp_set_hdr(req, "ETag", asset->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", asset->cache_control);
+    
+    char if_none_match[40];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match,
+                                    sizeof(if_none_match)) == ESP_OK &&
+        strcmp(if_none_match, asset->etag) == 0) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+    
+    httpd_resp_set_type(req, asset->type);
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    
+    const uint8_t *pos = asset->start;
+    while (pos < asset->end) {
+        size_t len = asset->end - pos;
+        if (len > WWW_CHUNK_SIZE) {
+            len = WWW_CHUNK_SIZE;
+        }
+        if (httpd_resp_send_chunk(req, (const char *)pos, len) != ESP_OK) {
+            ESP_LOGW(TAG, "Asset transfer aborted for %s", req->uri);
             return ESP_FAIL;
         }
+        pos += len;
     }
-    
-    httpd_resp_send_404(req);
-    return ESP_FAIL;
+    return httpd_resp_send_chunk(req, NULL, 0);
 }
 
-// Root page handler
-static esp_err_t root_handler(httpd_req_t *req)
+// Every handler is registered through a timing trampoline: user_ctx points
+// at the original handler and context, the duration goes to /metrics
+typedef struct {
+    esp_err_t (*handler)(httpd_req_t *req);
+    void *user_ctx;
+    const char *uri;
+    int slot;
+} timed_handler_t;
+
+static timed_handler_t timed_handlers[METRICS_HTTP_MAX_URIS];
+static int timed_handler_count = 0;
+
+static esp_err_t timed_handler(httpd_req_t *req)
 {
-    httpd_resp_set_type(req, "text/html");
-    httpd_resp_send(req, html_dashboard, HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    const timed_handler_t *th = (const timed_handler_t *)req->user_ctx;
+    req->user_ctx = th->user_ctx;
+    int64_t start_us = esp_timer_get_time();
+    TRACE_BEGIN(th->uri);
+    esp_err_t ret = th->handler(req);
+    TRACE_END(th->uri);
+    metrics_http_observe(th->slot, (uint32_t)(esp_timer_get_time() - start_us));
+    return ret;
+}
+
+static esp_err_t register_handler(httpd_uri_t *uri)
+{
+    if (timed_handler_count < METRICS_HTTP_MAX_URIS) {
+        timed_handler_t *th = &timed_handlers[timed_handler_count++];
+        th->handler = uri->handler;
+        th->user_ctx = uri->user_ctx;
+        th->uri = uri->uri;
+        th->slot = metrics_http_register(uri->uri, http_method_str(uri->method));
+        uri->handler = timed_handler;
+        uri->user_ctx = th;
+    }
+    return httpd_register_uri_handler(server, uri);
 }
 
 void web_server_init(void)
 {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.server_port = WEB_SERVER_PORT;
-    config.max_uri_handlers = 20;  // Increase from default 8 to 20
+    config.max_uri_handlers = 28;  // Increase from default 8 to 28
     config.max_resp_headers = 10;  // Increase from default 8 to 10
+    config.close_fn = ws_session_closed;  // Drop WebSocket clients when sockets close
+    config.core_id = 0;                   // Keep httpd off the control core
+    
+    // Requests parked on HTTP workers keep their socket open, so allow more
+    // sockets than workers + queue, recycle the least recently used one
+    // instead of refusing new clients, and drop dead peers via TCP keep-alive
+    config.max_open_sockets = 12;         // Needs CONFIG_LWIP_MAX_SOCKETS >= 15
+    config.lru_purge_enable = true;
+    config.keep_alive_enable = true;
+    config.keep_alive_idle = 5;           // Seconds idle before the first probe
+    config.keep_alive_interval = 5;
+    config.keep_alive_count = 3;
+    config.recv_wait_timeout = 5;
+    config.send_wait_timeout = 5;
+    
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        ws_clients[i].fd = -1;
+    }
+    
+    if (history_mutex == NULL) {
+        history_mutex = xSemaphoreCreateMutex();
+    }
+    if (status_writer_mutex == NULL) {
+        status_writer_mutex = xSemaphoreCreateMutex();
+    }
+    ESP_LOGI(TAG, "History store: %u bytes", (unsigned)history_memory_bytes());
     
     ESP_LOGI(TAG, "Starting web server on port %d", config.server_port);
     
+    if (http_workers_init() != ESP_OK) {
+        ESP_LOGW(TAG, "HTTP workers unavailable - slow requests will get 503");
+    }
+    
     if (httpd_start(&server, &config) == ESP_OK) {
-        // Root page
+        // Dashboard page and its assets
         httpd_uri_t root = {
             .uri = "/",
             .method = HTTP_GET,
-            .handler = root_handler,
-            .user_ctx = NULL
+            .handler = www_asset_handler,
+            .user_ctx = (void *)&www_index
+        };
+        register_handler(&root);
+        
+        httpd_uri_t app_js = {
+            .uri = "/app.js",
+            .method = HTTP_GET,
+            .handler = www_asset_handler,
+            .user_ctx = (void *)&www_app_js
         };
-        httpd_register_uri_handler(server, &root);
+        register_handler(&app_js);
+        
+        httpd_uri_t style_css = {
+            .uri = "/style.css",
+            .method = HTTP_GET,
+            .handler = www_asset_handler,
+            .user_ctx = (void *)&www_style_css
+        };
+        register_handler(&style_css);
         
         // API endpoint for weight data
         httpd_uri_t api = {
@@ -496,7 +1741,86 @@ void web_server_init(void)
             .handler = weight_api_handler,
             .user_ctx = NULL
         };
-        httpd_register_uri_handler(server, &api);
+        register_handler(&api);
+        
+        // API endpoint for aggregated system status
+        httpd_uri_t status_api = {
+            .uri = "/api/status",
+            .method = HTTP_GET,
+            .handler = status_api_handler,
+            .user_ctx = NULL
+        };
+        register_handler(&status_api);
+        
+        // API endpoint for weight history
+        httpd_uri_t history_api = {
+            .uri = "/api/history",
+            .method = HTTP_GET,
+            .handler = history_api_handler,
+            .user_ctx = NULL
+        };
+        register_handler(&history_api);
+        
+        // API endpoint for control loop timing
+        httpd_uri_t control_api = {
+            .uri = "/api/control",
+            .method = HTTP_GET,
+            .handler = control_api_handler,
+            .user_ctx = NULL
+        };
+        register_handler(&control_api);
+        
+        // WiFi connection quality
+        httpd_uri_t wifi_api = {
+            .uri = "/api/wifi",
+            .method = HTTP_GET,
+            .handler = wifi_api_handler,
+            .user_ctx = NULL
+        };
+        register_handler(&wifi_api);
+        
+        // WiFi latency / power profile
+        httpd_uri_t wifi_profile_get = {
+            .uri = "/api/wifi/profile",
+            .method = HTTP_GET,
+            .handler = wifi_profile_handler,
+            .user_ctx = NULL
+        };
+        register_handler(&wifi_profile_get);
+        
+        httpd_uri_t wifi_profile_post = {
+            .uri = "/api/wifi/profile",
+            .method = HTTP_POST,
+            .handler = wifi_profile_handler,
+            .user_ctx = NULL
+        };
+        register_handler(&wifi_profile_post);
+        
+        // Persisted configuration
+        httpd_uri_t config_get = {
+            .uri = "/api/config",
+            .method = HTTP_GET,
+            .handler = config_get_handler,
+            .user_ctx = NULL
+        };
+        register_handler(&config_get);
+        
+        httpd_uri_t config_post = {
+            .uri = "/api/config",
+            .method = HTTP_POST,
+            .handler = config_post_handler,
+            .user_ctx = NULL
+        };
+        register_handler(&config_post);
+        
+        // Deferred motor self-test
+        httpd_uri_t selftest = {
+            .uri = "/api/selftest",
+            .method = HTTP_POST,
+            .handler = selftest_handler,
+            .user_ctx = NULL
+        };
+        register_handler(&selftest);
         
         // API endpoint for zeroing the scale
         httpd_uri_t zero_api = {
@@ -505,7 +1829,16 @@ void web_server_init(void)
             .handler = zero_api_handler,
             .user_ctx = NULL
         };
-        httpd_register_uri_handler(server, &zero_api);
+        register_handler(&zero_api);
+        
+        // HX711 SCK pulse-width benchmark (IRAM vs flash)
+        httpd_uri_t hx711_pulse = {
+            .uri = "/api/hx711/pulse",
+            .method = HTTP_POST,
+            .handler = hx711_pulse_handler,
+            .user_ctx = NULL
+        };
+        register_handler(&hx711_pulse);
         
         // Motor control API endpoints
         httpd_uri_t motor_forward = {
@@ -514,7 +1847,7 @@ void web_server_init(void)
             .handler = motor_forward_handler,
             .user_ctx = NULL
         };
-        httpd_register_uri_handler(server, &motor_forward);
+        register_handler(&motor_forward);
         
         httpd_uri_t motor_backward = {
             .uri = "/api/motor/backward",
@@ -522,7 +1855,7 @@ void web_server_init(void)
             .handler = motor_backward_handler,
             .user_ctx = NULL
         };
-        httpd_register_uri_handler(server, &motor_backward);
+        register_handler(&motor_backward);
         
         httpd_uri_t motor_stop = {
             .uri = "/api/motor/stop",
@@ -530,7 +1863,7 @@ void web_server_init(void)
             .handler = motor_stop_handler,
             .user_ctx = NULL
         };
-        httpd_register_uri_handler(server, &motor_stop);
+        register_handler(&motor_stop);
         
         httpd_uri_t motor_reset = {
             .uri = "/api/motor/reset",
@@ -538,7 +1871,7 @@ void web_server_init(void)
             .handler = motor_reset_handler,
             .user_ctx = NULL
         };
-        httpd_register_uri_handler(server, &motor_reset);
+        register_handler(&motor_reset);
         
         httpd_uri_t motor_auto = {
             .uri = "/api/motor/auto",
@@ -546,7 +1879,7 @@ void web_server_init(void)
             .handler = motor_auto_handler,
             .user_ctx = NULL
         };
-        httpd_register_uri_handler(server, &motor_auto);
+        register_handler(&motor_auto);
         
         httpd_uri_t motor_threshold = {
             .uri = "/api/motor/threshold",
@@ -554,9 +1887,93 @@ void web_server_init(void)
             .handler = motor_threshold_handler,
             .user_ctx = NULL
         };
-        httpd_register_uri_handler(server, &motor_threshold);
+        register_handler(&motor_threshold);
         ESP_LOGI(TAG, "Registered /api/motor/threshold endpoint");
         
+        // WebSocket: telemetry push + motor commands
+        httpd_uri_t ws = {
+            .uri = "/ws",
+            .method = HTTP_GET,
+            .handler = ws_handler,
+            .user_ctx = NULL,
+            .is_websocket = true,
+            .handle_ws_control_frames = true,  // PONG timestamps for RTT
+            .supported_subprotocol = TELEMETRY_WS_SUBPROTOCOL
+        };
+        register_handler(&ws);
+        ESP_LOGI(TAG, "Registered /ws WebSocket endpoint");
+        
+        // Prometheus scrape endpoint
+        httpd_uri_t metrics = {
+            .uri = "/metrics",
+            .method = HTTP_GET,
+            .handler = metrics_handler,
+            .user_ctx = NULL
+        };
+        register_handler(&metrics);
+        ESP_LOGI(TAG, "Registered /metrics endpoint");
+        
+        // Event trace export (TRACE_ENABLED builds)
+        httpd_uri_t trace_api = {
+            .uri = "/api/trace",
+            .method = HTTP_GET,
+            .handler = trace_api_handler,
+            .user_ctx = NULL
+        };
+        register_handler(&trace_api);
+        ESP_LOGI(TAG, "Registered /api/trace endpoint");
+        
+        // Sensor/command capture for host replay
+        httpd_uri_t capture_get = {
+            .uri = "/api/capture",
+            .method = HTTP_GET,
+            .handler = capture_api_handler,
+            .user_ctx = NULL
+        };
+        register_handler(&capture_get);
+        httpd_uri_t capture_post = {
+            .uri = "/api/capture",
+            .method = HTTP_POST,
+            .handler = capture_api_handler,
+            .user_ctx = NULL
+        };
+        register_handler(&capture_post);
+        ESP_LOGI(TAG, "Registered /api/capture endpoint");
+        
+        // Flash sample log download
+        httpd_uri_t sample_log_api = {
+            .uri = "/api/log",
+            .method = HTTP_GET,
+            .handler = sample_log_api_handler,
+            .user_ctx = NULL
+        };
+        register_handler(&sample_log_api);
+        ESP_LOGI(TAG, "Registered /api/log endpoint");
+        
+        // Status re-publish requested by the control loops
+        const esp_timer_create_args_t publish_args = {
+            .callback = publish_timer_cb,
+            .name = "ws_publish"
+        };
+        esp_timer_create(&publish_args, &publish_timer);
+        
+        // Follow-up WebSocket flush when a client's rate cap expires
+        const esp_timer_create_args_t flush_args = {
+            .callback = ws_flush_timer_cb,
+            .name = "ws_flush"
+        };
+        esp_timer_create(&flush_args, &ws_flush_timer);
+        
+        // Periodic PING to WebSocket clients for RTT measurement
+        const esp_timer_create_args_t ping_args = {
+            .callback = ws_ping_timer_cb,
+            .name = "ws_ping"
+        };
+        if (esp_timer_create(&ping_args, &ws_ping_timer) == ESP_OK) {
+            esp_timer_start_periodic(ws_ping_timer, (uint64_t)WS_PING_INTERVAL_MS * 1000);
+        }
+        
+        server_ready = true;
         ESP_LOGI(TAG, "Web server started successfully");
     } else {
         ESP_LOGE(TAG, "Failed to start web server");
@@ -566,8 +1983,14 @@ void web_server_init(void)
 void web_server_send_weight(float weight_kg, long raw_value)
 {
     // Store current values for API endpoint
-    current_weight = weight_kg;
-    current_raw = raw_value;
+    // No motion information here: the sample counts as the load as is
+    elevator_state_t *st = shared_state_begin_update();
+    st->weight = weight_kg;
+    st->load = weight_kg;
+    st->raw = raw_value;
+    st->sample_ms = esp_timer_get_time() / 1000;
+    shared_state_end_update();
+    web_server_publish_status();
 }
 
 void web_server_set_hx711(hx711_t* hx711)
@@ -576,157 +1999,55 @@ void web_server_set_hx711(hx711_t* hx711)
     ESP_LOGI(TAG, "HX711 pointer set for web server");
 }
 
-// Smart weight measurement function
+// Record a sample (already published to the shared state by the sampler)
+// into the on-device history and push it to /ws clients. Does nothing
+// until the web server is up; the control path does not depend on it.
 void web_server_process_weight(float weight_kg, long raw_value)
 {
-    static int64_t calculation_start_ms = 0;
-    static bool first_run = true;
-    
-    // Update current values
-    current_weight = weight_kg;
-    current_raw = raw_value;
-    
-    // Initialize on first run
-    if (first_run) {
-        last_stable_weight = weight_kg;
-        stable_weight = weight_kg;
-        first_run = false;
-        ESP_LOGI(TAG, "✓ Initial weight set: %.2f kg", weight_kg);
-        
-        // Check motor auto control on first run
-        if (motor_auto_mode) {
-            if (weight_kg >= weight_threshold && !motor_was_triggered) {
-                motor_start_forward();
-                motor_was_triggered = true;
-                ESP_LOGI(TAG, "🚀 Motor started - weight %.2f kg >= threshold %.2f kg", 
-                         weight_kg, weight_threshold);
-            } else if (weight_kg < weight_threshold && motor_was_triggered) {
-                motor_stop();
-                motor_was_triggered = false;
-                ESP_LOGI(TAG, "🛑 Motor stopped - weight %.2f kg < threshold %.2f kg", 
-                         weight_kg, weight_threshold);
-            }
-        }
-        return;
-    }
+    int64_t now_ms = esp_timer_get_time() / 1000;
     
-    // Check motor auto control immediately for instant response
-    if (motor_auto_mode) {
-        // Check if motor was physically stopped (reset state if needed)
-        if (motor_was_triggered && weight_kg < weight_threshold) {
-            // Motor was running but weight is below threshold - reset state
-            motor_was_triggered = false;
-            ESP_LOGI(TAG, "🔄 Motor state reset - weight %.2f kg < threshold %.2f kg", 
-                     weight_kg, weight_threshold);
-            
-            // Send stop command to ensure motor driver is in known state
-            motor_stop();
-            ESP_LOGI(TAG, "🛑 Sending stop command to reset motor driver state");
-        }
-        
-        if (weight_kg >= weight_threshold && !motor_was_triggered) {
-            // Re-initialize motor driver before starting (in case it was physically stopped)
-            ESP_LOGI(TAG, "🔄 Re-initializing motor driver before start");
-            motor_control_init();
-            vTaskDelay(pdMS_TO_TICKS(100)); // Give time for initialization
-            
-            motor_start_forward();
-            motor_was_triggered = true;
-            ESP_LOGI(TAG, "🚀 Motor started - weight %.2f kg >= threshold %.2f kg", 
-                     weight_kg, weight_threshold);
-        } else if (weight_kg < weight_threshold && motor_was_triggered) {
-            motor_stop();
-            motor_was_triggered = false;
-            ESP_LOGI(TAG, "🛑 Motor stopped - weight %.2f kg < threshold %.2f kg", 
-                     weight_kg, weight_threshold);
-        }
+    if (!server_ready) {
+        return;
     }
     
-    // Skip the stabilization process for instant response
-    return;
-    
-    // Check for significant weight change (threshold: 0.13 kg = 130g)
-    float weight_change = fabs(weight_kg - last_stable_weight);
-    
-    if (weight_change > 0.13 && !is_calculating) {
-        // Start calculation process
-        is_calculating = true;
-        sample_count = 0;
-        calculation_start_ms = esp_timer_get_time() / 1000; // Get current time in milliseconds
-        ESP_LOGI(TAG, "⚡ Weight change detected: %.2f kg → %.2f kg (Δ=%.2f kg)", 
-                 last_stable_weight, weight_kg, weight_change);
-        ESP_LOGI(TAG, "⏱️  Starting 1-second measurement...");
+    // Record into on-device history
+    if (history_mutex != NULL && xSemaphoreTake(history_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+        history_add(now_ms, weight_kg);
+        xSemaphoreGive(history_mutex);
     }
     
-    if (is_calculating) {
-        // Collect samples
-        if (sample_count < 50) {
-            weight_samples[sample_count] = weight_kg;
-            sample_count++;
-        }
-        
-        // Check if 5 seconds have passed
-        int64_t current_ms = esp_timer_get_time() / 1000;
-        int64_t elapsed_ms = current_ms - calculation_start_ms;
-        
-        if (elapsed_ms >= 1000) { // 1000 ms = 1 second
-            // Calculate average weight
-            float sum = 0.0;
-            for (int i = 0; i < sample_count; i++) {
-                sum += weight_samples[i];
-            }
-            stable_weight = sum / sample_count;
-            last_stable_weight = stable_weight;
-            
-            // Reset calculation state
-            is_calculating = false;
-            int final_sample_count = sample_count;
-            sample_count = 0;
-            
-            ESP_LOGI(TAG, "✅ Measurement complete: %.2f kg (average of %d samples over %.1f seconds)", 
-                     stable_weight, final_sample_count, elapsed_ms / 1000.0);
-            
-            // Check motor auto control
-            if (motor_auto_mode) {
-                if (stable_weight >= weight_threshold && !motor_was_triggered) {
-                    motor_start_forward();
-                    motor_was_triggered = true;
-                    ESP_LOGI(TAG, "🚀 Motor started - weight %.2f kg >= threshold %.2f kg", 
-                             stable_weight, weight_threshold);
-                } else if (stable_weight < weight_threshold && motor_was_triggered) {
-                    motor_stop();
-                    motor_was_triggered = false;
-                    ESP_LOGI(TAG, "🛑 Motor stopped - weight %.2f kg < threshold %.2f kg", 
-                             stable_weight, weight_threshold);
-                }
-            }
-        } else {
-            // Log progress every 10 samples
-            if (sample_count % 10 == 0) {
-                ESP_LOGI(TAG, "📊 Measuring... %d samples collected (%.1f seconds elapsed)", 
-                         sample_count, elapsed_ms / 1000.0);
-            }
-        }
-    }
+    web_server_publish_status();
 }
 
 // Motor control functions
 void web_server_set_motor_auto_mode(bool enabled)
 {
-    motor_auto_mode = enabled;
+    elevator_state_t *st = shared_state_begin_update();
+    st->auto_mode = enabled;
+    shared_state_end_update();
+    persist_control_settings();
+    web_server_publish_status();
 }
 
 bool web_server_get_motor_auto_mode(void)
 {
-    return motor_auto_mode;
+    elevator_state_t es;
+    shared_state_read(&es);
+    return es.auto_mode;
 }
 
 float web_server_get_weight_threshold(void)
 {
-    return weight_threshold;
+    elevator_state_t es;
+    shared_state_read(&es);
+    return es.threshold;
 }
 
 void web_server_set_weight_threshold(float threshold)
 {
-    weight_threshold = threshold;
+    elevator_state_t *st = shared_state_begin_update();
+    st->threshold = threshold;
+    shared_state_end_update();
+    persist_control_settings();
+    web_server_publish_status();
 }
\ No newline at end of file
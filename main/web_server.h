@@ -8,15 +8,25 @@
 // Initialize web server
 void web_server_init(void);
 
-// Send weight update to all connected WebSocket clients
+// Store latest weight and push it to all connected WebSocket clients (/ws)
 void web_server_send_weight(float weight_kg, long raw_value);
 
 // Set HX711 pointer for zeroing functionality
 void web_server_set_hx711(hx711_t* hx711);
 
-// Smart weight processing with 5-second averaging
+// Record a new sample into history and push it to /ws clients.
+// The sampler publishes it to the shared state (shared_state.h) first;
+// auto motor decisions are made by the control task (control_task.h).
 void web_server_process_weight(float weight_kg, long raw_value);
 
+// Re-publish the status document (e.g. after a motor state change).
+// Formats and broadcasts on the caller: for httpd and the sampler.
+void web_server_publish_status(void);
+
+// Ask for a re-publish and return at once (the httpd task does the work):
+// the change callback of the control task and the deadline monitor
+void web_server_request_status(void);
+
 // Motor control functions
 void web_server_set_motor_auto_mode(bool enabled);
 bool web_server_get_motor_auto_mode(void);
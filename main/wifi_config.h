@@ -5,6 +5,18 @@
 #define WIFI_SSID "cotycoty"
 #define WIFI_PASSWORD "E1x40UJF!2703"
 
+// Reconnect (wifi_manager.c): jittered exponential backoff between attempts
+#define WIFI_BACKOFF_MIN_MS 250
+#define WIFI_BACKOFF_MAX_MS 30000
+
+// 1 = on the fast-connect path reuse the last DHCP lease as a static IP
+// (saves the DHCP round trips; only if the AP keeps leases stable)
+#define WIFI_FAST_CONNECT_STATIC_IP 0
+
+// Power save profile until changed via /api/wifi/profile
+// (WIFI_PROFILE_LOW_LATENCY, WIFI_PROFILE_BALANCED, WIFI_PROFILE_LOW_POWER)
+#define WIFI_DEFAULT_PROFILE WIFI_PROFILE_BALANCED
+
 // Web Server Configuration
 #define WEB_SERVER_PORT 80
 
@@ -3,7 +3,10 @@
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
-#include "nvs_flash.h"
+#include "esp_netif.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "nvs.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include <string.h>
@@ -13,24 +16,277 @@ static EventGroupHandle_t wifi_event_group;
 static const int WIFI_CONNECTED_BIT = BIT0;
 static char ip_address[16] = "0.0.0.0";
 static bool connected = false;
+static esp_netif_t *sta_netif = NULL;
+
+// Last good association, cached in NVS for the fast-connect path
+#define WIFI_CACHE_NAMESPACE "wifi"
+#define WIFI_CACHE_KEY       "last_ap"
+
+typedef struct {
+    char ssid[33];           // Cache is only used for the same SSID
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint32_t ip;             // Last DHCP lease (network byte order)
+    uint32_t netmask;
+    uint32_t gw;
+} wifi_cache_t;
+
+static wifi_cache_t cache;
+static bool cache_valid = false;
+static bool using_cache = false;       // Current attempt targets the cached AP
+
+// Power save profile
+#define WIFI_PROFILE_KEY "profile"
+
+typedef struct {
+    const char *name;
+    wifi_ps_type_t ps;
+    uint16_t listen_interval;   // In beacon intervals, used with WIFI_PS_MAX_MODEM
+} wifi_profile_def_t;
+
+static const wifi_profile_def_t profiles[WIFI_PROFILE_COUNT] = {
+    [WIFI_PROFILE_LOW_LATENCY] = { "low_latency", WIFI_PS_NONE,      1 },
+    [WIFI_PROFILE_BALANCED]    = { "balanced",    WIFI_PS_MIN_MODEM, 3 },
+    [WIFI_PROFILE_LOW_POWER]   = { "low_power",   WIFI_PS_MAX_MODEM, 10 },
+};
+static wifi_profile_t profile = WIFI_DEFAULT_PROFILE;
+
+// Reconnect with jittered exponential backoff
+static esp_timer_handle_t reconnect_timer = NULL;
+static uint32_t attempt = 0;           // Failed attempts since the last IP
+static int64_t connect_start_us = 0;   // Start of the current connection cycle
+
+// Connection quality history
+static wifi_conn_record_t history[WIFI_HISTORY_LEN];
+static uint8_t history_head = 0;
+static uint8_t history_count = 0;
+static wifi_stats_t stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void cache_load(void)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(WIFI_CACHE_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+    size_t len = sizeof(cache);
+    if (nvs_get_blob(nvs, WIFI_CACHE_KEY, &cache, &len) == ESP_OK && len == sizeof(cache) &&
+        strncmp(cache.ssid, WIFI_SSID, sizeof(cache.ssid)) == 0 && cache.channel != 0) {
+        cache_valid = true;
+    }
+    nvs_close(nvs);
+}
+
+static void profile_load(void)
+{
+    nvs_handle_t nvs;
+    uint8_t value;
+    if (nvs_open(WIFI_CACHE_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+    if (nvs_get_u8(nvs, WIFI_PROFILE_KEY, &value) == ESP_OK && value < WIFI_PROFILE_COUNT) {
+        profile = (wifi_profile_t)value;
+    }
+    nvs_close(nvs);
+}
+
+static void cache_store(void)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(WIFI_CACHE_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        return;
+    }
+    if (nvs_set_blob(nvs, WIFI_CACHE_KEY, &cache, sizeof(cache)) == ESP_OK) {
+        nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+}
+
+// Point the station at the cached AP (no scan) or at any AP with our SSID
+static void apply_sta_config(bool fast)
+{
+    wifi_config_t wifi_config = {
+        .sta = {
+            .ssid = WIFI_SSID,
+            .password = WIFI_PASSWORD,
+            .threshold.authmode = WIFI_AUTH_WPA2_PSK,
+            .listen_interval = profiles[profile].listen_interval,
+        },
+    };
+    if (fast) {
+        wifi_config.sta.bssid_set = true;
+        memcpy(wifi_config.sta.bssid, cache.bssid, sizeof(cache.bssid));
+        wifi_config.sta.channel = cache.channel;
+        wifi_config.sta.scan_method = WIFI_FAST_SCAN;
+    } else {
+        wifi_config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+        wifi_config.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
+    }
+    esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+    using_cache = fast;
+
+#if WIFI_FAST_CONNECT_STATIC_IP
+    // Reuse the last lease and skip DHCP on the fast path
+    if (fast && cache.ip != 0) {
+        esp_netif_ip_info_t ip_info = {
+            .ip.addr = cache.ip,
+            .netmask.addr = cache.netmask,
+            .gw.addr = cache.gw,
+        };
+        esp_netif_dhcpc_stop(sta_netif);
+        esp_netif_set_ip_info(sta_netif, &ip_info);
+    } else {
+        esp_netif_dhcpc_start(sta_netif);
+    }
+#endif
+}
+
+static void start_connect(void)
+{
+    if (attempt == 0) {
+        connect_start_us = esp_timer_get_time();
+    }
+    // First attempt of a cycle goes straight to the cached AP; if that
+    // fails, fall back to a full scan
+    apply_sta_config(cache_valid && attempt == 0);
+    ESP_LOGI(TAG, "Connecting to WiFi%s (attempt %u)...",
+             using_cache ? " (cached BSSID/channel)" : "", (unsigned)attempt + 1);
+    esp_wifi_connect();
+}
+
+static void reconnect_timer_cb(void *arg)
+{
+    start_connect();
+}
+
+// min(MIN * 2^attempt, MAX), randomized to 50-100% so devices that lost
+// the same AP do not retry in lockstep
+static uint32_t backoff_ms(uint32_t n)
+{
+    uint32_t delay = WIFI_BACKOFF_MIN_MS;
+    while (n-- > 0 && delay < WIFI_BACKOFF_MAX_MS) {
+        delay *= 2;
+    }
+    if (delay > WIFI_BACKOFF_MAX_MS) {
+        delay = WIFI_BACKOFF_MAX_MS;
+    }
+    return delay / 2 + esp_random() % (delay / 2 + 1);
+}
+
+static void history_add(const wifi_conn_record_t *rec)
+{
+    portENTER_CRITICAL(&stats_lock);
+    history[history_head] = *rec;
+    history_head = (history_head + 1) % WIFI_HISTORY_LEN;
+    if (history_count < WIFI_HISTORY_LEN) {
+        history_count++;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+static void on_disconnected(const wifi_event_sta_disconnected_t *event)
+{
+    bool was_connected = connected;
+    connected = false;
+    xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);
+
+    if (using_cache && !was_connected) {
+        ESP_LOGW(TAG, "Fast connect to cached AP failed (reason %d) - falling back to scan",
+                 event->reason);
+    }
+
+    portENTER_CRITICAL(&stats_lock);
+    if (was_connected) {
+        stats.disconnects++;
+        stats.connected_since_ms = 0;
+    } else {
+        stats.failed_attempts++;
+    }
+    stats.last_reason = event->reason;
+    stats.last_disconnect_rssi = event->rssi;
+    portEXIT_CRITICAL(&stats_lock);
+
+    if (was_connected) {
+        attempt = 0;  // New cycle: try the cached AP first again
+    }
+    uint32_t delay = was_connected ? 0 : backoff_ms(attempt);
+    attempt++;
+
+    if (delay == 0) {
+        ESP_LOGI(TAG, "Reconnecting to WiFi (reason %d)...", event->reason);
+        start_connect();
+    } else {
+        ESP_LOGI(TAG, "Reconnecting to WiFi in %u ms (reason %d)...", (unsigned)delay, event->reason);
+        esp_timer_stop(reconnect_timer);
+        esp_timer_start_once(reconnect_timer, (uint64_t)delay * 1000);
+    }
+}
+
+static void on_got_ip(const ip_event_got_ip_t *event)
+{
+    snprintf(ip_address, sizeof(ip_address), IPSTR, IP2STR(&event->ip_info.ip));
+
+    int64_t now_us = esp_timer_get_time();
+    wifi_ap_record_t ap;
+    bool have_ap = esp_wifi_sta_get_ap_info(&ap) == ESP_OK;
+
+    wifi_conn_record_t rec = {
+        .uptime_ms = now_us / 1000,
+        .time_to_ip_ms = (uint32_t)((now_us - connect_start_us) / 1000),
+        .attempts = attempt + 1,
+        .rssi = have_ap ? ap.rssi : 0,
+        .channel = have_ap ? ap.primary : 0,
+        .fast = using_cache,
+    };
+    history_add(&rec);
+
+    portENTER_CRITICAL(&stats_lock);
+    stats.connects++;
+    if (stats.connects > 1) {
+        stats.reconnects++;
+    } else {
+        stats.boot_to_ip_ms = rec.uptime_ms;
+    }
+    stats.connected_since_ms = rec.uptime_ms;
+    portEXIT_CRITICAL(&stats_lock);
+
+    ESP_LOGI(TAG, "Got IP: %s (%u ms, %u attempt(s)%s, RSSI %d dBm)", ip_address,
+             (unsigned)rec.time_to_ip_ms, (unsigned)rec.attempts,
+             rec.fast ? ", fast connect" : "", rec.rssi);
+
+    // Refresh the cache if the AP, channel or lease changed
+    if (have_ap) {
+        wifi_cache_t fresh = {
+            .channel = ap.primary,
+            .ip = event->ip_info.ip.addr,
+            .netmask = event->ip_info.netmask.addr,
+            .gw = event->ip_info.gw.addr,
+        };
+        strncpy(fresh.ssid, WIFI_SSID, sizeof(fresh.ssid) - 1);
+        memcpy(fresh.bssid, ap.bssid, sizeof(fresh.bssid));
+        if (!cache_valid || memcmp(&fresh, &cache, sizeof(cache)) != 0) {
+            cache = fresh;
+            cache_valid = true;
+            cache_store();
+            ESP_LOGI(TAG, "Cached AP " MACSTR " on channel %u", MAC2STR(cache.bssid),
+                     (unsigned)cache.channel);
+        }
+    }
+
+    attempt = 0;
+    connected = true;
+    xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
+}
 
 static void event_handler(void* arg, esp_event_base_t event_base,
                          int32_t event_id, void* event_data)
 {
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-        esp_wifi_connect();
-        ESP_LOGI(TAG, "Connecting to WiFi...");
+        start_connect();
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        connected = false;
-        esp_wifi_connect();
-        ESP_LOGI(TAG, "Reconnecting to WiFi...");
-        xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);
+        on_disconnected((wifi_event_sta_disconnected_t*) event_data);
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
-        ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
-        snprintf(ip_address, sizeof(ip_address), IPSTR, IP2STR(&event->ip_info.ip));
-        ESP_LOGI(TAG, "Got IP: %s", ip_address);
-        connected = true;
-        xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
+        on_got_ip((ip_event_got_ip_t*) event_data);
     }
 }
 
@@ -38,23 +294,24 @@ void wifi_init(void)
 {
     ESP_LOGI(TAG, "Initializing WiFi...");
     
-    // Initialize NVS
-    esp_err_t ret = nvs_flash_init();
-    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ret = nvs_flash_init();
-    }
-    ESP_ERROR_CHECK(ret);
-    
+    // NVS is initialized by config_store_init() before WiFi comes up
     wifi_event_group = xEventGroupCreate();
+    cache_load();
+    profile_load();
     
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
-    esp_netif_create_default_wifi_sta();
+    sta_netif = esp_netif_create_default_wifi_sta();
     
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
     
+    const esp_timer_create_args_t timer_args = {
+        .callback = reconnect_timer_cb,
+        .name = "wifi_reconnect"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &reconnect_timer));
+    
     esp_event_handler_instance_t instance_any_id;
     esp_event_handler_instance_t instance_got_ip;
     ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
@@ -68,26 +325,27 @@ void wifi_init(void)
                                                         NULL,
                                                         &instance_got_ip));
     
-    wifi_config_t wifi_config = {
-        .sta = {
-            .ssid = WIFI_SSID,
-            .password = WIFI_PASSWORD,
-            .threshold.authmode = WIFI_AUTH_WPA2_PSK,
-        },
-    };
-    
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+    apply_sta_config(false);
     ESP_ERROR_CHECK(esp_wifi_start());
+    esp_wifi_set_ps(profiles[profile].ps);
     
-    ESP_LOGI(TAG, "WiFi initialization complete. Connecting to SSID: %s", WIFI_SSID);
-    
-    // Wait for connection
-    xEventGroupWaitBits(wifi_event_group,
-                       WIFI_CONNECTED_BIT,
-                       pdFALSE,
-                       pdTRUE,
-                       portMAX_DELAY);
+    ESP_LOGI(TAG, "WiFi initialization complete. Connecting to SSID: %s%s (profile %s)", WIFI_SSID,
+             cache_valid ? " (cached AP available)" : "", profiles[profile].name);
+}
+
+bool wifi_wait_connected(uint32_t timeout_ms)
+{
+    if (wifi_event_group == NULL) {
+        return false;
+    }
+    EventBits_t bits = xEventGroupWaitBits(wifi_event_group,
+                                           WIFI_CONNECTED_BIT,
+                                           pdFALSE,
+                                           pdTRUE,
+                                           timeout_ms == UINT32_MAX ? portMAX_DELAY
+                                                                    : pdMS_TO_TICKS(timeout_ms));
+    return (bits & WIFI_CONNECTED_BIT) != 0;
 }
 
 bool wifi_is_connected(void)
@@ -100,3 +358,81 @@ const char* wifi_get_ip(void)
     return ip_address;
 }
 
+int wifi_get_rssi(void)
+{
+    wifi_ap_record_t ap;
+    if (!connected || esp_wifi_sta_get_ap_info(&ap) != ESP_OK) {
+        return 0;
+    }
+    return ap.rssi;
+}
+
+void wifi_get_stats(wifi_stats_t *out)
+{
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
+    out->cached_ap = cache_valid;
+    out->backoff_attempt = attempt;
+}
+
+size_t wifi_get_history(wifi_conn_record_t *out, size_t max)
+{
+    portENTER_CRITICAL(&stats_lock);
+    size_t n = history_count < max ? history_count : max;
+    // Newest first
+    for (size_t i = 0; i < n; i++) {
+        out[i] = history[(history_head + WIFI_HISTORY_LEN - 1 - i) % WIFI_HISTORY_LEN];
+    }
+    portEXIT_CRITICAL(&stats_lock);
+    return n;
+}
+
+bool wifi_set_profile(wifi_profile_t p)
+{
+    if (p >= WIFI_PROFILE_COUNT) {
+        return false;
+    }
+    if (esp_wifi_set_ps(profiles[p].ps) != ESP_OK) {
+        return false;
+    }
+    profile = p;
+
+    // Listen interval is negotiated at association; keep it for the next one
+    wifi_config_t wifi_config;
+    if (esp_wifi_get_config(WIFI_IF_STA, &wifi_config) == ESP_OK) {
+        wifi_config.sta.listen_interval = profiles[p].listen_interval;
+        esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+    }
+
+    nvs_handle_t nvs;
+    if (nvs_open(WIFI_CACHE_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK) {
+        if (nvs_set_u8(nvs, WIFI_PROFILE_KEY, (uint8_t)p) == ESP_OK) {
+            nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+    ESP_LOGI(TAG, "📶 WiFi profile: %s", profiles[p].name);
+    return true;
+}
+
+wifi_profile_t wifi_get_profile(void)
+{
+    return profile;
+}
+
+const char *wifi_profile_name(wifi_profile_t p)
+{
+    return p < WIFI_PROFILE_COUNT ? profiles[p].name : "?";
+}
+
+bool wifi_profile_from_name(const char *name, wifi_profile_t *out)
+{
+    for (int i = 0; i < WIFI_PROFILE_COUNT; i++) {
+        if (strcmp(name, profiles[i].name) == 0) {
+            *out = (wifi_profile_t)i;
+            return true;
+        }
+    }
+    return false;
+}
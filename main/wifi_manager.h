@@ -2,15 +2,70 @@
 #define WIFI_MANAGER_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
-// Initialize WiFi
+#define WIFI_HISTORY_LEN 16   // Connection records kept for /api/wifi
+
+// Latency / power trade-off of the station
+typedef enum {
+    WIFI_PROFILE_LOW_LATENCY = 0,   // Power save off: no added latency, ~100 mA
+    WIFI_PROFILE_BALANCED,          // Modem sleep, wake every DTIM (IDF default)
+    WIFI_PROFILE_LOW_POWER,         // Max modem sleep, long listen interval
+    WIFI_PROFILE_COUNT
+} wifi_profile_t;
+
+// One successful connection (got IP)
+typedef struct {
+    int64_t uptime_ms;        // When the IP was assigned
+    uint32_t time_to_ip_ms;   // From the first attempt of this cycle
+    uint16_t attempts;        // Attempts needed (1 = first try)
+    int8_t rssi;              // dBm right after association
+    uint8_t channel;
+    bool fast;                // Connected via the cached BSSID/channel
+} wifi_conn_record_t;
+
+typedef struct {
+    uint32_t connects;            // Successful connections (got IP)
+    uint32_t reconnects;          // Connections after the first one
+    uint32_t disconnects;         // Lost an established connection
+    uint32_t failed_attempts;     // Attempts that ended without an IP
+    uint32_t backoff_attempt;     // Current position in the backoff sequence
+    int64_t boot_to_ip_ms;        // First IP after boot
+    int64_t connected_since_ms;   // 0 while disconnected
+    int last_reason;              // Last wifi_err_reason_t
+    int last_disconnect_rssi;
+    bool cached_ap;               // A cached BSSID/channel is available
+} wifi_stats_t;
+
+// Initialize WiFi and start connecting (returns without waiting).
+// Requires NVS to be initialized (config_store_init()).
 void wifi_init(void);
 
+// Wait until connected (UINT32_MAX = forever); returns true if connected
+bool wifi_wait_connected(uint32_t timeout_ms);
+
 // Check if WiFi is connected
 bool wifi_is_connected(void);
 
 // Get IP address string
 const char* wifi_get_ip(void);
 
+// Get RSSI of the current AP in dBm (0 when not connected)
+int wifi_get_rssi(void);
+
+// Switch profile at runtime (stored in NVS). Power save changes take effect
+// immediately, the listen interval on the next association.
+bool wifi_set_profile(wifi_profile_t profile);
+wifi_profile_t wifi_get_profile(void);
+const char *wifi_profile_name(wifi_profile_t profile);
+bool wifi_profile_from_name(const char *name, wifi_profile_t *out);
+
+// Reconnect counters and timing
+void wifi_get_stats(wifi_stats_t *out);
+
+// Copy up to max connection records, newest first; returns the count
+size_t wifi_get_history(wifi_conn_record_t *out, size_t max);
+
 #endif // WIFI_MANAGER_H
 
@@ -0,0 +1,215 @@
+let data=[];
+let zeroOffset=0;
+const canvas=document.getElementById('chart');
+const ctx=canvas.getContext('2d');
+let ws=null;
+let wsReplies=[];
+let pollTimer=null;
+function showSample(result){
+  document.getElementById('weight').textContent=result.weight.toFixed(2);
+  document.getElementById('raw').textContent=result.raw;
+  if(result.status==='Stable'){
+    document.getElementById('stable-weight').textContent=result.weight.toFixed(2);
+    document.getElementById('status').textContent='Stable';
+    document.getElementById('status').style.color='#28a745';
+  }else if(result.status==='Calculating...'){
+    document.getElementById('status').textContent='Calculating...';
+    document.getElementById('status').style.color='#ff6b35';
+  }
+  if(result.sensor_ready!==undefined){
+    if(result.sensor_ready){
+      document.getElementById('sensor-status').textContent='Ready';
+      document.getElementById('sensor-status').style.color='#28a745';
+    }else{
+      document.getElementById('sensor-status').textContent='Not Ready';
+      document.getElementById('sensor-status').style.color='#dc3545';
+    }
+  }
+  if(result.motor!==undefined)showMotor(result.motor);
+  if(result.auto_mode!==undefined)showAuto(result.auto_mode);
+  document.getElementById('esp-status').textContent='Online';
+  document.getElementById('esp-status').style.color='#28a745';
+  document.getElementById('wifi-status').textContent=
+    result.wifi&&result.wifi.rssi?'Connected ('+result.wifi.rssi+' dBm)':'Connected';
+  document.getElementById('wifi-status').style.color='#28a745';
+  data.push({weight:result.weight,time:Date.now()});
+  if(data.length>100)data.shift();
+  drawChart();
+}
+function showOffline(){
+  document.getElementById('esp-status').textContent='Offline';
+  document.getElementById('esp-status').style.color='#dc3545';
+  document.getElementById('wifi-status').textContent='Disconnected';
+  document.getElementById('wifi-status').style.color='#dc3545';
+}
+function showMotor(state){
+  const colors={forward:'#28a745',backward:'#ffc107',stopped:'#dc3545',reset:'#6c757d'};
+  const el=document.getElementById('motor-status');
+  el.textContent=state.charAt(0).toUpperCase()+state.slice(1);
+  el.style.color=colors[state]||'#856404';
+}
+function showAuto(on){
+  document.getElementById('auto-status').textContent=on?'Auto ON':'Manual';
+  document.getElementById('auto-status').style.color=on?'#28a745':'#0c5460';
+  document.getElementById('btn-auto').textContent=on?'Disable Auto':'Enable Auto';
+}
+function updateData(){
+  fetch('/api/status')
+    .then(response=>response.json())
+    .then(showSample)
+    .catch(error=>{
+      console.error('Error:',error);
+      showOffline();
+    });
+}
+function startPolling(){
+  if(!pollTimer){updateData();pollTimer=setInterval(updateData,2000);}
+}
+function stopPolling(){
+  if(pollTimer){clearInterval(pollTimer);pollTimer=null;}
+}
+function connectWs(){
+  ws=new WebSocket('ws://'+location.host+'/ws');
+  ws.onopen=()=>stopPolling();
+  ws.onmessage=e=>{
+    const msg=JSON.parse(e.data);
+    if(msg.type==='status'){showSample(msg);return;}
+    const cb=wsReplies.shift();
+    if(cb)cb(msg);
+  };
+  ws.onclose=()=>{
+    ws=null;
+    wsReplies.forEach(cb=>cb({success:false}));
+    wsReplies=[];
+    startPolling();
+    setTimeout(connectWs,3000);
+  };
+}
+function sendCommand(cmd,url,extra){
+  if(ws&&ws.readyState===WebSocket.OPEN){
+    return new Promise(resolve=>{
+      wsReplies.push(resolve);
+      ws.send(JSON.stringify(Object.assign({cmd:cmd},extra||{})));
+    });
+  }
+  const opts={method:'POST'};
+  if(extra){opts.headers={'Content-Type':'application/json'};opts.body=JSON.stringify(extra);}
+  return fetch(url,opts).then(response=>response.json());
+}
+function drawChart(){
+  const w=canvas.width;const h=canvas.height;
+  ctx.clearRect(0,0,w,h);
+  if(data.length<2)return;
+  const maxW=Math.max(...data.map(d=>d.weight),1);
+  const minW=Math.min(...data.map(d=>d.weight),0);
+  const range=maxW-minW||1;
+  ctx.beginPath();
+  ctx.strokeStyle='#007bff';
+  ctx.lineWidth=2;
+  data.forEach((d,i)=>{
+    const x=(i/(data.length-1))*w;
+    const y=h-(((d.weight-minW)/range)*h*0.8+h*0.1);
+    i===0?ctx.moveTo(x,y):ctx.lineTo(x,y);
+  });
+  ctx.stroke();
+  ctx.fillStyle='#666';
+  ctx.font='12px Arial';
+  ctx.fillText(maxW.toFixed(2)+' kg',5,15);
+  ctx.fillText(minW.toFixed(2)+' kg',5,h-5);
+}
+function clearChart(){data.length=0;drawChart();}
+function zeroScale(){
+  fetch('/api/zero',{method:'POST'})
+    .then(response=>response.json())
+    .then(result=>{
+      console.log('Scale zeroed:',result);
+      alert('Scale zeroed successfully!');
+    })
+    .catch(error=>{
+      console.error('Error zeroing scale:',error);
+      alert('Error zeroing scale');
+    });
+}
+function motorForward(){
+  sendCommand('forward','/api/motor/forward')
+    .then(result=>{
+      console.log('Motor forward:',result);
+      showMotor('forward');
+    })
+    .catch(error=>{
+      console.error('Error starting motor:',error);
+    });
+}
+function motorBackward(){
+  sendCommand('backward','/api/motor/backward')
+    .then(result=>{
+      console.log('Motor backward:',result);
+      showMotor('backward');
+    })
+    .catch(error=>{
+      console.error('Error starting motor:',error);
+    });
+}
+function motorStop(){
+  sendCommand('stop','/api/motor/stop')
+    .then(result=>{
+      console.log('Motor stop:',result);
+      showMotor('stopped');
+    })
+    .catch(error=>{
+      console.error('Error stopping motor:',error);
+    });
+}
+function motorReset(){
+  if(confirm('Reset motor system? This will reinitialize the motor driver.')){
+    sendCommand('reset','/api/motor/reset')
+      .then(result=>{
+        console.log('Motor reset:',result);
+        showMotor('reset');
+        showAuto(true);
+        alert('Motor system reset completed!');
+      })
+      .catch(error=>{
+        console.error('Error resetting motor:',error);
+        alert('Error resetting motor system');
+      });
+  }
+}
+function toggleAutoMode(){
+  sendCommand('auto','/api/motor/auto')
+    .then(result=>{
+      console.log('Auto mode:',result);
+      showAuto(result.auto_mode);
+    })
+    .catch(error=>{
+      console.error('Error toggling auto mode:',error);
+    });
+}
+function setThreshold(){
+  const threshold=document.getElementById('threshold').value;
+  sendCommand('threshold','/api/motor/threshold',{threshold:parseFloat(threshold)})
+    .then(result=>{
+      console.log('Threshold set:',result);
+      alert('Threshold set to '+threshold+' kg');
+    })
+    .catch(error=>{
+      console.error('Error setting threshold:',error);
+    });
+}
+function loadHistory(){
+  fetch('/api/history?points=100')
+    .then(response=>response.json())
+    .then(result=>{
+      const now=Date.now();
+      const history=result.points.map(p=>({weight:p[1],time:now-(result.to-p[0])}));
+      data.unshift(...history);
+      if(data.length>100)data.splice(0,data.length-100);
+      drawChart();
+    })
+    .catch(error=>console.error('Error loading history:',error));
+}
+window.onload=function(){
+  loadHistory();
+  startPolling();
+  if('WebSocket' in window)connectWs();
+};
@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""
+Build-time packer for the web dashboard.
+
+Gzips index.html, app.js and style.css for embedding into flash and writes
+www_assets.h with a strong ETag per asset. index.html references the
+JS/CSS with a ?v=<hash> suffix so they can be cached forever by browsers
+and still change with every firmware that changes them.
+
+Usage: gzip_assets.py <src_dir> <out_dir>
+"""
+
+import gzip
+import hashlib
+import os
+import sys
+
+ASSETS = ["index.html", "app.js", "style.css"]
+
+
+def digest(data):
+    return hashlib.sha256(data).hexdigest()[:16]
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__)
+        return 1
+    src_dir, out_dir = sys.argv[1], sys.argv[2]
+    os.makedirs(out_dir, exist_ok=True)
+
+    sources = {}
+    for name in ASSETS:
+        with open(os.path.join(src_dir, name), "rb") as f:
+            sources[name] = f.read()
+
+    # Cache-bust versioned assets from the page
+    for name in ("app.js", "style.css"):
+        ref = ("/" + name).encode()
+        versioned = ("/%s?v=%s" % (name, digest(sources[name]))).encode()
+        sources["index.html"] = sources["index.html"].replace(ref, versioned)
+
+    defines = []
+    for name in ASSETS:
+        # mtime=0 keeps the output (and so the ETag) reproducible
+        packed = gzip.compress(sources[name], compresslevel=9, mtime=0)
+        with open(os.path.join(out_dir, name + ".gz"), "wb") as f:
+            f.write(packed)
+        macro = name.upper().replace(".", "_")
+        defines.append('#define WWW_ETAG_%s "\\"%s\\""' % (macro, digest(packed)))
+        print("www: %-10s %6d -> %5d bytes" % (name, len(sources[name]), len(packed)))
+
+    header = ["// Generated by gzip_assets.py - do not edit",
+              "#ifndef WWW_ASSETS_H",
+              "#define WWW_ASSETS_H",
+              ""] + defines + ["", "#endif // WWW_ASSETS_H", ""]
+    with open(os.path.join(out_dir, "www_assets.h"), "w") as f:
+        f.write("\n".join(header))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
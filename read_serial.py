@@ -1,37 +1,38 @@
 #!/usr/bin/env python3
-import serial
-import time
+# Quick look at the ESP32 serial port: log lines and decoded telemetry frames
+# for a few seconds (serial_telemetry.py has the full decoder/CLI)
 import sys
+import time
+
+from serial_telemetry import FrameReader, Port, control_frame, describe
+
+PORT = '/dev/cu.usbmodem5A671675611'
+MAX_DURATION = 15  # seconds
 
 try:
-    ser = serial.Serial('/dev/cu.usbmodem5A671675611', 115200, timeout=1)
-    print("Connected to ESP32-S3. Reading data...")
-    print("=" * 80)
-    
-    start_time = time.time()
-    line_count = 0
-    max_lines = 50
-    max_duration = 15  # seconds
-    
-    while line_count < max_lines and (time.time() - start_time) < max_duration:
-        if ser.in_waiting > 0:
-            try:
-                line = ser.readline().decode('utf-8', errors='ignore').rstrip()
-                if line:
-                    print(line)
-                    line_count += 1
-            except Exception as e:
-                print(f"Error reading line: {e}")
-        time.sleep(0.01)
-    
-    print("=" * 80)
-    print(f"Read {line_count} lines in {time.time() - start_time:.1f} seconds")
-    ser.close()
-    
-except serial.SerialException as e:
+    port = Port(sys.argv[1] if len(sys.argv) > 1 else PORT, 115200)
+except OSError as e:
     print(f"Error opening serial port: {e}")
     sys.exit(1)
+
+print("Connected to ESP32-S3. Reading data...")
+print("=" * 80)
+reader = FrameReader()
+port.write(control_frame(True))
+start_time = time.time()
+try:
+    while (time.time() - start_time) < MAX_DURATION:
+        for item in reader.feed(port.read()):
+            if item[0] == "text":
+                print(item[1])
+            else:
+                print(describe(*item[1:]))
 except KeyboardInterrupt:
     print("\nInterrupted by user")
-    sys.exit(0)
+finally:
+    port.write(control_frame(False))
+    port.close()
 
+print("=" * 80)
+print(f"Read {reader.frames} frames in {time.time() - start_time:.1f} seconds "
+      f"({reader.bad_frames} damaged, {reader.lost_frames} lost)")
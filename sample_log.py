@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+"""
+Flash sample log reader - Python side of main/sample_log.h (version 1).
+
+Block layout (little-endian), 512-byte flash slots, header + payload only
+on the wire:
+    'S' 'L' | version u8 | state u8 | seq u32 | boot u16 | count u16 |
+    t0_ms u32 | raw0 i32 | scale f32 | offset i32 | payload_len u16 |
+    dt0_ms u16 | crc32 u32 | payload...
+    entry:  varint (zigzag(d_raw) << 2 | dt_changed << 1 | state_changed)
+            [zigzag-varint d_dt_ms] [state u8]
+
+Usage:
+    python3 sample_log.py 192.168.1.50                     # whole log as CSV on stdout
+    python3 sample_log.py 192.168.1.50 --blocks 100 -o last.csv
+    python3 sample_log.py 192.168.1.50 --save sample_log.bin
+    python3 sample_log.py --file sample_log.bin --summary
+    python3 sample_log.py 192.168.1.50 --stats
+"""
+
+import argparse
+import binascii
+import json
+import struct
+import sys
+import urllib.request
+
+MAGIC = b"SL"
+VERSION = 1
+HEADER = struct.Struct("<2sBBIHHIifiHHI")
+CRC_COVERED = 32
+
+STATE_MOTOR_MASK = 0x03
+STATE_TRIGGERED = 0x04
+STATE_AUTO_MODE = 0x08
+STATE_SENSOR_OK = 0x10
+MOTOR_STATES = {0: "stopped", 1: "forward", 2: "backward"}
+
+
+def _get_varint(buf, pos, end):
+    v = 0
+    shift = 0
+    while True:
+        if pos >= end or shift > 28:
+            raise ValueError("truncated varint")
+        b = buf[pos]
+        pos += 1
+        v |= (b & 0x7F) << shift
+        if not b & 0x80:
+            return v, pos
+        shift += 7
+
+
+def _unzigzag(v):
+    return (v >> 1) ^ -(v & 1)
+
+
+def _wrap_i32(v):
+    return ((v + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+
+
+def decode_block(buf, pos=0):
+    """Decode the block at buf[pos:]; returns (header dict, [samples], next pos).
+    Raises ValueError if it is not a valid block."""
+    if len(buf) - pos < HEADER.size:
+        raise ValueError("block too short")
+    (magic, version, state, seq, boot, count, t, raw, scale, offset,
+     payload_len, dt, crc) = HEADER.unpack_from(buf, pos)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("not a v%d sample log block" % VERSION)
+    start = pos + HEADER.size
+    end = start + payload_len
+    if end > len(buf) or count == 0:
+        raise ValueError("truncated block")
+    calc = binascii.crc32(buf[start:end], binascii.crc32(buf[pos:pos + CRC_COVERED]))
+    if calc != crc:
+        raise ValueError("block %d: CRC mismatch" % seq)
+
+    header = {"seq": seq, "boot": boot, "count": count, "scale": scale, "offset": offset}
+    samples = [{"t_ms": t, "raw": raw, "state": state}]
+    p = start
+    for _ in range(count - 1):
+        v, p = _get_varint(buf, p, end)
+        if v & 2:
+            ddt, p = _get_varint(buf, p, end)
+            dt += _unzigzag(ddt)
+        if v & 1:
+            if p >= end:
+                raise ValueError("truncated entry")
+            state = buf[p]
+            p += 1
+        raw = _wrap_i32(raw + _unzigzag(v >> 2))
+        t += dt
+        samples.append({"t_ms": t, "raw": raw, "state": state})
+    if p != end:
+        raise ValueError("block %d: payload length mismatch" % seq)
+    return header, samples, end
+
+
+def decode_stream(buf):
+    """Yield (header, samples) for every block of a /api/log download."""
+    pos = 0
+    while pos < len(buf):
+        header, samples, pos = decode_block(buf, pos)
+        yield header, samples
+
+
+def weight_kg(header, raw):
+    return (raw - header["offset"]) / header["scale"] if header["scale"] else 0.0
+
+
+def write_csv(blocks, out):
+    out.write("boot,seq,t_ms,raw,weight_kg,motor,triggered,auto_mode,sensor_ok\n")
+    for header, samples in blocks:
+        for s in samples:
+            st = s["state"]
+            out.write("%d,%d,%d,%d,%.3f,%s,%d,%d,%d\n" % (
+                header["boot"], header["seq"], s["t_ms"], s["raw"], weight_kg(header, s["raw"]),
+                MOTOR_STATES.get(st & STATE_MOTOR_MASK, "?"),
+                1 if st & STATE_TRIGGERED else 0, 1 if st & STATE_AUTO_MODE else 0,
+                1 if st & STATE_SENSOR_OK else 0))
+
+
+def summary(buf):
+    blocks = samples = 0
+    boots = set()
+    first = last = None
+    for header, s in decode_stream(buf):
+        blocks += 1
+        samples += len(s)
+        boots.add(header["boot"])
+        first = first if first is not None else header["seq"]
+        last = header["seq"]
+    print("blocks:   %d (seq %s..%s)" % (blocks, first, last))
+    print("samples:  %d" % samples)
+    print("boots:    %s" % ", ".join(str(b) for b in sorted(boots)))
+    if samples:
+        print("bytes:    %d (%.2f per sample)" % (len(buf), len(buf) / samples))
+
+
+def fetch(host, path, timeout=60):
+    with urllib.request.urlopen("http://%s%s" % (host, path), timeout=timeout) as resp:
+        return resp.read()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Download and decode the ESP32 flash sample log")
+    parser.add_argument("host", nargs="?", help="ESP32 IP address")
+    parser.add_argument("--file", help="Decode a saved download instead")
+    parser.add_argument("--blocks", type=int, default=0, help="Only the newest N blocks")
+    parser.add_argument("--save", help="Save the raw download to this file")
+    parser.add_argument("-o", "--output", help="CSV output file (default stdout)")
+    parser.add_argument("--summary", action="store_true", help="Print block/sample counts only")
+    parser.add_argument("--stats", action="store_true", help="Print the device log counters")
+    args = parser.parse_args()
+
+    if args.file is None and args.host is None:
+        parser.error("give the ESP32 address or --file")
+    if args.stats:
+        print(json.dumps(json.loads(fetch(args.host, "/api/log?stats=1")), indent=2))
+        return 0
+
+    if args.file:
+        with open(args.file, "rb") as f:
+            buf = f.read()
+    else:
+        query = "?blocks=%d" % args.blocks if args.blocks > 0 else ""
+        buf = fetch(args.host, "/api/log" + query)
+        if args.save:
+            with open(args.save, "wb") as f:
+                f.write(buf)
+            print("💾 %d bytes saved to %s" % (len(buf), args.save), file=sys.stderr)
+
+    try:
+        if args.summary:
+            summary(buf)
+        elif args.output:
+            with open(args.output, "w") as f:
+                write_csv(decode_stream(buf), f)
+        else:
+            write_csv(decode_stream(buf), sys.stdout)
+    except ValueError as e:
+        print("❌ %s" % e, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
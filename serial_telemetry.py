@@ -0,0 +1,407 @@
+#!/usr/bin/env python3
+"""
+Binary serial telemetry - Python side of main/serial_telemetry.h (version 1).
+
+Frames are COBS encoded and delimited by 0x00 on the console UART, mixed
+with ESP_LOG text. Frame before COBS (little-endian):
+    type u8 | seq u16 | t_ms u32 | payload... | crc16 (Modbus) u16
+    TELEMETRY 0x01  telemetry_codec frame (see telemetry_codec.py)
+    MOTOR     0x02  state u8 | flags u8 (0x01 triggered, 0x02 auto mode)
+    EVENT     0x03  code u8 | arg i32 | text
+    STATS     0x04  frames_sent u32 | bytes_sent u32 | samples_sent u32 |
+                    samples_dropped u32 | events_dropped u32
+    CONTROL   0x10  u8 1 = start, 0 = stop (host -> device)
+
+The stream is off until a CONTROL start frame arrives; this tool sends it
+when it opens the port and a stop when it exits.
+
+Usage:
+    python3 serial_telemetry.py /dev/ttyUSB0                  # decoded frames
+    python3 serial_telemetry.py /dev/ttyUSB0 --csv -o w.csv   # samples as CSV
+    python3 serial_telemetry.py /dev/ttyUSB0 --show-log       # log lines too
+    python3 serial_telemetry.py /dev/ttyUSB0 --duration 60 --json   # link summary
+    python3 serial_telemetry.py --loopback build-host/sim_serial --rate 1000
+"""
+
+import argparse
+import json
+import os
+import select
+import struct
+import subprocess
+import sys
+import time
+
+import telemetry_codec
+
+VERSION = 1
+HEADER = struct.Struct("<BHI")
+
+FRAME_TELEMETRY = 0x01
+FRAME_MOTOR = 0x02
+FRAME_EVENT = 0x03
+FRAME_STATS = 0x04
+FRAME_CONTROL = 0x10
+FRAME_NAMES = {FRAME_TELEMETRY: "telemetry", FRAME_MOTOR: "motor", FRAME_EVENT: "event",
+               FRAME_STATS: "stats", FRAME_CONTROL: "control"}
+
+MOTOR_TRIGGERED = 0x01
+MOTOR_AUTO_MODE = 0x02
+
+EVENTS = {1: "decision", 2: "sensor", 3: "tare", 4: "config", 5: "stream", 6: "deadline"}
+DECISIONS = {0: "none", 1: "start", 2: "stop", 3: "emergency_stop"}
+STATS_FIELDS = ("frames_sent", "bytes_sent", "samples_sent", "samples_dropped", "events_dropped")
+
+
+def crc16_modbus(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_pos = 0
+    code = 1
+    for b in data:
+        if b == 0:
+            out[code_pos] = code
+            code_pos = len(out)
+            out.append(0)
+            code = 1
+            continue
+        out.append(b)
+        code += 1
+        if code == 0xFF:
+            out[code_pos] = code
+            code_pos = len(out)
+            out.append(0)
+            code = 1
+    out[code_pos] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    """Decode one frame (without delimiters). Raises ValueError if it is not COBS."""
+    out = bytearray()
+    pos = 0
+    while pos < len(data):
+        code = data[pos]
+        if code == 0:
+            raise ValueError("bad COBS code")
+        block = data[pos + 1:pos + code]
+        if 0 in block or len(block) != code - 1:
+            raise ValueError("bad COBS block")
+        out += block
+        pos += code
+        if code != 0xFF and pos < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def build_frame(ftype, seq, t_ms, payload=b""):
+    body = HEADER.pack(ftype, seq & 0xFFFF, t_ms & 0xFFFFFFFF) + bytes(payload)
+    return body + struct.pack("<H", crc16_modbus(body))
+
+
+def parse_frame(frame):
+    """Split a decoded frame; returns (type, seq, t_ms, payload). Raises ValueError."""
+    if len(frame) < HEADER.size + 2:
+        raise ValueError("frame too short")
+    (crc,) = struct.unpack_from("<H", frame, len(frame) - 2)
+    if crc16_modbus(frame[:-2]) != crc:
+        raise ValueError("CRC mismatch")
+    ftype, seq, t_ms = HEADER.unpack_from(frame)
+    return ftype, seq, t_ms, frame[HEADER.size:-2]
+
+
+def control_frame(start):
+    return b"\x00" + cobs_encode(build_frame(FRAME_CONTROL, 0, 0, bytes([1 if start else 0]))) + b"\x00"
+
+
+def decode_payload(ftype, payload):
+    """Payload of one frame as a dict (TELEMETRY: {"seq", "samples"})."""
+    if ftype == FRAME_TELEMETRY:
+        seq, samples = telemetry_codec.decode(payload)
+        return {"seq": seq, "samples": samples}
+    if ftype == FRAME_MOTOR and len(payload) >= 2:
+        return {"state": telemetry_codec.MOTOR_STATES.get(payload[0], "?"),
+                "triggered": bool(payload[1] & MOTOR_TRIGGERED),
+                "auto_mode": bool(payload[1] & MOTOR_AUTO_MODE)}
+    if ftype == FRAME_EVENT and len(payload) >= 5:
+        code, arg = struct.unpack_from("<Bi", payload)
+        return {"event": EVENTS.get(code, code), "arg": arg,
+                "text": payload[5:].decode("utf-8", errors="replace")}
+    if ftype == FRAME_STATS and len(payload) >= 20:
+        return dict(zip(STATS_FIELDS, struct.unpack_from("<5I", payload)))
+    raise ValueError("bad %s payload" % FRAME_NAMES.get(ftype, "0x%02x" % ftype))
+
+
+class FrameReader:
+    """Splits the byte stream at 0x00. feed() returns a list of
+    ("frame", type, seq, t_ms, payload dict) and ("text", line) items;
+    counts damaged frames and sequence gaps."""
+
+    MAX_CHUNK = 1024
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.frames = 0
+        self.bad_frames = 0
+        self.lost_frames = 0
+        self.next_seq = None
+
+    def feed(self, data):
+        out = []
+        self.buf += data
+        while True:
+            end = self.buf.find(b"\x00")
+            if end < 0:
+                if len(self.buf) > self.MAX_CHUNK:
+                    out += self._text(bytes(self.buf))
+                    self.buf.clear()
+                return out
+            chunk = bytes(self.buf[:end])
+            del self.buf[:end + 1]
+            if chunk:
+                out += self._chunk(chunk)
+
+    def _chunk(self, chunk):
+        try:
+            ftype, seq, t_ms, payload = parse_frame(cobs_decode(chunk))
+            decoded = decode_payload(ftype, payload)
+        except ValueError:
+            # Log text (a frame start 0x00 right after it) or a damaged frame
+            if b"\n" in chunk or chunk.isascii():
+                return self._text(chunk)
+            self.bad_frames += 1
+            return []
+        self.frames += 1
+        if self.next_seq is not None:
+            self.lost_frames += (seq - self.next_seq) & 0xFFFF
+        self.next_seq = (seq + 1) & 0xFFFF
+        return [("frame", ftype, seq, t_ms, decoded)]
+
+    @staticmethod
+    def _text(chunk):
+        lines = chunk.decode("utf-8", errors="replace").splitlines()
+        return [("text", line) for line in lines if line.strip()]
+
+
+class Port:
+    """Serial port: pyserial when it is installed, raw termios otherwise
+    (also what a pty needs)."""
+
+    def __init__(self, path, baud):
+        self.ser = None
+        self.fd = None
+        try:
+            import serial  # pip install pyserial
+        except ImportError:
+            serial = None
+        if serial is not None and not path.startswith("/dev/pts/"):
+            self.ser = serial.Serial(path, baud, timeout=0.1)
+            return
+        import termios
+        import tty
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        speed = getattr(termios, "B%d" % baud, None)
+        if speed is not None:
+            attrs = termios.tcgetattr(self.fd)
+            attrs[4] = attrs[5] = speed
+            termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+
+    def read(self, timeout=0.1):
+        if self.ser is not None:
+            return self.ser.read(max(1, self.ser.in_waiting))
+        ready, _, _ = select.select([self.fd], [], [], timeout)
+        if not ready:
+            return b""
+        try:
+            return os.read(self.fd, 4096)
+        except OSError:
+            return b""              # pty closed by the other end
+
+    def write(self, data):
+        if self.ser is not None:
+            self.ser.write(data)
+        else:
+            os.write(self.fd, data)
+
+    def close(self):
+        if self.ser is not None:
+            self.ser.close()
+        else:
+            os.close(self.fd)
+
+
+class LinkStats:
+    """Per-session counters: frames by type, samples, and samples missing
+    from the sample index (sim_serial puts it in raw)."""
+
+    def __init__(self, track_raw=False):
+        self.by_type = {}
+        self.samples = 0
+        self.bytes = 0
+        self.lost_samples = 0
+        self.device = {}
+        self.track_raw = track_raw
+        self.next_raw = None
+
+    def add(self, ftype, decoded):
+        name = FRAME_NAMES.get(ftype, str(ftype))
+        self.by_type[name] = self.by_type.get(name, 0) + 1
+        if ftype == FRAME_STATS:
+            self.device = decoded
+        elif ftype == FRAME_TELEMETRY:
+            for s in decoded["samples"]:
+                if self.track_raw and self.next_raw is not None and s["raw"] != self.next_raw:
+                    self.lost_samples += s["raw"] - self.next_raw
+                self.next_raw = s["raw"] + 1
+                self.samples += 1
+
+    def summary(self, reader, elapsed):
+        elapsed = max(elapsed, 1e-6)
+        out = {"duration_s": round(elapsed, 2), "frames": reader.frames,
+               "frames_per_s": round(reader.frames / elapsed, 1), "frames_by_type": self.by_type,
+               "samples": self.samples, "samples_per_s": round(self.samples / elapsed, 1),
+               "bytes": self.bytes, "bad_frames": reader.bad_frames,
+               "lost_frames": reader.lost_frames, "device": self.device}
+        if self.track_raw:
+            expected = self.samples + self.lost_samples
+            out["lost_samples"] = self.lost_samples
+            out["loss_rate"] = round(self.lost_samples / expected, 5) if expected else 0.0
+        return out
+
+
+def describe(ftype, seq, t_ms, decoded):
+    head = "[%5d] %9.3f s %-9s" % (seq, t_ms / 1000.0, FRAME_NAMES.get(ftype, "?"))
+    if ftype == FRAME_TELEMETRY:
+        return "\n".join("%s %s" % (head, telemetry_codec.describe(s)) for s in decoded["samples"])
+    if ftype == FRAME_EVENT and decoded["event"] == "decision":
+        decoded = dict(decoded, arg=DECISIONS.get(decoded["arg"], decoded["arg"]))
+    return "%s %s" % (head, json.dumps(decoded))
+
+
+def run(port, args, track_raw=False, until=None):
+    """Read frames until the duration is over (or until() is true); returns
+    the LinkStats summary."""
+    reader = FrameReader()
+    stats = LinkStats(track_raw)
+    out = sys.stdout
+    if args.output:
+        out = open(args.output, "w")
+    if args.csv:
+        out.write("t_ms,weight_kg,raw,motor,auto_mode,stable,sensor_ready\n")
+    port.write(control_frame(True))
+    start = time.monotonic()
+    try:
+        while args.duration <= 0 or time.monotonic() - start < args.duration:
+            if until is not None and until():
+                break
+            data = port.read()
+            stats.bytes += len(data)
+            for item in reader.feed(data):
+                if item[0] == "text":
+                    if args.show_log:
+                        print(item[1], file=sys.stderr)
+                    continue
+                _, ftype, seq, t_ms, decoded = item
+                stats.add(ftype, decoded)
+                if args.json:
+                    continue
+                if args.csv:
+                    if ftype == FRAME_TELEMETRY:
+                        for s in decoded["samples"]:
+                            f = s["flags"]
+                            out.write("%d,%.3f,%d,%s,%d,%d,%d\n" % (
+                                s["t_ms"], s["weight_g"] / 1000.0, s["raw"],
+                                telemetry_codec.MOTOR_STATES.get(f & telemetry_codec.FLAG_MOTOR_MASK, "?"),
+                                1 if f & telemetry_codec.FLAG_AUTO_MODE else 0,
+                                1 if f & telemetry_codec.FLAG_STABLE else 0,
+                                1 if f & telemetry_codec.FLAG_SENSOR_READY else 0))
+                else:
+                    out.write(describe(ftype, seq, t_ms, decoded) + "\n")
+    except KeyboardInterrupt:
+        pass
+    finally:
+        try:
+            port.write(control_frame(False))
+        except OSError:
+            pass
+        if out is not sys.stdout:
+            out.close()
+    return stats.summary(reader, time.monotonic() - start)
+
+
+def loopback(args):
+    """Run sim_serial --pty and decode its stream: the Python decoder against
+    the firmware encoder, with sample loss counted from the sample index."""
+    cmd = [args.loopback, "--pty", "--rate", str(args.rate), "--baud", str(args.baud),
+           "--duration", str(args.duration + 0.5)]
+    proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, text=True)
+    try:
+        line = proc.stdout.readline()
+        if not line:
+            print("❌ %s did not start" % args.loopback, file=sys.stderr)
+            return 1
+        port = Port(json.loads(line)["pty"], args.baud)
+        args.json = True
+        result = run(port, args, track_raw=True, until=lambda: proc.poll() is not None)
+        port.close()
+    finally:
+        proc.kill()
+        proc.wait()
+    print(json.dumps({"serial_py": result}))
+
+    failed = False
+    if result["bad_frames"] or result["lost_frames"]:
+        print("❌ Link errors: %d bad frames, %d lost frames" % (
+            result["bad_frames"], result["lost_frames"]), file=sys.stderr)
+        failed = True
+    if result["samples"] == 0:
+        print("❌ No samples decoded", file=sys.stderr)
+        failed = True
+    if args.max_loss is not None and result["loss_rate"] > args.max_loss:
+        print("❌ Sample loss %.5f above %.5f" % (result["loss_rate"], args.max_loss), file=sys.stderr)
+        failed = True
+    return 1 if failed else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Read binary serial telemetry from the ESP32")
+    parser.add_argument("port", nargs="?", help="Serial port (e.g. /dev/ttyUSB0)")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--csv", action="store_true", help="Samples as CSV")
+    parser.add_argument("-o", "--output", help="Output file (default stdout)")
+    parser.add_argument("--show-log", action="store_true", help="Print ESP_LOG lines to stderr")
+    parser.add_argument("--duration", type=float, default=0, help="Stop after S seconds")
+    parser.add_argument("--json", action="store_true", help="Print only a link summary at the end")
+    parser.add_argument("--loopback", metavar="SIM_SERIAL", help="Decode the host simulation instead")
+    parser.add_argument("--rate", type=float, default=1000, help="--loopback: samples per second")
+    parser.add_argument("--max-loss", type=float, help="--loopback: fail above this sample loss")
+    args = parser.parse_args()
+
+    if args.loopback:
+        if args.duration <= 0:
+            args.duration = 3
+        return loopback(args)
+    if args.port is None:
+        parser.error("give the serial port or --loopback")
+
+    port = Port(args.port, args.baud)
+    try:
+        result = run(port, args)
+    finally:
+        port.close()
+    if args.json:
+        print(json.dumps(result))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
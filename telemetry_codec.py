@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+"""
+Binary telemetry codec - Python side of main/telemetry_codec.h (version 1).
+
+Frame layout (little-endian):
+    'E' 'T' | version u8 | count u8 | seq u16 | base_t_ms u32 | samples...
+    sample:  varint dt_ms | zigzag-varint d_weight_g | zigzag-varint d_raw | flags u8
+
+Usage:
+    python3 telemetry_codec.py 192.168.1.50            # one binary /api/status sample
+    python3 telemetry_codec.py 192.168.1.50 --watch    # poll every second
+    python3 telemetry_codec.py 192.168.1.50 --ws       # stream /ws (needs websocket-client)
+"""
+
+import argparse
+import struct
+import sys
+import time
+import urllib.request
+
+MAGIC = b"ET"
+VERSION = 1
+HEADER = struct.Struct("<2sBBHI")
+MIME_TYPE = "application/x-elevator-telemetry"
+WS_SUBPROTOCOL = "elevator.bin.v1"
+
+FLAG_MOTOR_MASK = 0x03
+FLAG_AUTO_MODE = 0x04
+FLAG_STABLE = 0x08
+FLAG_SENSOR_READY = 0x10
+MOTOR_STATES = {0: "stopped", 1: "forward", 2: "backward"}
+
+
+def _put_varint(out, v):
+    while v >= 0x80:
+        out.append((v & 0x7F) | 0x80)
+        v >>= 7
+    out.append(v)
+
+
+def _get_varint(buf, pos):
+    v = 0
+    shift = 0
+    while True:
+        if pos >= len(buf) or shift > 28:
+            raise ValueError("truncated varint")
+        b = buf[pos]
+        pos += 1
+        v |= (b & 0x7F) << shift
+        if not b & 0x80:
+            return v, pos
+        shift += 7
+
+
+def _zigzag(v):
+    return ((v << 1) ^ (v >> 31)) & 0xFFFFFFFF
+
+
+def _unzigzag(v):
+    return (v >> 1) ^ -(v & 1)
+
+
+def _wrap_i32(v):
+    return ((v + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+
+
+def encode(samples, seq=0, base_t_ms=None):
+    """Encode a list of sample dicts (t_ms, weight_g, raw, flags) into one frame."""
+    if base_t_ms is None:
+        base_t_ms = samples[0]["t_ms"] if samples else 0
+    out = bytearray(HEADER.pack(MAGIC, VERSION, len(samples), seq & 0xFFFF, base_t_ms & 0xFFFFFFFF))
+    last_t, last_w, last_r = base_t_ms, 0, 0
+    for s in samples:
+        _put_varint(out, (s["t_ms"] - last_t) & 0xFFFFFFFF)
+        _put_varint(out, _zigzag(_wrap_i32(s["weight_g"] - last_w)))
+        _put_varint(out, _zigzag(_wrap_i32(s["raw"] - last_r)))
+        out.append(s["flags"] & 0xFF)
+        last_t, last_w, last_r = s["t_ms"], s["weight_g"], s["raw"]
+    return bytes(out)
+
+
+def decode(buf):
+    """Decode one frame; returns (seq, [sample dicts]). Raises ValueError if malformed."""
+    if len(buf) < HEADER.size:
+        raise ValueError("frame too short")
+    magic, version, count, seq, t = HEADER.unpack_from(buf)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("not a v%d telemetry frame" % VERSION)
+    pos = HEADER.size
+    w = r = 0
+    samples = []
+    for _ in range(count):
+        dt, pos = _get_varint(buf, pos)
+        dw, pos = _get_varint(buf, pos)
+        dr, pos = _get_varint(buf, pos)
+        if pos >= len(buf):
+            raise ValueError("truncated sample")
+        flags = buf[pos]
+        pos += 1
+        t = (t + dt) & 0xFFFFFFFF
+        w = _wrap_i32(w + _unzigzag(dw))
+        r = _wrap_i32(r + _unzigzag(dr))
+        samples.append({"t_ms": t, "weight_g": w, "raw": r, "flags": flags})
+    return seq, samples
+
+
+def describe(sample):
+    f = sample["flags"]
+    return ("t=%9.3f s  weight=%8.3f kg  raw=%9d  motor=%-8s auto=%s stable=%s sensor=%s" % (
+        sample["t_ms"] / 1000.0, sample["weight_g"] / 1000.0, sample["raw"],
+        MOTOR_STATES.get(f & FLAG_MOTOR_MASK, "?"),
+        "on" if f & FLAG_AUTO_MODE else "off",
+        "yes" if f & FLAG_STABLE else "no",
+        "ready" if f & FLAG_SENSOR_READY else "not ready"))
+
+
+def fetch_status(host):
+    req = urllib.request.Request("http://%s/api/status" % host, headers={"Accept": MIME_TYPE})
+    with urllib.request.urlopen(req, timeout=5) as resp:
+        return resp.read()
+
+
+def stream_ws(host):
+    try:
+        import websocket  # pip install websocket-client
+    except ImportError:
+        print("❌ --ws needs the websocket-client package (pip install websocket-client)")
+        return 1
+    ws = websocket.create_connection("ws://%s/ws" % host, subprotocols=[WS_SUBPROTOCOL])
+    try:
+        while True:
+            data = ws.recv()
+            if isinstance(data, bytes):
+                seq, samples = decode(data)
+                for s in samples:
+                    print("[%5d] %s" % (seq, describe(s)))
+    except KeyboardInterrupt:
+        pass
+    finally:
+        ws.close()
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Read binary telemetry from the ESP32")
+    parser.add_argument("host", help="ESP32 IP address")
+    parser.add_argument("--watch", action="store_true", help="Poll /api/status every second")
+    parser.add_argument("--ws", action="store_true", help="Stream samples from /ws")
+    args = parser.parse_args()
+
+    if args.ws:
+        return stream_ws(args.host)
+
+    try:
+        while True:
+            frame = fetch_status(args.host)
+            seq, samples = decode(frame)
+            for s in samples:
+                print("[%5d] %s  (%d bytes)" % (seq, describe(s), len(frame)))
+            if not args.watch:
+                break
+            time.sleep(1)
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())